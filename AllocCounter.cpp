@@ -0,0 +1,107 @@
+#include "AllocCounter.h"
+
+#include <atomic>
+#include <cerrno>
+#include <cstdlib>
+
+#if defined(__GLIBC__) && defined(ALLOC_COUNTER)  // 只在 qmake CONFIG+=alloc_counter 时替换分配函数
+#define ALLOC_COUNTER_ENABLED 1
+#endif
+
+#if ALLOC_COUNTER_ENABLED
+
+extern "C" {
+void* __libc_malloc(size_t size);
+void* __libc_calloc(size_t num, size_t size);
+void* __libc_realloc(void* ptr, size_t size);
+void* __libc_memalign(size_t alignment, size_t size);
+}
+
+namespace {
+
+std::atomic<quint64> g_alloc_count{0};  // 常量初始化，在任何分配之前就已经可用
+
+inline void countAlloc()
+{
+    g_alloc_count.fetch_add(1, std::memory_order_relaxed);
+}
+
+} // namespace
+
+extern "C" {
+
+void* malloc(size_t size) noexcept
+{
+    countAlloc();
+    return __libc_malloc(size);
+}
+
+void* calloc(size_t num, size_t size) noexcept
+{
+    countAlloc();
+    return __libc_calloc(num, size);
+}
+
+void* realloc(void* ptr, size_t size) noexcept
+{
+    countAlloc();
+    return __libc_realloc(ptr, size);
+}
+
+void* memalign(size_t alignment, size_t size) noexcept
+{
+    countAlloc();
+    return __libc_memalign(alignment, size);
+}
+
+void* aligned_alloc(size_t alignment, size_t size) noexcept
+{
+    countAlloc();
+    return __libc_memalign(alignment, size);
+}
+
+int posix_memalign(void** memptr, size_t alignment, size_t size) noexcept
+{
+    if (0 == alignment || 0 != (alignment & (alignment - 1)) || 0 != alignment % sizeof(void*))
+    {
+        return EINVAL;
+    }
+    countAlloc();
+    void* ptr = __libc_memalign(alignment, size);
+    if (nullptr == ptr)
+    {
+        return ENOMEM;
+    }
+    *memptr = ptr;
+    return 0;
+}
+
+} // extern "C"
+
+#endif
+
+/**
+ * @brief AllocCounter::isSupported 当前平台是否支持统计堆分配次数
+ * @return
+ */
+bool AllocCounter::isSupported()
+{
+#if ALLOC_COUNTER_ENABLED
+    return true;
+#else
+    return false;
+#endif
+}
+
+/**
+ * @brief AllocCounter::count 进程启动以来堆分配的总次数（不支持时总是返回 0）
+ * @return
+ */
+quint64 AllocCounter::count()
+{
+#if ALLOC_COUNTER_ENABLED
+    return g_alloc_count.load(std::memory_order_relaxed);
+#else
+    return 0;
+#endif
+}
@@ -0,0 +1,19 @@
+#ifndef ALLOCCOUNTER_H
+#define ALLOCCOUNTER_H
+
+#include <QtGlobal>
+
+/**
+ * @brief 进程内堆内存分配次数的计数器，用于统计分块和恢复循环中平均每个块的堆分配次数。
+ *  glibc 下替换 malloc / calloc / realloc / memalign 系列函数（计数后转发给 glibc 的实现），
+ *  new、QByteArray 等所有的堆分配都会经过这些函数。统计的是整个进程（所有线程）的分配次数。
+ *  替换分配函数会给每次分配增加一次原子操作，所以默认不启用：只有命令行版本以 qmake CONFIG+=alloc_counter
+ *  构建时才定义 ALLOC_COUNTER 并统计；没有启用和其他平台不支持（结果中每个块的分配次数为 -1）
+ */
+struct AllocCounter
+{
+    static bool isSupported();
+    static quint64 count();
+};
+
+#endif // ALLOCCOUNTER_H
@@ -4,28 +4,101 @@
 #include <QThread>
 #include <QTimer>
 #include <QElapsedTimer>
-
+#include <QFileInfo>
+#include <QDir>
+#include <QSet>
+#include <QSemaphore>
+#include <QtEndian>
+
+#include "HashIndex.h"
+#include "HashPipeline.h"
+#include "Chunker.h"
+#include "RecoverEngine.h"
+#include "SourceFileCache.h"
 #include "InputFile.h"
+#include "OutputFile.h"
+#include "HashMultiBuffer.h"
+#include "BlockBufferPool.h"
+#include "AllocCounter.h"
+#include "IoEngine.h"
+#include "AsyncFileReader.h"
+#include "ResultWriter.h"
+#include "SqliteIndex.h"
+#include "HashFileIndex.h"
+#include "Log.h"
 #include "ThemeStyle.h"
 
+#include <algorithm>
+#include <numeric>
+
+#define RECOVER_MAX_READ_SIZE   (8 * 1024 * 1024)   // 排序恢复时一次合并读取的最大字节数
+#define SEG_HASH_WINDOW_BLOCKS  1024                // 串行分块时每次读取并批量计算哈希的最大块数
+#define SEG_HASH_WINDOW_BYTES   (4 * 1024 * 1024)   // ↑ 的最大字节数
+
+/**
+ * @brief alignDirect 把长度向上对齐到直接 I/O 的对齐长度
+ * @param len 长度（Byte）
+ * @return
+ */
+static qint64 alignDirect(const qint64 len)
+{
+    return (len + DIRECT_IO_ALIGNMENT - 1) / DIRECT_IO_ALIGNMENT * DIRECT_IO_ALIGNMENT;
+}
+
+/**
+ * @brief lapNsecs 分段计时：返回从 mark 到现在的耗时，并把 mark 移动到现在（相邻的阶段共用一次时钟读取）
+ * @param timer 时钟（任务的计时器）
+ * @param mark [输入/输出] 上一个阶段结束的时刻（ns）
+ * @return 耗时（ns）
+ */
+static qint64 lapNsecs(const QElapsedTimer& timer, qint64& mark)
+{
+    const qint64 now = timer.nsecsElapsed();
+    const qint64 nsecs = now - mark;
+    mark = now;
+    return nsecs;
+}
+
+/**
+ * @brief averageInFlight 读、写两个 I/O 引擎按请求数加权的平均队列深度
+ * @param read_io 读取的引擎（可以为 nullptr）
+ * @param write_io 写入的引擎（可以为 nullptr）
+ * @return
+ */
+static double averageInFlight(const IoEngine* read_io, const IoEngine* write_io)
+{
+    qint64 requests = 0;
+    double sum = 0.0;
+    for (const IoEngine* io : {read_io, write_io})
+    {
+        if (io)
+        {
+            requests += io->requests();
+            sum += io->avgInFlight() * io->requests();
+        }
+    }
+    return 0 == requests ? 0.0 : sum / requests;
+}
+
 /**
  * 注意：这个类中所有的方法都是准备放置在子线程中执行的，内部包含了耗时的复杂计算任务
  */
 AsyncComputeModule::AsyncComputeModule(QObject *parent)
     : QObject{parent}
 {
-    _dbs = new DatabaseService(this);
+    _dbs    = new DatabaseService(this);
+    _sqlite = new SqliteIndex();
+    _hashfile = new HashFileIndex();
+    _index  = _dbs;
 
     emit signalWriteSuccLog(QString("[Thread %1] init successed").arg(getCurrentThreadID()));
 }
 
 AsyncComputeModule::~AsyncComputeModule()
 {
-    if (_dbs->isDatabaseOpen())
-    {
-        _dbs->disconnectCurDatabase();
-    }
-    delete _dbs;
+    delete _dbs;  // 析构时断开数据库（这里可能不在连接数据库的线程中，不能通过 isDatabaseOpen 从连接池获得连接）
+    delete _sqlite;
+    delete _hashfile;
 
     emit signalAllJobFinished();
 }
@@ -66,9 +139,7 @@ void AsyncComputeModule::disconnectCurrentDatabase()
 {
     bool is_succ = _dbs->disconnectCurDatabase();
     _last_log = QString("[Thread %1] %2").arg(getCurrentThreadID(), _dbs->lastLog());
-#if !QT_NO_DEBUG
-    qDebug() << _last_log;
-#endif
+    LOG_DEBUG(_last_log);
     if (!is_succ)
     {
         emit signalWriteErrorLog(_last_log);
@@ -82,9 +153,7 @@ void AsyncComputeModule::dropCurrentDatabase()
 {
     bool is_succ = _dbs->dropCurDatabase();
     _last_log = QString("[Thread %1] %2").arg(getCurrentThreadID(), _dbs->lastLog());
-#if !QT_NO_DEBUG
-    qDebug() << _last_log;
-#endif
+    LOG_DEBUG(_last_log);
     if (!is_succ)
     {
         emit signalWriteErrorLog(_last_log);
@@ -99,18 +168,34 @@ void AsyncComputeModule::dropCurrentDatabase()
  */
 void AsyncComputeModule::finishAllJob(const bool drop_db)
 {
-    if (drop_db)
+    if (_dbs->isDatabaseOpen())
+    {
+        if (drop_db)
+        {
+            dropCurrentDatabase();
+        }
+        disconnectCurrentDatabase();
+    }
+    if (!_sqlite->filePath().isEmpty())  // 删除数据库时同样删除 SQLite 数据库文件
     {
-        dropCurrentDatabase();
-        qDebug() << _last_log;
+        if (drop_db && _sqlite->removeDatabaseFile())
+        {
+            emit signalWriteSuccLog(QString("[Thread %1] %2").arg(getCurrentThreadID(), _sqlite->lastLog()));
+        }
+        _sqlite->close();
+    }
+    if (!_hashfile->dirPath().isEmpty())  // 删除数据库时同样删除哈希表文件（关闭时同步所有的表）
+    {
+        if (drop_db && _hashfile->removeIndexFiles())
+        {
+            emit signalWriteSuccLog(QString("[Thread %1] %2").arg(getCurrentThreadID(), _hashfile->lastLog()));
+        }
+        _hashfile->close();
     }
-    disconnectCurrentDatabase();
     emit signalAllJobFinished();
 
     _last_log = "Send signal AsyncComputeModule::signalAllJobFinished()";
-#if !QT_NO_DEBUG
-    qDebug() << _last_log;
-#endif
+    LOG_DEBUG(_last_log);
     return;
 }
 
@@ -130,10 +215,10 @@ void AsyncComputeModule::runTestSegmentationProfmance(const QString& source_file
     /* 为了避免意外操作，暂时禁用按钮 */
     emit signalSetActivityWidget(false);
 
-    /* 数据库无连接 */
-    if (!_dbs->isDatabaseOpen())
+    /* 打开去重索引（PostgreSQL 需要已经连接数据库） */
+    if (!openDedupIndex(block_hash_file_path))
     {
-        _last_log = QString("[Thread %1] Database do not connected, test exit").arg(getCurrentThreadID());
+        _last_log = QString("[Thread %1] %2, test exit").arg(getCurrentThreadID(), _index->lastLog());
         emit signalWriteErrorLog(_last_log);
         emit signalWarnBox(_last_log);
 
@@ -143,7 +228,7 @@ void AsyncComputeModule::runTestSegmentationProfmance(const QString& source_file
     }
 
     /* 打开源文件（输入） */
-    InputFile* fin = new InputFile(this, source_file_path);
+    InputFile* fin = new InputFile(this, source_file_path, _run_options.inputMode, _run_options.directIo);
     bool is_succ = fin->isOpen();
     _last_log = QString("[Thread %1] %2").arg(getCurrentThreadID(), fin->lastLog());
     if (!is_succ)
@@ -158,23 +243,19 @@ void AsyncComputeModule::runTestSegmentationProfmance(const QString& source_file
     emit signalWriteSuccLog(_last_log);
 
     /* 创建 Unique-Block file 唯一块文件（输出） */
-    QFile uniqueBlockFile(unqiue_block_file_path);
-    QFileInfo uniqueBlockInfo;
-    QDataStream uout;  // unique block out
-    if (uniqueBlockFile.open(QIODevice::WriteOnly))
+    OutputFile* uout = new OutputFile(this, unqiue_block_file_path, _run_options.outputMode,
+                                      _run_options.getOutputBufferSize(), _run_options.outputWritev, _run_options.directIo);  // unique block out
+    if (uout->isOpen())
     {
-        uout.setDevice(&uniqueBlockFile);
-        uout.setVersion(QDataStream::Qt_DefaultCompiledVersion);  // 设置流的版本（可以根据实际情况设置，通常用于处理跨版本兼容性）
-        uniqueBlockInfo.setFile(uniqueBlockFile);
-
-        _last_log = QString("[Thread %1] Successed create Unique-Block file %2").arg(getCurrentThreadID(), uniqueBlockInfo.filePath());
+        _last_log = QString("[Thread %1] Successed create Unique-Block file %2").arg(getCurrentThreadID(), uout->filePath());
         emit signalWriteSuccLog(_last_log);
     }
     else
     {
-        _last_log = QString("[Thread %1] Can not create Unique-Block file %2").arg(getCurrentThreadID(), uniqueBlockInfo.filePath());
+        _last_log = QString("[Thread %1] Can not create Unique-Block file %2").arg(getCurrentThreadID(), uout->filePath());
         emit signalWriteErrorLog(_last_log);
         emit signalErrorBox(_last_log);
+        delete uout;
 
         emit signalSetActivityWidget(true);
         emit signalTestSegmentationPerformanceFinished(false);
@@ -182,23 +263,20 @@ void AsyncComputeModule::runTestSegmentationProfmance(const QString& source_file
     }
 
     /* 创建 Block-Hash file 块哈希文件（输出） */
-    QFile blockHashFile(block_hash_file_path);
-    QFileInfo blockHashInfo;
-    QDataStream hout;
-    if (blockHashFile.open(QIODevice::WriteOnly))
+    OutputFile* hout = new OutputFile(this, block_hash_file_path, _run_options.outputMode,
+                                      _run_options.getOutputBufferSize(), _run_options.outputWritev, _run_options.directIo);  // hash out
+    if (hout->isOpen())
     {
-        hout.setDevice(&blockHashFile);
-        hout.setVersion(QDataStream::Qt_DefaultCompiledVersion);  // hout - hash out 设置流的版本（可以根据实际情况设置，通常用于处理跨版本兼容性）
-        blockHashInfo.setFile(blockHashFile);
-
-        _last_log = QString("[Thread %1] Successed create Block-Hash file %2").arg(getCurrentThreadID(), blockHashInfo.filePath());
+        _last_log = QString("[Thread %1] Successed create Block-Hash file %2").arg(getCurrentThreadID(), hout->filePath());
         emit signalWriteSuccLog(_last_log);
     }
     else
     {
-        _last_log = QString("[Thread %1] Can not create Block-Hash file %2").arg(getCurrentThreadID(), blockHashInfo.filePath());
+        _last_log = QString("[Thread %1] Can not create Block-Hash file %2").arg(getCurrentThreadID(), hout->filePath());
         emit signalWriteErrorLog(_last_log);
         emit signalErrorBox(_last_log);
+        delete hout;
+        delete uout;
 
         emit signalSetActivityWidget(true);
         emit signalTestSegmentationPerformanceFinished(false);
@@ -207,22 +285,28 @@ void AsyncComputeModule::runTestSegmentationProfmance(const QString& source_file
 
 
     /* 创建表 */
+    _index->setSchemaVersion(_run_options.schemaVersion);
+    _index->setPartitionCount(_run_options.tablePartitions);
+    _index->setPoolSize(_run_options.dbConnections);
+    _index->resetConnectionStats();
     QString tb = getTableName(block_size, alg);  // 根据算法和块大小自动创建表名
-    bool is_exists = _dbs->isTableExists(tb);
+    bool is_exists = _index->isTableExists(tb);
     if (is_exists)
     {
-        emit signalWriteWarningLog(QString("[Thread %1] %2").arg(getCurrentThreadID(), _dbs->lastLog()));
+        emit signalWriteWarningLog(QString("[Thread %1] %2").arg(getCurrentThreadID(), _index->lastLog()));
     }
     else
     {
         emit signalWriteInfoLog(QString("[Thread %1] Create table `%2`").arg(getCurrentThreadID(), tb));
-        is_succ = _dbs->createBlockInfoTable(tb);
-        emit signalWriteInfoLog(QString("[Thread %1] Run SQL `%2`").arg(getCurrentThreadID(), _dbs->lastSQL()));
-        _last_log = QString("[Thread %1] %2").arg(getCurrentThreadID(), _dbs->lastLog());
+        is_succ = _index->createBlockInfoTable(tb, Hash::getHashSize(alg));
+        emit signalWriteInfoLog(QString("[Thread %1] Run SQL `%2`").arg(getCurrentThreadID(), _index->lastSQL()));
+        _last_log = QString("[Thread %1] %2").arg(getCurrentThreadID(), _index->lastLog());
         if (!is_succ)
         {
             emit signalWriteErrorLog(_last_log);
             emit signalErrorBox(_last_log);
+            delete hout;
+            delete uout;
 
             emit signalSetActivityWidget(true);
             emit signalTestSegmentationPerformanceFinished(false);
@@ -238,95 +322,278 @@ void AsyncComputeModule::runTestSegmentationProfmance(const QString& source_file
                                     "Block-Hash File: %5<br>"
                                     "Table: %6<br>"
                                     "with Hash-Alg: %7, Segmentation-Block-Size: %8 Bytes").arg(getCurrentThreadID(), fin->filePath(), QString::number(fin->fileSize()),
-                                     uniqueBlockInfo.filePath(),
-                                     blockHashInfo.filePath(),
+                                     uout->filePath(),
+                                     hout->filePath(),
                                      tb, Hash::getHashName(alg), QString::number(block_size)));
     emit signalSetLbRuningJobInfo(QString("Job: Test segmentation profmance | Hash alg: %1 | Block size: %2 | DB-Table: %3").arg(Hash::getHashName(alg), QString::number(block_size), tb));
-    emit signalSetProgressBarRange(0, fin->fileSize());
-    emit signalSetProgressBarValue(0);
     emit signalSetLbSegmentationStyle(ThemeStyle::LABLE_ORANGE);
     emit signalSetLbRecoverStyle(ThemeStyle::LABLE_RED);
 
     /**
      * 开始读取 -> 计算哈希 -> 写入
      */
-    QByteArray buf_block;       // 读取的源文件的 buffer（用来暂存当前块）
-    qint64 ptr_source_loc = 0;  // 读取指针目前所处源文件的位置
-    qint64 ptr_unique_loc = 0;  // 指针目前所处 Unique-Block file 的位置
-    size_t cur_block_size = 0;  // 本次读取块的大小（因为文件末尾最后块的大小有可能不是块大小的整数倍）
-    QByteArray buf_hash;        // 存储当前块的哈希值
-    size_t repeat_times = 0;    // 当前块的重复次数
-    size_t total_repeat_times = 0;  // 所有哈希值/块的重复次数
-    size_t total_hash_records = 0; // 当前数据表中的哈希记录条数
-    const size_t file_blocks = (fin->fileSize() + block_size - 1) / block_size; // 文件一共会被分多少块由于可能除不尽，这里使用简单的向上取整算法
-    emit signalSetLcdTotalFileBlocks(file_blocks);
+    SegContext ctx;
+    ctx.fin         = fin;
+    ctx.uout        = uout;
+    ctx.hout        = hout;
+    ctx.tb          = tb;
+    ctx.uniquePath  = uout->filePath();
+    ctx.alg         = alg;
+    ctx.blockSize   = block_size;
+    ctx.fileBlocks  = (fin->fileSize() + block_size - 1) / block_size; // 文件一共会被分多少块由于可能除不尽，这里使用简单的向上取整算法
+    _progress.beginSegmentation(fin->fileSize(), ctx.fileBlocks);  // ui 定时读取进度
+
+    /* 基于内容分块（块的数量只能在分块结束后确定，之前按平均块大小估计） */
+    Chunker* chunker = nullptr;
+    if (ChunkMode::CHUNK_CDC == _run_options.chunkMode)
+    {
+        chunker = new Chunker(fin, _run_options.getCdcMinSize(block_size), block_size, _run_options.getCdcMaxSize(block_size));
+        ctx.chunker = chunker;
+        emit signalWriteInfoLog(QString("[Thread %1] Content-defined chunking (FastCDC): min %2, avg %3, max %4 Bytes").arg(
+            getCurrentThreadID(), QString::number(chunker->minSize()), QString::number(chunker->avgSize()), QString::number(chunker->maxSize())));
+    }
 
+    /* COPY 模式只适用于首次导入（空表），否则退化为分批模式 */
+    SegMode seg_mode = _run_options.segMode;
+    if (SegMode::SEG_COPY == seg_mode && _index->getTableRowCount(tb) != 0)
+    {
+        seg_mode = SegMode::SEG_BATCH;
+        emit signalWriteWarningLog(QString("[Thread %1] Table `%2` is not empty, COPY mode falls back to BATCH mode").arg(getCurrentThreadID(), tb));
+    }
 
     /* 计算耗时 */
-    QElapsedTimer elapsed_time;
-    elapsed_time.start();
+    ctx.elapsedTime.start();
 
-    while (!fin->atEnd())
+    /* 进程内哈希索引（COPY 模式总是需要在内存中去重） */
+    HashIndex* index = nullptr;
+    if (_run_options.useHashIndex || SegMode::SEG_COPY == seg_mode)
     {
-        buf_block = fin->read(block_size);
-        cur_block_size = buf_block.size();       // 计算当前读取的字节数，防止越界
-        buf_hash = Hash::getDataHash(buf_block, alg);  // 计算哈希（非性能瓶颈）
+        index = new HashIndex(Hash::getHashSize(alg));
+        const int row_count = _index->getTableRowCount(tb);
+        if (0 == row_count)
+        {
+            ctx.indexComplete = true;  // 空表：索引天然包含了表中所有的哈希
+        }
+        else if (_run_options.preloadHashIndex && row_count > 0)
+        {
+            index->reserve(row_count);
+            ctx.indexComplete = _index->forEachHashCounter(tb, [index](const QByteArray& hash, const int counter) {
+                index->insert(hash)->counter = counter;
+            });
+            index->resetStats();
+            emit signalWriteInfoLog(QString("[Thread %1] Preload hash index: %2").arg(getCurrentThreadID(), _index->lastLog()));
+        }
+        ctx.index = index;
+    }
+
+    /* 多线程哈希流水线（读取 -> 并行计算哈希 -> 按顺序提交） */
+    HashPipeline* pipeline = nullptr;
+    if (_run_options.hashThreads > 0)
+    {
+        pipeline = new HashPipeline(fin, block_size, alg, _run_options.hashThreads, 0, chunker);
+        pipeline->start();
+        ctx.pipeline = pipeline;
+        emit signalWriteInfoLog(QString("[Thread %1] Hash pipeline started with %2 hash threads").arg(getCurrentThreadID(), QString::number(pipeline->numWorkers())));
+    }
 
-        /* 写入数据库 */
-        repeat_times = _dbs->getHashRepeatTimes(tb, buf_hash);
+    /* 串行读取时每次读取一个窗口的块并批量计算哈希；分批模式下窗口不小于一批，保证一批中的块最多跨越两个窗口 */
+    BlockBufferPool* block_pool  = nullptr;
+    BlockBufferPool* digest_pool = nullptr;
+    if (!pipeline)
+    {
+        ctx.windowCapacity = qBound<qsizetype>(1, SEG_HASH_WINDOW_BYTES / block_size, SEG_HASH_WINDOW_BLOCKS);
+        if (SegMode::SEG_BATCH == seg_mode)
+        {
+            ctx.windowCapacity = qMax<qsizetype>(ctx.windowCapacity, _run_options.batchSize);
+        }
 
-#if !QT_NO_DEBUG
-        qDebug() << _dbs->lastLog();
-#endif
+        /* 缓冲区池：两个帧轮流使用，当前窗口的块和哈希都是帧的视图 */
+        if (_run_options.useBufferPool)
+        {
+            digest_pool = new BlockBufferPool(ctx.windowCapacity * Hash::getHashSize(alg), 2);
+            ctx.digestPool = digest_pool;
+            if (!chunker && !fin->isMapped())  // 内存映射和基于内容分块时块本身已经是视图或者由分块器读取
+            {
+                block_pool = new BlockBufferPool(ctx.windowCapacity * block_size, 2);
+                ctx.blockPool = block_pool;
+            }
+        }
+    }
 
-        if (0 == repeat_times)  // 重复次数为 0 说明没有记录过当前哈希
+    /* io_uring：固定大小分块、普通读取、串行计算哈希时源文件按顺序预读（同时保持 queue depth 个请求），
+     * 聚合写入的输出文件每次写入拆分为多个请求同时进行。读、写使用各自的引擎，互不等待对方的请求 */
+    IoEngine*        read_io  = nullptr;
+    IoEngine*        write_io = nullptr;
+    AsyncFileReader* reader   = nullptr;
+    if (IoEngineMode::IO_ENGINE_URING == _run_options.ioEngine)
+    {
+        write_io = new IoEngine(_run_options.ioEngine, _run_options.queueDepth);
+        uout->setIoEngine(write_io);
+        hout->setIoEngine(write_io);
+        if (!pipeline && !chunker && !fin->isMapped())
         {
-            ++total_hash_records;
-            uout.writeRawData(buf_block, cur_block_size);  // 写入不带有数据头的数据
-            _dbs->insertNewBlockInfoRow(tb, buf_hash, uniqueBlockInfo.filePath(), ptr_unique_loc, cur_block_size);
-            ptr_unique_loc += cur_block_size;
+            if (!block_pool)  // 预读的数据总是复制到帧中
+            {
+                block_pool = new BlockBufferPool(ctx.windowCapacity * block_size, 2);
+                ctx.blockPool = block_pool;
+            }
+            read_io = new IoEngine(_run_options.ioEngine, _run_options.queueDepth);
+            reader = new AsyncFileReader(read_io, fin->handle(), fin->fileSize());
+            ctx.reader = reader;
         }
         else
         {
-            ++total_repeat_times;
-            _dbs->updateCounter(tb, buf_hash, (repeat_times + 1));
+            emit signalWriteWarningLog(QString("[Thread %1] io_uring reads only apply to fixed-size, non-mapped, single-threaded segmentation, "
+                                               "source file is read synchronously").arg(getCurrentThreadID()));
         }
-
-#if !QT_NO_DEBUG
-        qDebug() << _dbs->lastLog();
-        qDebug() << QString("↳ Read: %1, Hash: %2, Pointer location: %3, Repet times: %4").arg(
-            buf_block.toHex(), buf_hash.toHex(), QString::number(ptr_source_loc), QString::number(repeat_times));  // 输出读取的内容（十六进制格式显示）
-        qDebug() << "---------------------------------";
-#endif
-
-        // out << buf_hash;           // 记录哈希到文件【注意】通过 `<<` QDataStream 写入时，QDataStream 会在字符串的前面写入一个4字节的长度字段，表示接下来数据的长度
-        hout.writeRawData(buf_hash, buf_hash.size());
-        ptr_source_loc += cur_block_size; // 移动指针位置
-
-        /* 刷新 ui */
-        if (0 == ptr_source_loc % 16 || fin->atEnd())
+        emit signalWriteInfoLog(QString("[Thread %1] I/O engine: %2").arg(getCurrentThreadID(), write_io->name()));
+        if (!write_io->isUring())
         {
-            emit signalSetProgressBarValue(ptr_source_loc);
-            emit signalSetLcdTotalDbHashRecords(total_hash_records);
-            emit signalSetLcdTotalRepeat(total_repeat_times);
-            emit signalSetLcdRepeatPercent((double)total_repeat_times/file_blocks*100);
-            emit signalSetLcdSegmentationTime((double)(elapsed_time.elapsed() / 1000.0));
+            emit signalWriteWarningLog(QString("[Thread %1] %2").arg(getCurrentThreadID(), write_io->lastLog()));
         }
     }
+
+    const quint64 allocs_begin = AllocCounter::count();
+    const qint64 syscw_begin = OutputFile::processWriteSyscalls();
+    switch (seg_mode) {
+    case SegMode::SEG_BATCH:
+        is_succ = segmentBatched(ctx);
+        break;
+
+    case SegMode::SEG_COPY:
+        is_succ = segmentCopy(ctx);
+        break;
+
+    case SegMode::SEG_ROW:
+    default:
+        is_succ = segmentRowByRow(ctx);
+        break;
+    }
+    const quint64 allocs_end = AllocCounter::count();
+    if (pipeline)
+    {
+        pipeline->stop();  // 停止并等待流水线中的所有线程退出
+        ctx.hashNsecs   += pipeline->hashNsecs();
+        ctx.bytesHashed += pipeline->bytesHashed();
+        ctx.phases[PHASE_HASH].merge(pipeline->hashLatency());
+        delete pipeline;
+    }
+    qint64 mark = ctx.elapsedTime.nsecsElapsed();
+    uout->close();  // 写入暂存缓冲区中剩下的数据（计入分块耗时）
+    ctx.phases[PHASE_FILE_WRITE].record(lapNsecs(ctx.elapsedTime, mark));
+    hout->close();
+    ctx.phases[PHASE_FILE_WRITE].record(lapNsecs(ctx.elapsedTime, mark));
+    const qint64 syscw_end = OutputFile::processWriteSyscalls();
+    if (reader && reader->hasError())
+    {
+        emit signalWriteErrorLog(QString("[Thread %1] %2").arg(getCurrentThreadID(), reader->lastLog()));
+    }
+    delete reader;  // 等待还在进行的预读请求
+    ctx.windowBlocks.clear();  // 视图在缓冲区池释放之前清除
+    ctx.windowHashes.clear();
+    delete block_pool;
+    delete digest_pool;
+    if (chunker)
+    {
+        delete chunker;
+        ctx.fileBlocks = ctx.blocksRead;  // 实际的块数
+        _progress.fileBlocks.store(ctx.fileBlocks, std::memory_order_relaxed);
+    }
+    updateSegmentationProgress(ctx);  // 最终的进度（包括写入剩下的数据的时间）
+    addIngestPoint(ctx, ctx.elapsedTime.nsecsElapsed());  // 曲线的最后一个点（最后一次翻倍之后写入的行）
+
     _cur_result_comput                = ResultComput();
     _cur_result_comput.sourceFilePath = fin->filePath();
     _cur_result_comput.hashAlg        = alg;
     _cur_result_comput.blockSize      = block_size;
-    _cur_result_comput.totalBlock     = file_blocks;
-    _cur_result_comput.hashRecordDB   = total_hash_records;
-    _cur_result_comput.repeatRecord   = total_repeat_times;
-    _cur_result_comput.repeatRate     = (double)total_repeat_times/file_blocks*100;
-    _cur_result_comput.segTime        = (double)(elapsed_time.elapsed() / 1000.0);
-
-    blockHashFile.close();
-    uniqueBlockFile.close();
+    _cur_result_comput.totalBlock     = ctx.fileBlocks;
+    _cur_result_comput.hashRecordDB   = ctx.totalHashRecords;
+    _cur_result_comput.repeatRecord   = ctx.totalRepeatTimes;
+    _cur_result_comput.repeatRate     = (double)ctx.totalRepeatTimes/ctx.fileBlocks*100;
+    const qint64 seg_nsecs = ctx.elapsedTime.nsecsElapsed();
+    _cur_result_comput.segTime        = seg_nsecs / 1e9;
+    for (int i = 0; i < PHASE_COUNT; ++i)
+    {
+        _cur_result_comput.segPhases[i] = ctx.phases[i].stats(seg_nsecs);
+        if (ctx.phases[i].count() > 0)
+        {
+            emit signalWriteInfoLog(QString("[Thread %1] Segmentation phase %2: %3 ops, p50 / p90 / p99 / max %4").arg(
+                getCurrentThreadID(), LatencyHistogram::getPhaseName(Phase(i)), QString::number(ctx.phases[i].count()),
+                LatencyHistogram::formatStats(_cur_result_comput.segPhases[i])));
+        }
+    }
+    _cur_result_comput.segMode        = seg_mode;
+    _cur_result_comput.batchSize      = (SegMode::SEG_ROW == seg_mode) ? 1 : qMax<size_t>(1, _run_options.batchSize);
+    _cur_result_comput.hashThreads    = _run_options.hashThreads;
+    _cur_result_comput.inputMode      = fin->isMapped() ? InputMode::INPUT_MAPPED : InputMode::INPUT_BUFFERED;
+    _cur_result_comput.chunkMode      = _run_options.chunkMode;
+    _cur_result_comput.bufferPool     = nullptr != digest_pool;
+    _cur_result_comput.segAllocsPerBlock = (!AllocCounter::isSupported() || 0 == ctx.blocksRead) ? -1.0 : (double)(allocs_end - allocs_begin) / ctx.blocksRead;
+    _cur_result_comput.outputMode     = uout->mode();  // 直接 I/O 时总是聚合写入
+    _cur_result_comput.directIo       = fin->isDirect() && uout->isDirect() && hout->isDirect();
+    _cur_result_comput.schemaVersion  = _index->schemaVersion();
+    _cur_result_comput.tablePartitions = _index->partitionCount();
+    _cur_result_comput.indexBackend   = _index->backend();
+    _cur_result_comput.ingestCurve    = ctx.ingestCurve;
+    emit signalWriteInfoLog(QString("[Thread %1] Ingest curve (%2 partitions, rows:blocks/s): %3").arg(
+        getCurrentThreadID(), QString::number(_cur_result_comput.tablePartitions), ResultWriter::formatIngestCurve(ctx.ingestCurve)));
+    if (_index->getTableSize(tb, _cur_result_comput.tableBytes, _cur_result_comput.indexBytes))  // 对比表结构：表和索引的大小
+    {
+        emit signalWriteInfoLog(QString("[Thread %1] Schema %2: %3").arg(
+            getCurrentThreadID(), RunOptions::getSchemaVersionName(_cur_result_comput.schemaVersion), _index->lastLog()));
+    }
+    logDbConnectionStats();
+    _cur_result_comput.segWriteSyscalls = (syscw_begin < 0 || syscw_end < 0) ? -1 : syscw_end - syscw_begin;
+    const qint64 write_nsecs = uout->writeNsecs() + hout->writeNsecs();
+    _cur_result_comput.segWriteMBps   = 0 == write_nsecs ? 0.0 : (uout->bytesWritten() + hout->bytesWritten()) / 1048576.0 / (write_nsecs / 1e9);
+    _cur_result_comput.ioEngine       = (write_io && write_io->isUring()) ? IoEngineMode::IO_ENGINE_URING : IoEngineMode::IO_ENGINE_SYNC;
+    _cur_result_comput.queueDepth     = write_io ? write_io->queueDepth() : 1;
+    _cur_result_comput.segIoInFlight  = write_io ? averageInFlight(read_io, write_io) : 0.0;
+    _cur_result_comput.avgChunkSize   = 0 == ctx.blocksRead ? 0.0 : (double)ctx.ptrSourceLoc / ctx.blocksRead;
+    _cur_result_comput.segMBps        = 0.0 == _cur_result_comput.segTime ? 0.0 : ctx.ptrSourceLoc / 1048576.0 / _cur_result_comput.segTime;
+    _cur_result_comput.hashGBps       = ctx.hashNsecs > 0 ? (double)ctx.bytesHashed / ctx.hashNsecs : 0.0;  // Byte/ns 即 GB/s
+    emit signalWriteInfoLog(QString("[Thread %1] Hash %2%3: %4 Bytes in %5 ms, %6 GB/s").arg(
+        getCurrentThreadID(), Hash::getHashName(alg),
+        QString((HashAlg::SHA256_NI == alg && !Hash::hasSha256Ni()) ? " (SHA-NI unsupported, software fallback)" : "")
+            + (MultiBufferHash::isSupported(alg) ? QString(" (multi-buffer x%1)").arg(MultiBufferHash::lanes()) : QString()),
+        QString::number(ctx.bytesHashed), QString::number(ctx.hashNsecs / 1000000.0, 'f', 1),
+        QString::number(_cur_result_comput.hashGBps, 'f', 2)));
+    if (index)
+    {
+        _cur_result_comput.indexHitRate       = index->hitRate();
+        _cur_result_comput.indexBytesPerEntry = index->bytesPerEntry();
+        emit signalWriteInfoLog(QString("[Thread %1] Hash index: %2 entries, %3 lookups, hit rate %4%, %5 Bytes/entry").arg(
+            getCurrentThreadID(), QString::number(index->size()), QString::number(index->lookups()),
+            QString::number(index->hitRate(), 'f', 2), QString::number(index->bytesPerEntry(), 'f', 1)));
+        delete index;
+    }
+
+    emit signalWriteInfoLog(QString("[Thread %1] Output %2: %3 Bytes written, %4 write syscalls, %5 MB/s").arg(
+        getCurrentThreadID(), OutputFile::getOutputModeName(_run_options.outputMode),
+        QString::number(uout->bytesWritten() + hout->bytesWritten()),
+        QString::number(_cur_result_comput.segWriteSyscalls), QString::number(_cur_result_comput.segWriteMBps, 'f', 2)));
+    if (uout->hasError() || hout->hasError())
+    {
+        emit signalWriteErrorLog(QString("[Thread %1] %2").arg(getCurrentThreadID(), uout->hasError() ? uout->lastLog() : hout->lastLog()));
+    }
+    if (write_io)
+    {
+        emit signalWriteInfoLog(QString("[Thread %1] I/O engine %2: %3 read requests, %4 write requests, %5 requests in flight on average").arg(
+            getCurrentThreadID(), write_io->name(), QString::number(read_io ? read_io->requests() : 0),
+            QString::number(write_io->requests()), QString::number(_cur_result_comput.segIoInFlight, 'f', 2)));
+    }
+
+    delete hout;
+    delete uout;
+    delete read_io;
+    delete write_io;
     delete fin;
 
+    if (!is_succ)
+    {
+        emit signalWriteErrorLog(QString("[Thread %1] Segmentation stopped with database error: %2").arg(getCurrentThreadID(), _index->lastLog()));
+    }
+
     emit signalCurSegmentationResult(_cur_result_comput);
 
     _last_log = QString("[Thread %1] Finish test writing performance, use time %2 sec").arg(getCurrentThreadID(), QString::number(_cur_result_comput.segTime));
@@ -337,243 +604,1417 @@ void AsyncComputeModule::runTestSegmentationProfmance(const QString& source_file
     emit signalSetLbSegmentationStyle(ThemeStyle::LABLE_GREEN);
 
     /* 发送结束信号 */
-    emit signalTestSegmentationPerformanceFinished(true);
+    emit signalTestSegmentationPerformanceFinished(is_succ);
 }
 
 /**
- * @brief AsyncComputeModule::runTestRecoverProfmance 子线程开始恢复文件
- * @param recover_file_path  要恢复至的文件的文件名
- * @param block_hash_file_path 存储哈希块的文件
- * @param alg 哈希算法
- * @param block_size 块大小
+ * @brief AsyncComputeModule::segmentRowByRow 逐块分割：每个块单独查询数据库，然后插入新行或者更新计数器。
+ *  使用哈希索引时，索引中已有的哈希不再查询数据库，计数器增量在内存中累计，最后用一条语句写入
+ * @param ctx 分块任务上下文
+ * @return 是否成功
  */
-void AsyncComputeModule::runTestRecoverProfmance(const QString &recover_file_path, const QString& block_hash_file_path, const HashAlg alg, const size_t block_size)
+bool AsyncComputeModule::segmentRowByRow(SegContext& ctx)
 {
-    emit signalWriteInfoLog(QString("[Thread %1] Start test block recover performance").arg(getCurrentThreadID()));
-
-    /* 为了避免意外操作，暂时禁用按钮 */
-    emit signalSetActivityWidget(false);
+    QByteArray buf_block;       // 读取的源文件的 buffer（用来暂存当前块）
+    size_t cur_block_size = 0;  // 本次读取块的大小（因为文件末尾最后块的大小有可能不是块大小的整数倍）
+    QByteArray buf_hash;        // 存储当前块的哈希值
+    size_t repeat_times = 0;    // 当前块的重复次数
+    HashIndex::Entry* entry = nullptr;  // 当前块在哈希索引中的记录
 
-    /* 数据库无连接 */
-    if (!_dbs->isDatabaseOpen())
+    while (readNextBlock(ctx, buf_block, buf_hash))  // 读取并计算哈希
     {
-        _last_log = QString("[Thread %1] Database do not connected, test exit").arg(getCurrentThreadID());
-        emit signalWriteErrorLog(_last_log);
-        emit signalWarnBox(_last_log);
+        cur_block_size = buf_block.size();       // 计算当前读取的字节数，防止越界
+        qint64 mark = ctx.elapsedTime.nsecsElapsed();
 
-        emit signalSetActivityWidget(true);
-        emit signalTestRecoverPerformanceFinished(false);
-        return;
-    }
+        /* 查询重复次数：先查索引，索引不完整时再查数据库 */
+        if (ctx.index)
+        {
+            entry = ctx.index->find(buf_hash);
+            if (entry)
+            {
+                ++entry->pending;   // 命中：不需要数据库往返
+                repeat_times = entry->counter + entry->pending;
+            }
+            else
+            {
+                repeat_times = ctx.indexComplete ? 0 : _index->getHashRepeatTimes(ctx.tb, buf_hash);
+                if (0 != repeat_times)
+                {
+                    entry = ctx.index->insertMissed(buf_hash);
+                    entry->counter = repeat_times;
+                    entry->pending = 1;
+                }
+            }
+        }
+        else
+        {
+            repeat_times = _index->getHashRepeatTimes(ctx.tb, buf_hash);
+        }
+        ctx.phases[PHASE_DB_LOOKUP].record(lapNsecs(ctx.elapsedTime, mark));
 
-    /* 打开块文件（输入） */
-    InputFile* fin = new InputFile(this, block_hash_file_path);
-    bool is_succ = fin->isOpen();
-    _last_log = QString("[Thread %1] %2").arg(getCurrentThreadID(), fin->lastLog());
-    if (!is_succ)
-    {
-        emit signalWriteErrorLog(_last_log);
-        emit signalErrorBox(_last_log);
+        LOG_DEBUG(_index->lastLog());
 
-        emit signalSetActivityWidget(true);
-        emit signalTestRecoverPerformanceFinished(false);
-        return;
-    }
-    emit signalWriteSuccLog(_last_log);
+        if (0 == repeat_times)  // 重复次数为 0 说明没有记录过当前哈希
+        {
+            ++ctx.totalHashRecords;
+            ctx.uout->write(buf_block.constData(), cur_block_size);  // 写入不带有数据头的数据
+            ctx.phases[PHASE_FILE_WRITE].record(lapNsecs(ctx.elapsedTime, mark));
+            _index->insertNewBlockInfoRow(ctx.tb, buf_hash, ctx.uniquePath, ctx.ptrUniqueLoc, cur_block_size);
+            ctx.phases[PHASE_DB_WRITE].record(lapNsecs(ctx.elapsedTime, mark));
+            if (ctx.index)
+            {
+                entry = ctx.index->insertMissed(buf_hash);
+                entry->location = ctx.ptrUniqueLoc;
+                entry->size     = cur_block_size;
+                entry->counter  = 1;
+            }
+            ctx.ptrUniqueLoc += cur_block_size;
+        }
+        else
+        {
+            ++ctx.totalRepeatTimes;
+            if (!ctx.index)
+            {
+                _index->updateCounter(ctx.tb, buf_hash, (repeat_times + 1));
+                ctx.phases[PHASE_DB_WRITE].record(lapNsecs(ctx.elapsedTime, mark));
+            }
+        }
 
-    /* 创建恢复的文件（输出） */
-    QFile recoverFile(recover_file_path);
-    QFileInfo recoverFileInfo;
-    QDataStream out;
-    if (recoverFile.open(QIODevice::WriteOnly))
-    {
-        out.setDevice(&recoverFile);
-        out.setVersion(QDataStream::Qt_DefaultCompiledVersion);  // 设置流的版本（可以根据实际情况设置，通常用于处理跨版本兼容性）
-        recoverFileInfo.setFile(recoverFile);
+        LOG_DEBUG(_index->lastLog());
+        LOG_DEBUG(QString("↳ Read: %1 Bytes, Hash: %2, Pointer location: %3, Repet times: %4").arg(
+            QString::number(cur_block_size), buf_hash.toHex(), QString::number(ctx.ptrSourceLoc), QString::number(repeat_times)));  // 只输出块的大小，不输出整个块的内容
 
-        _last_log = QString("[Thread %1] Successed create Recover-Block %2").arg(getCurrentThreadID(), recoverFileInfo.filePath());
-        emit signalWriteSuccLog(_last_log);
-    }
-    else
-    {
-        _last_log = QString("[Thread %1] Can not create Recover-Block %2").arg(getCurrentThreadID(), recoverFileInfo.filePath());
-        emit signalWriteErrorLog(_last_log);
-        emit signalErrorBox(_last_log);
+        mark = ctx.elapsedTime.nsecsElapsed();
+        writeHashRecord(ctx, buf_hash, cur_block_size);
+        ctx.phases[PHASE_FILE_WRITE].record(lapNsecs(ctx.elapsedTime, mark));
+        ctx.ptrSourceLoc += cur_block_size; // 移动指针位置
 
-        emit signalSetActivityWidget(true);
-        emit signalTestRecoverPerformanceFinished(false);
-        return;
+        /* 更新进度（ui 定时读取） */
+        updateSegmentationProgress(ctx);
     }
 
-    /* 根据哈希值和块大小判断要读取的表是否存在 */
-    QString tb = getTableName(block_size, alg);
-    if (!_dbs->isTableExists(tb))
-    {
-        _last_log = QString("[Thread %1] Exit Test Recover Profmance: %2").arg(getCurrentThreadID(), _dbs->lastLog());
-        emit signalWriteErrorLog(_last_log);
-
-        emit signalSetActivityWidget(true);
-        emit signalTestRecoverPerformanceFinished(false);
-        return;
-    }
-    _last_log = QString("[Thread %1] %2").arg(getCurrentThreadID(), _dbs->lastLog());
-    emit signalWriteSuccLog(_last_log);
+    /* 把索引中累计的计数器增量写入数据库 */
+    return ctx.index ? flushIndexCounters(ctx, ctx.index) : true;
+}
 
-    /* 计算耗时，这里 QTime 不起作用，因为开始计算后线程一只处于阻塞状态 */
-    QElapsedTimer elapsed_time;
-    elapsed_time.start();
+/**
+ * @brief AsyncComputeModule::segmentBatched 分批分割：先读取并计算 N 个块的哈希，然后用一次集合查询判断哪些哈希已经存在，
+ *  最后用一条语句插入整批新行、一条语句更新整批计数器（每批 3 次数据库往返，而不是每块 2 次）
+ *  使用哈希索引时只查询索引中没有的哈希，计数器增量在最后统一写入
+ *  写入 .ubk 和 .bkh 的内容与逐块模式完全相同
+ * @param ctx 分块任务上下文
+ * @return 是否成功（数据库操作失败时返回 false）
+ */
+bool AsyncComputeModule::segmentBatched(SegContext& ctx)
+{
+    const qsizetype batch_size = qMax<qsizetype>(1, _run_options.batchSize);
 
-    /* 其他用于恢复原信息需要用到的对象 */
-    InputFile* curSourceFile = nullptr;            // 用于读取源文件
-    BlockInfo cur_block_info;
-    const size_t hash_size = Hash::getHashSize(alg);  // 获取哈希块文件中，每个哈希的长度（这个长度是固定的）
-    const size_t num_need_recover = fin->fileSize() / hash_size;  // .bkh 文件中记录的哈希记录条数，同样的也是需要从源文件恢复几个块
-    QByteArray buf_hash;                        // 用于读取块文件中存储的哈希值，读取的长度为 hash_size
-    size_t total_cant_revcover = 0;             // 无法恢复块的数量（数据库中没记录这个块）
-    const QByteArray blank_block(block_size, '\0'); // 如果没找到这个哈希值的源数据块，用这个全是 0 的数据填充 '\0' 是 ASCII 表中的空字符，对应二进制 0
+    /* 不使用全局索引时，用一个只在当前批次内有效的索引合并同一批中重复的块 */
+    HashIndex batch_index(Hash::getHashSize(ctx.alg), batch_size);
+    HashIndex* index = ctx.index ? ctx.index : &batch_index;
+    const bool index_complete = ctx.index ? ctx.indexComplete : false;
 
-    /* 更新（初始化） UI 信息 */
-    emit signalWriteInfoLog(QString("[Thread %1] "
-                                    "From Block-Hash-File: %2, Size: %3<br>"
-                                    "To Recover-File: %4<br>"
-                                    "With:<br>"
-                                    "Hash alg: %5, Hash-Length: %6<br>"
-                                    "Every recover block size: %7<br>"
-                                    "DB-Table: %8").arg(getCurrentThreadID(), fin->filePath(), QString::number(fin->fileSize()),
-                                                        recoverFileInfo.filePath(), Hash::getHashName(alg), QString::number(hash_size), QString::number(block_size), tb));
-    emit signalSetLbRuningJobInfo(QString("Job: Test recover profmance | Hash alg: %1 | Block size: %2 | DB-Table: %3").arg(Hash::getHashName(alg), QString::number(block_size), tb));
-    emit signalSetLcdNumNeedRecover(num_need_recover);
-    emit signalSetProgressBarRange(0, fin->fileSize());  // 以读取块文件的指针位置作为进度
-    emit signalSetProgressBarValue(0);
-    emit signalSetLbRecoverStyle(ThemeStyle::LABLE_ORANGE);
+    QList<QByteArray> batch_blocks;     // 当前批次读取的块
+    QList<QByteArray> batch_hashes;     // 当前批次块的哈希值（与 batch_blocks 一一对应）
+    QList<QByteArray> lookup_hashes;    // 需要查询数据库的哈希（不在索引中）
+    QHash<QByteArray, int> repeat_times;// 数据库中已存在的哈希 -> 重复次数
+    QList<size_t> new_entries;          // 本批次中新出现的块在索引中的下标
 
-    while (!fin->atEnd())
-    {
-        buf_hash = fin->read(hash_size);
-        cur_block_info = _dbs->getBlockInfo(tb, buf_hash);
-#if !QT_NO_DEBUG
-        qDebug() << "\n[AsyncComputeModule::runTestRecoverProfmance] Read Hash: " << buf_hash.toHex() << "\nIn source: " << cur_block_info.filePath << "\nLoction: " << cur_block_info.location << " Size: " << cur_block_info.size;
-#endif
-        /* 更新 ui */
-        emit signalSetProgressBarValue(fin->curPtrPostion());
+    QList<QByteArray> new_hashes;       // 需要插入的行
+    QList<qint64>     new_locs;
+    QList<int>        new_sizes;
+    QList<int>        new_counters;
 
-        /* 数据库中没有记录当前块 */
-        if (0 == cur_block_info.size)
-        {
-            _last_log = QString("[Thread %1] %2").arg(getCurrentThreadID(), _dbs->lastLog());
-            ++total_cant_revcover;
-            emit signalSetLcdTotalUnrecovered(total_cant_revcover);
-            // out << blank_block;
-            out.writeRawData(blank_block, block_size);
+    QByteArray buf_block;
+    QByteArray buf_hash;
 
-            emit signalWriteWarningLog(_last_log);
-#if !QT_NO_DEBUG
-            qDebug() << _last_log;
+    batch_blocks.reserve(batch_size);
+    batch_hashes.reserve(batch_size);
 
-#endif
-            continue;
+    while (!isSourceDrained(ctx))
+    {
+        /* 读取一批块并计算哈希 */
+        batch_blocks.clear();
+        batch_hashes.clear();
+        while (batch_blocks.size() < batch_size && readNextBlock(ctx, buf_block, buf_hash))
+        {
+            batch_blocks.append(buf_block);
+            batch_hashes.append(buf_hash);
         }
 
-        /* 如果数据库中记录了当前块
-         * 更新要读取源数据的源文件
-         *  （这里可以优化，比如将数据表中的数据按照文件路径排序） */
-        if (nullptr == curSourceFile || curSourceFile->filePath() != cur_block_info.filePath)
+        /* 一次集合查询（只查询索引中没有的哈希；索引完整时不需要查询） */
+        qint64 mark = ctx.elapsedTime.nsecsElapsed();
+        repeat_times.clear();
+        if (!index_complete)
         {
-            delete curSourceFile;
-            curSourceFile = new InputFile(nullptr, cur_block_info.filePath);
-            _last_log = QString("[Thread %1] Try to open source file %2").arg(getCurrentThreadID(), cur_block_info.filePath);
+            lookup_hashes.clear();
+            for (const QByteArray& buf_hash : std::as_const(batch_hashes))
+            {
+                if (!index->contains(buf_hash))
+                {
+                    lookup_hashes.append(buf_hash);
+                }
+            }
+            if (!_index->getHashRepeatTimesBatch(ctx.tb, lookup_hashes, repeat_times))
+            {
+                return false;
+            }
+            ctx.phases[PHASE_DB_LOOKUP].record(lapNsecs(ctx.elapsedTime, mark));
         }
 
-        /* 可能出现源文件丢失的情况 */
-        if (!curSourceFile->isOpen())
+        /* 按块的顺序去重并写入文件 */
+        new_entries.clear();
+        for (qsizetype i = 0; i < batch_blocks.size(); ++i)
         {
-            ++total_cant_revcover;
-            emit signalSetLcdTotalUnrecovered(total_cant_revcover);
-            out.writeRawData(blank_block, block_size);
+            const QByteArray& buf_block = batch_blocks.at(i);
+            const QByteArray& buf_hash  = batch_hashes.at(i);
+            const size_t cur_block_size = buf_block.size();
+
+            HashIndex::Entry* entry = index->find(buf_hash);
+            if (entry)  // 索引中已经有当前哈希（之前的批次或者本批次中出现过）
+            {
+                ++ctx.totalRepeatTimes;
+                ++entry->pending;
+            }
+            else if (repeat_times.contains(buf_hash))  // 数据库中已经记录过当前哈希
+            {
+                ++ctx.totalRepeatTimes;
+                entry = index->insertMissed(buf_hash);
+                entry->counter = repeat_times.value(buf_hash);
+                entry->pending = 1;
+            }
+            else
+            {
+                ++ctx.totalHashRecords;
+                mark = ctx.elapsedTime.nsecsElapsed();
+                ctx.uout->write(buf_block.constData(), cur_block_size);  // 写入不带有数据头的数据
+                ctx.phases[PHASE_FILE_WRITE].record(lapNsecs(ctx.elapsedTime, mark));
+                entry = index->insertMissed(buf_hash);
+                entry->location = ctx.ptrUniqueLoc;
+                entry->size     = cur_block_size;
+                new_entries.append(index->indexOf(entry));
+                ctx.ptrUniqueLoc += cur_block_size;
+            }
+
+            mark = ctx.elapsedTime.nsecsElapsed();
+            writeHashRecord(ctx, buf_hash, cur_block_size);
+            ctx.phases[PHASE_FILE_WRITE].record(lapNsecs(ctx.elapsedTime, mark));
+            ctx.ptrSourceLoc += cur_block_size; // 移动指针位置
+        }
 
-            _last_log = QString("[Thread %1] %2").arg(getCurrentThreadID(), curSourceFile->lastLog());
-            emit signalWriteWarningLog(_last_log);
-            continue;
+        /* 一条语句插入新行（本批次中重复出现的新块直接计入插入的 counter） */
+        new_hashes.clear();
+        new_locs.clear();
+        new_sizes.clear();
+        new_counters.clear();
+        for (size_t i : std::as_const(new_entries))
+        {
+            HashIndex::Entry& entry = index->entryAt(i);
+            entry.counter = 1 + entry.pending;
+            entry.pending = 0;
+            new_hashes.append(index->digestAt(i));
+            new_locs.append(entry.location);
+            new_sizes.append(entry.size);
+            new_counters.append(entry.counter);
+        }
+        mark = ctx.elapsedTime.nsecsElapsed();
+        if (!_index->insertNewBlockInfoRows(ctx.tb, new_hashes, ctx.uniquePath, new_locs, new_sizes, new_counters))
+        {
+            return false;
         }
+        ctx.phases[PHASE_DB_WRITE].record(lapNsecs(ctx.elapsedTime, mark));
 
-        // out << fin->readFrom(cur_block_info.location, cur_block_info.size);
-        out.writeRawData(curSourceFile->readFrom(cur_block_info.location, cur_block_info.size), cur_block_info.size);
+        /* 没有全局索引时，每批用一条语句更新计数器 */
+        if (!ctx.index)
+        {
+            if (!flushIndexCounters(ctx, &batch_index))
+            {
+                return false;
+            }
+            batch_index.clear();
+        }
 
-        ++_cur_result_comput.recoveredBlock;  // 成功恢复块的数量（数据库中记录了这个块，并且源文件也成功读取了）
-        _cur_result_comput.recoveredRate = (double)_cur_result_comput.recoveredBlock / num_need_recover * 100;  // 恢复成功率
-        _cur_result_comput.recoveredTime = elapsed_time.elapsed() / 1000.0;  // 用时
+        LOG_DEBUG(QString("↳ Batch of %1 blocks, lookup in DB: %2, new: %3, Pointer location: %4").arg(
+            QString::number(batch_blocks.size()), QString::number(lookup_hashes.size()),
+            QString::number(new_entries.size()), QString::number(ctx.ptrSourceLoc)));
 
-        emit signalSetLcdTotalRecovered(_cur_result_comput.recoveredBlock);
-        emit signalSetLcdRecoveredPercent(_cur_result_comput.recoveredRate);
-        emit signalSetLcdRecoverTime(_cur_result_comput.recoveredTime);
-#if !QT_NO_DEBUG
-        qDebug() << _last_log << "\nRecover data: " << curSourceFile->readFrom(cur_block_info.location, cur_block_info.size);
-#endif
+        /* 更新进度（每批一次） */
+        updateSegmentationProgress(ctx);
     }
 
-    // 结果发送到表
-    emit signalCurRecoverResult(_cur_result_comput);
-    recoverFile.close();
-    delete curSourceFile;
-    delete fin;
-
-    _last_log = QString("[Thread %1] Successful recovery file to %2<br>"
-                        "Number of unrecoverable blocks %3/%4, Recovery rate %5\%,"
-                        "Use time: %6 sec").arg(getCurrentThreadID(), recover_file_path,
-                                                QString::number(total_cant_revcover),
-                                                QString::number(num_need_recover), QString::number(_cur_result_comput.recoveredRate, 'f', 2),
-                                                QString::number(_cur_result_comput.recoveredTime));
-    emit signalWriteSuccLog(_last_log);
-
-    /* 解锁按钮 */
-    emit signalSetActivityWidget(true);
-    emit signalSetLbRecoverStyle(ThemeStyle::LABLE_GREEN);
-    emit signalTestRecoverPerformanceFinished(true);
+    /* 把全局索引中累计的计数器增量写入数据库 */
+    return ctx.index ? flushIndexCounters(ctx, ctx.index) : true;
 }
 
 /**
- * @brief AsyncComputeModule::runTestSingal 执行单步测试（分块性能 + 恢复性能）
- * @param source_file_path 源文件路径
- * @param unqiue_block_file_path 存储块的文件
- * @param block_hash_file_path 存储哈希块的文件
- * @param recover_file_path 要恢复至的文件的文件名
- * @param alg 哈希算法
- * @param block_size 块大小
+ * @brief AsyncComputeModule::segmentCopy 批量导入：用哈希索引在内存中对所有块去重，新行每累计 N 行就通过一次 COPY 写入数据库，
+ *  已写入数据库的块再次出现时只在内存中累计计数器增量，最后用一条语句更新。
+ *  只能用于空表（索引中需要包含表中所有的哈希值）
+ * @param ctx 分块任务上下文（ctx.index 不能为 nullptr）
+ * @return 是否成功（数据库操作失败时返回 false）
  */
-void AsyncComputeModule::runSingleTest(const QString &source_file_path, const QString& unqiue_block_file_path, const QString &block_hash_file_path,
-                                       const QString &recover_file_path, const HashAlg alg, const size_t block_size)
+bool AsyncComputeModule::segmentCopy(SegContext& ctx)
 {
-    emit signalWriteInfoLog(QString("[Thread %1] Start to run Singal Test").arg(getCurrentThreadID()));
+    const size_t batch_size = qMax<size_t>(1, _run_options.batchSize);
+    HashIndex* index = ctx.index;
+    size_t copied = index->size();      // 下标小于 copied 的记录已经写入数据库
+    QList<BlockRecord> records;         // 本次 COPY 要写入的行
+    records.reserve(batch_size);
+
+    QByteArray buf_block;
+    QByteArray buf_hash;
+    size_t cur_block_size = 0;
+    bool inserted = false;
+
+    /* 把索引中还没有写入数据库的新行通过一次 COPY 写入 */
+    auto copy_new_rows = [&]() -> bool {
+        qint64 mark = ctx.elapsedTime.nsecsElapsed();
+        records.clear();
+        for (size_t i = copied; i < index->size(); ++i)
+        {
+            const HashIndex::Entry& new_entry = index->entryAt(i);
+            BlockRecord record;
+            record.hash          = index->digestAt(i);
+            record.info.filePath = ctx.uniquePath;
+            record.info.location = new_entry.location;
+            record.info.size     = new_entry.size;
+            record.counter       = new_entry.counter;
+            records.append(record);
+        }
+        if (!_index->copyBlockRecords(ctx.tb, records))
+        {
+            return false;
+        }
+        copied = index->size();
+        ctx.phases[PHASE_DB_WRITE].record(lapNsecs(ctx.elapsedTime, mark));
+        return true;
+    };
 
-    /* 数据库无连接 */
-    if (!_dbs->isDatabaseOpen())
+    while (readNextBlock(ctx, buf_block, buf_hash))
     {
-        _last_log = QString("[Thread %1] Database do not connected, test exit").arg(getCurrentThreadID());
-        emit signalWriteErrorLog(_last_log);
-        emit signalWarnBox(_last_log);
+        cur_block_size = buf_block.size();
 
-        emit signalSetActivityWidget(true);
-        emit signalTestRecoverPerformanceFinished(false);
-        return;
+        qint64 mark = ctx.elapsedTime.nsecsElapsed();
+        HashIndex::Entry* entry = index->insert(buf_hash, &inserted);
+        ctx.phases[PHASE_DB_LOOKUP].record(lapNsecs(ctx.elapsedTime, mark));  // 在内存中去重
+        if (inserted)  // 新的块
+        {
+            ++ctx.totalHashRecords;
+            ctx.uout->write(buf_block.constData(), cur_block_size);
+            ctx.phases[PHASE_FILE_WRITE].record(lapNsecs(ctx.elapsedTime, mark));
+            entry->location = ctx.ptrUniqueLoc;
+            entry->size     = cur_block_size;
+            entry->counter  = 1;
+            ctx.ptrUniqueLoc += cur_block_size;
+        }
+        else
+        {
+            ++ctx.totalRepeatTimes;
+            if (index->indexOf(entry) < copied)
+            {
+                ++entry->pending;   // 已经在数据库中，最后再更新
+            }
+            else
+            {
+                ++entry->counter;   // 还没有写入数据库，直接计入 COPY 的 counter
+            }
+        }
+
+        mark = ctx.elapsedTime.nsecsElapsed();
+        writeHashRecord(ctx, buf_hash, cur_block_size);
+        ctx.phases[PHASE_FILE_WRITE].record(lapNsecs(ctx.elapsedTime, mark));
+        ctx.ptrSourceLoc += cur_block_size;
+
+        /* 累计了一批新行，通过 COPY 写入 */
+        if (index->size() - copied >= batch_size || isSourceDrained(ctx))
+        {
+            if (!copy_new_rows())
+            {
+                return false;
+            }
+            updateSegmentationProgress(ctx);
+        }
     }
 
-    runTestSegmentationProfmance(source_file_path, unqiue_block_file_path, block_hash_file_path, alg, block_size);
-    runTestRecoverProfmance(recover_file_path, block_hash_file_path, alg, block_size);
+    /* 块数事先未知时（基于内容分块），最后一批可能还没有写入 */
+    if (index->size() > copied)
+    {
+        if (!copy_new_rows())
+        {
+            return false;
+        }
+        updateSegmentationProgress(ctx);
+    }
 
-    emit signalWriteSuccLog(QString("[Thread %1] Singal Test done").arg(getCurrentThreadID()));
+    /* 最后一次性更新已经写入数据库的块的计数器 */
+    return flushIndexCounters(ctx, index);
 }
 
-
 /**
- * @brief AsyncComputeModule::runBenchmarkTest 自动执行基准测试
- * @param source_file_path 源文件路径
- * @param unqiue_block_file_path 存储块的文件
- * @param block_hash_file_path 存储哈希块的文件
- * @param recover_file_path 要恢复至的文件的文件名
- * @param alg 哈希算法
- * @param block_size_list
+ * @brief AsyncComputeModule::flushIndexCounters 把哈希索引中累计的计数器增量用一条语句写入数据库（计入数据库写入阶段）
+ * @param ctx 分块任务上下文
+ * @param index 哈希索引
+ * @return 是否成功
  */
-void AsyncComputeModule::runBenchmarkTest(const QString &source_file_path, const QString& unqiue_block_file_path,
+bool AsyncComputeModule::flushIndexCounters(SegContext& ctx, HashIndex* index)
+{
+    qint64 mark = ctx.elapsedTime.nsecsElapsed();
+    QList<QByteArray> hashes;
+    QList<int> increments;
+    for (size_t i = 0; i < index->size(); ++i)
+    {
+        HashIndex::Entry& entry = index->entryAt(i);
+        if (entry.pending > 0)
+        {
+            hashes.append(index->digestAt(i));
+            increments.append(entry.pending);
+            entry.counter += entry.pending;
+            entry.pending = 0;
+        }
+    }
+    const bool is_succ = _index->addCounters(ctx.tb, hashes, increments);
+    ctx.phases[PHASE_DB_WRITE].record(lapNsecs(ctx.elapsedTime, mark));
+    return is_succ;
+}
+
+/**
+ * @brief AsyncComputeModule::readNextBlock 按顺序读取源文件的下一个块并计算哈希（使用流水线时从流水线中取出，
+ *  否则每次读取一个窗口的块并批量计算哈希，再逐个取出）
+ * @param ctx 分块任务上下文
+ * @param block [输出] 块数据
+ * @param hash [输出] 块的哈希值
+ * @return 是否读取到了块（源文件已经读完返回 false）
+ */
+bool AsyncComputeModule::readNextBlock(SegContext& ctx, QByteArray& block, QByteArray& hash)
+{
+    if (ctx.pipeline)
+    {
+        const qint64 begin = ctx.elapsedTime.nsecsElapsed();
+        const bool is_next = ctx.pipeline->next(block, hash);
+        ctx.phases[PHASE_READ].record(ctx.elapsedTime.nsecsElapsed() - begin);  // 等待流水线（读取和计算哈希在其他线程中进行）
+        if (!is_next)
+        {
+            ctx.sourceDrained = true;
+            return false;
+        }
+    }
+    else
+    {
+        if (ctx.windowPos >= ctx.windowBlocks.size() && !readHashWindow(ctx))
+        {
+            ctx.sourceDrained = true;
+            return false;
+        }
+        block = std::move(ctx.windowBlocks[ctx.windowPos]);
+        hash  = std::move(ctx.windowHashes[ctx.windowPos]);
+        ++ctx.windowPos;
+    }
+
+    ++ctx.blocksRead;
+    return true;
+}
+
+/**
+ * @brief AsyncComputeModule::readHashWindow 串行读取时读取下一个窗口（最多 ctx.windowCapacity 个块或 SEG_HASH_WINDOW_BYTES 字节），
+ *  在当前线程中用 Hash::getDataHashes 批量计算哈希。使用缓冲区池时固定大小的块一次读入池中的帧，哈希也写入池中，
+ *  窗口中的块和哈希都是帧的视图，不为每个块分配堆内存。使用 io_uring 时帧的数据来自预读的请求
+ * @param ctx 分块任务上下文
+ * @return 是否读取到了块（源文件已经读完返回 false）
+ */
+bool AsyncComputeModule::readHashWindow(SegContext& ctx)
+{
+    ctx.windowBlocks.clear();
+    ctx.windowHashes.clear();
+    ctx.windowPos = 0;
+
+    qint64 mark = ctx.elapsedTime.nsecsElapsed();
+    qint64 window_bytes = 0;
+    if (ctx.blockPool)
+    {
+        char* frame = ctx.blockPool->nextFrame();
+        const qint64 maxlen = ctx.windowCapacity * ctx.blockSize;
+        window_bytes = qMax<qint64>(0, ctx.reader ? ctx.reader->readInto(frame, maxlen) : ctx.fin->readInto(frame, maxlen));
+        for (qint64 offset = 0; offset < window_bytes; offset += ctx.blockSize)
+        {
+            ctx.windowBlocks.append(QByteArray::fromRawData(frame + offset, qMin<qint64>(ctx.blockSize, window_bytes - offset)));
+        }
+    }
+    else
+    {
+        QByteArray buf_block;
+        while (ctx.windowBlocks.size() < ctx.windowCapacity && window_bytes < SEG_HASH_WINDOW_BYTES)
+        {
+            if (ctx.chunker)
+            {
+                if (!ctx.chunker->next(buf_block))
+                {
+                    break;
+                }
+            }
+            else
+            {
+                if (ctx.fin->atEnd())
+                {
+                    break;
+                }
+                buf_block = ctx.fin->read(ctx.blockSize);
+            }
+            window_bytes += buf_block.size();
+            ctx.windowBlocks.append(std::move(buf_block));
+        }
+    }
+
+    ctx.phases[PHASE_READ].record(lapNsecs(ctx.elapsedTime, mark));
+    if (ctx.windowBlocks.isEmpty())
+    {
+        return false;
+    }
+
+    if (ctx.digestPool)
+    {
+        const size_t hash_size = Hash::getHashSize(ctx.alg);
+        char* digests = ctx.digestPool->nextFrame();
+        Hash::getDataHashes(ctx.windowBlocks, ctx.alg, digests);
+        for (qsizetype i = 0; i < ctx.windowBlocks.size(); ++i)
+        {
+            ctx.windowHashes.append(QByteArray::fromRawData(digests + i * hash_size, hash_size));
+        }
+    }
+    else
+    {
+        ctx.windowHashes = Hash::getDataHashes(ctx.windowBlocks, ctx.alg);
+    }
+    const qint64 hash_nsecs = lapNsecs(ctx.elapsedTime, mark);
+    ctx.phases[PHASE_HASH].record(hash_nsecs);
+    ctx.hashNsecs   += hash_nsecs;
+    ctx.bytesHashed += window_bytes;
+    return true;
+}
+
+/**
+ * @brief AsyncComputeModule::isSourceDrained 源文件中所有的块是否都已经被读取（不会阻塞等待流水线）
+ * @param ctx 分块任务上下文
+ * @return
+ */
+bool AsyncComputeModule::isSourceDrained(const SegContext& ctx) const
+{
+    if (ctx.chunker)
+    {
+        return ctx.sourceDrained;  // 基于内容分块时块数事先未知，只有读取失败后才能确定
+    }
+    return ctx.sourceDrained || ctx.blocksRead >= ctx.fileBlocks;
+}
+
+/**
+ * @brief AsyncComputeModule::writeHashRecord 把一个块的记录写入 Block-Hash file：固定大小分块时只写入哈希，
+ *  基于内容分块时在哈希后面写入块的长度（4 字节，大端），恢复时据此计算每个块在恢复的文件中的位置
+ * @param ctx 分块任务上下文
+ * @param hash 块的哈希值
+ * @param block_size 块的长度
+ */
+void AsyncComputeModule::writeHashRecord(SegContext& ctx, const QByteArray& hash, const size_t block_size)
+{
+    // out << buf_hash;           // 记录哈希到文件【注意】通过 `<<` QDataStream 写入时，QDataStream 会在字符串的前面写入一个4字节的长度字段，表示接下来数据的长度
+    ctx.hout->write(hash);
+    if (ctx.chunker)
+    {
+        ctx.hout->writeBigEndian(block_size);  // 与 QDataStream 相同使用大端
+    }
+}
+
+/**
+ * @brief AsyncComputeModule::updateSegmentationProgress 更新分块进度的计数器（只写原子变量，不发送信号，ui 定时读取），
+ *  写入的行数每翻一倍在吞吐量曲线上记录一个点
+ * @param ctx 分块任务上下文
+ */
+void AsyncComputeModule::updateSegmentationProgress(SegContext& ctx)
+{
+    const qint64 nsecs = ctx.elapsedTime.nsecsElapsed();
+    _progress.position.store(ctx.ptrSourceLoc, std::memory_order_relaxed);
+    _progress.hashRecords.store(ctx.totalHashRecords, std::memory_order_relaxed);
+    _progress.repeats.store(ctx.totalRepeatTimes, std::memory_order_relaxed);
+    _progress.segNsecs.store(nsecs, std::memory_order_relaxed);
+
+    if (ctx.totalHashRecords >= ctx.nextCurveRows)
+    {
+        addIngestPoint(ctx, nsecs);
+        while (ctx.nextCurveRows <= ctx.totalHashRecords)
+        {
+            ctx.nextCurveRows *= 2;
+        }
+    }
+}
+
+/**
+ * @brief AsyncComputeModule::addIngestPoint 在吞吐量曲线上记录一个点：当前写入的行数和从上一个点到现在的分块吞吐量
+ * @param ctx 分块任务上下文
+ * @param nsecs 当前的时间（ns）
+ */
+void AsyncComputeModule::addIngestPoint(SegContext& ctx, const qint64 nsecs)
+{
+    const qint64 interval_nsecs = nsecs - ctx.curveNsecs;
+    if (interval_nsecs <= 0 || ctx.blocksRead <= ctx.curveBlocks)
+    {
+        return;
+    }
+
+    IngestPoint point;
+    point.rows         = ctx.totalHashRecords;
+    point.blocksPerSec = (ctx.blocksRead - ctx.curveBlocks) / (interval_nsecs / 1e9);
+    ctx.ingestCurve.append(point);
+    ctx.curveBlocks = ctx.blocksRead;
+    ctx.curveNsecs  = nsecs;
+}
+
+/**
+ * @brief AsyncComputeModule::runTestRecoverProfmance 子线程开始恢复文件
+ * @param recover_file_path  要恢复至的文件的文件名
+ * @param block_hash_file_path 存储哈希块的文件
+ * @param alg 哈希算法
+ * @param block_size 块大小
+ */
+void AsyncComputeModule::runTestRecoverProfmance(const QString &recover_file_path, const QString& block_hash_file_path, const HashAlg alg, const size_t block_size)
+{
+    emit signalWriteInfoLog(QString("[Thread %1] Start test block recover performance").arg(getCurrentThreadID()));
+
+    /* 为了避免意外操作，暂时禁用按钮 */
+    emit signalSetActivityWidget(false);
+
+    /* 打开去重索引（PostgreSQL 需要已经连接数据库） */
+    if (!openDedupIndex(block_hash_file_path))
+    {
+        _last_log = QString("[Thread %1] %2, test exit").arg(getCurrentThreadID(), _index->lastLog());
+        emit signalWriteErrorLog(_last_log);
+        emit signalWarnBox(_last_log);
+
+        emit signalSetActivityWidget(true);
+        emit signalTestRecoverPerformanceFinished(false);
+        return;
+    }
+
+    /* 打开块文件（输入） */
+    InputFile* fin = new InputFile(this, block_hash_file_path, InputMode::INPUT_BUFFERED, _run_options.directIo);
+    bool is_succ = fin->isOpen();
+    _last_log = QString("[Thread %1] %2").arg(getCurrentThreadID(), fin->lastLog());
+    if (!is_succ)
+    {
+        emit signalWriteErrorLog(_last_log);
+        emit signalErrorBox(_last_log);
+
+        emit signalSetActivityWidget(true);
+        emit signalTestRecoverPerformanceFinished(false);
+        return;
+    }
+    emit signalWriteSuccLog(_last_log);
+
+    /* 创建恢复的文件（输出） */
+    /* 多线程恢复时各线程用 pwrite 把块直接写到最终位置，不能满足直接 I/O 的对齐要求，恢复的文件仍然通过页缓存写入 */
+    const bool parallel_recover = _run_options.recoverThreads > 0 || _run_options.sortedRecover;
+    if (_run_options.directIo && parallel_recover)
+    {
+        emit signalWriteWarningLog(QString("[Thread %1] Recovered file is written through the page cache by the recover threads, "
+                                           "direct I/O only applies to reading").arg(getCurrentThreadID()));
+    }
+    OutputFile* out = new OutputFile(this, recover_file_path, _run_options.outputMode,
+                                     _run_options.getOutputBufferSize(), _run_options.outputWritev,
+                                     _run_options.directIo && !parallel_recover);
+    if (out->isOpen())
+    {
+        _last_log = QString("[Thread %1] Successed create Recover-Block %2").arg(getCurrentThreadID(), out->filePath());
+        emit signalWriteSuccLog(_last_log);
+    }
+    else
+    {
+        _last_log = QString("[Thread %1] Can not create Recover-Block %2").arg(getCurrentThreadID(), out->filePath());
+        emit signalWriteErrorLog(_last_log);
+        emit signalErrorBox(_last_log);
+        delete out;
+
+        emit signalSetActivityWidget(true);
+        emit signalTestRecoverPerformanceFinished(false);
+        return;
+    }
+
+    /* 根据哈希值和块大小判断要读取的表是否存在（v2 表不存在时从同样参数的 v1 表迁移） */
+    _index->setSchemaVersion(_run_options.schemaVersion);
+    _index->setPartitionCount(_run_options.tablePartitions);
+    QString tb = getTableName(block_size, alg);
+    if (SchemaVersion::SCHEMA_V2 == _run_options.schemaVersion && !_index->isTableExists(tb))
+    {
+        migrateV1Table(tb, alg);
+    }
+    if (!_index->isTableExists(tb))
+    {
+        _last_log = QString("[Thread %1] Exit Test Recover Profmance: %2").arg(getCurrentThreadID(), _index->lastLog());
+        emit signalWriteErrorLog(_last_log);
+        delete out;
+
+        emit signalSetActivityWidget(true);
+        emit signalTestRecoverPerformanceFinished(false);
+        return;
+    }
+    _last_log = QString("[Thread %1] %2").arg(getCurrentThreadID(), _index->lastLog());
+    emit signalWriteSuccLog(_last_log);
+
+    /* 计算耗时，这里 QTime 不起作用，因为开始计算后线程一只处于阻塞状态 */
+    RecoverContext ctx;
+    ctx.elapsedTime.start();
+
+    /* 其他用于恢复原信息需要用到的对象 */
+    ctx.fin             = fin;
+    ctx.out             = out->file();
+    ctx.dout            = out;
+    ctx.tb              = tb;
+    ctx.alg             = alg;
+    ctx.blockSize       = block_size;
+    ctx.hashSize        = Hash::getHashSize(alg);  // 获取哈希块文件中，每个哈希的长度（这个长度是固定的）
+    ctx.variableBlocks  = ChunkMode::CHUNK_CDC == _run_options.chunkMode;
+    ctx.recordSize      = ctx.hashSize + (ctx.variableBlocks ? sizeof(quint32) : 0);  // 基于内容分块时每个哈希后面记录了块的长度
+    ctx.maxBlockSize    = ctx.variableBlocks ? _run_options.getCdcMaxSize(block_size) : block_size;
+    ctx.numNeedRecover  = fin->fileSize() / ctx.recordSize;  // .bkh 文件中记录的哈希记录条数，同样的也是需要从源文件恢复几个块
+
+    /* 更新（初始化） UI 信息 */
+    emit signalWriteInfoLog(QString("[Thread %1] "
+                                    "From Block-Hash-File: %2, Size: %3<br>"
+                                    "To Recover-File: %4<br>"
+                                    "With:<br>"
+                                    "Hash alg: %5, Hash-Length: %6<br>"
+                                    "Every recover block size: %7<br>"
+                                    "DB-Table: %8").arg(getCurrentThreadID(), fin->filePath(), QString::number(fin->fileSize()),
+                                                        out->filePath(), Hash::getHashName(alg), QString::number(ctx.hashSize), QString::number(block_size), tb));
+    emit signalSetLbRuningJobInfo(QString("Job: Test recover profmance | Hash alg: %1 | Block size: %2 | DB-Table: %3").arg(Hash::getHashName(alg), QString::number(block_size), tb));
+    _progress.beginRecover(fin->fileSize(), ctx.numNeedRecover);  // 以读取块文件的指针位置作为进度
+    emit signalSetLbRecoverStyle(ThemeStyle::LABLE_ORANGE);
+
+    /* io_uring：单线程恢复时每个窗口的块同时读取（同时保持 queue depth 个请求），聚合写入的恢复文件每次写入拆分为多个请求；
+     * 多线程恢复时各线程仍然同步读写 */
+    IoEngine* read_io  = nullptr;
+    IoEngine* write_io = nullptr;
+    if (IoEngineMode::IO_ENGINE_URING == _run_options.ioEngine)
+    {
+        write_io = new IoEngine(_run_options.ioEngine, _run_options.queueDepth);
+        out->setIoEngine(write_io);
+        if (0 == _run_options.recoverThreads && !_run_options.sortedRecover)
+        {
+            read_io = new IoEngine(_run_options.ioEngine, _run_options.queueDepth);
+            ctx.io = read_io;
+        }
+        else
+        {
+            emit signalWriteWarningLog(QString("[Thread %1] io_uring reads only apply to single-threaded unsorted recovery, "
+                                               "source files are read by the recover threads").arg(getCurrentThreadID()));
+        }
+        emit signalWriteInfoLog(QString("[Thread %1] I/O engine: %2").arg(getCurrentThreadID(), write_io->name()));
+        if (!write_io->isUring())
+        {
+            emit signalWriteWarningLog(QString("[Thread %1] %2").arg(getCurrentThreadID(), write_io->lastLog()));
+        }
+    }
+
+    /* 缓冲区池：每个窗口的 .bkh 记录一次读入，逐块恢复时块读入同一个缓冲区 */
+    BlockBufferPool* record_pool = nullptr;
+    BlockBufferPool* block_pool  = nullptr;
+    if (_run_options.useBufferPool)
+    {
+        record_pool = new BlockBufferPool(qMax<size_t>(1, _run_options.recoverWindow) * ctx.recordSize, 1);
+        ctx.recordPool = record_pool;
+        if (0 == _run_options.recoverThreads && !_run_options.sortedRecover && !read_io)
+        {
+            block_pool = new BlockBufferPool(ctx.maxBlockSize, 1);
+            ctx.blockPool = block_pool;
+        }
+    }
+
+    /* 连接池：不批量解析时窗口中不同的哈希分给查询线程，各线程在自己的数据库连接上并行查询 */
+    _index->setPoolSize(_run_options.dbConnections);
+    _index->resetConnectionStats();
+    QThreadPool* lookup_pool = nullptr;
+    if (!_run_options.bulkResolve && _run_options.dbConnections > 1)
+    {
+        lookup_pool = new QThreadPool;
+        lookup_pool->setMaxThreadCount(_run_options.dbConnections - 1);
+        lookup_pool->setExpiryTimeout(-1);  // 线程和它们的连接保留到恢复结束
+        ctx.lookupPool = lookup_pool;
+    }
+
+    const quint64 allocs_begin = AllocCounter::count();
+    const qint64 syscw_begin = OutputFile::processWriteSyscalls();
+    if (_run_options.recoverThreads > 0 || _run_options.sortedRecover)
+    {
+        recoverParallel(ctx);
+    }
+    else if (ctx.io)
+    {
+        recoverAsync(ctx);
+    }
+    else
+    {
+        recoverSerial(ctx);
+    }
+    const quint64 allocs_end = AllocCounter::count();
+    qint64 mark = ctx.elapsedTime.nsecsElapsed();
+    out->close();  // 写入暂存缓冲区中剩下的数据（计入恢复耗时）
+    ctx.phases[PHASE_FILE_WRITE].record(lapNsecs(ctx.elapsedTime, mark));
+    const qint64 syscw_end = OutputFile::processWriteSyscalls();
+    delete record_pool;
+    delete block_pool;
+    delete lookup_pool;  // 等待查询线程结束，线程结束时归还各自的连接
+    updateRecoverProgress(ctx);  // 最终的进度
+    logDbConnectionStats();
+
+    /* 无法恢复的块只在最后汇总为一条日志（不为每个块发送信号） */
+    if (ctx.totalUnrecovered > 0)
+    {
+        emit signalWriteWarningLog(QString("[Thread %1] %2 blocks can not be recovered, last error: %3").arg(
+            getCurrentThreadID(), QString::number(ctx.totalUnrecovered), ctx.lastError));
+    }
+
+    _cur_result_comput.recoverAllocsPerBlock = (!AllocCounter::isSupported() || 0 == ctx.numNeedRecover) ? -1.0 : (double)(allocs_end - allocs_begin) / ctx.numNeedRecover;
+    emit signalWriteInfoLog(QString("[Thread %1] Heap allocations per block: segmentation %2, recovery %3 (buffer pool %4)").arg(
+        getCurrentThreadID(), QString::number(_cur_result_comput.segAllocsPerBlock, 'f', 2),
+        QString::number(_cur_result_comput.recoverAllocsPerBlock, 'f', 2), _run_options.useBufferPool ? "yes" : "no"));
+    _cur_result_comput.recoveredRate  = (double)_cur_result_comput.recoveredBlock / ctx.numNeedRecover * 100;  // 恢复成功率
+    const qint64 recover_nsecs = ctx.elapsedTime.nsecsElapsed();
+    _cur_result_comput.recoveredTime  = recover_nsecs / 1e9;  // 用时
+    for (int i = 0; i < PHASE_COUNT; ++i)
+    {
+        _cur_result_comput.recoverPhases[i] = ctx.phases[i].stats(recover_nsecs);
+        if (ctx.phases[i].count() > 0)
+        {
+            emit signalWriteInfoLog(QString("[Thread %1] Recovery phase %2: %3 ops, p50 / p90 / p99 / max %4").arg(
+                getCurrentThreadID(), LatencyHistogram::getPhaseName(Phase(i)), QString::number(ctx.phases[i].count()),
+                LatencyHistogram::formatStats(_cur_result_comput.recoverPhases[i])));
+        }
+    }
+    _cur_result_comput.recoveredMBps  = 0.0 == _cur_result_comput.recoveredTime ? 0.0 : ctx.bytesRecovered / 1048576.0 / _cur_result_comput.recoveredTime;
+    _cur_result_comput.recoverThreads = _run_options.recoverThreads;
+    _cur_result_comput.coalesceRatio  = 0 == ctx.sourceReads ? 0.0 : (double)ctx.blocksRecovered / ctx.sourceReads;
+    _cur_result_comput.sourceCacheHits      = ctx.cacheStats.hits;
+    _cur_result_comput.sourceCacheMisses    = ctx.cacheStats.misses;
+    _cur_result_comput.sourceCacheEvictions = ctx.cacheStats.evictions;
+    _cur_result_comput.recoverWriteSyscalls = (syscw_begin < 0 || syscw_end < 0) ? -1 : syscw_end - syscw_begin;
+    _cur_result_comput.recoverWriteMBps     = 0 == out->writeNsecs() ? -1.0 : out->bytesWritten() / 1048576.0 / (out->writeNsecs() / 1e9);  // 多线程恢复时由各线程直接写入，不统计
+    emit signalWriteInfoLog(QString("[Thread %1] Output %2: %3 write syscalls, %4 MB/s").arg(
+        getCurrentThreadID(), OutputFile::getOutputModeName(_run_options.outputMode),
+        QString::number(_cur_result_comput.recoverWriteSyscalls),
+        _cur_result_comput.recoverWriteMBps < 0 ? QString("n/a") : QString::number(_cur_result_comput.recoverWriteMBps, 'f', 2)));
+    if (out->hasError())
+    {
+        emit signalWriteErrorLog(QString("[Thread %1] %2").arg(getCurrentThreadID(), out->lastLog()));
+    }
+    _cur_result_comput.recoverIoInFlight = write_io ? averageInFlight(read_io, write_io) : 0.0;
+    if (write_io)
+    {
+        emit signalWriteInfoLog(QString("[Thread %1] I/O engine %2: %3 read requests, %4 write requests, %5 requests in flight on average").arg(
+            getCurrentThreadID(), write_io->name(), QString::number(read_io ? read_io->requests() : 0),
+            QString::number(write_io->requests()), QString::number(_cur_result_comput.recoverIoInFlight, 'f', 2)));
+    }
+    emit signalWriteInfoLog(QString("[Thread %1] Source file cache (capacity %2 per thread): %3 hits, %4 misses, %5 evictions").arg(
+        getCurrentThreadID(), QString::number(_run_options.sourceCacheCapacity), QString::number(ctx.cacheStats.hits),
+        QString::number(ctx.cacheStats.misses), QString::number(ctx.cacheStats.evictions)));
+
+    // 结果发送到表
+    emit signalCurRecoverResult(_cur_result_comput);
+    delete out;
+    delete read_io;
+    delete write_io;
+    delete fin;
+
+    _last_log = QString("[Thread %1] Successful recovery file to %2<br>"
+                        "Number of unrecoverable blocks %3/%4, Recovery rate %5\%,"
+                        "Use time: %6 sec, %7 MB/s").arg(getCurrentThreadID(), recover_file_path,
+                                                QString::number(ctx.totalUnrecovered),
+                                                QString::number(ctx.numNeedRecover), QString::number(_cur_result_comput.recoveredRate, 'f', 2),
+                                                QString::number(_cur_result_comput.recoveredTime),
+                                                QString::number(_cur_result_comput.recoveredMBps, 'f', 2)));
+    emit signalWriteSuccLog(_last_log);
+
+    /* 解锁按钮 */
+    emit signalSetActivityWidget(true);
+    emit signalSetLbRecoverStyle(ThemeStyle::LABLE_GREEN);
+    emit signalTestRecoverPerformanceFinished(true);
+}
+
+/**
+ * @brief AsyncComputeModule::recoverSerial 逐块恢复：每个哈希单独查询数据库，然后从源文件读取块并按顺序写入恢复的文件
+ * @param ctx 恢复任务上下文
+ */
+void AsyncComputeModule::recoverSerial(RecoverContext& ctx)
+{
+    SourceFileCache sources(_run_options.sourceCacheCapacity, _run_options.inputMode, _run_options.directIo);  // 已经打开的源文件
+    InputFile* curSourceFile = nullptr;            // 用于读取源文件
+    BlockInfo cur_block_info;
+    QByteArray buf_hash;                        // 用于读取块文件中存储的哈希值，读取的长度为 hash_size
+    const QByteArray blank_block(ctx.maxBlockSize, '\0'); // 如果没找到这个哈希值的源数据块，用这个全是 0 的数据填充 '\0' 是 ASCII 表中的空字符，对应二进制 0
+    qint64 cur_block_len = 0;                   // 当前块在恢复的文件中的长度（无法恢复时填充的长度）
+
+    /* 批量解析时每次解析一个窗口的哈希，否则逐条解析 */
+    const qsizetype window = _run_options.bulkResolve ? qMax<qsizetype>(1, _run_options.recoverWindow) : 1;
+    QList<QByteArray> window_hashes;
+    QList<BlockInfo>  window_infos;
+    QList<qint64>     window_sizes;
+    qsizetype i_window = 0;
+
+    while (true)
+    {
+        if (i_window >= window_hashes.size())
+        {
+            if (0 == readRecoverWindow(ctx, window, window_hashes, window_infos, window_sizes))
+            {
+                break;
+            }
+            i_window = 0;
+        }
+        buf_hash       = window_hashes.at(i_window);
+        cur_block_info = window_infos.at(i_window);
+        cur_block_len  = qMin<qint64>(window_sizes.at(i_window), blank_block.size());
+        ++i_window;
+        LOG_DEBUG(QString("[AsyncComputeModule::recoverSerial] Read Hash: %1, In source: %2, Loction: %3, Size: %4").arg(
+            buf_hash.toHex(), cur_block_info.filePath, QString::number(cur_block_info.location), QString::number(cur_block_info.size)));
+        /* 更新进度（ui 定时读取） */
+        updateRecoverProgress(ctx);
+
+        /* 数据库中没有记录当前块 */
+        qint64 mark = ctx.elapsedTime.nsecsElapsed();
+        if (0 == cur_block_info.size)
+        {
+            // out << blank_block;
+            ctx.dout->write(blank_block.constData(), cur_block_len);
+            ctx.phases[PHASE_FILE_WRITE].record(lapNsecs(ctx.elapsedTime, mark));
+            ctx.lastError = QString("No matching hash found in table %1 with given hash %2").arg(ctx.tb, buf_hash.toHex());
+            ++ctx.totalUnrecovered;
+            LOG_DEBUG(ctx.lastError);
+            continue;
+        }
+
+        /* 如果数据库中记录了当前块
+         * 从缓存中获取要读取源数据的源文件（没有打开过的文件会被打开，缓存已满时关闭最久没有使用的文件） */
+        if (nullptr == curSourceFile || curSourceFile->filePath() != cur_block_info.filePath)
+        {
+            curSourceFile = sources.open(cur_block_info.filePath);
+            LOG_LAZY(LOG_LEVEL_DEBUG, _last_log, QString("[Thread %1] Try to open source file %2").arg(getCurrentThreadID(), cur_block_info.filePath));
+        }
+
+        /* 可能出现源文件丢失的情况 */
+        if (!curSourceFile->isOpen())
+        {
+            ctx.phases[PHASE_READ].record(lapNsecs(ctx.elapsedTime, mark));  // 尝试打开源文件
+            ctx.dout->write(blank_block.constData(), cur_block_len);
+            ctx.phases[PHASE_FILE_WRITE].record(lapNsecs(ctx.elapsedTime, mark));
+            ++ctx.totalUnrecovered;
+            ctx.lastError = curSourceFile->lastLog();
+            continue;
+        }
+
+        // out << fin->readFrom(cur_block_info.location, cur_block_info.size);
+        if (ctx.blockPool && !curSourceFile->isMapped() && cur_block_info.size <= ctx.blockPool->frameSize())  // 读入缓冲区池，不为每个块分配内存
+        {
+            char* buf_block = ctx.blockPool->nextFrame();
+            const qint64 len = curSourceFile->readAt(cur_block_info.location, buf_block, cur_block_info.size);
+            ctx.phases[PHASE_READ].record(lapNsecs(ctx.elapsedTime, mark));
+            if ((qint64)cur_block_info.size != len)
+            {
+                ctx.dout->write(blank_block.constData(), cur_block_len);
+                ctx.phases[PHASE_FILE_WRITE].record(lapNsecs(ctx.elapsedTime, mark));
+                ++ctx.totalUnrecovered;
+                ctx.lastError = QString("Unable to read %1 Bytes at %2 from source file %3").arg(
+                    QString::number(cur_block_info.size), QString::number(cur_block_info.location), cur_block_info.filePath);
+                continue;
+            }
+            ctx.dout->write(buf_block, cur_block_info.size);
+        }
+        else
+        {
+            const QByteArray buf_block = curSourceFile->readFrom(cur_block_info.location, cur_block_info.size);
+            ctx.phases[PHASE_READ].record(lapNsecs(ctx.elapsedTime, mark));
+            if ((qint64)cur_block_info.size != buf_block.size())
+            {
+                ctx.dout->write(blank_block.constData(), cur_block_len);
+                ctx.phases[PHASE_FILE_WRITE].record(lapNsecs(ctx.elapsedTime, mark));
+                ++ctx.totalUnrecovered;
+                ctx.lastError = QString("Unable to read %1 Bytes at %2 from source file %3").arg(
+                    QString::number(cur_block_info.size), QString::number(cur_block_info.location), cur_block_info.filePath);
+                continue;
+            }
+            ctx.dout->write(buf_block.constData(), cur_block_info.size);
+        }
+        ctx.phases[PHASE_FILE_WRITE].record(lapNsecs(ctx.elapsedTime, mark));
+        ctx.bytesRecovered += cur_block_info.size;
+        ++ctx.blocksRecovered;
+        ++ctx.sourceReads;
+
+        ++_cur_result_comput.recoveredBlock;  // 成功恢复块的数量（数据库中记录了这个块，并且源文件也成功读取了）
+        LOG_DEBUG(_last_log);
+    }
+
+    ctx.cacheStats = sources.stats();
+}
+
+/**
+ * @brief AsyncComputeModule::recoverAsync 异步恢复：按窗口读取 .bkh 中的哈希并解析块的位置，窗口中所有块的读取请求
+ *  同时交给 I/O 引擎（最多 queue depth 个请求同时进行），全部完成后按顺序写入恢复的文件
+ * @param ctx 恢复任务上下文
+ */
+void AsyncComputeModule::recoverAsync(RecoverContext& ctx)
+{
+    SourceFileCache sources(_run_options.sourceCacheCapacity, InputMode::INPUT_BUFFERED, _run_options.directIo);  // 通过文件描述符读取，不需要内存映射
+    const QByteArray blank_block(ctx.maxBlockSize, '\0');
+    const qsizetype window = qMax<qsizetype>(1, _run_options.recoverWindow);
+    QList<QByteArray> window_hashes;
+    QList<BlockInfo>  window_infos;
+    QList<qint64>     window_sizes;
+    QList<qint64>     offsets;          // 每个块在帧中的位置（-1 表示没有读取）
+    QList<qint64>     heads;            // 直接 I/O 时读取从块之前的对齐位置开始，块在读取的数据中的偏移
+    QList<qint64>     results;          // 每个块的读取结果（读取的字节数，出错时为 -errno）
+    QSet<QString>     batch_files;      // 上次等待之后打开过的源文件
+    char*             data = nullptr;   // 一个窗口的块读入的缓冲区（对齐，直接 I/O 时可以直接读入）
+    qint64            data_capacity = 0;
+
+    qsizetype count = 0;
+    while ((count = readRecoverWindow(ctx, window, window_hashes, window_infos, window_sizes)) > 0)
+    {
+        qint64 frame_size = 0;
+        for (qsizetype i = 0; i < count; ++i)
+        {
+            const BlockInfo& info = window_infos.at(i);
+            frame_size += (_run_options.directIo && info.size > 0) ? alignDirect(info.location % DIRECT_IO_ALIGNMENT + info.size) : info.size;
+        }
+        if (data_capacity < frame_size)
+        {
+            qFreeAligned(data);
+            data_capacity = frame_size;
+            data = static_cast<char*>(qMallocAligned(data_capacity, DIRECT_IO_ALIGNMENT));
+            Q_CHECK_PTR(data);
+        }
+
+        offsets.fill(-1, count);
+        heads.fill(0, count);
+        results.fill(0, count);
+        batch_files.clear();
+        qint64 pos = 0;
+        qint64 mark = ctx.elapsedTime.nsecsElapsed();  // 整个窗口的读取（提交 + 等待全部完成）计为一次
+        for (qsizetype i = 0; i < count; ++i)
+        {
+            const BlockInfo& info = window_infos.at(i);
+            if (0 == info.size)
+            {
+                continue;
+            }
+
+            /* 缓存已满时打开新的文件会关闭最久没有使用的文件：先等待已经提交的请求完成，避免文件描述符在请求完成之前被关闭（或者被重用） */
+            if (!batch_files.contains(info.filePath) && (size_t)batch_files.size() >= sources.capacity())
+            {
+                for (const IoEngine::Completion& done : ctx.io->wait())
+                {
+                    results[done.tag] = done.result;
+                }
+                batch_files.clear();
+            }
+            batch_files.insert(info.filePath);
+
+            InputFile* source = sources.open(info.filePath);
+            if (!source->isOpen())  // 可能出现源文件丢失的情况
+            {
+                ctx.lastError = source->lastLog();
+                continue;
+            }
+            /* 直接 I/O 时读取覆盖块的对齐区间 */
+            const qint64 head = source->isDirect() ? info.location % DIRECT_IO_ALIGNMENT : 0;
+            const qint64 span = source->isDirect() ? alignDirect(head + info.size) : info.size;
+            offsets[i] = pos + head;
+            heads[i]   = head;
+            ctx.io->read(source->handle(), data + pos, span, info.location - head, i);
+            pos += _run_options.directIo ? alignDirect(span) : span;  // 后面的块读入的位置保持对齐（不支持直接 I/O 的源文件也一样）
+        }
+        for (const IoEngine::Completion& done : ctx.io->wait())
+        {
+            results[done.tag] = done.result;
+        }
+        ctx.phases[PHASE_READ].record(lapNsecs(ctx.elapsedTime, mark));
+
+        /* 按顺序写入，无法恢复的块用 0 填充 */
+        for (qsizetype i = 0; i < count; ++i)
+        {
+            const BlockInfo& info = window_infos.at(i);
+            mark = ctx.elapsedTime.nsecsElapsed();
+            if (offsets.at(i) >= 0 && results.at(i) >= heads.at(i) + (qint64)info.size)
+            {
+                ctx.dout->write(data + offsets.at(i), info.size);
+                ctx.phases[PHASE_FILE_WRITE].record(lapNsecs(ctx.elapsedTime, mark));
+                ctx.bytesRecovered += info.size;
+                ++ctx.blocksRecovered;
+                ++ctx.sourceReads;
+                ++_cur_result_comput.recoveredBlock;
+                continue;
+            }
+
+            ctx.dout->write(blank_block.constData(), qMin<qint64>(window_sizes.at(i), blank_block.size()));
+            ctx.phases[PHASE_FILE_WRITE].record(lapNsecs(ctx.elapsedTime, mark));
+            ++ctx.totalUnrecovered;
+            if (0 == info.size)
+            {
+                ctx.lastError = QString("No matching hash found in table %1 with given hash %2").arg(ctx.tb, window_hashes.at(i).toHex());
+            }
+            else if (offsets.at(i) >= 0)
+            {
+                ctx.lastError = QString("Unable to read %1 Bytes at %2 from source file %3").arg(
+                    QString::number(info.size), QString::number(info.location), info.filePath);
+            }
+        }
+
+        updateRecoverProgress(ctx);  // 每个窗口一次
+    }
+
+    qFreeAligned(data);
+    ctx.cacheStats = sources.stats();
+}
+
+/**
+ * @brief AsyncComputeModule::recoverParallel 多线程恢复：按窗口读取 .bkh 中的哈希并解析块的位置，
+ *  然后交给 RecoverEngine 由多个线程并行读取源文件，每个块用 pwrite 直接写到恢复文件中的最终位置
+ *  （块的位置是之前所有块的长度之和，固定大小分块时第 i 个块位于 i * block_size）
+ * @param ctx 恢复任务上下文
+ */
+void AsyncComputeModule::recoverParallel(RecoverContext& ctx)
+{
+    const qsizetype window = qMax<qsizetype>(1, _run_options.recoverWindow);
+    const size_t recovered_base = _cur_result_comput.recoveredBlock;
+
+    RecoverEngine engine(ctx.out, ctx.blockSize, _run_options.recoverThreads);
+    engine.setInputMode(_run_options.inputMode);
+    engine.setSourceCacheCapacity(_run_options.sourceCacheCapacity);
+    engine.setDirectIo(_run_options.directIo);
+    engine.start();
+    emit signalWriteInfoLog(QString("[Thread %1] Recover engine started with %2 threads, window %3 blocks, sorted read-ahead %4").arg(
+        getCurrentThreadID(), QString::number(engine.numWorkers()), QString::number(window), _run_options.sortedRecover ? "yes" : "no"));
+
+    QList<QByteArray> window_hashes;        // 当前窗口中的哈希（按 .bkh 中的顺序）
+    QList<BlockInfo>  window_infos;         // 与 window_hashes 一一对应的块的位置
+    QList<qint64>     window_sizes;         // 与 window_hashes 一一对应的块在恢复的文件中的长度
+    QList<qint64>     window_offsets;       // 与 window_hashes 一一对应的块在恢复的文件中的位置
+    qint64 out_offset = 0;                  // 下一个块在恢复的文件中的位置
+
+    /* 读取一个窗口的哈希并解析块的位置 */
+    while (readRecoverWindow(ctx, window, window_hashes, window_infos, window_sizes) > 0)
+    {
+        window_offsets.clear();
+        for (const qint64 size : std::as_const(window_sizes))
+        {
+            window_offsets.append(out_offset);
+            out_offset += size;
+        }
+
+        /* 提交给恢复引擎（队列已满时阻塞） */
+        if (_run_options.sortedRecover)
+        {
+            submitSortedWindow(engine, window_infos, window_offsets, window_sizes);
+        }
+        else
+        {
+            for (qsizetype i = 0; i < window_infos.size(); ++i)
+            {
+                engine.submit(window_offsets.at(i), window_infos.at(i), window_sizes.at(i));
+            }
+        }
+
+        /* 更新进度（每个窗口一次） */
+        ctx.totalUnrecovered              = engine.unrecoveredBlocks();
+        _cur_result_comput.recoveredBlock = recovered_base + engine.recoveredBlocks();
+        updateRecoverProgress(ctx);
+    }
+
+    engine.stop();
+    ctx.totalUnrecovered              = engine.unrecoveredBlocks();
+    ctx.bytesRecovered                = engine.bytesRecovered();
+    ctx.sourceReads                   = engine.sourceReads();
+    ctx.blocksRecovered               = engine.recoveredBlocks();
+    ctx.cacheStats                    = engine.sourceCacheStats();
+    ctx.phases[PHASE_READ].merge(engine.readLatency());
+    ctx.phases[PHASE_FILE_WRITE].merge(engine.writeLatency());
+    ctx.lastError                     = engine.lastLog();
+    _cur_result_comput.recoveredBlock = recovered_base + engine.recoveredBlocks();
+
+    emit signalWriteInfoLog(QString("[Thread %1] Recovered %2 blocks with %3 source reads (%4 blocks per read)").arg(
+        getCurrentThreadID(), QString::number(ctx.blocksRecovered), QString::number(ctx.sourceReads),
+        QString::number(0 == ctx.sourceReads ? 0.0 : (double)ctx.blocksRecovered / ctx.sourceReads, 'f', 2)));
+}
+
+/**
+ * @brief AsyncComputeModule::submitSortedWindow 排序恢复：把一个窗口中的块按 (源文件, 位置) 排序，
+ *  相邻（或重叠）的块合并成一次大的顺序读取，读取后再分别写回各自在恢复文件中的位置
+ * @param engine 恢复引擎
+ * @param infos 窗口中每个块的位置（按 .bkh 中的顺序）
+ * @param out_offsets 窗口中每个块在恢复的文件中的位置
+ * @param sizes 窗口中每个块在恢复的文件中的长度
+ */
+void AsyncComputeModule::submitSortedWindow(RecoverEngine& engine, const QList<BlockInfo>& infos,
+                                            const QList<qint64>& out_offsets, const QList<qint64>& sizes)
+{
+    QList<qsizetype> order(infos.size());
+    std::iota(order.begin(), order.end(), 0);
+    std::stable_sort(order.begin(), order.end(), [&infos](const qsizetype a, const qsizetype b) {
+        const BlockInfo& x = infos.at(a);
+        const BlockInfo& y = infos.at(b);
+        return x.filePath != y.filePath ? x.filePath < y.filePath : x.location < y.location;
+    });
+
+    BlockInfo range;                        // 当前合并的读取范围
+    QList<RecoverEngine::Piece> pieces;     // 范围中的块
+    for (const qsizetype i : std::as_const(order))
+    {
+        const BlockInfo& info = infos.at(i);
+        const qint64 out_offset = out_offsets.at(i);
+        if (0 == info.size)  // 数据库中没有记录的块单独提交
+        {
+            engine.submit(out_offset, info, sizes.at(i));
+            continue;
+        }
+
+        /* 不同的文件、中间有空隙或者超过最大读取长度时，提交当前范围 */
+        const qint64 range_end = range.location + range.size;
+        const qint64 info_end  = info.location + info.size;
+        if (range.size > 0 && (info.filePath != range.filePath || info.location > range_end
+                               || qMax(range_end, info_end) - range.location > RECOVER_MAX_READ_SIZE))
+        {
+            engine.submitRange(range, pieces);
+            range = BlockInfo();
+            pieces.clear();
+        }
+
+        if (0 == range.size)
+        {
+            range = info;
+        }
+        else
+        {
+            range.size = qMax(range_end, info_end) - range.location;
+        }
+        pieces.append(RecoverEngine::Piece{out_offset, info.location - range.location, (qint64)info.size});
+    }
+
+    if (range.size > 0)
+    {
+        engine.submitRange(range, pieces);
+    }
+}
+
+/**
+ * @brief AsyncComputeModule::readRecoverWindow 从 .bkh 文件读取下一个窗口的哈希并解析块的位置。
+ *  批量解析时整个窗口只需要一次数据库往返（getBlockInfos），否则窗口中每个不同的哈希一次往返（getBlockInfo，有查询线程时并行）
+ * @param ctx 恢复任务上下文
+ * @param window 最多读取的哈希条数
+ * @param hashes [输出] 读取的哈希（按 .bkh 中的顺序）
+ * @param infos [输出] 与 hashes 一一对应的块的位置（数据库中没有记录的块 size 为 0）
+ * @param sizes [输出] 与 hashes 一一对应的块在恢复的文件中的长度（固定大小分块时为 block_size，否则为 .bkh 中记录的长度）
+ * @return 读取的哈希条数（0 表示 .bkh 文件已经读完）
+ */
+qsizetype AsyncComputeModule::readRecoverWindow(RecoverContext& ctx, const qsizetype window,
+                                                QList<QByteArray>& hashes, QList<BlockInfo>& infos, QList<qint64>& sizes)
+{
+    hashes.clear();
+    sizes.clear();
+    qint64 mark = ctx.elapsedTime.nsecsElapsed();
+
+    /* 使用缓冲区池时整个窗口的记录一次读入，哈希是缓冲区的视图（在读取下一个窗口之前有效） */
+    if (ctx.recordPool)
+    {
+        char* frame = ctx.recordPool->nextFrame();
+        const qint64 len = qMax<qint64>(0, ctx.fin->readInto(frame, window * ctx.recordSize));
+        for (qint64 offset = 0; offset + (qint64)ctx.recordSize <= len; offset += ctx.recordSize)
+        {
+            hashes.append(QByteArray::fromRawData(frame + offset, ctx.hashSize));
+            sizes.append(ctx.variableBlocks ? qFromBigEndian<quint32>(frame + offset + ctx.hashSize) : ctx.blockSize);
+        }
+    }
+    else
+    {
+        while (hashes.size() < window && !ctx.fin->atEnd())
+        {
+            if (!ctx.variableBlocks)
+            {
+                hashes.append(ctx.fin->read(ctx.hashSize));
+                sizes.append(ctx.blockSize);
+                continue;
+            }
+
+            const QByteArray record = ctx.fin->read(ctx.recordSize);  // 哈希 + 块的长度（4 字节，大端）
+            if ((size_t)record.size() < ctx.recordSize)
+            {
+                break;
+            }
+            hashes.append(record.left(ctx.hashSize));
+            sizes.append(qFromBigEndian<quint32>(record.constData() + ctx.hashSize));
+        }
+    }
+
+    ctx.phases[PHASE_READ].record(lapNsecs(ctx.elapsedTime, mark));
+
+    if (_run_options.bulkResolve)
+    {
+        if (!_index->getBlockInfos(ctx.tb, hashes, infos))
+        {
+            emit signalWriteErrorLog(QString("[Thread %1] %2").arg(getCurrentThreadID(), _index->lastLog()));
+        }
+        ctx.phases[PHASE_DB_LOOKUP].record(lapNsecs(ctx.elapsedTime, mark));
+        return hashes.size();
+    }
+
+    if (ctx.lookupPool && !hashes.isEmpty())
+    {
+        resolveWindowParallel(ctx, hashes, infos);
+        return hashes.size();
+    }
+
+    QHash<QByteArray, BlockInfo> resolved;  // 同一个哈希只查询一次
+    infos.clear();
+    infos.reserve(hashes.size());
+    for (const QByteArray& buf_hash : std::as_const(hashes))
+    {
+        auto it = resolved.constFind(buf_hash);
+        if (resolved.constEnd() == it)
+        {
+            mark = ctx.elapsedTime.nsecsElapsed();
+            it = resolved.insert(buf_hash, _index->getBlockInfo(ctx.tb, buf_hash));
+            ctx.phases[PHASE_DB_LOOKUP].record(lapNsecs(ctx.elapsedTime, mark));
+        }
+        infos.append(it.value());
+    }
+    return hashes.size();
+}
+
+/**
+ * @brief AsyncComputeModule::resolveWindowParallel 窗口中不同的哈希平均分为（查询线程数 + 1）份，
+ *  计算线程和查询线程各查询一份（每个线程使用自己的数据库连接，每个哈希一次往返）
+ * @param ctx 恢复任务上下文
+ * @param hashes 窗口中的哈希（不能为空）
+ * @param infos [输出] 与 hashes 一一对应的块的位置（数据库中没有记录的块 size 为 0）
+ */
+void AsyncComputeModule::resolveWindowParallel(RecoverContext& ctx, const QList<QByteArray>& hashes, QList<BlockInfo>& infos)
+{
+    QHash<QByteArray, qsizetype> positions;  // 哈希 -> 在 unique_hashes 中的位置（同一个哈希只查询一次）
+    QList<QByteArray> unique_hashes;
+    unique_hashes.reserve(hashes.size());
+    for (const QByteArray& hash : hashes)
+    {
+        if (!positions.contains(hash))
+        {
+            positions.insert(hash, unique_hashes.size());
+            unique_hashes.append(hash);
+        }
+    }
+
+    const qsizetype num_unique = unique_hashes.size();
+    const int num_slices = (int)qMin<qsizetype>(ctx.lookupPool->maxThreadCount() + 1, num_unique);
+    QList<BlockInfo> unique_infos(num_unique);
+    QList<LatencyHistogram> latencies(num_slices);
+    QList<QString> errors(num_slices);
+
+    /* 每份只写自己范围内的结果、自己的直方图和错误，不需要加锁 */
+    const QByteArray* in   = unique_hashes.constData();
+    BlockInfo* out         = unique_infos.data();
+    LatencyHistogram* hist = latencies.data();
+    QString* error         = errors.data();
+    const QString& tb      = ctx.tb;
+    DedupIndex* index = _index;
+    auto resolve_slice = [=, &tb](const int slice) {
+        if (!index->isOpen())  // 查询线程第一次查询时打开（从连接池获得）自己的连接
+        {
+            error[slice] = index->lastLog();
+            return;
+        }
+        QElapsedTimer timer;
+        timer.start();
+        qint64 mark = 0;
+        for (qsizetype i = num_unique * slice / num_slices; i < num_unique * (slice + 1) / num_slices; ++i)
+        {
+            out[i] = index->getBlockInfo(tb, in[i]);
+            hist[slice].record(lapNsecs(timer, mark));
+        }
+    };
+
+    QSemaphore done;
+    for (int slice = 1; slice < num_slices; ++slice)
+    {
+        ctx.lookupPool->start([resolve_slice, &done, slice]() {
+            resolve_slice(slice);
+            done.release();
+        });
+    }
+    resolve_slice(0);
+    done.acquire(num_slices - 1);  // 不能用 waitForDone：它会结束线程，下一个窗口需要重新打开连接
+
+    for (int slice = 0; slice < num_slices; ++slice)
+    {
+        ctx.phases[PHASE_DB_LOOKUP].merge(latencies.at(slice));
+        if (!errors.at(slice).isEmpty())
+        {
+            ctx.lastError = errors.at(slice);  // 这一份的块都无法恢复，恢复结束后汇总
+        }
+    }
+
+    infos.clear();
+    infos.reserve(hashes.size());
+    for (const QByteArray& hash : hashes)
+    {
+        infos.append(unique_infos.at(positions.value(hash)));
+    }
+}
+
+/**
+ * @brief AsyncComputeModule::updateRecoverProgress 更新恢复进度的计数器（只写原子变量，不发送信号，ui 定时读取）
+ * @param ctx 恢复任务上下文
+ */
+void AsyncComputeModule::updateRecoverProgress(const RecoverContext& ctx)
+{
+    _progress.position.store(ctx.fin->curPtrPostion(), std::memory_order_relaxed);
+    _progress.recovered.store(_cur_result_comput.recoveredBlock, std::memory_order_relaxed);
+    _progress.unrecovered.store(ctx.totalUnrecovered, std::memory_order_relaxed);
+    _progress.recoverNsecs.store(ctx.elapsedTime.nsecsElapsed(), std::memory_order_relaxed);
+}
+
+/**
+ * @brief AsyncComputeModule::runTestSingal 执行单步测试（分块性能 + 恢复性能）
+ * @param source_file_path 源文件路径
+ * @param unqiue_block_file_path 存储块的文件
+ * @param block_hash_file_path 存储哈希块的文件
+ * @param recover_file_path 要恢复至的文件的文件名
+ * @param alg 哈希算法
+ * @param block_size 块大小
+ */
+void AsyncComputeModule::runSingleTest(const QString &source_file_path, const QString& unqiue_block_file_path, const QString &block_hash_file_path,
+                                       const QString &recover_file_path, const HashAlg alg, const size_t block_size)
+{
+    emit signalWriteInfoLog(QString("[Thread %1] Start to run Singal Test").arg(getCurrentThreadID()));
+
+    /* 打开去重索引（PostgreSQL 需要已经连接数据库） */
+    if (!openDedupIndex(block_hash_file_path))
+    {
+        _last_log = QString("[Thread %1] %2, test exit").arg(getCurrentThreadID(), _index->lastLog());
+        emit signalWriteErrorLog(_last_log);
+        emit signalWarnBox(_last_log);
+
+        emit signalSetActivityWidget(true);
+        emit signalTestRecoverPerformanceFinished(false);
+        return;
+    }
+
+    runTestSegmentationProfmance(source_file_path, unqiue_block_file_path, block_hash_file_path, alg, block_size);
+    runTestRecoverProfmance(recover_file_path, block_hash_file_path, alg, block_size);
+
+    emit signalWriteSuccLog(QString("[Thread %1] Singal Test done").arg(getCurrentThreadID()));
+}
+
+
+/**
+ * @brief AsyncComputeModule::runBenchmarkTest 自动执行基准测试
+ * @param source_file_path 源文件路径
+ * @param unqiue_block_file_path 存储块的文件
+ * @param block_hash_file_path 存储哈希块的文件
+ * @param recover_file_path 要恢复至的文件的文件名
+ * @param alg 哈希算法
+ * @param block_size_list
+ */
+void AsyncComputeModule::runBenchmarkTest(const QString &source_file_path, const QString& unqiue_block_file_path,
                                           const QString &block_hash_file_path, const QString &recover_file_path,
                                           const HashAlg alg, const QList<size_t> &block_size_list)
 {
@@ -582,10 +2023,10 @@ void AsyncComputeModule::runBenchmarkTest(const QString &source_file_path, const
     /* 为了避免意外操作，暂时禁用按钮 */
     emit signalSetActivityWidget(false);
 
-    /* 数据库无连接 */
-    if (!_dbs->isDatabaseOpen())
+    /* 打开去重索引（PostgreSQL 需要已经连接数据库） */
+    if (!openDedupIndex(block_hash_file_path))
     {
-        _last_log = QString("[Thread %1] Database do not connected, test exit").arg(getCurrentThreadID());
+        _last_log = QString("[Thread %1] %2, test exit").arg(getCurrentThreadID(), _index->lastLog());
         emit signalWriteErrorLog(_last_log);
         emit signalWarnBox(_last_log);
 
@@ -595,26 +2036,280 @@ void AsyncComputeModule::runBenchmarkTest(const QString &source_file_path, const
     }
 
     QString tb;
+    const RunOptions base_options = _run_options;
+    const QList<RunOptions> variants = getBenchmarkVariants();  // 第一个总是基础参数，其余是用于对比的变体
+    const qsizetype first_depth_variant = variants.size() - base_options.benchmarkQueueDepths.size();  // 队列深度扫描的变体在最后
     for (size_t block_size : block_size_list)
     {
-        /* 保证测试准确，每次都先删除指定表  */
-        tb = getTableName(block_size, alg);
-        if (_dbs->isTableExists(tb))
+        for (qsizetype i = 0; i < variants.size(); ++i)
         {
+            _run_options = variants.at(i);
+
+            /* 保证测试准确，每次都先删除指定表  */
+            tb = getTableName(block_size, alg);
+            if (openDedupIndex(block_hash_file_path) && _index->isTableExists(tb))
+            {
+
+                _index->deleteTable(tb);
+            }
+
+            emit signalWriteInfoLog(QString("[Thread %1] Benchmark Test with Block Size %2 Bytes, Hash-Alg %3, Segmentation mode %4, Input %5, Chunking %6, Buffer pool %7, Output %8, I/O engine %9 (QD %10), Direct I/O %11, Schema %12, Partitions %13, Index %14").arg(
+                getCurrentThreadID(), QString::number(block_size), Hash::getHashName(alg), RunOptions::getSegModeName(_run_options.segMode),
+                InputFile::getInputModeName(_run_options.inputMode), RunOptions::getChunkModeName(_run_options.chunkMode),
+                _run_options.useBufferPool ? "yes" : "no", OutputFile::getOutputModeName(_run_options.outputMode),
+                IoEngine::getIoEngineModeName(_run_options.ioEngine), QString::number(_run_options.queueDepth),
+                _run_options.directIo ? "yes" : "no", RunOptions::getSchemaVersionName(_run_options.schemaVersion),
+                QString::number(_run_options.tablePartitions), DedupIndex::getIndexBackendName(_run_options.indexBackend)));
+
+            runTestSegmentationProfmance(source_file_path, unqiue_block_file_path, block_hash_file_path, alg, block_size);
+            if (0 == i)  // 只有基础参数的结果会画到图表上
+            {
+                emit signalAddPointSegTimeAndRepeateRate(_cur_result_comput);
+            }
+            if ((0 == i || _run_options.tablePartitions != base_options.tablePartitions) && block_size == block_size_list.first())  // 吞吐量曲线只画第一个块大小的分区 / 不分区的结果
+            {
+                emit signalAddPointIngestCurve(_cur_result_comput);
+            }
+
+            runTestRecoverProfmance(recover_file_path, block_hash_file_path, alg, block_size);
+            if (0 == i)
+            {
+                emit signalAddPointRecoverTime(_cur_result_comput);
+            }
+            if (i >= first_depth_variant && block_size == block_size_list.first())  // 队列深度图表只画第一个块大小的结果
+            {
+                emit signalAddPointQueueDepth(_cur_result_comput);
+            }
+        }
+    }
+    _run_options = base_options;
+
+    emit signalWriteSuccLog(QString("[Thread %1] Benchmark Test done").arg(getCurrentThreadID()));
+}
 
-            _dbs->deleteTable(tb);
+/**
+ * @brief AsyncComputeModule::setRunOptions 设置之后计算任务的运行参数
+ * @param options 运行参数
+ */
+void AsyncComputeModule::setRunOptions(const RunOptions& options)
+{
+    _run_options = options;
+    const auto yesNo = [](const bool on) { return QString(on ? "yes" : "no"); };
+    const QList<QPair<QString, QString>> fields = {
+        {"seg-mode",            RunOptions::getSegModeName(_run_options.segMode)},
+        {"batch-size",          QString::number(_run_options.batchSize)},
+        {"compare-ingest",      yesNo(_run_options.compareIngest)},
+        {"hash-index",          yesNo(_run_options.useHashIndex)},
+        {"preload-index",       yesNo(_run_options.preloadHashIndex)},
+        {"hash-threads",        QString::number(_run_options.hashThreads)},
+        {"recover-threads",     QString::number(_run_options.recoverThreads)},
+        {"recover-window",      QString::number(_run_options.recoverWindow)},
+        {"bulk-resolve",        yesNo(_run_options.bulkResolve)},
+        {"sorted-recover",      yesNo(_run_options.sortedRecover)},
+        {"input",               InputFile::getInputModeName(_run_options.inputMode)},
+        {"compare-input",       yesNo(_run_options.compareInput)},
+        {"source-cache",        QString::number(_run_options.sourceCacheCapacity)},
+        {"chunking",            RunOptions::getChunkModeName(_run_options.chunkMode)},
+        {"cdc-min-div",         QString::number(_run_options.cdcMinDivisor)},
+        {"cdc-max-mul",         QString::number(_run_options.cdcMaxMultiplier)},
+        {"compare-chunking",    yesNo(_run_options.compareChunking)},
+        {"buffer-pool",         yesNo(_run_options.useBufferPool)},
+        {"compare-buffer-pool", yesNo(_run_options.compareBufferPool)},
+        {"output",              OutputFile::getOutputModeName(_run_options.outputMode)},
+        {"output-buffer",       QString::number(_run_options.outputBufferMB)},
+        {"writev",              yesNo(_run_options.outputWritev)},
+        {"compare-output",      yesNo(_run_options.compareOutput)},
+        {"io-engine",           IoEngine::getIoEngineModeName(_run_options.ioEngine)},
+        {"queue-depth",         QString::number(_run_options.queueDepth)},
+        {"queue-depths",        _run_options.benchmarkQueueDepths.isEmpty() ? QString("none") : RunOptions::joinQueueDepths(_run_options.benchmarkQueueDepths)},
+        {"direct-io",           yesNo(_run_options.directIo)},
+        {"schema",              RunOptions::getSchemaVersionName(_run_options.schemaVersion)},
+        {"compare-schema",      yesNo(_run_options.compareSchema)},
+        {"db-connections",      QString::number(_run_options.dbConnections)},
+        {"partitions",          QString::number(_run_options.tablePartitions)},
+        {"compare-partitions",  yesNo(_run_options.comparePartitions)},
+        {"index",               DedupIndex::getIndexBackendName(_run_options.indexBackend)},
+        {"compare-index",       yesNo(_run_options.compareIndex)},
+        {"index-path",          _run_options.indexPath.isEmpty() ? QString(IndexBackend::INDEX_HASHFILE == _run_options.indexBackend ? HASHFILE_INDEX_DIR_NAME : SQLITE_INDEX_FILE_NAME)
+                                                                 : _run_options.indexPath}
+    };
+
+    // 每个参数一行（名称与命令行选项相同）
+    emit signalWriteInfoLog(QString("[Thread %1] Run options:").arg(getCurrentThreadID()));
+    for (const QPair<QString, QString>& field : fields)
+    {
+        emit signalWriteInfoLog(QString("[Thread %1]   %2=%3").arg(getCurrentThreadID(), field.first, field.second));
+    }
+}
+
+/**
+ * @brief AsyncComputeModule::openDedupIndex 按运行参数选择去重索引的后端：PostgreSQL 需要已经连接数据库，
+ *  SQLite 打开（不存在时创建）数据库文件，哈希表文件打开（不存在时创建）索引目录，之后的块信息表操作都通过 _index 进行
+ * @param block_hash_file_path .bkh 文件路径（没有指定 SQLite 数据库文件或者索引目录时，它们在 .bkh 所在的目录中）
+ * @return 是否可用（失败时原因在 _index->lastLog()）
+ */
+bool AsyncComputeModule::openDedupIndex(const QString& block_hash_file_path)
+{
+    if (IndexBackend::INDEX_HASHFILE == _run_options.indexBackend)
+    {
+        _index = _hashfile;
+        const QString path = _run_options.indexPath.isEmpty() ? QFileInfo(block_hash_file_path).dir().filePath(HASHFILE_INDEX_DIR_NAME)
+                                                              : _run_options.indexPath;
+        if (QFileInfo(path).absoluteFilePath() == _hashfile->dirPath())
+        {
+            return true;
         }
+        if (!_hashfile->open(path))
+        {
+            return false;
+        }
+        emit signalWriteSuccLog(QString("[Thread %1] %2").arg(getCurrentThreadID(), _hashfile->lastLog()));
+        return true;
+    }
 
-        emit signalWriteInfoLog(QString("[Thread %1] Benchmark Test with Block Size %2 Bytes, Hash-Alg %3").arg(getCurrentThreadID(), QString::number(block_size), Hash::getHashName(alg)));
+    if (IndexBackend::INDEX_SQLITE == _run_options.indexBackend)
+    {
+        _index = _sqlite;
+        const QString path = _run_options.indexPath.isEmpty() ? QFileInfo(block_hash_file_path).dir().filePath(SQLITE_INDEX_FILE_NAME)
+                                                              : _run_options.indexPath;
+        if (QFileInfo(path).absoluteFilePath() == _sqlite->filePath())
+        {
+            return _sqlite->isOpen();
+        }
+        if (!_sqlite->open(path))
+        {
+            return false;
+        }
+        emit signalWriteSuccLog(QString("[Thread %1] %2").arg(getCurrentThreadID(), _sqlite->lastLog()));
+        return true;
+    }
 
-        runTestSegmentationProfmance(source_file_path, unqiue_block_file_path, block_hash_file_path, alg, block_size);
-        emit signalAddPointSegTimeAndRepeateRate(_cur_result_comput);
+    _index = _dbs;
+    return _dbs->isDatabaseOpen();
+}
 
-        runTestRecoverProfmance(recover_file_path, block_hash_file_path, alg, block_size);
-        emit signalAddPointRecoverTime(_cur_result_comput);
+/**
+ * @brief AsyncComputeModule::logDbConnectionStats 记录连接池中每个用过的连接在当前任务中的查询次数和等待连接的时间
+ */
+void AsyncComputeModule::logDbConnectionStats()
+{
+    for (const DbConnectionStats& stats : _index->connectionStats())
+    {
+        if (stats.queries > 0)
+        {
+            emit signalWriteInfoLog(QString("[Thread %1] DB connection %2: %3 queries, waited %4 ms for the connection").arg(
+                getCurrentThreadID(), stats.name, QString::number(stats.queries), QString::number(stats.waitNsecs / 1e6, 'f', 2)));
+        }
     }
+}
 
-    emit signalWriteSuccLog(QString("[Thread %1] Benchmark Test done").arg(getCurrentThreadID()));
+/**
+ * @brief AsyncComputeModule::progress 当前任务的进度计数器（可以在其他线程中读取）
+ * @return
+ */
+const ProgressCounters& AsyncComputeModule::progress() const
+{
+    return _progress;
+}
+
+/**
+ * @brief AsyncComputeModule::getBenchmarkVariants 根据当前运行参数生成基准测试中每个块大小要运行的参数组合
+ * @return 第一个元素是当前参数本身，之后是用于对比的变体
+ */
+QList<RunOptions> AsyncComputeModule::getBenchmarkVariants() const
+{
+    QList<RunOptions> variants;
+    variants.append(_run_options);
+
+    /* 对比逐块写入和 COPY 批量导入 */
+    if (_run_options.compareIngest)
+    {
+        for (SegMode mode : {SegMode::SEG_ROW, SegMode::SEG_COPY})
+        {
+            if (mode != _run_options.segMode)
+            {
+                RunOptions variant = _run_options;
+                variant.segMode = mode;
+                variants.append(variant);
+            }
+        }
+    }
+
+    /* 对比普通读取和内存映射读取 */
+    if (_run_options.compareInput)
+    {
+        RunOptions variant = _run_options;
+        variant.inputMode = (InputMode::INPUT_MAPPED == _run_options.inputMode) ? InputMode::INPUT_BUFFERED : InputMode::INPUT_MAPPED;
+        variants.append(variant);
+    }
+
+    /* 对比固定大小分块和基于内容分块（块大小列表即基于内容分块的平均块大小） */
+    if (_run_options.compareChunking)
+    {
+        RunOptions variant = _run_options;
+        variant.chunkMode = (ChunkMode::CHUNK_CDC == _run_options.chunkMode) ? ChunkMode::CHUNK_FIXED : ChunkMode::CHUNK_CDC;
+        variants.append(variant);
+    }
+
+    /* 对比使用和不使用缓冲区池（每个块的堆分配次数） */
+    if (_run_options.compareBufferPool)
+    {
+        RunOptions variant = _run_options;
+        variant.useBufferPool = !_run_options.useBufferPool;
+        variants.append(variant);
+    }
+
+    /* 对比逐块写入和聚合写入（写入的系统调用次数和吞吐量） */
+    if (_run_options.compareOutput)
+    {
+        RunOptions variant = _run_options;
+        variant.outputMode = (OutputMode::OUTPUT_STREAM == _run_options.outputMode) ? OutputMode::OUTPUT_AGGREGATED : OutputMode::OUTPUT_STREAM;
+        variants.append(variant);
+    }
+
+    /* 对比 v1 和 v2 表结构（表和索引的大小、查询延迟） */
+    if (_run_options.compareSchema)
+    {
+        RunOptions variant = _run_options;
+        variant.schemaVersion = (SchemaVersion::SCHEMA_V2 == _run_options.schemaVersion) ? SchemaVersion::SCHEMA_V1 : SchemaVersion::SCHEMA_V2;
+        variants.append(variant);
+    }
+
+    /* 对比分区和不分区的块信息表（吞吐量随写入行数的变化） */
+    if (_run_options.comparePartitions)
+    {
+        RunOptions variant = _run_options;
+        variant.tablePartitions = _run_options.tablePartitions > 0 ? 0 : DEFAULT_TABLE_PARTITIONS;
+        variants.append(variant);
+    }
+
+    /* 对比去重索引的后端（SQL 数据库和内存映射的哈希表文件的吞吐量、查询延迟）。其他后端使用 .bkh 所在目录中的默认位置 */
+    if (_run_options.compareIndex)
+    {
+        for (IndexBackend backend : {IndexBackend::INDEX_POSTGRESQL, IndexBackend::INDEX_SQLITE, IndexBackend::INDEX_HASHFILE})
+        {
+            if (backend == _run_options.indexBackend
+                || (IndexBackend::INDEX_POSTGRESQL == backend && !_dbs->isDatabaseOpen()))
+            {
+                continue;
+            }
+            RunOptions variant = _run_options;
+            variant.indexBackend = backend;
+            variant.indexPath.clear();
+            variants.append(variant);
+        }
+    }
+
+    /* 队列深度扫描：以 io_uring 和每个队列深度各运行一次（必须在最后，runBenchmarkTest 据此判断哪些结果画到队列深度图表上） */
+    for (const int depth : _run_options.benchmarkQueueDepths)
+    {
+        RunOptions variant = _run_options;
+        variant.ioEngine   = IoEngineMode::IO_ENGINE_URING;
+        variant.queueDepth = depth;
+        variants.append(variant);
+    }
+
+    return variants;
 }
 
 QString AsyncComputeModule::getCurrentThreadID() const
@@ -623,13 +2318,56 @@ QString AsyncComputeModule::getCurrentThreadID() const
 }
 
 /**
- * @brief AsyncComputeModule::getTableName 根据算法和块大小构建表名
+ * @brief AsyncComputeModule::getTableName 根据算法和块大小构建表名（基于内容分块时使用单独的表，块大小为平均块大小）
  * @param block_size 块大小
  * @param alg 哈希算法
  * @return
  */
 QString AsyncComputeModule::getTableName(const size_t block_size, const HashAlg alg)
 {
-    return QString("tb_%1bytes_%2").arg(QString::number(block_size), Hash::getHashName(alg)).toLower();
+    QString tb = QString("tb_%1bytes_%2").arg(QString::number(block_size), Hash::getHashName(alg)).toLower();
+    if (ChunkMode::CHUNK_CDC == _run_options.chunkMode)
+    {
+        tb.append("_cdc");
+    }
+    if (_run_options.tablePartitions > 0 && IndexBackend::INDEX_POSTGRESQL == _run_options.indexBackend)  // 只有 PostgreSQL 支持分区
+    {
+        tb.append(QString("%1%2").arg(PARTITION_TABLE_SUFFIX, QString::number(_run_options.tablePartitions)));
+    }
+    if (SchemaVersion::SCHEMA_V2 == _run_options.schemaVersion)
+    {
+        tb.append(V2_TABLE_SUFFIX);
+    }
+    return tb;
+}
+
+/**
+ * @brief AsyncComputeModule::migrateV1Table v2 表结构的表不存在、而同样参数的 v1 表存在时，把 v1 表的记录迁移到新建的 v2 表（v1 表保持不变）
+ * @param tb v2 表名
+ * @param alg 哈希算法（决定哈希列的长度）
+ * @return 是否进行了迁移
+ */
+bool AsyncComputeModule::migrateV1Table(const QString& tb, const HashAlg alg)
+{
+    if (!tb.endsWith(V2_TABLE_SUFFIX))
+    {
+        return false;
+    }
+    const QString v1_tb = tb.chopped(qstrlen(V2_TABLE_SUFFIX));
+    if (!_index->isTableExists(v1_tb))
+    {
+        return false;
+    }
+
+    emit signalWriteInfoLog(QString("[Thread %1] Migrate table `%2` to schema v2 table `%3`").arg(getCurrentThreadID(), v1_tb, tb));
+    const bool is_succ = _index->migrateBlockInfoTableToV2(v1_tb, tb, Hash::getHashSize(alg));
+    _last_log = QString("[Thread %1] %2").arg(getCurrentThreadID(), _index->lastLog());
+    if (!is_succ)
+    {
+        emit signalWriteErrorLog(_last_log);
+        return false;
+    }
+    emit signalWriteSuccLog(_last_log);
+    return true;
 }
 
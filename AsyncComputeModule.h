@@ -2,10 +2,34 @@
 #define ASYNCCOMPUTEMODULE_H
 
 #include <QObject>
+#include <QDataStream>
+#include <QElapsedTimer>
+#include <QFile>
+#include <QThreadPool>
 
 #include "DatabaseService.h"
 #include "HashAlgorithm.h"
+#include "LatencyHistogram.h"
+#include "ProgressCounters.h"
 #include "ResultComput.h"
+#include "RunOptions.h"
+#include "SourceFileCache.h"
+
+#define V2_TABLE_SUFFIX     "_v2"   // v2 表结构的块信息表名的后缀（与同样参数的 v1 表同时存在）
+#define PARTITION_TABLE_SUFFIX  "_p"    // 哈希分区的块信息表名的后缀（后面是分区数，与同样参数的不分区的表同时存在）
+#define DEFAULT_TABLE_PARTITIONS    16  // 不分区时对比分区表使用的分区数
+#define INGEST_CURVE_FIRST_ROWS     1024    // 吞吐量曲线的第一个点的行数（之后写入的行数每翻一倍记录一个点）
+
+class InputFile;
+class HashIndex;
+class HashPipeline;
+class Chunker;
+class RecoverEngine;
+class BlockBufferPool;
+class IoEngine;
+class AsyncFileReader;
+class SqliteIndex;
+class HashFileIndex;
 
 /**
  * @brief [Asynchronous Computation Module] 异步计算模块，执行所需的数据库、文件IO、计算等复杂的或耗时的计算任务。注意：最好使用单独的线程调用这个模块
@@ -24,6 +48,12 @@ public:
     void dropCurrentDatabase();
     void finishAllJob(const bool drop_db);  // 同时也是最后的数据库断开连接和删除操作，发出最终的退出信号
 
+    /* 运行参数 */
+    void setRunOptions(const RunOptions& options);
+
+    /* 进度（ui 线程定时读取） */
+    const ProgressCounters& progress() const;
+
     /* 计算任务 */
     void runTestSegmentationProfmance(const QString& source_file_path,
                                       const QString& unqiue_block_file_path,
@@ -52,21 +82,6 @@ signals:
 
     void signalSetLbRuningJobInfo(const QString& info);
 
-    void signalSetProgressBarValue(const int number);
-    void signalSetProgressBarRange(const int minimum, const int maximum);
-
-    void signalSetLcdTotalFileBlocks(const int number);
-    void signalSetLcdTotalDbHashRecords(const int number);
-    void signalSetLcdTotalRepeat(const int number);
-    void signalSetLcdRepeatPercent(const double number);  // 注意：这个是 Repeat（重复）
-    void signalSetLcdSegmentationTime(const double number);
-
-    void signalSetLcdNumNeedRecover(const int number);
-    void signalSetLcdTotalUnrecovered(const int number);
-    void signalSetLcdTotalRecovered(const int number);
-    void signalSetLcdRecoveredPercent(const double number);  // 注意：这个是 Recovered（恢复）
-    void signalSetLcdRecoverTime(const double number);
-
 
     /* 日志信号 */
     void signalWriteInfoLog(const QString& msg);
@@ -87,6 +102,7 @@ signals:
     void signalDisconnDb();
     void signalDbConnState(const bool is_conn);  // 当前连接状态
     void signalDropCurDb();
+    void signalSetRunOptions(const RunOptions& options);  // 设置之后计算任务的运行参数
 
     /* 计算任务信号 */
     void signalRunTestSegmentationPerformance(const QString& source_file_path,
@@ -116,15 +132,122 @@ signals:
     void signalCurRecoverResult(const ResultComput& recover_result);
     void signalAddPointSegTimeAndRepeateRate(const ResultComput& seg_result);  // 让 ui 添加分割时间和哈希重复率到图表
     void signalAddPointRecoverTime(const ResultComput& seg_result); // 让 ui 添加 恢复时间到图表
+    void signalAddPointQueueDepth(const ResultComput& result);     // 让 ui 添加不同队列深度的分块、恢复速度到图表
+    void signalAddPointIngestCurve(const ResultComput& seg_result); // 让 ui 添加分块吞吐量随写入行数的变化到图表
 
 private:
+    /**
+     * @brief 分块任务的运行时上下文（在不同的分块模式之间共享）
+     */
+    struct SegContext
+    {
+        InputFile*      fin         = nullptr;  // 源文件（输入）
+        OutputFile*     uout        = nullptr;  // Unique-Block file（输出）
+        OutputFile*     hout        = nullptr;  // Block-Hash file（输出）
+        QString         tb;                     // 数据表名
+        QString         uniquePath;             // Unique-Block file 路径（写入数据库的块所在文件）
+        HashAlg         alg         = HashAlg::NONE;
+        size_t          blockSize   = 0;
+        size_t          fileBlocks  = 0;        // 文件一共会被分多少块（基于内容分块时为估计值，分块结束后更新为实际块数）
+        HashIndex*      index       = nullptr;  // 进程内哈希索引（nullptr 表示不使用）
+        bool            indexComplete = false;  // 索引是否包含表中所有的哈希（为 true 时未命中即为新块，不需要查询数据库）
+        HashPipeline*   pipeline    = nullptr;  // 多线程哈希流水线（nullptr 表示在当前线程中读取并计算哈希）
+        Chunker*        chunker     = nullptr;  // 基于内容分块（nullptr 表示固定大小分块；使用流水线时由流水线的读取线程调用）
+        size_t          blocksRead  = 0;        // 已经读取（并计算了哈希）的块数
+        bool            sourceDrained = false;  // 源文件已经读完
+        QList<QByteArray> windowBlocks;         // 串行读取时已经读取并批量计算了哈希、还没有取出的块
+        QList<QByteArray> windowHashes;         // ↑ 对应的哈希值
+        qsizetype       windowPos   = 0;        // 下一个取出的块在 windowBlocks 中的位置
+        qsizetype       windowCapacity = 0;     // 串行读取时每个窗口最多的块数
+        BlockBufferPool* blockPool  = nullptr;  // 固定大小分块普通读取时，每个窗口的块一次读入的缓冲区（nullptr 表示每个块单独读取）
+        BlockBufferPool* digestPool = nullptr;  // 串行读取时每个窗口的哈希值写入的缓冲区（nullptr 表示每个哈希单独分配）
+        AsyncFileReader* reader     = nullptr;  // 通过 io_uring 顺序预读源文件（nullptr 表示同步读取）
+        qint64          hashNsecs   = 0;        // 计算哈希的总耗时（ns，串行读取时统计）
+        qint64          bytesHashed = 0;        // 计算了哈希的字节数（串行读取时统计）
+        QElapsedTimer   elapsedTime;            // 计算耗时（同时作为各阶段计时的时钟）
+        LatencyHistogram phases[PHASE_COUNT];   // 每个阶段每次操作的耗时
+
+        qint64          ptrSourceLoc        = 0;    // 读取指针目前所处源文件的位置
+        qint64          ptrUniqueLoc        = 0;    // 指针目前所处 Unique-Block file 的位置
+        size_t          totalRepeatTimes    = 0;    // 所有哈希值/块的重复次数
+        size_t          totalHashRecords    = 0;    // 当前数据表中的哈希记录条数
+
+        QList<IngestPoint> ingestCurve;             // 吞吐量随写入行数的变化
+        size_t          nextCurveRows       = INGEST_CURVE_FIRST_ROWS;  // 写入的行数达到这个值时记录下一个点
+        size_t          curveBlocks         = 0;    // 上一个点的块数
+        qint64          curveNsecs          = 0;    // 上一个点的时间（ns）
+    };
+
+    /**
+     * @brief 恢复任务的运行时上下文（在不同的恢复模式之间共享）
+     */
+    struct RecoverContext
+    {
+        InputFile*      fin         = nullptr;  // Block-Hash file（输入）
+        QFile*          out         = nullptr;  // 恢复的文件（多线程恢复时各线程直接 pwrite）
+        OutputFile*     dout        = nullptr;  // 恢复的文件（逐块恢复时顺序写入）
+        QString         tb;                     // 数据表名
+        HashAlg         alg         = HashAlg::NONE;
+        size_t          blockSize   = 0;
+        size_t          hashSize    = 0;        // 每个哈希的长度（Byte）
+        bool            variableBlocks = false; // 块大小可变（基于内容分块），.bkh 中每个哈希后面记录块的长度
+        size_t          recordSize  = 0;        // .bkh 中每条记录的长度（Byte）
+        size_t          maxBlockSize = 0;       // 块的最大长度（无法恢复的块最多填充这么多个 0）
+        size_t          numNeedRecover = 0;     // 需要恢复的块数
+        BlockBufferPool* recordPool = nullptr;  // 每个窗口的 .bkh 记录一次读入的缓冲区（nullptr 表示每条记录单独读取）
+        BlockBufferPool* blockPool  = nullptr;  // 逐块恢复时读取块的缓冲区（nullptr 表示每个块单独分配）
+        IoEngine*       io          = nullptr;  // 异步读取源文件的 I/O 引擎（nullptr 表示逐块同步读取）
+        QThreadPool*    lookupPool  = nullptr;  // 不批量解析时并行查询块位置的线程（各自使用连接池中的一个连接，nullptr 表示在计算线程中逐个查询）
+        QElapsedTimer   elapsedTime;            // 计算耗时（同时作为各阶段计时的时钟）
+        LatencyHistogram phases[PHASE_COUNT];   // 每个阶段每次操作的耗时（多线程恢复时合并各线程的读写耗时）
+
+        size_t          totalUnrecovered    = 0;    // 无法恢复块的数量
+        qint64          bytesRecovered      = 0;    // 成功恢复的字节数
+        size_t          blocksRecovered     = 0;    // 成功恢复的块数量
+        size_t          sourceReads         = 0;    // 读取源文件的次数
+        SourceFileCache::Stats cacheStats;          // 源文件句柄缓存的统计信息
+        QString         lastError;                  // 最后一个无法恢复的块的原因（恢复结束后汇总为一条日志）
+    };
+
     QString getCurrentThreadID() const;
     QString getTableName(const size_t block_size, const HashAlg alg);
+    bool migrateV1Table(const QString& tb, const HashAlg alg);
+    QList<RunOptions> getBenchmarkVariants() const;
+    bool openDedupIndex(const QString& block_hash_file_path);
+    void logDbConnectionStats();
+
+    /* 分块模式 */
+    bool segmentRowByRow(SegContext& ctx);
+    bool segmentBatched(SegContext& ctx);
+    bool segmentCopy(SegContext& ctx);
+    bool flushIndexCounters(SegContext& ctx, HashIndex* index);
+    bool readNextBlock(SegContext& ctx, QByteArray& block, QByteArray& hash);
+    bool readHashWindow(SegContext& ctx);
+    void writeHashRecord(SegContext& ctx, const QByteArray& hash, const size_t block_size);
+    bool isSourceDrained(const SegContext& ctx) const;
+    void updateSegmentationProgress(SegContext& ctx);
+    void addIngestPoint(SegContext& ctx, const qint64 nsecs);
+
+    /* 恢复模式 */
+    void recoverSerial(RecoverContext& ctx);
+    void recoverParallel(RecoverContext& ctx);
+    void recoverAsync(RecoverContext& ctx);
+    void submitSortedWindow(RecoverEngine& engine, const QList<BlockInfo>& infos,
+                            const QList<qint64>& out_offsets, const QList<qint64>& sizes);
+    qsizetype readRecoverWindow(RecoverContext& ctx, const qsizetype window,
+                                QList<QByteArray>& hashes, QList<BlockInfo>& infos, QList<qint64>& sizes);
+    void resolveWindowParallel(RecoverContext& ctx, const QList<QByteArray>& hashes, QList<BlockInfo>& infos);
+    void updateRecoverProgress(const RecoverContext& ctx);
 
 private:
     DatabaseService* _dbs; // 当前操作的数据库对象
+    SqliteIndex*    _sqlite;    // 嵌入式 SQLite 去重索引
+    HashFileIndex*  _hashfile;  // 内存映射的哈希表文件去重索引
+    DedupIndex*     _index;     // 当前任务使用的去重索引（_dbs、_sqlite 或 _hashfile，由 openDedupIndex 选择）
     ResultComput     _cur_result_comput; // 存储当前计算任务的结果
+    RunOptions       _run_options;  // 计算任务的运行参数
     QString          _last_log;     // 最后一条日志信息
+    ProgressCounters _progress;     // 当前任务的进度（计算线程写入，ui 线程定时读取）
 };
 
 #endif // ASYNCCOMPUTEMODULE_H
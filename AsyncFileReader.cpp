@@ -0,0 +1,158 @@
+#include "AsyncFileReader.h"
+#include "InputFile.h"
+
+#include <cstring>
+
+/**
+ * @brief AsyncFileReader::AsyncFileReader 创建后立即开始读取文件开头的（最多）队列深度个请求
+ * @param io I/O 引擎（只能由这个读取器使用，决定了同时进行的请求数）
+ * @param fd 文件描述符
+ * @param file_size 文件大小（Byte）
+ * @param request_size 每个请求的长度（Byte）
+ */
+AsyncFileReader::AsyncFileReader(IoEngine* io, const int fd, const qint64 file_size, const size_t request_size)
+    : _io(io)
+    , _fd(fd)
+    , _file_size(file_size)
+    , _request_size(qMax<size_t>(1, request_size))
+{
+    const int num_slots = _io->queueDepth();
+    _buffers = static_cast<char*>(qMallocAligned(_request_size * num_slots, DIRECT_IO_ALIGNMENT));
+    Q_CHECK_PTR(_buffers);
+    _slots.resize(num_slots);
+    for (int i = 0; i < num_slots; ++i)
+    {
+        submit(i);
+    }
+    _io->submitPending();
+}
+
+AsyncFileReader::~AsyncFileReader()
+{
+    _io->wait();  // 缓冲区释放之前等待所有请求完成
+    qFreeAligned(_buffers);
+}
+
+/**
+ * @brief AsyncFileReader::readInto 按顺序读取最多 maxlen 个字节
+ * @param data 读取的数据写入的位置（至少 maxlen 字节）
+ * @param maxlen 读取的字节
+ * @return 实际读取的字节数（小于 maxlen 表示文件已经读完或者出错），出错且没有读到数据时返回 -1
+ */
+qint64 AsyncFileReader::readInto(char* data, const qint64 maxlen)
+{
+    qint64 total = 0;
+    while (total < maxlen && !_error)
+    {
+        Slot& slot = _slots[_cur];
+        while (slot.len > 0 && !slot.ready && !_error)
+        {
+            collect();
+        }
+        if (_error)
+        {
+            break;
+        }
+        if (0 == slot.len)  // 文件已经读完
+        {
+            break;
+        }
+        if (slot.result < 0)
+        {
+            _error = true;
+            _last_log = QString("Unable to read %1 Bytes at %2 (%3)").arg(QString::number(slot.len), QString::number(slot.offset),
+                                                                           QString::fromLocal8Bit(std::strerror(-slot.result)));
+            break;
+        }
+        if (slot.result < slot.len)  // 请求没有读满就到了文件末尾：文件在读取期间变短了，不能用后面的数据补上
+        {
+            _error = true;
+            _last_log = QString("File became shorter while reading: only %1 of %2 Bytes at %3").arg(
+                QString::number(slot.result), QString::number(slot.len), QString::number(slot.offset));
+            break;
+        }
+
+        const qint64 available = slot.len - slot.pos;
+        const qint64 n = qMin(available, maxlen - total);
+        std::memcpy(data + total, _buffers + _request_size * _cur + slot.pos, n);
+        slot.pos += n;
+        total += n;
+
+        if (slot.pos >= slot.len)  // 这个请求的数据已经取完，缓冲区用于读取后面的数据
+        {
+            submit(_cur);
+            _cur = (_cur + 1) % _slots.size();
+        }
+    }
+    _io->submitPending();  // 返回之后调用者处理数据时请求继续进行
+    return (0 == total && _error) ? -1 : total;
+}
+
+bool AsyncFileReader::hasError() const
+{
+    return _error;
+}
+
+QString AsyncFileReader::lastLog() const
+{
+    return _last_log;
+}
+
+/**
+ * @brief AsyncFileReader::submit 用槽位的缓冲区读取文件中下一段数据（文件已经读完时标记为结束）
+ * @param slot 槽位
+ */
+void AsyncFileReader::submit(const int slot)
+{
+    Slot& s = _slots[slot];
+    s.offset = _next_offset;
+    s.len    = qMax<qint64>(0, qMin<qint64>(_request_size, _file_size - _next_offset));
+    s.result = 0;
+    s.filled = 0;
+    s.pos    = 0;
+    s.ready  = false;
+    if (s.len > 0)
+    {
+        /* 请求的长度向上对齐（不超过缓冲区），以直接 I/O 打开的文件最后一个请求同样合法，读到文件末尾为止 */
+        const size_t aligned_len = qMin<size_t>(_request_size, (s.len + DIRECT_IO_ALIGNMENT - 1) / DIRECT_IO_ALIGNMENT * DIRECT_IO_ALIGNMENT);
+        _next_offset += s.len;
+        _io->read(_fd, _buffers + _request_size * slot, aligned_len, s.offset, slot);
+    }
+}
+
+/**
+ * @brief AsyncFileReader::collect 等待至少一个请求完成，记录所有已经完成的请求的结果
+ *  （部分读取时在同一个位置继续读取剩下的部分，直到读满、出错或者读到文件末尾才算完成）
+ */
+void AsyncFileReader::collect()
+{
+    const QList<IoEngine::Completion> completions = _io->waitSome();
+    if (completions.isEmpty() && 0 == _io->inFlight())  // 没有正在进行的请求，等待的请求已经丢失
+    {
+        _error = true;
+        _last_log = _io->lastLog();
+        return;
+    }
+
+    for (const IoEngine::Completion& done : completions)
+    {
+        Slot& s = _slots[done.tag];
+        if (done.result < 0)
+        {
+            s.result = done.result;
+            s.ready  = true;
+            continue;
+        }
+
+        s.filled += done.result;
+        if (done.result > 0 && s.filled < s.len)  // 部分读取：剩下的部分读到同一个缓冲区的后面
+        {
+            const size_t rest = qMin<size_t>(_request_size - s.filled,
+                                             (s.len - s.filled + DIRECT_IO_ALIGNMENT - 1) / DIRECT_IO_ALIGNMENT * DIRECT_IO_ALIGNMENT);
+            _io->read(_fd, _buffers + _request_size * done.tag + s.filled, rest, s.offset + s.filled, done.tag);
+            continue;
+        }
+        s.result = qMin(s.filled, s.len);
+        s.ready  = true;
+    }
+}
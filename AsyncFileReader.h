@@ -0,0 +1,56 @@
+#ifndef ASYNCFILEREADER_H
+#define ASYNCFILEREADER_H
+
+#include <QList>
+#include <QString>
+
+#include "IoEngine.h"
+
+/**
+ * @brief 基于 IoEngine 的顺序预读：把文件按 request_size 切分为请求，始终保持（最多）队列深度个请求在进行中，
+ *  readInto() 按顺序从已经完成的请求中复制数据，每个请求的数据被取完后它的缓冲区立即用于读取后面的数据。
+ *  因此调用者处理数据（计算哈希）时读取仍在进行。不是线程安全的
+ */
+class AsyncFileReader
+{
+public:
+    AsyncFileReader(IoEngine* io, const int fd, const qint64 file_size, const size_t request_size = IO_ENGINE_REQUEST_SIZE);
+    ~AsyncFileReader();
+
+    qint64 readInto(char* data, const qint64 maxlen);
+    bool hasError() const;
+    QString lastLog() const;
+
+private:
+    Q_DISABLE_COPY(AsyncFileReader)
+
+    /**
+     * @brief 一个请求的缓冲区
+     */
+    struct Slot
+    {
+        qint64  offset  = 0;        // 在文件中的位置
+        qint64  len     = 0;        // 请求的长度（0 表示文件已经读完）
+        qint64  result  = 0;        // 实际读取的字节数（出错时为 -errno）
+        qint64  filled  = 0;        // 部分读取时已经读到缓冲区中的字节数
+        qint64  pos     = 0;        // 已经被取走的字节数
+        bool    ready   = false;    // 请求已经完成
+    };
+
+    void submit(const int slot);
+    void collect();
+
+private:
+    IoEngine*   _io;
+    int         _fd;
+    qint64      _file_size;
+    size_t      _request_size;
+    char*       _buffers;           // 所有请求的缓冲区（每个 request_size 字节）
+    QList<Slot> _slots;
+    int         _cur    = 0;        // 下一个取数据的请求
+    qint64      _next_offset = 0;   // 下一个请求在文件中的位置
+    bool        _error  = false;
+    QString     _last_log;
+};
+
+#endif // ASYNCFILEREADER_H
@@ -0,0 +1,41 @@
+#include "BlockBufferPool.h"
+
+/**
+ * @brief BlockBufferPool::BlockBufferPool
+ * @param frame_size 每个帧的大小（Byte）
+ * @param num_frames 帧的数量（同时使用的帧的最大数量）
+ */
+BlockBufferPool::BlockBufferPool(const size_t frame_size, const int num_frames)
+    : _frame_size(qMax<size_t>(1, frame_size))
+    , _num_frames(qMax(1, num_frames))
+{
+    _frame_stride = (_frame_size + BLOCK_BUFFER_POOL_ALIGNMENT - 1) / BLOCK_BUFFER_POOL_ALIGNMENT * BLOCK_BUFFER_POOL_ALIGNMENT;
+    _arena = static_cast<char*>(qMallocAligned(_frame_stride * _num_frames, BLOCK_BUFFER_POOL_ALIGNMENT));
+    Q_CHECK_PTR(_arena);
+}
+
+BlockBufferPool::~BlockBufferPool()
+{
+    qFreeAligned(_arena);
+}
+
+/**
+ * @brief BlockBufferPool::nextFrame 取得下一个帧（循环使用，之前从这个帧得到的视图将会失效）
+ * @return 帧的起始地址（对齐到 BLOCK_BUFFER_POOL_ALIGNMENT）
+ */
+char* BlockBufferPool::nextFrame()
+{
+    char* frame = _arena + _frame_stride * _next;
+    _next = (_next + 1) % _num_frames;
+    return frame;
+}
+
+size_t BlockBufferPool::frameSize() const
+{
+    return _frame_size;
+}
+
+int BlockBufferPool::numFrames() const
+{
+    return _num_frames;
+}
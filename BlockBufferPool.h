@@ -0,0 +1,34 @@
+#ifndef BLOCKBUFFERPOOL_H
+#define BLOCKBUFFERPOOL_H
+
+#include <QtGlobal>
+
+#define BLOCK_BUFFER_POOL_ALIGNMENT     4096    // 帧的对齐（页大小：直接 I/O 可以读入帧，同时满足缓存行和 SIMD 加载的对齐要求）
+
+/**
+ * @brief 可重用的块缓冲区池：创建时一次性分配一块对齐的连续内存，切分为 num_frames 个帧，按顺序循环使用。
+ *  分块和恢复的循环把一个窗口的数据读入帧中，块和哈希都是帧中数据的零拷贝视图（QByteArray::fromRawData），
+ *  循环中不再为每个块分配堆内存。帧被再次使用时其中的数据会被覆盖，
+ *  调用者需要保证之前从这个帧得到的视图已经不再使用（即同时使用的帧不超过 num_frames 个）。不是线程安全的
+ */
+class BlockBufferPool
+{
+public:
+    BlockBufferPool(const size_t frame_size, const int num_frames);
+    ~BlockBufferPool();
+
+    char* nextFrame();
+    size_t frameSize() const;
+    int numFrames() const;
+
+private:
+    Q_DISABLE_COPY(BlockBufferPool)
+
+    char*   _arena;         // 所有帧所在的连续内存
+    size_t  _frame_size;    // 每个帧的大小（Byte）
+    size_t  _frame_stride;  // 相邻帧起始位置的距离（帧大小向上对齐）
+    int     _num_frames;
+    int     _next = 0;      // 下一个使用的帧
+};
+
+#endif // BLOCKBUFFERPOOL_H
@@ -2,6 +2,15 @@
 #define BLOCKINFO_H
 
 #include <QString>
+#include <QByteArray>
+
+/**
+ * @brief 块信息表的结构
+ */
+enum SchemaVersion {
+    SCHEMA_V1 = 1,  // 每行记录源文件路径（TEXT），位置为 NUMERIC(1000, 0)
+    SCHEMA_V2 = 2   // 源文件路径记录在字典表中（每行只有 INTEGER 编号），位置为 BIGINT，哈希为定长（由 CHECK 约束长度）
+};
 
 /**
  * @brief 存储块的信息（用于定位块的位置）
@@ -12,4 +21,13 @@ struct BlockInfo {
     size_t size         = 0;    // 块的大小（Byte）
 };
 
+/**
+ * @brief 一条完整的块信息记录（用于向数据库批量写入）
+ */
+struct BlockRecord {
+    QByteArray hash;            // 块的哈希值
+    BlockInfo  info;            // 块的位置信息
+    int        counter  = 1;    // 块的重复次数
+};
+
 #endif // BLOCKINFO_H
@@ -0,0 +1,72 @@
+# 图形界面（BlockStorageTester.pro）和命令行（BlockStorageTesterCli.pro）共用的计算模块，不依赖 QtWidgets / QtCharts
+QT       += core sql
+
+CONFIG += c++17
+
+INCLUDEPATH += $$PWD
+DEPENDPATH  += $$PWD
+
+# 包含 homebrew 的 qt-postgreSQL 路径（DatabaseService 的 COPY 批量写入直接使用 libpq）
+LIBS += -L/opt/homebrew/opt/libpq/lib -lpq
+macx: INCLUDEPATH += /opt/homebrew/opt/libpq/include
+unix:!macx: INCLUDEPATH += /usr/include/postgresql
+
+# BLAKE3（libblake3）和 xxHash（libxxhash）哈希算法库（macOS 使用 homebrew 的路径，其他平台通过 pkg-config 查找）
+macx {
+    LIBS += -L/opt/homebrew/opt/blake3/lib -lblake3 -L/opt/homebrew/opt/xxhash/lib -lxxhash
+    INCLUDEPATH += /opt/homebrew/opt/blake3/include /opt/homebrew/opt/xxhash/include
+} else {
+    CONFIG += link_pkgconfig
+    PKGCONFIG += libblake3 libxxhash
+}
+
+SOURCES += \
+    $$PWD/AllocCounter.cpp \
+    $$PWD/AsyncComputeModule.cpp \
+    $$PWD/AsyncFileReader.cpp \
+    $$PWD/BlockBufferPool.cpp \
+    $$PWD/Chunker.cpp \
+    $$PWD/DatabaseService.cpp \
+    $$PWD/DedupIndex.cpp \
+    $$PWD/HashAlgorithm.cpp \
+    $$PWD/HashFileIndex.cpp \
+    $$PWD/HashIndex.cpp \
+    $$PWD/HashMultiBuffer.cpp \
+    $$PWD/HashPipeline.cpp \
+    $$PWD/InputFile.cpp \
+    $$PWD/IoEngine.cpp \
+    $$PWD/LatencyHistogram.cpp \
+    $$PWD/Log.cpp \
+    $$PWD/OutputFile.cpp \
+    $$PWD/RecoverEngine.cpp \
+    $$PWD/ResultWriter.cpp \
+    $$PWD/SourceFileCache.cpp \
+    $$PWD/SqliteIndex.cpp
+
+HEADERS += \
+    $$PWD/AllocCounter.h \
+    $$PWD/AsyncComputeModule.h \
+    $$PWD/AsyncFileReader.h \
+    $$PWD/BlockBufferPool.h \
+    $$PWD/BlockInfo.h \
+    $$PWD/Chunker.h \
+    $$PWD/DatabaseService.h \
+    $$PWD/DedupIndex.h \
+    $$PWD/HashAlgorithm.h \
+    $$PWD/HashFileIndex.h \
+    $$PWD/HashIndex.h \
+    $$PWD/HashMultiBuffer.h \
+    $$PWD/HashPipeline.h \
+    $$PWD/InputFile.h \
+    $$PWD/IoEngine.h \
+    $$PWD/LatencyHistogram.h \
+    $$PWD/Log.h \
+    $$PWD/OutputFile.h \
+    $$PWD/ProgressCounters.h \
+    $$PWD/RecoverEngine.h \
+    $$PWD/ResultComput.h \
+    $$PWD/ResultWriter.h \
+    $$PWD/RunOptions.h \
+    $$PWD/SourceFileCache.h \
+    $$PWD/SqliteIndex.h \
+    $$PWD/ThemeStyle.h
@@ -8,9 +8,8 @@ CONFIG += c++17
 # 包含 Crypto++ 头文件路径
 # INCLUDEPATH += $$PWD/cryptopp
 
-# 包含 homebrew 的 qt-postgreSQL 路径
-LIBS += -L/opt/homebrew/opt/libpq/lib -lpq
-# INCLUDEPATH += /opt/homebrew/opt/libpq/include
+# 计算模块（与命令行版本 BlockStorageTesterCli.pro 共用），包含 libpq、BLAKE3 和 xxHash 的路径
+include(BlockStorageCore.pri)
 
 
 # You can make your code fail to compile if it uses deprecated APIs.
@@ -19,22 +18,11 @@ LIBS += -L/opt/homebrew/opt/libpq/lib -lpq
 
 # 添加所有 .cpp 源码文件到项目中
 SOURCES += \
-    AsyncComputeModule.cpp \
-    DatabaseService.cpp \
-    HashAlgorithm.cpp \
-    InputFile.cpp \
     main.cpp \
     mainwindow.cpp
 
 
 HEADERS += \
-    AsyncComputeModule.h \
-    BlockInfo.h \
-    DatabaseService.h \
-    HashAlgorithm.h \
-    InputFile.h \
-    ResultComput.h \
-    ThemeStyle.h \
     mainwindow.h
 
 FORMS += \
@@ -0,0 +1,25 @@
+# 命令行（无图形界面）版本：不依赖 QtWidgets / QtCharts，可以在服务器上直接运行基准测试
+QT        = core sql
+
+CONFIG += c++17 console
+CONFIG -= app_bundle
+
+TARGET = BlockStorageTesterCli
+
+# 计算模块（与图形界面版本 BlockStorageTester.pro 共用）
+include(BlockStorageCore.pri)
+
+# qmake CONFIG+=alloc_counter：替换 glibc 的 malloc 系列函数，统计每个块的堆分配次数（会拖慢分配，默认不启用）
+alloc_counter: DEFINES += ALLOC_COUNTER
+
+SOURCES += \
+    CliRunner.cpp \
+    main_cli.cpp
+
+HEADERS += \
+    CliRunner.h
+
+# Default rules for deployment.
+qnx: target.path = /tmp/$${TARGET}/bin
+else: unix:!android: target.path = /opt/$${TARGET}/bin
+!isEmpty(target.path): INSTALLS += target
@@ -0,0 +1,164 @@
+#include "Chunker.h"
+
+#include "InputFile.h"
+
+#define CHUNKER_READ_SIZE   (4 * 1024 * 1024)   // 普通读取时每次从源文件读取的字节数
+
+namespace {
+
+/**
+ * @brief Gear 哈希表：每个字节值对应一个固定的 64 位随机数（用 splitmix64 从固定的种子生成，保证每次运行的切分点相同）
+ */
+struct GearTable
+{
+    quint64 values[256];
+
+    GearTable()
+    {
+        quint64 seed = 0x9E3779B97F4A7C15ULL;
+        for (int i = 0; i < 256; ++i)
+        {
+            quint64 z = (seed += 0x9E3779B97F4A7C15ULL);
+            z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+            z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+            values[i] = z ^ (z >> 31);
+        }
+    }
+};
+
+const GearTable GEAR;
+
+/**
+ * @brief highBitsMask 取 64 位中最高的 bits 位作为掩码（Gear 哈希的高位包含了最近 64 个字节的信息）
+ * @param bits 位数
+ * @return
+ */
+quint64 highBitsMask(const int bits)
+{
+    if (bits <= 0)
+    {
+        return 0;
+    }
+    if (bits >= 64)
+    {
+        return ~0ULL;
+    }
+    return ((1ULL << bits) - 1) << (64 - bits);
+}
+
+} // namespace
+
+/**
+ * @brief Chunker::Chunker
+ * @param fin 源文件（分块期间只能由调用 next 的线程访问）
+ * @param min_size 最小块大小（Byte）
+ * @param avg_size 平均块大小（Byte）
+ * @param max_size 最大块大小（Byte）
+ */
+Chunker::Chunker(InputFile* fin, const size_t min_size, const size_t avg_size, const size_t max_size)
+    : _fin(fin)
+    , _avg_size(qMax<size_t>(1, avg_size))
+{
+    _min_size = qMin(min_size, _avg_size);
+    _max_size = qMax(max_size, _avg_size);
+
+    int bits = 0;  // log2(平均块大小)
+    while (((size_t)1 << (bits + 1)) <= _avg_size)
+    {
+        ++bits;
+    }
+    _mask_s = highBitsMask(bits + 2);
+    _mask_l = highBitsMask(bits - 2);
+}
+
+/**
+ * @brief Chunker::next 按顺序读取源文件的下一个块
+ * @param chunk [输出] 块数据（内存映射时是映射区域的零拷贝视图）
+ * @return 是否读取到了块（源文件已经读完返回 false）
+ */
+bool Chunker::next(QByteArray& chunk)
+{
+    if (_fin->isMapped())
+    {
+        const qint64 remain = _fin->fileSize() - _offset;
+        if (remain <= 0)
+        {
+            return false;
+        }
+        const QByteArray window = _fin->readFrom(_offset, qMin<qint64>(remain, _max_size));
+        const size_t len = cutPoint((const uchar*)window.constData(), window.size());
+        chunk = _fin->readFrom(_offset, len);
+        _offset += len;
+        return true;
+    }
+
+    /* 缓冲区中剩余的数据不足一个最大块时，从源文件补充 */
+    while (_buf.size() - _buf_pos < (qsizetype)_max_size && !_fin->atEnd())
+    {
+        _buf = _buf.mid(_buf_pos) + _fin->read(qMax<qint64>(CHUNKER_READ_SIZE, _max_size));
+        _buf_pos = 0;
+    }
+    if (_buf_pos >= _buf.size())
+    {
+        return false;
+    }
+
+    const size_t len = cutPoint((const uchar*)_buf.constData() + _buf_pos, qMin<size_t>(_buf.size() - _buf_pos, _max_size));
+    chunk = _buf.mid(_buf_pos, len);
+    _buf_pos += len;
+    _offset  += len;
+    return true;
+}
+
+/**
+ * @brief Chunker::cutPoint 在数据中寻找第一个切分点（FastCDC）：跳过前 min_size 个字节，
+ *  在平均大小之前使用较难满足的掩码，之后使用较容易满足的掩码，到达 max_size 时强制切分
+ * @param data 数据（从块的起始位置开始）
+ * @param len 数据长度
+ * @return 块的长度
+ */
+size_t Chunker::cutPoint(const uchar* data, const size_t len) const
+{
+    if (len <= _min_size)
+    {
+        return len;
+    }
+
+    const size_t end    = qMin(len, _max_size);
+    const size_t normal = qMin(end, _avg_size);
+    quint64 fp = 0;
+    size_t i = _min_size;
+
+    for (; i < normal; ++i)
+    {
+        fp = (fp << 1) + GEAR.values[data[i]];
+        if (!(fp & _mask_s))
+        {
+            return i + 1;
+        }
+    }
+    for (; i < end; ++i)
+    {
+        fp = (fp << 1) + GEAR.values[data[i]];
+        if (!(fp & _mask_l))
+        {
+            return i + 1;
+        }
+    }
+    return end;
+}
+
+size_t Chunker::minSize() const
+{
+    return _min_size;
+}
+
+size_t Chunker::avgSize() const
+{
+    return _avg_size;
+}
+
+size_t Chunker::maxSize() const
+{
+    return _max_size;
+}
@@ -0,0 +1,39 @@
+#ifndef CHUNKER_H
+#define CHUNKER_H
+
+#include <QByteArray>
+
+class InputFile;
+
+/**
+ * @brief 基于内容的分块（FastCDC）：用 Gear 滚动哈希在数据中寻找切分点，块的边界只由附近的内容决定，
+ *  插入或删除数据只会影响附近的一两个块，之后的块保持不变（固定大小分块时之后所有的块都会错位）。
+ *  块的大小在 [min_size, max_size] 之间，平均约为 avg_size（使用归一化分块，块大小集中在平均值附近）。
+ *  按顺序读取源文件，不是线程安全的
+ */
+class Chunker
+{
+public:
+    Chunker(InputFile* fin, const size_t min_size, const size_t avg_size, const size_t max_size);
+
+    bool next(QByteArray& chunk);
+    size_t cutPoint(const uchar* data, const size_t len) const;
+
+    size_t minSize() const;
+    size_t avgSize() const;
+    size_t maxSize() const;
+
+private:
+    InputFile*  _fin;
+    size_t      _min_size;
+    size_t      _avg_size;
+    size_t      _max_size;
+    quint64     _mask_s;    // 块小于平均大小时使用的掩码（更多的位，更难切分）
+    quint64     _mask_l;    // 块大于平均大小时使用的掩码（更少的位，更容易切分）
+
+    QByteArray  _buf;           // 普通读取时已经读取但还没有分块的数据
+    qsizetype   _buf_pos = 0;   // _buf 中下一个块的起始位置
+    qint64      _offset  = 0;   // 下一个块在源文件中的位置
+};
+
+#endif // CHUNKER_H
@@ -0,0 +1,356 @@
+#include "CliRunner.h"
+
+#include "AsyncComputeModule.h"
+#include "ResultWriter.h"
+#include "Log.h"
+
+#include <QCommandLineParser>
+#include <QCoreApplication>
+#include <QFileInfo>
+#include <QDir>
+#include <QSettings>
+#include <QTextStream>
+
+#define CLI_DEFAULT_BLOCK_SIZES "4,8,16,32,64,128,256,512,1024,2048"  // 与图形界面 cbBlockSize 中的块大小相同
+
+CliRunner::CliRunner(QObject *parent)
+    : QObject{parent}
+{
+    _asyncJob = new AsyncComputeModule(this);
+
+    /* 日志写入 stderr（在当前线程中直接调用计算模块，信号为直接连接），低于 --log-level 的日志不输出 */
+    connect(_asyncJob, &AsyncComputeModule::signalWriteInfoLog,    this, [this](const QString& msg){ if (Log::isEnabled(LOG_LEVEL_INFO))    writeLog("INFO", msg); });
+    connect(_asyncJob, &AsyncComputeModule::signalWriteWarningLog, this, [this](const QString& msg){ if (Log::isEnabled(LOG_LEVEL_WARNING)) writeLog("WARN", msg); });
+    connect(_asyncJob, &AsyncComputeModule::signalWriteErrorLog,   this, [this](const QString& msg){ if (Log::isEnabled(LOG_LEVEL_ERROR))   writeLog("ERROR", msg); });
+    connect(_asyncJob, &AsyncComputeModule::signalWriteSuccLog,    this, [this](const QString& msg){ if (Log::isEnabled(LOG_LEVEL_INFO))    writeLog("SUCC", msg); });
+
+    /* 任务结果 */
+    connect(_asyncJob, &AsyncComputeModule::signalCurRecoverResult, this, &CliRunner::addRecoverResult);
+    connect(_asyncJob, &AsyncComputeModule::signalTestSegmentationPerformanceFinished, this, [this](const bool is_succ){
+        _is_failed = _is_failed || !is_succ;
+        return is_succ;
+    });
+    connect(_asyncJob, &AsyncComputeModule::signalTestRecoverPerformanceFinished, this, [this](const bool is_succ){
+        _is_failed = _is_failed || !is_succ;
+        return is_succ;
+    });
+}
+
+CliRunner::~CliRunner()
+{
+}
+
+/**
+ * @brief CliRunner::parseArguments 解析命令行参数。--config 指定的 INI 配置文件中的键与长参数名相同，命令行参数优先于配置文件
+ * @param arguments 命令行参数
+ * @return 参数是否有效
+ */
+bool CliRunner::parseArguments(const QStringList& arguments)
+{
+    QCommandLineParser parser;
+    parser.setApplicationDescription("Block Storage Tester (command line): block segmentation and recovery benchmark");
+    parser.addHelpOption();
+    parser.addOptions({
+        {"config",          "INI config file, keys are the long option names below.", "file"},
+
+        /* 文件 */
+        {"source",          "Source file path.", "file"},
+        {"unique",          "Unique-Block file (.ubk) path, default <source dir>/<base>.ubk.", "file"},
+        {"bkh",             "Block-Hash file (.bkh) path, default <source dir>/<base>.bkh.", "file"},
+        {"recover",         "Recover file path, default <source dir>/RECOVERED_<file name>.", "file"},
+
+        /* 数据库 */
+        {"host",            "Database host (default localhost).", "host"},
+        {"port",            "Database port (default 5432).", "port"},
+        {"driver",          "Qt database driver (default QPSQL).", "driver"},
+        {"user",            "Database user (default postgres).", "user"},
+        {"password",        "Database password.", "password"},
+        {"database",        "Database name (default postgres).", "name"},
+        {"drop-db",         "Drop the database after all tests."},
+
+        /* 测试 */
+        {"mode",            "benchmark (default, tables are dropped before each block size) or single.", "mode"},
+        {"algorithms",      "Comma separated hash algorithms, e.g. MD5,SHA256,BLAKE3 (default SHA256).", "list"},
+        {"block-sizes",     "Comma separated block sizes (default " CLI_DEFAULT_BLOCK_SIZES ").", "list"},
+
+        /* 输出 */
+        {"csv",             "Result CSV path, default <source dir>/RESULT_<base>.csv.", "file"},
+        {"json",            "Result JSON path (not written if empty).", "file"},
+        {"log-level",       "Log level: debug, info (default), warning, error or off. debug logs every block and database call "
+                            "and slows the benchmark down (default from environment variable " LOG_LEVEL_ENV ").", "level"},
+
+        /* 运行参数（RunOptions） */
+        {"seg-mode",        "Segmentation mode: ROW (default), BATCH or COPY.", "mode"},
+        {"batch-size",      "Blocks per batch (BATCH) or rows per COPY (default 1024).", "n"},
+        {"compare-ingest",  "Benchmark: also run ROW and COPY for each block size."},
+        {"hash-index",      "Use in-process hash index."},
+        {"preload-index",   "Preload all hashes of the table into the index."},
+        {"hash-threads",    "Hash worker threads (default 0, serial).", "n"},
+        {"recover-threads", "Recover reader threads (default 0, serial).", "n"},
+        {"recover-window",  "Hash records per recover window (default 4096).", "n"},
+        {"no-bulk-resolve", "Resolve each hash with its own query while recovering."},
+        {"sorted-recover",  "Sort and coalesce source reads in each recover window."},
+        {"input",           "Source read mode: BUFFERED (default) or MAPPED.", "mode"},
+        {"compare-input",   "Benchmark: also run the other input mode for each block size."},
+        {"source-cache",    "Max open source files per recover thread (default 64).", "n"},
+        {"chunking",        "Chunking: FIXED (default) or CDC.", "mode"},
+        {"cdc-min-div",     "CDC min chunk = block size / n (default 4).", "n"},
+        {"cdc-max-mul",     "CDC max chunk = block size * n (default 4).", "n"},
+        {"compare-chunking","Benchmark: also run the other chunking mode for each block size."},
+        {"no-buffer-pool",  "Allocate block / digest / record buffers per block instead of reusing a buffer pool."},
+        {"compare-buffer-pool", "Benchmark: also run with the buffer pool toggled for each block size."},
+        {"output",          "Output write mode: STREAM or AGGREGATED (default).", "mode"},
+        {"output-buffer",   "Staging buffer per output file in MB for AGGREGATED output (default 16).", "mb"},
+        {"no-writev",       "AGGREGATED output: copy oversized writes through the buffer instead of one writev."},
+        {"compare-output",  "Benchmark: also run the other output mode for each block size."},
+        {"io-engine",       "I/O engine: SYNC (default) or URING (falls back to SYNC when io_uring is unavailable).", "engine"},
+        {"queue-depth",     "Max io_uring requests in flight (default 32).", "n"},
+        {"queue-depths",    "Benchmark: also run with io_uring at each of these queue depths, e.g. 1,4,16,64.", "list"},
+        {"direct-io",       "Open the source, .ubk, .bkh and recovered files with O_DIRECT (bypass the page cache)."},
+        {"schema",          "Block info table schema: V1 (default) or V2 (source file dictionary, BIGINT offsets, fixed-length digest).", "version"},
+        {"compare-schema",  "Benchmark: also run the other schema for each block size (table / index size and lookup latency)."},
+        {"db-connections",  "Database connection pool size (default 1). Recovery without bulk resolve looks up a window's distinct hashes "
+                            "in parallel on up to n - 1 worker connections.", "n"},
+        {"partitions",      "Create block info tables PARTITION BY HASH (block_hash) with n partitions (default 0 = unpartitioned, "
+                            "tables end with _p<n>, requires PostgreSQL 12+).", "n"},
+        {"compare-partitions", "Benchmark: also run the other table layout (partitioned / unpartitioned) for each block size."},
+        {"index",           "Dedup index backend: POSTGRESQL (default), SQLITE (local database file in WAL mode) or HASHFILE "
+                            "(memory-mapped hash table files, no SQL); SQLITE and HASHFILE need no database server.", "backend"},
+        {"index-path",      "SQLite database file of SQLITE, or directory of the hash table files of HASHFILE "
+                            "(default: block_index.sqlite / block_index_hash next to the .bkh file).", "path"},
+        {"compare-index",   "Benchmark: also run every other index backend for each block size (POSTGRESQL only when connected)."},
+    });
+    parser.process(arguments);
+
+    QSettings* config = nullptr;
+    if (parser.isSet("config"))
+    {
+        if (!QFileInfo::exists(parser.value("config")))
+        {
+            writeLog("ERROR", QString("Config file does not exist: %1").arg(parser.value("config")));
+            return false;
+        }
+        config = new QSettings(parser.value("config"), QSettings::IniFormat, this);
+    }
+
+    /* 命令行参数优先，其次是配置文件，最后是默认值 */
+    auto value = [&](const QString& name, const QString& default_value = QString()) -> QString {
+        if (parser.isSet(name))
+        {
+            return parser.value(name);
+        }
+        if (config && config->contains(name))
+        {
+            return config->value(name).toString();
+        }
+        return default_value;
+    };
+    auto flag = [&](const QString& name) -> bool {
+        if (parser.isSet(name))
+        {
+            return true;
+        }
+        return config && config->value(name, false).toBool();
+    };
+
+    /* 文件 */
+    _source_path = value("source");
+    if (_source_path.isEmpty() || !QFileInfo::exists(_source_path))
+    {
+        writeLog("ERROR", QString("Source file does not exist: %1").arg(_source_path));
+        return false;
+    }
+    QFileInfo source_info(_source_path);
+    _unique_path     = value("unique",  source_info.dir().filePath(source_info.baseName().append(".ubk")));
+    _block_hash_path = value("bkh",     source_info.dir().filePath(source_info.baseName().append(".bkh")));
+    _recover_path    = value("recover", source_info.dir().filePath(QString("RECOVERED_").append(source_info.fileName())));
+
+    /* 数据库 */
+    _host     = value("host",     "localhost");
+    _port     = value("port",     "5432").toInt();
+    _driver   = value("driver",   "QPSQL");
+    _user     = value("user",     "postgres");
+    _password = value("password");
+    _database = value("database", "postgres");
+    _drop_db  = flag("drop-db");
+
+    /* 测试 */
+    const QString mode = value("mode", "benchmark").toLower();
+    if ("benchmark" != mode && "single" != mode)
+    {
+        writeLog("ERROR", QString("Unknown mode: %1").arg(mode));
+        return false;
+    }
+    _is_benchmark = ("benchmark" == mode);
+
+    _algs.clear();
+    for (const QString& name : value("algorithms", "SHA256").split(',', Qt::SkipEmptyParts))
+    {
+        HashAlg alg = HashAlg::NONE;
+        for (int i = HashAlg::MD5; i <= HashAlg::SHA256_NI; ++i)
+        {
+            if (0 == Hash::getHashName((HashAlg)i).compare(name.trimmed(), Qt::CaseInsensitive))
+            {
+                alg = (HashAlg)i;
+                break;
+            }
+        }
+        if (HashAlg::NONE == alg)
+        {
+            writeLog("ERROR", QString("Unknown hash algorithm: %1").arg(name));
+            return false;
+        }
+        _algs.append(alg);
+    }
+
+    _block_sizes.clear();
+    for (const QString& size : value("block-sizes", CLI_DEFAULT_BLOCK_SIZES).split(',', Qt::SkipEmptyParts))
+    {
+        bool is_ok = false;
+        const size_t block_size = size.trimmed().toULongLong(&is_ok);
+        if (!is_ok || 0 == block_size)
+        {
+            writeLog("ERROR", QString("Invalid block size: %1").arg(size));
+            return false;
+        }
+        _block_sizes.append(block_size);
+    }
+    if (_algs.isEmpty() || _block_sizes.isEmpty())
+    {
+        writeLog("ERROR", "No hash algorithm or block size to test");
+        return false;
+    }
+
+    /* 输出 */
+    _csv_path  = value("csv", source_info.dir().filePath(QString("RESULT_").append(source_info.baseName().append(".csv"))));
+    _json_path = value("json");
+    Log::setLevel(Log::fromName(value("log-level", qEnvironmentVariable(LOG_LEVEL_ENV)), LOG_LEVEL_INFO));
+
+    /* 运行参数 */
+    RunOptions options;
+    const QString seg_mode = value("seg-mode", "ROW").toUpper();
+    options.segMode             = ("COPY" == seg_mode) ? SegMode::SEG_COPY
+                                : ("BATCH" == seg_mode) ? SegMode::SEG_BATCH : SegMode::SEG_ROW;
+    options.batchSize           = qMax<size_t>(1, value("batch-size", "1024").toULongLong());
+    options.compareIngest       = flag("compare-ingest");
+    options.useHashIndex        = flag("hash-index") || flag("preload-index");
+    options.preloadHashIndex    = flag("preload-index");
+    options.hashThreads         = qMax(0, value("hash-threads", "0").toInt());
+    options.recoverThreads      = qMax(0, value("recover-threads", "0").toInt());
+    options.recoverWindow       = qMax<size_t>(1, value("recover-window", "4096").toULongLong());
+    options.bulkResolve         = !flag("no-bulk-resolve");
+    options.sortedRecover       = flag("sorted-recover");
+    options.inputMode           = ("MAPPED" == value("input", "BUFFERED").toUpper()) ? InputMode::INPUT_MAPPED : InputMode::INPUT_BUFFERED;
+    options.compareInput        = flag("compare-input");
+    options.sourceCacheCapacity = qMax<size_t>(1, value("source-cache", "64").toULongLong());
+    options.chunkMode           = ("CDC" == value("chunking", "FIXED").toUpper()) ? ChunkMode::CHUNK_CDC : ChunkMode::CHUNK_FIXED;
+    options.cdcMinDivisor       = qMax<size_t>(1, value("cdc-min-div", "4").toULongLong());
+    options.cdcMaxMultiplier    = qMax<size_t>(1, value("cdc-max-mul", "4").toULongLong());
+    options.compareChunking     = flag("compare-chunking");
+    options.useBufferPool       = !flag("no-buffer-pool");
+    options.compareBufferPool   = flag("compare-buffer-pool");
+    options.outputMode          = ("STREAM" == value("output", "AGGREGATED").toUpper()) ? OutputMode::OUTPUT_STREAM : OutputMode::OUTPUT_AGGREGATED;
+    options.outputBufferMB      = qMax<size_t>(1, value("output-buffer", "16").toULongLong());
+    options.outputWritev        = !flag("no-writev");
+    options.compareOutput       = flag("compare-output");
+    options.ioEngine            = ("URING" == value("io-engine", "SYNC").toUpper()) ? IoEngineMode::IO_ENGINE_URING : IoEngineMode::IO_ENGINE_SYNC;
+    options.queueDepth          = qBound(1, value("queue-depth", "32").toInt(), IO_ENGINE_MAX_QUEUE_DEPTH);
+    options.benchmarkQueueDepths = RunOptions::parseQueueDepths(value("queue-depths"));
+    options.directIo            = flag("direct-io");
+    options.schemaVersion       = ("V2" == value("schema", "V1").toUpper()) ? SchemaVersion::SCHEMA_V2 : SchemaVersion::SCHEMA_V1;
+    options.compareSchema       = flag("compare-schema");
+    options.dbConnections       = qBound(1, value("db-connections", "1").toInt(), DB_POOL_MAX_SIZE);
+    options.tablePartitions     = qBound(0, value("partitions", "0").toInt(), DB_MAX_PARTITIONS);
+    options.comparePartitions   = flag("compare-partitions");
+    const QString index_backend = value("index", "POSTGRESQL").toUpper();
+    options.indexBackend        = ("HASHFILE" == index_backend) ? IndexBackend::INDEX_HASHFILE
+                                : ("SQLITE" == index_backend) ? IndexBackend::INDEX_SQLITE : IndexBackend::INDEX_POSTGRESQL;
+    options.indexPath           = value("index-path");
+    options.compareIndex        = flag("compare-index");
+    _run_options = options;
+
+    return true;
+}
+
+/**
+ * @brief CliRunner::run 连接数据库（SQLite 和哈希表文件索引后端不需要），按顺序执行所有测试并保存结果
+ * @return 进程退出码（0 表示所有任务都成功）
+ */
+int CliRunner::run()
+{
+    if (IndexBackend::INDEX_POSTGRESQL == _run_options.indexBackend
+        && !_asyncJob->connectDatabase(_host, _port, _driver, _user, _password, _database))
+    {
+        return 2;
+    }
+    _asyncJob->setRunOptions(_run_options);
+
+    for (const HashAlg alg : _algs)
+    {
+        if (_is_benchmark)
+        {
+            _asyncJob->runBenchmarkTest(_source_path, _unique_path, _block_hash_path, _recover_path, alg, _block_sizes);
+            continue;
+        }
+        for (const size_t block_size : _block_sizes)
+        {
+            _asyncJob->runSingleTest(_source_path, _unique_path, _block_hash_path, _recover_path, alg, block_size);
+        }
+    }
+    _asyncJob->finishAllJob(_drop_db);
+
+    if (!saveResults())
+    {
+        return 3;
+    }
+    return _is_failed ? 1 : 0;
+}
+
+/**
+ * @brief CliRunner::writeLog 日志写入 stderr（去掉日志中用于界面换行的 <br>）
+ * @param level 日志级别
+ * @param msg 日志
+ */
+void CliRunner::writeLog(const QString& level, const QString& msg)
+{
+    static QTextStream err(stderr);
+    QString text = msg;
+    err << QString("[%1] %2").arg(level, text.replace("<br>", "\n")) << Qt::endl;
+}
+
+/**
+ * @brief CliRunner::addRecoverResult 添加一条（分块 + 恢复）运算结果
+ * @param recover_result
+ */
+void CliRunner::addRecoverResult(const ResultComput& recover_result)
+{
+    _listResultComput.append(recover_result);
+}
+
+/**
+ * @brief CliRunner::saveResults 所有运算结果保存为 CSV（以及 JSON）
+ * @return 是否成功
+ */
+bool CliRunner::saveResults()
+{
+    QString error;
+    if (!_csv_path.isEmpty())
+    {
+        if (!ResultWriter::saveToCSV(_csv_path, _listResultComput, error))
+        {
+            writeLog("ERROR", QString("Unable to save result to %1: %2").arg(_csv_path, error));
+            return false;
+        }
+        writeLog("SUCC", QString("Successed save %1 results to path: %2").arg(QString::number(_listResultComput.size()), _csv_path));
+    }
+    if (!_json_path.isEmpty())
+    {
+        if (!ResultWriter::saveToJSON(_json_path, _listResultComput, error))
+        {
+            writeLog("ERROR", QString("Unable to save result to %1: %2").arg(_json_path, error));
+            return false;
+        }
+        writeLog("SUCC", QString("Successed save %1 results to path: %2").arg(QString::number(_listResultComput.size()), _json_path));
+    }
+    return true;
+}
@@ -0,0 +1,65 @@
+#ifndef CLIRUNNER_H
+#define CLIRUNNER_H
+
+#include <QObject>
+#include <QList>
+#include <QString>
+#include <QStringList>
+
+#include "HashAlgorithm.h"
+#include "ResultComput.h"
+#include "RunOptions.h"
+
+class AsyncComputeModule;
+
+/**
+ * @brief 命令行（无图形界面）测试：从命令行参数或配置文件读取测试参数，在当前线程中直接调用 AsyncComputeModule
+ *  执行单步测试或基准测试，日志输出到 stderr，结果保存为 CSV / JSON。不依赖 QtWidgets / QtCharts
+ */
+class CliRunner : public QObject
+{
+    Q_OBJECT
+public:
+    explicit CliRunner(QObject *parent = nullptr);
+    ~CliRunner();
+
+    bool parseArguments(const QStringList& arguments);
+    int run();
+
+private:
+    void writeLog(const QString& level, const QString& msg);
+    void addRecoverResult(const ResultComput& recover_result);
+    bool saveResults();
+
+private:
+    AsyncComputeModule* _asyncJob;
+    QList<ResultComput> _listResultComput;  // 所有运算结果（每次恢复完成后添加一条）
+    bool                _is_failed = false; // 是否有任务失败
+
+    /* 数据库 */
+    QString _host;
+    int     _port = 5432;
+    QString _driver;
+    QString _user;
+    QString _password;
+    QString _database;
+    bool    _drop_db = false;   // 结束后删除数据库
+
+    /* 文件 */
+    QString _source_path;
+    QString _unique_path;
+    QString _block_hash_path;
+    QString _recover_path;
+
+    /* 测试 */
+    bool            _is_benchmark = true;   // 基准测试（每次先删除数据表），否则对每个块大小执行单步测试
+    QList<HashAlg>  _algs;
+    QList<size_t>   _block_sizes;
+    RunOptions      _run_options;
+
+    /* 输出 */
+    QString _csv_path;
+    QString _json_path;
+};
+
+#endif // CLIRUNNER_H
@@ -1,7 +1,52 @@
 #include "DatabaseService.h"
+#include "Log.h"
 
 #include <QSqlQuery>
 #include <QSqlError>
+#include <QSqlDriver>
+#include <QStringList>
+#include <QElapsedTimer>
+#include <QtEndian>
+
+#include <libpq-fe.h>
+
+/**
+ * @brief joinHex 将一组哈希值转换为以逗号分隔的十六进制字符串，
+ *  用于在 SQL 中通过 string_to_array + decode 还原为 BYTEA 数组（只绑定一个参数，避免拼接 SQL）
+ * @param blockHashes 哈希值列表
+ * @return 例如 "0a1b,2c3d"
+ */
+static QString joinHex(const QList<QByteArray>& blockHashes)
+{
+    QByteArray joined;
+    joined.reserve(blockHashes.isEmpty() ? 0 : blockHashes.size() * (blockHashes.first().size() * 2 + 1));
+    for (const QByteArray& hash : blockHashes)
+    {
+        if (!joined.isEmpty())
+        {
+            joined.append(',');
+        }
+        joined.append(hash.toHex());
+    }
+    return QString::fromLatin1(joined);
+}
+
+/**
+ * @brief joinNumbers 将一组数字转换为以逗号分隔的字符串
+ * @param numbers 数字列表
+ * @return 例如 "1,2,3"
+ */
+template <typename T>
+static QString joinNumbers(const QList<T>& numbers)
+{
+    QStringList list;
+    list.reserve(numbers.size());
+    for (const T& n : numbers)
+    {
+        list.append(QString::number(n));
+    }
+    return list.join(',');
+}
 
 DatabaseService::DatabaseService(QObject *parent)
     : QObject{parent}
@@ -12,21 +57,24 @@ DatabaseService::DatabaseService(QObject *parent)
     _user = "";
     _password = "";
     _name_db = DEFAULT_DB_CONN;
+
+    _pool.append(new Connection);
+    _pool.first()->name = "default";
 }
 
 
 DatabaseService::~DatabaseService()
 {
     disconnectCurDatabase();
-#if !QT_NO_DEBUG
-    qDebug() << "DatabaseService::~DatabaseService auto disconnect";
-#endif
+    _thread_state.setLocalData(nullptr);  // 析构线程的状态在这里删除，其他使用过连接的线程应该已经结束
+    qDeleteAll(_pool);
+    LOG_DEBUG("DatabaseService::~DatabaseService auto disconnect");
 }
 
 
 // MacOS 下 PostgreSQL 连接问题解决：https://ru.stackoverflow.com/questions/1478871/qpsql-driver-not-found
 /**
- * @brief DatabaseService::connectDatabase 连接到指定数据库
+ * @brief DatabaseService::connectDatabase 连接到指定数据库（调用的线程使用默认连接，工作线程之后从连接池获得各自的连接）
  * @param host 主机名或链接
  * @param port 端口号
  * @param driver Qt 数据库驱动
@@ -38,6 +86,7 @@ DatabaseService::~DatabaseService()
 bool DatabaseService::connectDatabase(const QString& host, const int port, const QString& driver,
                                       const QString& user, const QString& pwd, const QString& database)
 {
+    ThreadState& s = state();
     _host = host;
     _port = port;
     _driver = driver;
@@ -45,6 +94,7 @@ bool DatabaseService::connectDatabase(const QString& host, const int port, const
     _password = pwd;
     _name_db = database;
 
+    clearFileCache();  // 字典的编号只在同一个数据库中有效
     _db = QSqlDatabase::addDatabase(_driver, QSqlDatabase::defaultConnection);
     _db.setHostName(_host);
     _db.setPort(_port);
@@ -57,39 +107,69 @@ bool DatabaseService::connectDatabase(const QString& host, const int port, const
         _db.setDatabaseName(_name_db);
     }
 
-    if (_db.open())
+    const bool is_open = _db.open();
+    {
+        QMutexLocker locker(&_pool_mutex);
+        _pool.first()->db    = is_open ? _db : QSqlDatabase();
+        _pool.first()->inUse = is_open;
+        _is_connected        = is_open;
+    }
+    s.conn = is_open ? _pool.first() : nullptr;
+
+    if (is_open)
     {
-        _last_log = QString("Successed connect to database %1 from %2:%3").arg(_name_db, _host, QString::number(_port));
+        s.lastLog = QString("Successed connect to database %1 from %2:%3").arg(_name_db, _host, QString::number(_port));
         return true;
     }
     else
     {
-        _last_log = QString("Cannot connect to datebase %1 from %2:%3").arg(_name_db, _host, QString::number(_port));
+        s.lastLog = QString("Cannot connect to datebase %1 from %2:%3").arg(_name_db, _host, QString::number(_port));
         return false;
     }
 }
 
 
 /**
- * @brief DatabaseService::isDatabaseOpen 当前数据库是否连接
+ * @brief DatabaseService::isDatabaseOpen 当前数据库是否连接。工作线程第一次调用时从连接池获得连接（没有空闲连接时等待）
  * @return
  */
 bool DatabaseService::isDatabaseOpen()
 {
-    if (_db.isValid() && _db.isOpen())
+    ThreadState& s = state();
+    if (nullptr == s.conn && !acquireConnection(s))
+    {
+        return false;
+    }
+
+    if (s.conn->db.isValid() && s.conn->db.isOpen())
     {
-        _last_log = "Database connected successfully!";
+        LOG_LAZY(LOG_LEVEL_DEBUG, s.lastLog, QStringLiteral("Database connected successfully!"));  // 每次数据库操作之前都会检查，成功时不格式化消息
         return true;
     }
     else
     {
         // 如果连接失败，输出错误信息
-        _last_log = QString("Database connection failed: %1").arg(_db.lastError().text());
+        s.lastLog = QString("Database connection failed: %1").arg(s.conn->db.lastError().text());
         return false;
     }
 }
 
 
+IndexBackend DatabaseService::backend() const
+{
+    return IndexBackend::INDEX_POSTGRESQL;
+}
+
+/**
+ * @brief DatabaseService::isOpen 作为去重索引是否可用（即 isDatabaseOpen）
+ * @return
+ */
+bool DatabaseService::isOpen()
+{
+    return isDatabaseOpen();
+}
+
+
 /**
  * @brief DatabaseService::isDatabaseExist 给定数据库是否存在
  * @param database 数据库名称
@@ -97,25 +177,27 @@ bool DatabaseService::isDatabaseOpen()
  */
 bool DatabaseService::isDatabaseExist(const QString& database)
 {
+    ThreadState& s = state();
     if (!isDatabaseOpen())
     {
         return false;
     }
 
     QString sql = QString("SELECT 1 FROM pg_database WHERE datname = '%1';").arg(database);
-    _last_sql = sql;
-    QSqlQuery q(sql);
-    qDebug() << QString("Run SQL: %1").arg(sql);
+    s.lastSql = sql;
+    QSqlQuery q(s.conn->db);
+    exec(s, q, sql);
+    LOG_DEBUG(QString("Run SQL: %1").arg(sql));
 
     q.next();
     if (q.value(0) == 1)
     {
-        _last_log = QString("Database `%1` exist").arg(database);
+        s.lastLog = QString("Database `%1` exist").arg(database);
         q.clear();
         return true;
     }
 
-    _last_log = QString("Database `%1` do not exist").arg(database);
+    s.lastLog = QString("Database `%1` do not exist").arg(database);
     q.clear();
     return false;
 }
@@ -128,25 +210,26 @@ bool DatabaseService::isDatabaseExist(const QString& database)
  */
 bool DatabaseService::createDatabase(const QString& database)
 {
+    ThreadState& s = state();
     if (!isDatabaseOpen())
     {
         return false;
     }
 
     QString sql = QString("CREATE DATABASE \"%1\";").arg(database);
-    _last_sql = sql;
-    QSqlQuery q;
-    qDebug() << QString("Run SQL: %1").arg(sql);
+    s.lastSql = sql;
+    QSqlQuery q(s.conn->db);
+    LOG_DEBUG(QString("Run SQL: %1").arg(sql));
 
-    bool succ = q.exec(sql);
+    bool succ = exec(s, q, sql);
     if (succ)
     {
-        _last_log  = QString("Successed create database `%1`").arg(database);
+        s.lastLog  = QString("Successed create database `%1`").arg(database);
         return true;
     }
     else
     {
-        _last_log = QString("Failed to create database `%1`: %2").arg(database, q.lastError().text());
+        s.lastLog = QString("Failed to create database `%1`: %2").arg(database, q.lastError().text());
         return false;
     }
 }
@@ -157,6 +240,7 @@ bool DatabaseService::createDatabase(const QString& database)
  */
 bool DatabaseService::dropCurDatabase()
 {
+    ThreadState& s = state();
     if (!isDatabaseOpen())
     {
         return false;
@@ -164,65 +248,346 @@ bool DatabaseService::dropCurDatabase()
 
     if (_name_db.isEmpty())
     {
-        _last_log = "Can not remove default database (database name is empty)";
+        s.lastLog = "Can not remove default database (database name is empty)";
         return false;
     }
 
     disconnectCurDatabase();
 
     QString drop_db_name = _name_db;
-    connectDatabase(_host, _port, _driver, _user, _password, DEFAULT_DB_CONN); // 要删除，先连接到默认数据库(注意：这里重新连接至默认数据库，并使 _name_db = "")
+    if (!connectDatabase(_host, _port, _driver, _user, _password, DEFAULT_DB_CONN)) // 要删除，先连接到默认数据库(注意：这里重新连接至默认数据库，并使 _name_db = "")
+    {
+        return false;
+    }
 
-    QSqlQuery q;
+    QSqlQuery q(s.conn->db);
     QString sql = QString("DROP DATABASE \"%1\";").arg(drop_db_name);
-    _last_sql = sql;
-    bool succ = q.exec(sql);
+    s.lastSql = sql;
+    bool succ = exec(s, q, sql);
     if (succ)
     {
-        _last_log = QString("Successed drop current database `%1`").arg(drop_db_name);
+        clearFileCache();
+        s.lastLog = QString("Successed drop current database `%1`").arg(drop_db_name);
         return true;
     }
     else
     {
-        _last_log =  QString("Failed drop current database `%1`:, %2").arg(drop_db_name, _db.lastError().text());
+        s.lastLog =  QString("Failed drop current database `%1`:, %2").arg(drop_db_name, q.lastError().text());
         return false;
     }
 }
 
 
 /**
- * @brief DatabaseService::disconnectDatabase 断开与当前数据库的连接
+ * @brief DatabaseService::disconnectDatabase 断开与当前数据库的连接（关闭默认连接，工作线程的连接应该已经归还）
  * @return 数据库未连接或者未打开
  */
 bool DatabaseService::disconnectCurDatabase()
 {
+    ThreadState& s = state();
+
     // 检查数据库连接是否有效并已打开
-    if (isDatabaseOpen())
+    if (_db.isValid() && _db.isOpen())
     {
+        const QString name_db = _db.databaseName();
+        clearFileCache();
+        {
+            QMutexLocker locker(&_pool_mutex);
+            _pool.first()->db    = QSqlDatabase();
+            _pool.first()->inUse = false;
+            _is_connected        = false;
+        }
+        s.conn = nullptr;
         _db.close();
         _db = QSqlDatabase(); // 将 _curDB 重置为空，以解除与实际数据库连接的关联
         QSqlDatabase::removeDatabase(QSqlDatabase::defaultConnection);
 
-        _last_log = QString("Disconnect database %1").arg(_db.databaseName());
+        s.lastLog = QString("Disconnect database %1").arg(name_db);
         return true;
     }
 
-    _last_log = QString("Failed disconnect database %1: %2").arg(_db.databaseName(), _db.lastError().text());
+    s.lastLog = QString("Failed disconnect database %1: %2").arg(_db.databaseName(), _db.lastError().text());
     return false;
 }
 
 /**
- * @brief DatabaseService::createTable 在当前连接的数据库中创建指定名称的块信息表
+ * @brief DatabaseService::setPoolSize 设置连接池的大小（包括默认连接，工作线程最多同时使用 size - 1 个连接）。
+ *  应该在没有工作线程使用连接时调用，正在使用的连接不会被删除
+ * @param size 连接数（1 - DB_POOL_MAX_SIZE）
+ */
+void DatabaseService::setPoolSize(const int size)
+{
+    const int new_size = qBound(1, size, DB_POOL_MAX_SIZE);
+    QMutexLocker locker(&_pool_mutex);
+    while (_pool.size() < new_size)
+    {
+        Connection* conn = new Connection;
+        conn->name = QString(DB_POOL_CONN_PREFIX "%1").arg(_pool.size());
+        _pool.append(conn);
+        _free_conns.release();
+    }
+    while (_pool.size() > new_size && !_pool.last()->inUse && _free_conns.tryAcquire())
+    {
+        delete _pool.takeLast();
+    }
+}
+
+int DatabaseService::poolSize()
+{
+    QMutexLocker locker(&_pool_mutex);
+    return _pool.size();
+}
+
+/**
+ * @brief DatabaseService::connectionStats 连接池中每个连接的查询次数和等待时间（可以在任何线程中调用）
+ * @return 按连接编号排列，[0] 为默认连接
+ */
+QList<DbConnectionStats> DatabaseService::connectionStats()
+{
+    QList<DbConnectionStats> stats;
+    QMutexLocker locker(&_pool_mutex);
+    for (const Connection* conn : std::as_const(_pool))
+    {
+        DbConnectionStats stat;
+        stat.name      = conn->name;
+        stat.queries   = conn->queries.load(std::memory_order_relaxed);
+        stat.waitNsecs = conn->waitNsecs.load(std::memory_order_relaxed);
+        stats.append(stat);
+    }
+    return stats;
+}
+
+void DatabaseService::resetConnectionStats()
+{
+    QMutexLocker locker(&_pool_mutex);
+    for (Connection* conn : std::as_const(_pool))
+    {
+        conn->queries.store(0, std::memory_order_relaxed);
+        conn->waitNsecs.store(0, std::memory_order_relaxed);
+    }
+}
+
+/**
+ * @brief DatabaseService::releaseThreadConnection 关闭并归还调用线程从连接池获得的连接（线程结束时会自动归还）
+ */
+void DatabaseService::releaseThreadConnection()
+{
+    releaseConnection(state());
+}
+
+/**
+ * @brief DatabaseService::state 调用线程的状态（第一次调用时创建，线程结束时删除）
+ * @return
+ */
+DatabaseService::ThreadState& DatabaseService::state()
+{
+    if (!_thread_state.hasLocalData())
+    {
+        ThreadState* s = new ThreadState;
+        s->dbs = this;
+        _thread_state.setLocalData(s);
+    }
+    return *_thread_state.localData();
+}
+
+DatabaseService::ThreadState::~ThreadState()
+{
+    dbs->releaseConnection(*this);
+}
+
+/**
+ * @brief DatabaseService::acquireConnection 为调用线程从连接池获得一个空闲连接，并在这个线程中用默认连接的参数打开
+ *  （Qt 的连接只能在打开它的线程中使用）。只有没有空闲连接时才计入等待时间
+ * @param s 调用线程的状态
+ * @return 是否成功
+ */
+bool DatabaseService::acquireConnection(ThreadState& s)
+{
+    {
+        QMutexLocker locker(&_pool_mutex);
+        if (!_is_connected)
+        {
+            s.lastLog = "Database connection failed: database is not connected";
+            return false;
+        }
+        if (_pool.size() <= 1)
+        {
+            s.lastLog = "Database connection failed: connection pool has no connection for worker threads";
+            return false;
+        }
+    }
+
+    qint64 wait_nsecs = 0;
+    if (!_free_conns.tryAcquire())
+    {
+        QElapsedTimer timer;
+        timer.start();
+        if (!_free_conns.tryAcquire(1, DB_POOL_WAIT_TIMEOUT_MS))
+        {
+            s.lastLog = QString("Database connection failed: no free connection in pool after %1 ms").arg(DB_POOL_WAIT_TIMEOUT_MS);
+            return false;
+        }
+        wait_nsecs = timer.nsecsElapsed();
+    }
+
+    Connection* conn = nullptr;
+    {
+        QMutexLocker locker(&_pool_mutex);
+        for (qsizetype i = 1; i < _pool.size() && nullptr == conn; ++i)
+        {
+            if (!_pool.at(i)->inUse)
+            {
+                conn = _pool.at(i);
+                conn->inUse = true;
+            }
+        }
+    }
+    if (nullptr == conn)
+    {
+        _free_conns.release();
+        s.lastLog = "Database connection failed: connection pool was resized";
+        return false;
+    }
+    conn->waitNsecs.fetch_add(wait_nsecs, std::memory_order_relaxed);
+
+    conn->db = QSqlDatabase::cloneDatabase(QSqlDatabase::defaultConnection, conn->name);
+    s.conn = conn;
+    if (!conn->db.open())
+    {
+        s.lastLog = QString("Cannot open database connection %1: %2").arg(conn->name, conn->db.lastError().text());
+        releaseConnection(s);
+        return false;
+    }
+    return true;
+}
+
+/**
+ * @brief DatabaseService::releaseConnection 关闭调用线程的工作连接并归还连接池（默认连接只由 disconnectCurDatabase 关闭）
+ * @param s 调用线程的状态
+ */
+void DatabaseService::releaseConnection(ThreadState& s)
+{
+    Connection* conn = s.conn;
+    {
+        QMutexLocker locker(&_pool_mutex);
+        if (nullptr == conn || conn == _pool.first())
+        {
+            return;
+        }
+    }
+
+    s.conn = nullptr;
+    conn->db.close();
+    conn->db = QSqlDatabase();
+    QSqlDatabase::removeDatabase(conn->name);
+    {
+        QMutexLocker locker(&_pool_mutex);
+        conn->inUse = false;
+    }
+    _free_conns.release();
+}
+
+/**
+ * @brief DatabaseService::exec 执行查询并计入调用线程的连接的查询次数
+ * @param s 调用线程的状态
+ * @param q 查询（已经 prepare 时 sql 为空）
+ * @param sql 要执行的 SQL 语句
+ * @return 是否执行成功
+ */
+bool DatabaseService::exec(ThreadState& s, QSqlQuery& q, const QString& sql)
+{
+    s.conn->queries.fetch_add(1, std::memory_order_relaxed);
+    return sql.isEmpty() ? q.exec() : q.exec(sql);
+}
+
+/**
+ * @brief DatabaseService::setSchemaVersion 设置块信息表的结构，之后创建、读写块信息表都按这个结构进行
+ * @param version 表结构
+ */
+void DatabaseService::setSchemaVersion(const SchemaVersion version)
+{
+    _schema = version;
+}
+
+SchemaVersion DatabaseService::schemaVersion() const
+{
+    return _schema;
+}
+
+/**
+ * @brief DatabaseService::setPartitionCount 设置之后新建的块信息表的哈希分区数。分区表上的所有操作与普通表相同（由 PostgreSQL 路由到分区）
+ * @param partitions 分区数（0 表示不分区，最多 DB_MAX_PARTITIONS）
+ */
+void DatabaseService::setPartitionCount(const int partitions)
+{
+    _partitions = qBound(0, partitions, DB_MAX_PARTITIONS);
+}
+
+int DatabaseService::partitionCount() const
+{
+    return _partitions;
+}
+
+/**
+ * @brief DatabaseService::createTable 在当前连接的数据库中创建指定名称的块信息表（按当前的表结构）。
+ *  设置了分区数时创建为按 block_hash 哈希分区的表，每个分区有自己的 UNIQUE 索引（单个索引更小，更容易留在 shared_buffers 中）
  * @param tbName 要创建的表名
+ * @param hashSize 哈希值的长度（Byte），v2 表结构用 CHECK 约束哈希列为定长；0 表示不限制
  * @return 是否成功创建
  */
-bool DatabaseService::createBlockInfoTable(const QString& tbName)
+bool DatabaseService::createBlockInfoTable(const QString& tbName, const size_t hashSize)
 {
+    ThreadState& s = state();
     if (!isDatabaseOpen())
     {
         return false;
     }
 
+    // 分区表的唯一约束必须包含分区键，所以直接以整个哈希值（而不是它的前缀）作为分区键，哈希值本身是均匀分布的
+    const QString partition_by = _partitions > 0 ? QString(" PARTITION BY HASH (block_hash)") : QString();
+    const QString partition_info = _partitions > 0 ? QString(", %1 hash partitions").arg(_partitions) : QString();
+
+    if (SchemaVersion::SCHEMA_V2 == _schema)
+    {
+        if (!createFilesTable())
+        {
+            return false;
+        }
+
+        /**
+         * 定长的列在前，行内没有对齐填充
+         * block_loc            块在源文件中的位置（BIGINT，比较和读取不需要任意精度运算）
+         * file_id              块所在的源文件在字典表 block_files 中的编号
+         * block_size           块的大小（Byte）
+         * counter              块的重复次数（计数器）
+         * block_hash           块的哈希值（长度固定为 hashSize）
+         */
+        QString sql = QString("CREATE TABLE %1 ("
+                              "block_loc BIGINT NOT NULL,"
+                              "file_id INTEGER NOT NULL,"
+                              "block_size INTEGER NOT NULL,"
+                              "counter INTEGER NOT NULL DEFAULT 1,"
+                              "block_hash BYTEA NOT NULL UNIQUE%2)%3;").arg(
+            tbName, hashSize > 0 ? QString(" CHECK (octet_length(block_hash) = %1)").arg(QString::number(hashSize)) : QString(), partition_by);
+        s.lastSql = sql;
+        LOG_DEBUG(QString("Create table `%1`").arg(tbName));
+        LOG_DEBUG(QString("↳ Run SQL: %1").arg(sql));
+
+        QSqlQuery q(s.conn->db);
+        if (exec(s, q, sql))
+        {
+            if (_partitions > 0 && !createPartitions(tbName))
+            {
+                return false;
+            }
+            s.lastLog = QString("Successed create table `%1` (schema v2%2)").arg(tbName, partition_info);
+            return true;
+        }
+
+        s.lastLog = QString("Failed to create table `%1`: %2").arg(tbName, q.lastError().text());
+        return false;
+    }
+
     /**
      * block_hash           块的哈希值
      * source_file_path     块所在的源文件 TODO 确认这里都改了
@@ -235,22 +600,255 @@ bool DatabaseService::createBlockInfoTable(const QString& tbName)
                           "source_file_path TEXT NOT NULL,"
                           "block_loc NUMERIC(1000, 0) NOT NULL,"
                           "block_size INTEGER NOT NULL,"
-                          "counter INTEGER NOT NULL DEFAULT 1);").arg(tbName);
-    _last_sql = sql;
-    qDebug() << QString("Create table `%1`").arg(tbName);
-    qDebug() << QString("↳ Run SQL: %1").arg(sql);
+                          "counter INTEGER NOT NULL DEFAULT 1)%2;").arg(tbName, partition_by);
+    s.lastSql = sql;
+    LOG_DEBUG(QString("Create table `%1`").arg(tbName));
+    LOG_DEBUG(QString("↳ Run SQL: %1").arg(sql));
+
+    QSqlQuery q(s.conn->db);
+    if (exec(s, q, sql))
+    {
+        if (_partitions > 0 && !createPartitions(tbName))
+        {
+            return false;
+        }
+        s.lastLog = QString("Successed create table `%1`%2").arg(tbName, _partitions > 0 ? QString(" (%1 hash partitions)").arg(_partitions) : QString());
+        return true;
+    }
+
+    s.lastLog = QString("Failed to create table `%1`: %2").arg(tbName, q.lastError().text());
+    return false;
+}
 
-    QSqlQuery q;
-    if (q.exec(sql))
+/**
+ * @brief DatabaseService::createFilesTable 创建 v2 表结构的源文件字典表（已经存在时不做任何事）
+ * @return 是否成功
+ */
+bool DatabaseService::createFilesTable()
+{
+    ThreadState& s = state();
+    QString sql = "CREATE TABLE IF NOT EXISTS " V2_FILES_TABLE " ("
+                  "file_id SERIAL PRIMARY KEY,"
+                  "path TEXT NOT NULL UNIQUE);";
+    s.lastSql = sql;
+
+    QSqlQuery q(s.conn->db);
+    if (exec(s, q, sql))
     {
-        _last_log = QString("Successed create table `%1`").arg(tbName);
         return true;
     }
 
-    _last_log = QString("Failed to create table `%1`: %2").arg(tbName, q.lastError().text());
+    s.lastLog = QString("Failed to create table `%1`: %2").arg(QString(V2_FILES_TABLE), q.lastError().text());
     return false;
 }
 
+/**
+ * @brief DatabaseService::createPartitions 为刚创建的哈希分区表创建 _partitions 个分区（表名_p0、表名_p1 ...），失败时删除整个表
+ * @param tbName 分区表名
+ * @return 是否成功
+ */
+bool DatabaseService::createPartitions(const QString& tbName)
+{
+    ThreadState& s = state();
+    QSqlQuery q(s.conn->db);
+    for (int i = 0; i < _partitions; ++i)
+    {
+        QString sql = QString("CREATE TABLE %1_p%2 PARTITION OF %1 FOR VALUES WITH (MODULUS %3, REMAINDER %2);").arg(
+            tbName, QString::number(i), QString::number(_partitions));
+        s.lastSql = sql;
+        if (!exec(s, q, sql))
+        {
+            const QString error = q.lastError().text();
+            exec(s, q, QString("DROP TABLE IF EXISTS %1;").arg(tbName));  // 同时删除已经创建的分区
+            s.lastLog = QString("Failed to create partition %1 of table `%2`: %3").arg(QString::number(i), tbName, error);
+            return false;
+        }
+    }
+    return true;
+}
+
+/**
+ * @brief DatabaseService::getFileId 源文件在字典表中的编号（字典中没有时插入），结果会被缓存
+ * @param sourceFilePath 源文件路径
+ * @return 编号，-1 表示失败
+ */
+int DatabaseService::getFileId(const QString& sourceFilePath)
+{
+    {
+        QMutexLocker locker(&_file_mutex);
+        const auto it = _file_ids.constFind(sourceFilePath);
+        if (it != _file_ids.constEnd())
+        {
+            return it.value();
+        }
+    }
+
+    // 已经存在时 DO UPDATE（值不变）使 RETURNING 同样返回已有的编号（多个线程同时插入同一个路径时得到相同的编号）
+    ThreadState& s = state();
+    QSqlQuery q(s.conn->db);
+    QString sql = "INSERT INTO " V2_FILES_TABLE " (path) VALUES (:path) "
+                  "ON CONFLICT (path) DO UPDATE SET path = EXCLUDED.path RETURNING file_id";
+    s.lastSql = sql;
+    q.prepare(sql);
+    q.bindValue(":path", sourceFilePath);
+
+    if (!exec(s, q) || !q.next())
+    {
+        s.lastLog = QString("Failed to get id of source file %1: %2").arg(sourceFilePath, q.lastError().text());
+        return -1;
+    }
+
+    const int file_id = q.value(0).toInt();
+    QMutexLocker locker(&_file_mutex);
+    _file_ids.insert(sourceFilePath, file_id);
+    _file_paths.insert(file_id, sourceFilePath);
+    return file_id;
+}
+
+/**
+ * @brief DatabaseService::getFilePath 字典表中编号对应的源文件路径。缓存中没有时重新加载整个字典（字典表很小）
+ * @param fileId 编号
+ * @return 源文件路径，未知的编号返回空字符串
+ */
+QString DatabaseService::getFilePath(const int fileId)
+{
+    {
+        QMutexLocker locker(&_file_mutex);
+        const auto it = _file_paths.constFind(fileId);
+        if (it != _file_paths.constEnd())
+        {
+            return it.value();
+        }
+    }
+
+    ThreadState& s = state();
+    QSqlQuery q(s.conn->db);
+    q.setForwardOnly(true);
+    QString sql = "SELECT file_id, path FROM " V2_FILES_TABLE;
+    s.lastSql = sql;
+    if (!exec(s, q, sql))
+    {
+        s.lastLog = QString("Failed to load source files from table %1: %2").arg(QString(V2_FILES_TABLE), q.lastError().text());
+        return QString();
+    }
+
+    QMutexLocker locker(&_file_mutex);
+    while (q.next())
+    {
+        const int id = q.value(0).toInt();
+        const QString path = q.value(1).toString();
+        _file_ids.insert(path, id);
+        _file_paths.insert(id, path);
+    }
+    return _file_paths.value(fileId);
+}
+
+void DatabaseService::clearFileCache()
+{
+    QMutexLocker locker(&_file_mutex);
+    _file_ids.clear();
+    _file_paths.clear();
+}
+
+/**
+ * @brief DatabaseService::migrateBlockInfoTableToV2 把 v1 表结构的块信息表复制为 v2 表结构的新表（在一个事务中，失败时不留下新表），
+ *  源文件路径写入字典表，位置转换为 BIGINT。原表保持不变
+ * @param v1TbName v1 表名
+ * @param v2TbName 新建的 v2 表名（不能已经存在）
+ * @param hashSize 哈希值的长度（Byte），0 表示不限制
+ * @return 是否成功
+ */
+bool DatabaseService::migrateBlockInfoTableToV2(const QString& v1TbName, const QString& v2TbName, const size_t hashSize)
+{
+    ThreadState& s = state();
+    if (!isDatabaseOpen())
+    {
+        return false;
+    }
+
+    if (!s.conn->db.transaction())
+    {
+        s.lastLog = QString("Failed to migrate table %1: %2").arg(v1TbName, s.conn->db.lastError().text());
+        return false;
+    }
+
+    const SchemaVersion schema = _schema;
+    _schema = SchemaVersion::SCHEMA_V2;
+    bool is_succ = createBlockInfoTable(v2TbName, hashSize);
+    _schema = schema;
+
+    QSqlQuery q(s.conn->db);
+    if (is_succ)
+    {
+        QString sql = QString("INSERT INTO " V2_FILES_TABLE " (path) SELECT DISTINCT source_file_path FROM %1 "
+                              "ON CONFLICT (path) DO NOTHING").arg(v1TbName);
+        s.lastSql = sql;
+        is_succ = exec(s, q, sql);
+    }
+    if (is_succ)
+    {
+        QString sql = QString("INSERT INTO %1 (block_loc, file_id, block_size, counter, block_hash) "
+                              "SELECT t.block_loc::BIGINT, f.file_id, t.block_size, t.counter, t.block_hash "
+                              "FROM %2 AS t JOIN " V2_FILES_TABLE " AS f ON f.path = t.source_file_path").arg(v2TbName, v1TbName);
+        s.lastSql = sql;
+        is_succ = exec(s, q, sql);
+    }
+
+    if (!is_succ)
+    {
+        const QString error = q.lastError().text().isEmpty() ? s.lastLog : q.lastError().text();
+        s.conn->db.rollback();
+        s.lastLog = QString("Failed to migrate table %1 to %2: %3").arg(v1TbName, v2TbName, error);
+        return false;
+    }
+
+    const int rows = q.numRowsAffected();
+    if (!s.conn->db.commit())
+    {
+        s.lastLog = QString("Failed to migrate table %1 to %2: %3").arg(v1TbName, v2TbName, s.conn->db.lastError().text());
+        return false;
+    }
+
+    s.lastLog = QString("Successed migrate %1 rows from table %2 to %3 (schema v2)").arg(QString::number(rows), v1TbName, v2TbName);
+    return true;
+}
+
+/**
+ * @brief DatabaseService::getTableSize 表（包括 TOAST）和所有索引占用的磁盘空间，分区表为所有分区之和（只能用于 PostgreSQL 12 及以上）
+ * @param tbName 表名
+ * @param tableBytes [输出] 表的大小（Byte）
+ * @param indexBytes [输出] 索引的大小（Byte）
+ * @return 是否成功
+ */
+bool DatabaseService::getTableSize(const QString& tbName, qint64& tableBytes, qint64& indexBytes)
+{
+    ThreadState& s = state();
+    tableBytes = -1;
+    indexBytes = -1;
+    if (!isDatabaseOpen())
+    {
+        return false;
+    }
+
+    QSqlQuery q(s.conn->db);
+    // 分区表本身不占空间，pg_partition_tree 列出表自己和所有分区（普通表只有自己一行）
+    QString sql = "SELECT sum(pg_table_size(relid)), sum(pg_indexes_size(relid)) FROM pg_partition_tree(to_regclass(:table_name))";
+    s.lastSql = sql;
+    q.prepare(sql);
+    q.bindValue(":table_name", tbName);
+
+    if (!exec(s, q) || !q.next() || q.value(0).isNull())
+    {
+        s.lastLog = QString("Failed to get size of table %1: %2").arg(tbName, q.lastError().text());
+        return false;
+    }
+
+    tableBytes = q.value(0).toLongLong();
+    indexBytes = q.value(1).toLongLong();
+    s.lastLog = QString("Table %1: %2 Bytes, indexes %3 Bytes").arg(tbName, QString::number(tableBytes), QString::number(indexBytes));
+    return true;
+}
+
 /**
  * @brief DatabaseService::deleteTable 删除当前连接的数据库中指定名称的表
  * @param tbName 要删除的表名
@@ -258,6 +856,7 @@ bool DatabaseService::createBlockInfoTable(const QString& tbName)
  */
 bool DatabaseService::deleteTable(const QString &tbName)
 {
+    ThreadState& s = state();
     if (!isDatabaseOpen())
     {
         return false;
@@ -270,18 +869,18 @@ bool DatabaseService::deleteTable(const QString &tbName)
 
     // 构建 SQL 语句，删除指定的表
     QString sql = QString("DROP TABLE IF EXISTS %1;").arg(tbName);
-    _last_sql = sql;
-    qDebug() << QString("Delete table `%1`").arg(tbName);
-    qDebug() << QString("↳ Run SQL: %1").arg(sql);
+    s.lastSql = sql;
+    LOG_DEBUG(QString("Delete table `%1`").arg(tbName));
+    LOG_DEBUG(QString("↳ Run SQL: %1").arg(sql));
 
-    QSqlQuery q;
-    if (q.exec(sql))
+    QSqlQuery q(s.conn->db);
+    if (exec(s, q, sql))
     {
-        _last_log = QString("Successfully deleted table `%1`").arg(tbName);
+        s.lastLog = QString("Successfully deleted table `%1`").arg(tbName);
         return true;
     }
 
-    _last_log = QString("Failed to delete table `%1`: %2").arg(tbName, q.lastError().text());
+    s.lastLog = QString("Failed to delete table `%1`: %2").arg(tbName, q.lastError().text());
     return false;
 
 }
@@ -293,32 +892,33 @@ bool DatabaseService::deleteTable(const QString &tbName)
  */
 bool DatabaseService::isTableExists(const QString &tbName)
 {
+    ThreadState& s = state();
     if (!isDatabaseOpen())
     {
         return false;
     }
 
-    QSqlQuery q(QSqlDatabase::database(QSqlDatabase::defaultConnection));
+    QSqlQuery q(s.conn->db);
     QString sql = QString("SELECT EXISTS (SELECT 1 FROM information_schema.tables "
                           "WHERE table_schema = 'public' AND table_name = :table_name)");
-    _last_sql = sql;
+    s.lastSql = sql;
     q.prepare(sql);
     q.bindValue(":table_name", tbName);
 
-    if (q.exec())
+    if (exec(s, q))
     {
         if (q.next())
         {
             // 如果表存在，返回 true；否则返回 false
             bool exists = q.value(0).toBool();
-            _last_log = exists ? QString("Table %1 exists").arg(tbName)
+            s.lastLog = exists ? QString("Table %1 exists").arg(tbName)
                                : QString("Table %1 does not exist").arg(tbName);
             return exists;
         }
     }
 
     // 如果查询失败，记录日志并返回 false
-    _last_log = QString("Failed to check is table %1 exists: %2").arg(tbName, q.lastError().text());
+    s.lastLog = QString("Failed to check is table %1 exists: %2").arg(tbName, q.lastError().text());
     return false;
 }
 
@@ -333,37 +933,54 @@ bool DatabaseService::isTableExists(const QString &tbName)
  * @return
  */
 bool DatabaseService::insertNewBlockInfoRow(const QString& tbName, const QByteArray& blockHash,
-                                            const QString& sourceFilePath, const int blockLoc, const int blockSize)
+                                            const QString& sourceFilePath, const qint64 blockLoc, const int blockSize)
 {
+    ThreadState& s = state();
     if (!isDatabaseOpen())
     {
         return false;
     }
 
+    const bool is_v2 = SchemaVersion::SCHEMA_V2 == _schema;
+    const int file_id = is_v2 ? getFileId(sourceFilePath) : 0;
+    if (file_id < 0)
+    {
+        return false;
+    }
+
     // 创建查询对象
-    QSqlQuery q(QSqlDatabase::database(QSqlDatabase::defaultConnection));
+    QSqlQuery q(s.conn->db);
 
     // 准备插入语句，使用参数绑定防止 SQL 注入
-    QString sql = QString("INSERT INTO %1 (block_hash, source_file_path, block_loc, block_size, counter) "
-                          "VALUES (:block_hash, :source_file_path, :block_loc, :block_size, :counter)").arg(tbName);
-    _last_sql = sql;
+    QString sql = is_v2 ? QString("INSERT INTO %1 (block_hash, file_id, block_loc, block_size, counter) "
+                                  "VALUES (:block_hash, :file_id, :block_loc, :block_size, :counter)").arg(tbName)
+                        : QString("INSERT INTO %1 (block_hash, source_file_path, block_loc, block_size, counter) "
+                                  "VALUES (:block_hash, :source_file_path, :block_loc, :block_size, :counter)").arg(tbName);
+    s.lastSql = sql;
     q.prepare(sql);
 
     // 绑定参数
     q.bindValue(":block_hash", blockHash);  // 直接绑定 QByteArray
-    q.bindValue(":source_file_path", sourceFilePath);
+    if (is_v2)
+    {
+        q.bindValue(":file_id", file_id);
+    }
+    else
+    {
+        q.bindValue(":source_file_path", sourceFilePath);
+    }
     q.bindValue(":block_loc", blockLoc);
     q.bindValue(":block_size", blockSize);
     q.bindValue(":counter", 1);
 
     // 执行插入
-    if (q.exec())
+    if (exec(s, q))
     {
-        _last_log = QString("Successed insert new row to table %1").arg(tbName);
+        LOG_LAZY(LOG_LEVEL_DEBUG, s.lastLog, QString("Successed insert new row to table %1").arg(tbName));
         return true;
     }
 
-    _last_log = QString("Failed to insert new row to table %1: %2").arg(tbName, q.lastError().text());
+    s.lastLog = QString("Failed to insert new row to table %1: %2").arg(tbName, q.lastError().text());
     return false;
 }
 
@@ -376,25 +993,26 @@ bool DatabaseService::insertNewBlockInfoRow(const QString& tbName, const QByteAr
  */
 int DatabaseService::getHashRepeatTimes(const QString& tbName, const QByteArray& blockHash)
 {
+    ThreadState& s = state();
     if (!isDatabaseOpen())
     {
         return false;
     }
 
     // 创建查询对象
-    QSqlQuery q(QSqlDatabase::database(QSqlDatabase::defaultConnection));
+    QSqlQuery q(s.conn->db);
 
     // 准备查询语句，查找相同的哈希值
     QString sql = QString("SELECT counter FROM %1 WHERE block_hash = :block_hash").arg(tbName);
-    _last_sql = sql;
+    s.lastSql = sql;
     q.prepare(sql);
 
     // 绑定哈希值参数
     q.bindValue(":block_hash", blockHash);
 
     // 执行查询
-    if (!q.exec()) {
-        _last_log = QString("Failed to get HashRepeatTimes: %1").arg(q.lastError().text());
+    if (!exec(s, q)) {
+        s.lastLog = QString("Failed to get HashRepeatTimes: %1").arg(q.lastError().text());
         return -1;  // 返回 -1 表示查询失败
     }
 
@@ -402,12 +1020,12 @@ int DatabaseService::getHashRepeatTimes(const QString& tbName, const QByteArray&
     if (q.next())
     {
         int counter = q.value(0).toInt();  // 获取重复次数
-        _last_log = QString("Find the same hash, repeat times: %1").arg(counter);
+        LOG_LAZY(LOG_LEVEL_DEBUG, s.lastLog, QString("Find the same hash, repeat times: %1").arg(counter));
         return counter;
     }
     else
     {
-        _last_log = "Do not have same hash";
+        LOG_LAZY(LOG_LEVEL_DEBUG, s.lastLog, QStringLiteral("Do not have same hash"));
         return 0;  // 返回 0 表示没有找到重复的记录
     }
 }
@@ -421,12 +1039,13 @@ int DatabaseService::getHashRepeatTimes(const QString& tbName, const QByteArray&
  */
 bool DatabaseService::updateCounter(const QString& tbName, const QByteArray &blockHash, int count)
 {
+    ThreadState& s = state();
     if (!isDatabaseOpen())
     {
         return false;
     }
 
-    QSqlQuery q(QSqlDatabase::database(QSqlDatabase::defaultConnection));
+    QSqlQuery q(s.conn->db);
 
     QString sql = QString("UPDATE %1 SET counter = :counter WHERE block_hash = :block_hash").arg(tbName);
     q.prepare(sql);
@@ -435,20 +1054,20 @@ bool DatabaseService::updateCounter(const QString& tbName, const QByteArray &blo
     q.bindValue(":block_hash", blockHash);
 
     // 执行更新
-    if (!q.exec()) {
-        _last_log = QString("Update failure: %1").arg(q.lastError().text());
+    if (!exec(s, q)) {
+        s.lastLog = QString("Update failure: %1").arg(q.lastError().text());
         return false;
     }
 
     // 检查是否有行受影响
     if (q.numRowsAffected() > 0)
     {
-        _last_log = QString("Update Counter successful! Number of rows affected: %1").arg(q.numRowsAffected());
+        LOG_LAZY(LOG_LEVEL_DEBUG, s.lastLog, QString("Update Counter successful! Number of rows affected: %1").arg(q.numRowsAffected()));
         return true;
     }
     else
     {
-        _last_log = "No matching hash found, Counter update failed";
+        s.lastLog = "No matching hash found, Counter update failed";
         return false;
     }
 }
@@ -461,23 +1080,24 @@ bool DatabaseService::updateCounter(const QString& tbName, const QByteArray &blo
  */
 int DatabaseService::getTableRowCount(const QString& tbName)
 {
+    ThreadState& s = state();
     if (!isDatabaseOpen())
     {
         return -1;
     }
     QString sql = QString("SELECT COUNT(*) FROM %1").arg(tbName);
-    QSqlQuery q(QSqlDatabase::database(QSqlDatabase::defaultConnection));
+    QSqlQuery q(s.conn->db);
 
-    if (!q.exec(sql))
+    if (!exec(s, q, sql))
     {
-        _last_log = QString("Failed get row count of table `%1`: %2").arg(tbName, q.lastError().text());
+        s.lastLog = QString("Failed get row count of table `%1`: %2").arg(tbName, q.lastError().text());
         return -2;
     }
 
     if (q.next())
     {
         int rowCount = q.value(0).toInt(); // 获取 COUNT(*) 的结果
-        _last_log = QString("Successed get row count of table `%1`, COUNT = %2").arg(tbName, rowCount);
+        s.lastLog = QString("Successed get row count of table `%1`, COUNT = %2").arg(tbName, rowCount);
         return rowCount;
     }
 
@@ -493,55 +1113,554 @@ int DatabaseService::getTableRowCount(const QString& tbName)
  */
 BlockInfo DatabaseService::getBlockInfo(const QString &tbName, const QByteArray &blockHash)
 {
+    ThreadState& s = state();
     if (!isDatabaseOpen())
     {
         return BlockInfo();
     }
 
-    QSqlQuery q(QSqlDatabase::database(QSqlDatabase::defaultConnection));
+    QSqlQuery q(s.conn->db);
 
     // 准备查询语句，根据 block_hash 查找对应的块信息
-    QString sql = QString("SELECT source_file_path, block_loc, block_size FROM %1 WHERE block_hash = :blockHash").arg(tbName);
-    _last_sql = sql;
+    const bool is_v2 = SchemaVersion::SCHEMA_V2 == _schema;
+    QString sql = QString("SELECT %1, block_loc, block_size FROM %2 WHERE block_hash = :blockHash").arg(QString(is_v2 ? "file_id" : "source_file_path"), tbName);
+    s.lastSql = sql;
     q.prepare(sql);
     q.bindValue(":blockHash", blockHash);
 
-    if (q.exec())
+    if (exec(s, q))
     {
         if (q.next())
         {
             // 提取查询结果并填充 BlockInfo 结构体
             BlockInfo info;
-            info.filePath = q.value(0).toString();             // 获取 source_file_path
             info.location = q.value(1).toLongLong();           // 获取 block_loc
             info.size = q.value(2).toUInt();                   // 获取 block_size
+            info.filePath = is_v2 ? getFilePath(q.value(0).toInt()) : q.value(0).toString();  // 获取 source_file_path（v2 从字典中获取）
 
-            _last_log = QString("Successfully retrieved block info from table %1, "
-                                "File: %2, Location: %3, Size: %4").arg(tbName, info.filePath, QString::number(info.location), QString::number(info.size));
+            LOG_LAZY(LOG_LEVEL_DEBUG, s.lastLog, QString("Successfully retrieved block info from table %1, "
+                                                         "File: %2, Location: %3, Size: %4").arg(tbName, info.filePath, QString::number(info.location), QString::number(info.size)));
             return info;
         }
         else
         {
-            _last_log = QString("No matching hash found in table %1 with given hash %2").arg(tbName, blockHash.toHex());
+            LOG_LAZY(LOG_LEVEL_DEBUG, s.lastLog, QString("No matching hash found in table %1 with given hash %2").arg(tbName, blockHash.toHex()));  // 调用者自己记录无法恢复的块
         }
     }
     else
     {
         // 查询执行失败，记录错误日志
-        _last_log = QString("Failed to retrieve block info from table %1: %2").arg(tbName, q.lastError().text());
+        s.lastLog = QString("Failed to retrieve block info from table %1: %2").arg(tbName, q.lastError().text());
     }
 
     return BlockInfo();  // 查询失败或没有找到匹配记录时返回 空对象
 }
 
+/**
+ * @brief DatabaseService::getBlockInfos 一次查询获取一批哈希值对应的块信息（用于恢复时批量解析块的位置）
+ * @param tbName 表名
+ * @param blockHashes 哈希值列表（可以包含重复的哈希，每个不同的哈希只查询一次）
+ * @param infos [输出] 与 blockHashes 一一对应的块信息；表中没有记录的哈希对应空的 BlockInfo（size 为 0）
+ * @return 是否查询成功（失败时 infos 中全部为空的 BlockInfo）
+ */
+bool DatabaseService::getBlockInfos(const QString& tbName, const QList<QByteArray>& blockHashes, QList<BlockInfo>& infos)
+{
+    ThreadState& s = state();
+    infos.clear();
+    infos.resize(blockHashes.size());
+
+    if (!isDatabaseOpen())
+    {
+        return false;
+    }
+
+    if (blockHashes.isEmpty())
+    {
+        return true;
+    }
+
+    /* 去掉重复的哈希，减少发送的数据量 */
+    QHash<QByteArray, BlockInfo> found;
+    QList<QByteArray> unique_hashes;
+    unique_hashes.reserve(blockHashes.size());
+    for (const QByteArray& hash : blockHashes)
+    {
+        if (!found.contains(hash))
+        {
+            found.insert(hash, BlockInfo());
+            unique_hashes.append(hash);
+        }
+    }
+
+    QSqlQuery q(s.conn->db);
+    q.setForwardOnly(true);
+
+    // 集合查询：一次往返解析整批哈希（block_hash 上的 UNIQUE 索引可以用于 = ANY(...)）
+    const bool is_v2 = SchemaVersion::SCHEMA_V2 == _schema;
+    QString sql = QString("SELECT block_hash, %1, block_loc, block_size FROM %2 "
+                          "WHERE block_hash = ANY(ARRAY(SELECT decode(h, 'hex') FROM unnest(string_to_array(:block_hashes, ',')) AS h))").arg(
+        QString(is_v2 ? "file_id" : "source_file_path"), tbName);
+    s.lastSql = sql;
+    q.prepare(sql);
+    q.bindValue(":block_hashes", joinHex(unique_hashes));
+
+    if (!exec(s, q))
+    {
+        s.lastLog = QString("Failed to retrieve block infos of batch from table %1: %2").arg(tbName, q.lastError().text());
+        return false;
+    }
+
+    size_t num_found = 0;
+    QList<QPair<QByteArray, int>> file_ids;  // v2：遍历结果时不能执行其他查询，遍历结束后再从字典中获取路径
+    while (q.next())
+    {
+        const QByteArray hash = q.value(0).toByteArray();
+        BlockInfo& info = found[hash];
+        if (is_v2)
+        {
+            file_ids.append(qMakePair(hash, q.value(1).toInt()));
+        }
+        else
+        {
+            info.filePath = q.value(1).toString();         // 获取 source_file_path
+        }
+        info.location = q.value(2).toLongLong();           // 获取 block_loc
+        info.size     = q.value(3).toUInt();               // 获取 block_size
+        ++num_found;
+    }
+    for (const QPair<QByteArray, int>& file_id : file_ids)
+    {
+        found[file_id.first].filePath = getFilePath(file_id.second);
+    }
+
+    for (qsizetype i = 0; i < blockHashes.size(); ++i)
+    {
+        infos[i] = found.value(blockHashes.at(i));
+    }
+
+    LOG_LAZY(LOG_LEVEL_DEBUG, s.lastLog, QString("Retrieved block info of %1 of %2 distinct hashes from table %3").arg(
+        QString::number(num_found), QString::number(unique_hashes.size()), tbName));
+    return true;
+}
+
+/**
+ * @brief DatabaseService::getHashRepeatTimesBatch 一次查询获取一批哈希值在表中的重复次数
+ * @param tbName 表名
+ * @param blockHashes 哈希值列表（可以包含重复的哈希）
+ * @param repeatTimes [输出] 表中已存在的哈希 -> 重复次数；不在表中的哈希不会出现在结果中
+ * @return 是否查询成功
+ */
+bool DatabaseService::getHashRepeatTimesBatch(const QString& tbName, const QList<QByteArray>& blockHashes,
+                                              QHash<QByteArray, int>& repeatTimes)
+{
+    ThreadState& s = state();
+    repeatTimes.clear();
+
+    if (!isDatabaseOpen())
+    {
+        return false;
+    }
+
+    if (blockHashes.isEmpty())
+    {
+        return true;
+    }
+
+    QSqlQuery q(s.conn->db);
+    q.setForwardOnly(true);
+
+    // 集合查询：一次往返查询整批哈希（block_hash 上的 UNIQUE 索引可以用于 = ANY(...)）
+    QString sql = QString("SELECT block_hash, counter FROM %1 "
+                          "WHERE block_hash = ANY(ARRAY(SELECT decode(h, 'hex') FROM unnest(string_to_array(:block_hashes, ',')) AS h))").arg(tbName);
+    s.lastSql = sql;
+    q.prepare(sql);
+    q.bindValue(":block_hashes", joinHex(blockHashes));
+
+    if (!exec(s, q))
+    {
+        s.lastLog = QString("Failed to get HashRepeatTimes of batch: %1").arg(q.lastError().text());
+        return false;
+    }
+
+    while (q.next())
+    {
+        repeatTimes.insert(q.value(0).toByteArray(), q.value(1).toInt());
+    }
+
+    LOG_LAZY(LOG_LEVEL_DEBUG, s.lastLog, QString("Find %1 of %2 hashes in table %3").arg(QString::number(repeatTimes.size()), QString::number(blockHashes.size()), tbName));
+    return true;
+}
+
+/**
+ * @brief DatabaseService::insertNewBlockInfoRows 一条语句插入一批新的块信息行
+ * @param tbName 表名
+ * @param blockHashes 块的哈希值（不能有重复）
+ * @param sourceFilePath 块所在文件的路径（同一批的块在同一个文件中）
+ * @param blockLocs 块在文件中的位置（第几字节）
+ * @param blockSizes 块的大小（Byte）
+ * @param counters 块的重复次数
+ * @return 是否插入成功
+ */
+bool DatabaseService::insertNewBlockInfoRows(const QString& tbName, const QList<QByteArray>& blockHashes,
+                                             const QString& sourceFilePath, const QList<qint64>& blockLocs,
+                                             const QList<int>& blockSizes, const QList<int>& counters)
+{
+    ThreadState& s = state();
+    if (!isDatabaseOpen())
+    {
+        return false;
+    }
+
+    if (blockHashes.size() != blockLocs.size()
+        || blockHashes.size() != blockSizes.size()
+        || blockHashes.size() != counters.size())
+    {
+        s.lastLog = QString("Failed to insert new rows to table %1: size of arguments do not match").arg(tbName);
+        return false;
+    }
+
+    if (blockHashes.isEmpty())
+    {
+        return true;
+    }
+
+    const bool is_v2 = SchemaVersion::SCHEMA_V2 == _schema;
+    const int file_id = is_v2 ? getFileId(sourceFilePath) : 0;
+    if (file_id < 0)
+    {
+        return false;
+    }
+
+    QSqlQuery q(s.conn->db);
+
+    // 多个数组并行展开（unnest）为多行，一次插入
+    QString sql = is_v2 ? QString("INSERT INTO %1 (block_hash, file_id, block_loc, block_size, counter) "
+                                  "SELECT decode(t.h, 'hex'), :file_id, t.l::BIGINT, t.s::INTEGER, t.c::INTEGER "
+                                  "FROM unnest(string_to_array(:block_hashes, ','), string_to_array(:block_locs, ','), "
+                                  "string_to_array(:block_sizes, ','), string_to_array(:counters, ',')) AS t(h, l, s, c)").arg(tbName)
+                        : QString("INSERT INTO %1 (block_hash, source_file_path, block_loc, block_size, counter) "
+                                  "SELECT decode(t.h, 'hex'), :source_file_path, t.l::NUMERIC, t.s::INTEGER, t.c::INTEGER "
+                                  "FROM unnest(string_to_array(:block_hashes, ','), string_to_array(:block_locs, ','), "
+                                  "string_to_array(:block_sizes, ','), string_to_array(:counters, ',')) AS t(h, l, s, c)").arg(tbName);
+    s.lastSql = sql;
+    q.prepare(sql);
+
+    if (is_v2)
+    {
+        q.bindValue(":file_id", file_id);
+    }
+    else
+    {
+        q.bindValue(":source_file_path", sourceFilePath);
+    }
+    q.bindValue(":block_hashes", joinHex(blockHashes));
+    q.bindValue(":block_locs", joinNumbers(blockLocs));
+    q.bindValue(":block_sizes", joinNumbers(blockSizes));
+    q.bindValue(":counters", joinNumbers(counters));
+
+    if (exec(s, q))
+    {
+        LOG_LAZY(LOG_LEVEL_DEBUG, s.lastLog, QString("Successed insert %1 new rows to table %2").arg(QString::number(blockHashes.size()), tbName));
+        return true;
+    }
+
+    s.lastLog = QString("Failed to insert new rows to table %1: %2").arg(tbName, q.lastError().text());
+    return false;
+}
+
+/**
+ * @brief DatabaseService::addCounters 一条语句为一批哈希值增加重复次数
+ * @param tbName 表名
+ * @param blockHashes 块的哈希值（不能有重复，否则同一行只会被更新一次）
+ * @param increments 每个哈希值 counter 的增量
+ * @return 是否更新成功
+ */
+bool DatabaseService::addCounters(const QString& tbName, const QList<QByteArray>& blockHashes, const QList<int>& increments)
+{
+    ThreadState& s = state();
+    if (!isDatabaseOpen())
+    {
+        return false;
+    }
+
+    if (blockHashes.size() != increments.size())
+    {
+        s.lastLog = QString("Update failure: size of arguments do not match");
+        return false;
+    }
+
+    if (blockHashes.isEmpty())
+    {
+        return true;
+    }
+
+    QSqlQuery q(s.conn->db);
+
+    QString sql = QString("UPDATE %1 AS tb SET counter = tb.counter + d.inc::INTEGER "
+                          "FROM unnest(string_to_array(:block_hashes, ','), string_to_array(:increments, ',')) AS d(h, inc) "
+                          "WHERE tb.block_hash = decode(d.h, 'hex')").arg(tbName);
+    s.lastSql = sql;
+    q.prepare(sql);
+
+    q.bindValue(":block_hashes", joinHex(blockHashes));
+    q.bindValue(":increments", joinNumbers(increments));
+
+    if (!exec(s, q))
+    {
+        s.lastLog = QString("Update failure: %1").arg(q.lastError().text());
+        return false;
+    }
+
+    LOG_LAZY(LOG_LEVEL_DEBUG, s.lastLog, QString("Update Counter successful! Number of rows affected: %1").arg(q.numRowsAffected()));
+    return true;
+}
+
+/**
+ * @brief DatabaseService::forEachHashCounter 遍历表中所有的哈希值和重复次数（用于预加载内存中的哈希索引）
+ * @param tbName 表名
+ * @param callback 每一行调用一次：callback(哈希值, 重复次数)
+ * @return 是否查询成功
+ */
+bool DatabaseService::forEachHashCounter(const QString& tbName, const std::function<void(const QByteArray&, int)>& callback)
+{
+    ThreadState& s = state();
+    if (!isDatabaseOpen())
+    {
+        return false;
+    }
+
+    QSqlQuery q(s.conn->db);
+    q.setForwardOnly(true);  // 只向前遍历，不缓存整个结果集
+
+    QString sql = QString("SELECT block_hash, counter FROM %1").arg(tbName);
+    s.lastSql = sql;
+
+    if (!exec(s, q, sql))
+    {
+        s.lastLog = QString("Failed to load hashes from table %1: %2").arg(tbName, q.lastError().text());
+        return false;
+    }
+
+    size_t rows = 0;
+    while (q.next())
+    {
+        callback(q.value(0).toByteArray(), q.value(1).toInt());
+        ++rows;
+    }
+
+    s.lastLog = QString("Successed load %1 hashes from table %2").arg(QString::number(rows), tbName);
+    return true;
+}
+
+/* PostgreSQL COPY 二进制格式的编码函数（所有整数均为网络字节序） */
+static void appendInt16(QByteArray& buf, const qint16 value)
+{
+    const qint16 be = qToBigEndian(value);
+    buf.append(reinterpret_cast<const char*>(&be), sizeof(be));
+}
+
+static void appendInt32(QByteArray& buf, const qint32 value)
+{
+    const qint32 be = qToBigEndian(value);
+    buf.append(reinterpret_cast<const char*>(&be), sizeof(be));
+}
+
+static void appendInt64(QByteArray& buf, const qint64 value)
+{
+    const qint64 be = qToBigEndian(value);
+    buf.append(reinterpret_cast<const char*>(&be), sizeof(be));
+}
+
+/**
+ * @brief appendNumericField 以 NUMERIC 的二进制格式写入一个非负整数字段（4 字节长度 + ndigits, weight, sign, dscale + 万进制数字）
+ * @param buf 缓冲区
+ * @param value 非负整数
+ */
+static void appendNumericField(QByteArray& buf, const qint64 value)
+{
+    qint16 digits[8];   // 万进制（NBASE = 10000）数字，低位在前；qint64 最多 5 位
+    qint16 ndigits = 0;
+    for (quint64 v = value; v > 0; v /= 10000)
+    {
+        digits[ndigits++] = v % 10000;
+    }
+
+    appendInt32(buf, 8 + ndigits * 2);
+    appendInt16(buf, ndigits);
+    appendInt16(buf, ndigits > 0 ? ndigits - 1 : 0);  // weight：最高位数字的权重
+    appendInt16(buf, 0x0000);                          // sign：正数
+    appendInt16(buf, 0);                               // dscale：没有小数部分
+    for (qint16 i = ndigits - 1; i >= 0; --i)
+    {
+        appendInt16(buf, digits[i]);
+    }
+}
+
+/**
+ * @brief DatabaseService::copyBlockRecords 通过 libpq 的 COPY ... FROM STDIN (FORMAT binary) 批量写入块信息（只能用于 PostgreSQL）
+ *  适用于首次导入：表中不能已经存在相同的哈希值，否则整个 COPY 会因为 UNIQUE 约束失败
+ * @param tbName 表名
+ * @param records 要写入的块信息（哈希值不能重复）
+ * @return 是否写入成功
+ */
+bool DatabaseService::copyBlockRecords(const QString& tbName, const QList<BlockRecord>& records)
+{
+    ThreadState& s = state();
+    if (!isDatabaseOpen())
+    {
+        return false;
+    }
+
+    if (records.isEmpty())
+    {
+        return true;
+    }
+
+    /* 获取 QPSQL 驱动底层的 libpq 连接（与 QSqlQuery 使用的是同一个连接） */
+    QVariant handle = s.conn->db.driver()->handle();
+    if (!handle.isValid() || qstrcmp(handle.typeName(), "PGconn*") != 0)
+    {
+        s.lastLog = QString("Failed to copy rows to table %1: driver %2 do not support COPY").arg(tbName, _driver);
+        return false;
+    }
+    PGconn* conn = *static_cast<PGconn**>(handle.data());
+    if (nullptr == conn)
+    {
+        s.lastLog = QString("Failed to copy rows to table %1: invalid connection handle").arg(tbName);
+        return false;
+    }
+
+    /* v2：COPY 进行期间不能执行其他查询，先获取所有源文件的编号 */
+    const bool is_v2 = SchemaVersion::SCHEMA_V2 == _schema;
+    if (is_v2)
+    {
+        QString last_path;
+        for (const BlockRecord& record : records)
+        {
+            if (record.info.filePath != last_path)
+            {
+                last_path = record.info.filePath;
+                if (getFileId(last_path) < 0)
+                {
+                    return false;
+                }
+            }
+        }
+    }
+
+    QString sql = is_v2 ? QString("COPY %1 (block_loc, file_id, block_size, counter, block_hash) FROM STDIN (FORMAT binary)").arg(tbName)
+                        : QString("COPY %1 (block_hash, source_file_path, block_loc, block_size, counter) FROM STDIN (FORMAT binary)").arg(tbName);
+    s.lastSql = sql;
+
+    s.conn->queries.fetch_add(1, std::memory_order_relaxed);
+    PGresult* res = PQexec(conn, sql.toUtf8().constData());
+    if (PGRES_COPY_IN != PQresultStatus(res))
+    {
+        s.lastLog = QString("Failed to start COPY to table %1: %2").arg(tbName, QString::fromUtf8(PQerrorMessage(conn)));
+        PQclear(res);
+        return false;
+    }
+    PQclear(res);
+
+    /* 文件头：签名 + 标志位 + 头扩展长度 */
+    static const char signature[] = "PGCOPY\n\377\r\n";  // 11 字节（包含结尾的 '\0'）
+    QByteArray buf;
+    const qsizetype flush_size = 1 << 20;  // 每 1 MiB 发送一次
+    buf.reserve(flush_size + 4096);
+    buf.append(signature, sizeof(signature));
+    appendInt32(buf, 0);
+    appendInt32(buf, 0);
+
+    bool is_succ = true;
+    QByteArray path_utf8;
+    QString last_path;
+    int file_id = 0;
+    for (const BlockRecord& record : records)
+    {
+        if (record.info.filePath != last_path)
+        {
+            last_path = record.info.filePath;
+            path_utf8 = is_v2 ? QByteArray() : last_path.toUtf8();
+            file_id   = is_v2 ? getFileId(last_path) : 0;  // 已经在缓存中，不会执行查询
+        }
+
+        appendInt16(buf, 5);  // 每行 5 个字段
+        if (is_v2)
+        {
+            appendInt32(buf, 8);
+            appendInt64(buf, record.info.location);
+            appendInt32(buf, 4);
+            appendInt32(buf, file_id);
+        }
+        else
+        {
+            appendInt32(buf, record.hash.size());
+            buf.append(record.hash);
+            appendInt32(buf, path_utf8.size());
+            buf.append(path_utf8);
+            appendNumericField(buf, record.info.location);
+        }
+        appendInt32(buf, 4);
+        appendInt32(buf, record.info.size);
+        appendInt32(buf, 4);
+        appendInt32(buf, record.counter);
+        if (is_v2)
+        {
+            appendInt32(buf, record.hash.size());
+            buf.append(record.hash);
+        }
+
+        if (buf.size() >= flush_size)
+        {
+            if (1 != PQputCopyData(conn, buf.constData(), buf.size()))
+            {
+                is_succ = false;
+                break;
+            }
+            buf.clear();
+        }
+    }
+
+    /* 文件尾 */
+    if (is_succ)
+    {
+        appendInt16(buf, -1);
+        is_succ = (1 == PQputCopyData(conn, buf.constData(), buf.size()));
+    }
+
+    if (1 != PQputCopyEnd(conn, is_succ ? nullptr : "BlockStorageTester: failed to send COPY data"))
+    {
+        is_succ = false;
+    }
+
+    /* 读取 COPY 的执行结果 */
+    while (nullptr != (res = PQgetResult(conn)))
+    {
+        if (PGRES_COMMAND_OK != PQresultStatus(res))
+        {
+            is_succ = false;
+        }
+        PQclear(res);
+    }
+
+    if (is_succ)
+    {
+        LOG_LAZY(LOG_LEVEL_DEBUG, s.lastLog, QString("Successed copy %1 rows to table %2").arg(QString::number(records.size()), tbName));
+        return true;
+    }
+
+    s.lastLog = QString("Failed to copy rows to table %1: %2").arg(tbName, QString::fromUtf8(PQerrorMessage(conn)));
+    return false;
+}
+
 QString DatabaseService::lastSQL()
 {
-    return _last_sql;
+    return state().lastSql;
 }
 
 QString DatabaseService::lastLog()
 {
-    return _last_log;
+    return state().lastLog;
 }
 
 QString DatabaseService::getHost()
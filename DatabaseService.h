@@ -1,14 +1,32 @@
 #ifndef DATABASESERVICE_H
 #define DATABASESERVICE_H
 
-#include "BlockInfo.h"
+#include "DedupIndex.h"
 
 #include <QObject>
 #include <QSqlDatabase>
+#include <QHash>
+#include <QList>
+#include <QMutex>
+#include <QSemaphore>
+#include <QThreadStorage>
+
+#include <atomic>
+#include <functional>
+
+class QSqlQuery;
 
 #define DEFAULT_DB_CONN     ""
 
-class DatabaseService : public QObject
+#define DB_POOL_MAX_SIZE            64          // 连接池最多的连接数（包括连接数据库的线程使用的默认连接）
+#define DB_POOL_WAIT_TIMEOUT_MS     30000       // 工作线程等待空闲连接的最长时间
+#define DB_POOL_CONN_PREFIX         "bst_db_"   // 工作线程连接的名字前缀（之后是连接的编号）
+#define DB_MAX_PARTITIONS           1024        // 块信息表最多的哈希分区数
+
+/**
+ * @brief 去重索引的 PostgreSQL 实现（同时负责连接、创建和删除数据库）
+ */
+class DatabaseService : public QObject, public DedupIndex
 {
     Q_OBJECT
 public:
@@ -23,17 +41,45 @@ public:
     bool createDatabase(const QString& database);
     bool dropCurDatabase();
     bool disconnectCurDatabase();
+    IndexBackend backend() const override;
+    bool isOpen() override;
+
+    /* 连接池（工作线程各自使用一个命名连接，调用线程结束时自动归还） */
+    void setPoolSize(const int size) override;
+    int poolSize();
+    QList<DbConnectionStats> connectionStats() override;
+    void resetConnectionStats() override;
+    void releaseThreadConnection();
+
+    /* 表结构（之后的块信息表操作都按这个结构进行） */
+    void setSchemaVersion(const SchemaVersion version) override;
+    SchemaVersion schemaVersion() const override;
+    void setPartitionCount(const int partitions) override;
+    int partitionCount() const override;
 
     /* 表相关操作 */
-    bool createBlockInfoTable(const QString& tbName);
-    bool deleteTable(const QString& tbName);
-    bool isTableExists(const QString& tbName);
+    bool createBlockInfoTable(const QString& tbName, const size_t hashSize = 0) override;
+    bool migrateBlockInfoTableToV2(const QString& v1TbName, const QString& v2TbName, const size_t hashSize = 0) override;
+    bool getTableSize(const QString& tbName, qint64& tableBytes, qint64& indexBytes) override;
+    bool deleteTable(const QString& tbName) override;
+    bool isTableExists(const QString& tbName) override;
     bool insertNewBlockInfoRow(const QString& tbName, const QByteArray& blockHash,
-                               const QString& sourceFilePath, const int blockLoc, const int blockSize);
-    int getHashRepeatTimes(const QString& tbName, const QByteArray& blockHash);
-    bool updateCounter(const QString& tbName, const QByteArray& blockHash, int count);
-    int getTableRowCount(const QString& tbName);
-    BlockInfo getBlockInfo(const QString& tbName, const QByteArray& blockHash);
+                               const QString& sourceFilePath, const qint64 blockLoc, const int blockSize) override;
+    int getHashRepeatTimes(const QString& tbName, const QByteArray& blockHash) override;
+    bool updateCounter(const QString& tbName, const QByteArray& blockHash, int count) override;
+    int getTableRowCount(const QString& tbName) override;
+    BlockInfo getBlockInfo(const QString& tbName, const QByteArray& blockHash) override;
+
+    /* 批量操作（一次数据库往返处理一批哈希） */
+    bool getBlockInfos(const QString& tbName, const QList<QByteArray>& blockHashes, QList<BlockInfo>& infos) override;
+    bool getHashRepeatTimesBatch(const QString& tbName, const QList<QByteArray>& blockHashes,
+                                 QHash<QByteArray, int>& repeatTimes) override;
+    bool insertNewBlockInfoRows(const QString& tbName, const QList<QByteArray>& blockHashes,
+                                const QString& sourceFilePath, const QList<qint64>& blockLocs,
+                                const QList<int>& blockSizes, const QList<int>& counters) override;
+    bool addCounters(const QString& tbName, const QList<QByteArray>& blockHashes, const QList<int>& increments) override;
+    bool copyBlockRecords(const QString& tbName, const QList<BlockRecord>& records) override;
+    bool forEachHashCounter(const QString& tbName, const std::function<void(const QByteArray&, int)>& callback) override;
 
     /* getter 方法*/
     QString getHost();
@@ -43,12 +89,63 @@ public:
     QString getPassword();
     QString getNameDatabase();
 
-    /* 日志相关 */
-    QString lastSQL();
-    QString lastLog();
+    /* 日志相关（调用线程最后执行的 SQL 语句和日志消息） */
+    QString lastSQL() override;
+    QString lastLog() override;
 
 private:
-    QSqlDatabase _db;   // 连接 & 管理的数据库对象
+    /**
+     * @brief 连接池中的一个连接：编号 0 是连接数据库的线程使用的默认连接，其他编号由工作线程获得后在该线程中打开，归还时关闭
+     */
+    struct Connection
+    {
+        QString             name;
+        QSqlDatabase        db;
+        bool                inUse       = false;    // 是否已经被某个线程获得（由 _pool_mutex 保护）
+        std::atomic<qint64> queries     {0};
+        std::atomic<qint64> waitNsecs   {0};
+    };
+
+    /**
+     * @brief 每个线程的状态：获得的连接、最后执行的 SQL 语句和日志消息。线程结束时析构并归还连接
+     */
+    struct ThreadState
+    {
+        DatabaseService*    dbs     = nullptr;
+        Connection*         conn    = nullptr;
+        QString             lastSql;
+        QString             lastLog;
+
+        ~ThreadState();
+    };
+
+    ThreadState& state();
+    bool acquireConnection(ThreadState& s);
+    void releaseConnection(ThreadState& s);
+    bool exec(ThreadState& s, QSqlQuery& q, const QString& sql = QString());
+
+    bool createFilesTable();
+    bool createPartitions(const QString& tbName);
+    int getFileId(const QString& sourceFilePath);
+    QString getFilePath(const int fileId);
+    void clearFileCache();
+
+private:
+    QSqlDatabase _db;   // 连接 & 管理的数据库对象（默认连接，只能在连接数据库的线程中使用）
+    SchemaVersion _schema = SchemaVersion::SCHEMA_V1;
+    int _partitions = 0;  // 新建的块信息表按 block_hash 哈希分区的分区数（0 表示不分区）
+
+    /* 连接池 */
+    QList<Connection*>  _pool;                  // [0] 为默认连接
+    QMutex              _pool_mutex;            // 保护 _pool 和 _is_connected
+    QSemaphore          _free_conns;            // 空闲的工作线程连接数
+    bool                _is_connected = false;  // 默认连接是否已经打开（工作线程只在这时克隆连接）
+    QThreadStorage<ThreadState*> _thread_state;
+
+    /* v2 源文件字典的缓存（路径 <-> 编号），避免每个块都查询字典表。由 _file_mutex 保护 */
+    QMutex              _file_mutex;
+    QHash<QString, int> _file_ids;
+    QHash<int, QString> _file_paths;
 
     QString _host;
     qint16  _port;
@@ -57,9 +154,6 @@ private:
     QString _password;
     QString _name_db;
 
-    QString _last_sql;  // 最后执行的 SQL 语句
-    QString _last_log;  // 最后记录的日志消息
-
 };
 
 #endif // DATABASESERVICE_H
@@ -0,0 +1,23 @@
+#include "DedupIndex.h"
+
+/**
+ * @brief DedupIndex::getIndexBackendName 获得去重索引后端名字字符串
+ * @param backend 后端
+ * @return
+ */
+QString DedupIndex::getIndexBackendName(const IndexBackend backend)
+{
+    switch (backend) {
+    case IndexBackend::INDEX_POSTGRESQL:
+        return "POSTGRESQL";
+
+    case IndexBackend::INDEX_SQLITE:
+        return "SQLITE";
+
+    case IndexBackend::INDEX_HASHFILE:
+        return "HASHFILE";
+
+    default:
+        return "NONE";
+    }
+}
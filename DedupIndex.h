@@ -0,0 +1,88 @@
+#ifndef DEDUPINDEX_H
+#define DEDUPINDEX_H
+
+#include "BlockInfo.h"
+
+#include <QByteArray>
+#include <QHash>
+#include <QList>
+#include <QString>
+
+#include <functional>
+
+#define V2_FILES_TABLE      "block_files"   // v2 表结构的源文件字典表（同一个数据库中所有 v2 块信息表共用）
+
+/**
+ * @brief 去重索引（块信息表）的后端
+ */
+enum IndexBackend {
+    INDEX_POSTGRESQL = 0,   // PostgreSQL 服务器（DatabaseService，需要先连接数据库）
+    INDEX_SQLITE     = 1,   // 嵌入式 SQLite 数据库文件（SqliteIndex，WAL 模式，不需要数据库服务器）
+    INDEX_HASHFILE   = 2    // 内存映射的哈希表文件（HashFileIndex，不经过 SQL）
+};
+
+/**
+ * @brief 一个数据库连接的统计信息
+ */
+struct DbConnectionStats
+{
+    QString name;               // 连接名（默认连接为 "default"）
+    qint64  queries     = 0;    // 执行的查询次数（包括 COPY）
+    qint64  waitNsecs   = 0;    // 线程等待获得这个连接的总时间（ns）
+};
+
+/**
+ * @brief 去重索引的接口：分块和恢复只通过这些块信息表操作读写块的哈希、位置和重复次数，不关心具体的存储后端。
+ *  除非特别说明，所有方法都可以在多个线程中同时调用（每个线程使用自己的连接），lastSQL / lastLog 为调用线程最后的记录
+ */
+class DedupIndex
+{
+public:
+    virtual ~DedupIndex() = default;
+
+    virtual IndexBackend backend() const = 0;
+    virtual bool isOpen() = 0;
+
+    /* 连接（不使用连接池的后端忽略连接数） */
+    virtual void setPoolSize(const int size) = 0;
+    virtual QList<DbConnectionStats> connectionStats() = 0;
+    virtual void resetConnectionStats() = 0;
+
+    /* 表结构（之后的块信息表操作都按这个结构进行，不支持分区的后端分区数总是 0） */
+    virtual void setSchemaVersion(const SchemaVersion version) = 0;
+    virtual SchemaVersion schemaVersion() const = 0;
+    virtual void setPartitionCount(const int partitions) = 0;
+    virtual int partitionCount() const = 0;
+
+    /* 表相关操作 */
+    virtual bool createBlockInfoTable(const QString& tbName, const size_t hashSize = 0) = 0;
+    virtual bool migrateBlockInfoTableToV2(const QString& v1TbName, const QString& v2TbName, const size_t hashSize = 0) = 0;
+    virtual bool getTableSize(const QString& tbName, qint64& tableBytes, qint64& indexBytes) = 0;
+    virtual bool deleteTable(const QString& tbName) = 0;
+    virtual bool isTableExists(const QString& tbName) = 0;
+    virtual bool insertNewBlockInfoRow(const QString& tbName, const QByteArray& blockHash,
+                                       const QString& sourceFilePath, const qint64 blockLoc, const int blockSize) = 0;
+    virtual int getHashRepeatTimes(const QString& tbName, const QByteArray& blockHash) = 0;
+    virtual bool updateCounter(const QString& tbName, const QByteArray& blockHash, int count) = 0;
+    virtual int getTableRowCount(const QString& tbName) = 0;
+    virtual BlockInfo getBlockInfo(const QString& tbName, const QByteArray& blockHash) = 0;
+
+    /* 批量操作 */
+    virtual bool getBlockInfos(const QString& tbName, const QList<QByteArray>& blockHashes, QList<BlockInfo>& infos) = 0;
+    virtual bool getHashRepeatTimesBatch(const QString& tbName, const QList<QByteArray>& blockHashes,
+                                         QHash<QByteArray, int>& repeatTimes) = 0;
+    virtual bool insertNewBlockInfoRows(const QString& tbName, const QList<QByteArray>& blockHashes,
+                                        const QString& sourceFilePath, const QList<qint64>& blockLocs,
+                                        const QList<int>& blockSizes, const QList<int>& counters) = 0;
+    virtual bool addCounters(const QString& tbName, const QList<QByteArray>& blockHashes, const QList<int>& increments) = 0;
+    virtual bool copyBlockRecords(const QString& tbName, const QList<BlockRecord>& records) = 0;
+    virtual bool forEachHashCounter(const QString& tbName, const std::function<void(const QByteArray&, int)>& callback) = 0;
+
+    /* 日志相关（调用线程最后执行的 SQL 语句和日志消息） */
+    virtual QString lastSQL() = 0;
+    virtual QString lastLog() = 0;
+
+    static QString getIndexBackendName(const IndexBackend backend);
+};
+
+#endif // DEDUPINDEX_H
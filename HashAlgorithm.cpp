@@ -1,5 +1,153 @@
 #include "HashAlgorithm.h"
 
+#include <cstring>
+
+#include <QHash>
+
+#include "HashMultiBuffer.h"
+
+#include <blake3.h>
+#include <xxhash.h>
+
+#if (defined(__x86_64__) || defined(__i386__)) && (defined(__GNUC__) || defined(__clang__))
+#define HASH_HAS_X86_SHA_NI 1
+#include <immintrin.h>
+#include <cpuid.h>
+#endif
+
+namespace {
+
+#if HASH_HAS_X86_SHA_NI
+alignas(16) const quint32 SHA256_K[64] = {
+    0x428a2f98, 0x71374491, 0xb5c0fbcf, 0xe9b5dba5, 0x3956c25b, 0x59f111f1, 0x923f82a4, 0xab1c5ed5,
+    0xd807aa98, 0x12835b01, 0x243185be, 0x550c7dc3, 0x72be5d74, 0x80deb1fe, 0x9bdc06a7, 0xc19bf174,
+    0xe49b69c1, 0xefbe4786, 0x0fc19dc6, 0x240ca1cc, 0x2de92c6f, 0x4a7484aa, 0x5cb0a9dc, 0x76f988da,
+    0x983e5152, 0xa831c66d, 0xb00327c8, 0xbf597fc7, 0xc6e00bf3, 0xd5a79147, 0x06ca6351, 0x14292967,
+    0x27b70a85, 0x2e1b2138, 0x4d2c6dfc, 0x53380d13, 0x650a7354, 0x766a0abb, 0x81c2c92e, 0x92722c85,
+    0xa2bfe8a1, 0xa81a664b, 0xc24b8b70, 0xc76c51a3, 0xd192e819, 0xd6990624, 0xf40e3585, 0x106aa070,
+    0x19a4c116, 0x1e376c08, 0x2748774c, 0x34b0bcb5, 0x391c0cb3, 0x4ed8aa4a, 0x5b9cca4f, 0x682e6ff3,
+    0x748f82ee, 0x78a5636f, 0x84c87814, 0x8cc70208, 0x90befffa, 0xa4506ceb, 0xbef9a3f7, 0xc67178f2
+};
+
+/**
+ * @brief sha256BlocksNI 使用 SHA-NI 指令压缩 num_blocks 个 64 字节的消息块
+ * @param state SHA-256 的 8 个状态字
+ * @param data 消息块
+ * @param num_blocks 消息块数量
+ */
+__attribute__((target("sha,sse4.1,ssse3")))
+void sha256BlocksNI(quint32 state[8], const uchar* data, size_t num_blocks)
+{
+    const __m128i mask = _mm_set_epi64x(0x0c0d0e0f08090a0bULL, 0x0405060700010203ULL);  // 每个 32 位字转为大端
+
+    /* 状态字重排为 sha256rnds2 需要的 ABEF / CDGH */
+    __m128i tmp    = _mm_loadu_si128((const __m128i*)&state[0]);
+    __m128i state1 = _mm_loadu_si128((const __m128i*)&state[4]);
+    tmp    = _mm_shuffle_epi32(tmp, 0xB1);
+    state1 = _mm_shuffle_epi32(state1, 0x1B);
+    __m128i state0 = _mm_alignr_epi8(tmp, state1, 8);
+    state1 = _mm_blend_epi16(state1, tmp, 0xF0);
+
+    for (size_t b = 0; b < num_blocks; ++b, data += 64)
+    {
+        const __m128i abef_save = state0;
+        const __m128i cdgh_save = state1;
+        __m128i msg[4];  // 最近 16 个消息字 W[i-16..i-1]
+
+        for (int i = 0; i < 16; ++i)  // 每次 4 轮
+        {
+            __m128i& m = msg[i & 3];
+            if (i < 4)
+            {
+                m = _mm_shuffle_epi8(_mm_loadu_si128((const __m128i*)(data + i * 16)), mask);
+            }
+            else
+            {
+                __m128i w = _mm_sha256msg1_epu32(msg[i & 3], msg[(i + 1) & 3]);
+                w = _mm_add_epi32(w, _mm_alignr_epi8(msg[(i + 3) & 3], msg[(i + 2) & 3], 4));
+                m = _mm_sha256msg2_epu32(w, msg[(i + 3) & 3]);
+            }
+
+            __m128i wk = _mm_add_epi32(m, _mm_load_si128((const __m128i*)&SHA256_K[i * 4]));
+            state1 = _mm_sha256rnds2_epu32(state1, state0, wk);
+            wk     = _mm_shuffle_epi32(wk, 0x0E);
+            state0 = _mm_sha256rnds2_epu32(state0, state1, wk);
+        }
+
+        state0 = _mm_add_epi32(state0, abef_save);
+        state1 = _mm_add_epi32(state1, cdgh_save);
+    }
+
+    tmp    = _mm_shuffle_epi32(state0, 0x1B);
+    state1 = _mm_shuffle_epi32(state1, 0xB1);
+    state0 = _mm_blend_epi16(tmp, state1, 0xF0);
+    state1 = _mm_alignr_epi8(state1, tmp, 8);
+    _mm_storeu_si128((__m128i*)&state[0], state0);
+    _mm_storeu_si128((__m128i*)&state[4], state1);
+}
+
+/**
+ * @brief sha256NI 使用 SHA-NI 指令计算 SHA-256
+ * @param ptr 数据
+ * @param len 数据长度
+ * @param out [输出] 32 字节的哈希值
+ */
+void sha256NI(const uchar* ptr, const size_t len, uchar* out)
+{
+    quint32 state[8] = {0x6a09e667, 0xbb67ae85, 0x3c6ef372, 0xa54ff53a, 0x510e527f, 0x9b05688c, 0x1f83d9ab, 0x5be0cd19};
+
+    sha256BlocksNI(state, ptr, len / 64);
+
+    /* 最后不足 64 字节的数据 + 0x80 + 消息长度（bit，大端）填充为 1 或 2 个消息块 */
+    uchar tail[128] = {0};
+    const size_t rem = len % 64;
+    const size_t num_tail = (rem + 9 <= 64) ? 1 : 2;
+    const quint64 bits = (quint64)len * 8;
+    memcpy(tail, ptr + len - rem, rem);
+    tail[rem] = 0x80;
+    for (int i = 0; i < 8; ++i)
+    {
+        tail[num_tail * 64 - 1 - i] = (uchar)(bits >> (8 * i));
+    }
+    sha256BlocksNI(state, tail, num_tail);
+
+    for (int i = 0; i < 8; ++i)
+    {
+        out[i * 4 + 0] = (uchar)(state[i] >> 24);
+        out[i * 4 + 1] = (uchar)(state[i] >> 16);
+        out[i * 4 + 2] = (uchar)(state[i] >> 8);
+        out[i * 4 + 3] = (uchar)(state[i]);
+    }
+}
+#endif
+
+} // namespace
+
+/**
+ * @brief hasSha256Ni 当前 CPU 是否支持 SHA-NI 指令（不支持时 SHA256_NI 使用 QCryptographicHash 计算）
+ * @return
+ */
+bool Hash::hasSha256Ni()
+{
+#if HASH_HAS_X86_SHA_NI
+    static const bool supported = []() {
+        unsigned int eax = 0, ebx = 0, ecx = 0, edx = 0;
+        if (!__get_cpuid(1, &eax, &ebx, &ecx, &edx) || !(ecx & bit_SSSE3) || !(ecx & bit_SSE4_1))
+        {
+            return false;
+        }
+        if (!__get_cpuid_count(7, 0, &eax, &ebx, &ecx, &edx))
+        {
+            return false;
+        }
+        return 0 != (ebx & (1u << 29));  // CPUID.(EAX=7,ECX=0):EBX[29] SHA
+    }();
+    return supported;
+#else
+    return false;
+#endif
+}
+
 
 /**
  * @brief getDataHash
@@ -22,9 +170,190 @@ QByteArray Hash::getDataHash(const QByteArray& data, const HashAlg alg)
     case HashAlg::SHA512:
         return QCryptographicHash::hash(data, QCryptographicHash::Sha512);
 
+    case HashAlg::BLAKE3:
+    {
+        QByteArray hash(BLAKE3_OUT_LEN, Qt::Uninitialized);
+        blake3_hasher hasher;
+        blake3_hasher_init(&hasher);
+        blake3_hasher_update(&hasher, data.constData(), data.size());
+        blake3_hasher_finalize(&hasher, (uint8_t*)hash.data(), BLAKE3_OUT_LEN);
+        return hash;
+    }
+
+    case HashAlg::XXH128:
+    {
+        XXH128_canonical_t canonical;  // 大端的规范形式，与平台无关
+        XXH128_canonicalFromHash(&canonical, XXH3_128bits(data.constData(), data.size()));
+        return QByteArray((const char*)canonical.digest, sizeof(canonical.digest));
+    }
+
+    case HashAlg::SHA256_NI:
+#if HASH_HAS_X86_SHA_NI
+        if (hasSha256Ni())
+        {
+            QByteArray hash(32, Qt::Uninitialized);
+            sha256NI((const uchar*)data.constData(), data.size(), (uchar*)hash.data());
+            return hash;
+        }
+#endif
+        return QCryptographicHash::hash(data, QCryptographicHash::Sha256);
+
+    default:
+        break;
+    }
+    return QByteArray();
+}
+
+/**
+ * @brief getDataHashes 批量计算多个块的哈希（结果与逐个调用 getDataHash 相同）
+ * @param blocks 数据块
+ * @param alg 算法
+ * @return 每个块的哈希值（顺序与 blocks 相同）
+ */
+QList<QByteArray> Hash::getDataHashes(const QList<QByteArray>& blocks, const HashAlg alg)
+{
+    const size_t hash_size = getHashSize(alg);
+    QByteArray digests(blocks.size() * hash_size, Qt::Uninitialized);
+    getDataHashes(blocks, alg, digests.data());
+
+    QList<QByteArray> hashes;
+    hashes.reserve(blocks.size());
+    for (qsizetype i = 0; i < blocks.size(); ++i)
+    {
+        hashes.append(digests.mid(i * hash_size, hash_size));
+    }
+    return hashes;
+}
+
+/**
+ * @brief getDataHashes 批量计算多个块的哈希，依次写入调用者提供的缓冲区（不为每个块分配内存）。
+ *  支持多缓冲区 SIMD 的算法（MD5 / SHA1 / SHA256）把等长的块每 MultiBufferHash::lanes() 个一组同时计算，
+ *  凑不满一组的少量块以及其他算法逐个计算，QCryptographicHash 只创建一次并在块之间重用
+ * @param blocks 数据块
+ * @param alg 算法
+ * @param digests [输出] 每个块的哈希值（顺序与 blocks 相同，每个 getHashSize(alg) 字节，至少 blocks.size() * getHashSize(alg) 字节）
+ */
+void Hash::getDataHashes(const QList<QByteArray>& blocks, const HashAlg alg, char* digests)
+{
+    const size_t hash_size = getHashSize(alg);
+    QList<qsizetype> remain;  // 逐个计算的块
+
+    const int lanes = MultiBufferHash::isSupported(alg) ? MultiBufferHash::lanes() : 0;
+    if (lanes > 0)
+    {
+        /* 按块的长度分组，同一组中每 lanes 个块同时计算；最后不足一组的块较多时用重复的块补齐，否则逐个计算 */
+        QHash<qsizetype, QList<qsizetype>> groups;
+        for (qsizetype i = 0; i < blocks.size(); ++i)
+        {
+            groups[blocks.at(i).size()].append(i);
+        }
+
+        uchar lane_digests[HASH_MAX_LANES * HASH_MAX_SIZE];
+        const uchar* data[HASH_MAX_LANES];
+        for (auto it = groups.cbegin(); it != groups.cend(); ++it)
+        {
+            const QList<qsizetype>& indexes = it.value();
+            qsizetype pos = 0;
+            for (; indexes.size() - pos >= qMax(2, lanes / 4); pos += lanes)
+            {
+                const qsizetype count = qMin<qsizetype>(lanes, indexes.size() - pos);
+                for (int l = 0; l < lanes; ++l)
+                {
+                    data[l] = (const uchar*)blocks.at(indexes.at(pos + qMin<qsizetype>(l, count - 1))).constData();
+                }
+                MultiBufferHash::hash(alg, data, it.key(), lane_digests);
+                for (qsizetype l = 0; l < count; ++l)
+                {
+                    memcpy(digests + indexes.at(pos + l) * hash_size, lane_digests + l * hash_size, hash_size);
+                }
+            }
+            for (; pos < indexes.size(); ++pos)
+            {
+                remain.append(indexes.at(pos));
+            }
+        }
+    }
+    else
+    {
+        remain.reserve(blocks.size());
+        for (qsizetype i = 0; i < blocks.size(); ++i)
+        {
+            remain.append(i);
+        }
+    }
+
+    QCryptographicHash::Algorithm method = QCryptographicHash::Sha256;
+    bool use_qt = false;
+    switch (alg) {
+    case HashAlg::MD5:
+        method = QCryptographicHash::Md5;
+        use_qt = true;
+        break;
+
+    case HashAlg::SHA1:
+        method = QCryptographicHash::Sha1;
+        use_qt = true;
+        break;
+
+    case HashAlg::SHA256:
+        method = QCryptographicHash::Sha256;
+        use_qt = true;
+        break;
+
+    case HashAlg::SHA512:
+        method = QCryptographicHash::Sha512;
+        use_qt = true;
+        break;
+
+    case HashAlg::SHA256_NI:
+        use_qt = !hasSha256Ni();
+        break;
+
     default:
         break;
     }
+
+    if (use_qt)
+    {
+        QCryptographicHash hasher(method);
+        for (const qsizetype i : std::as_const(remain))
+        {
+            hasher.reset();
+            hasher.addData(blocks.at(i));
+            memcpy(digests + i * hash_size, hasher.resultView().data(), hash_size);
+        }
+        return;
+    }
+
+    for (const qsizetype i : std::as_const(remain))
+    {
+        const QByteArray& block = blocks.at(i);
+        char* out = digests + i * hash_size;
+        switch (alg) {
+        case HashAlg::BLAKE3:
+        {
+            blake3_hasher hasher;
+            blake3_hasher_init(&hasher);
+            blake3_hasher_update(&hasher, block.constData(), block.size());
+            blake3_hasher_finalize(&hasher, (uint8_t*)out, BLAKE3_OUT_LEN);
+            break;
+        }
+
+        case HashAlg::XXH128:
+            XXH128_canonicalFromHash((XXH128_canonical_t*)out, XXH3_128bits(block.constData(), block.size()));
+            break;
+
+#if HASH_HAS_X86_SHA_NI
+        case HashAlg::SHA256_NI:
+            sha256NI((const uchar*)block.constData(), block.size(), (uchar*)out);
+            break;
+#endif
+
+        default:
+            memcpy(out, getDataHash(block, alg).constData(), hash_size);
+            break;
+        }
+    }
 }
 
 /**
@@ -47,6 +376,15 @@ QString Hash::getHashName(const HashAlg alg)
     case HashAlg::SHA512:
         return "SHA512";
 
+    case HashAlg::BLAKE3:
+        return "BLAKE3";
+
+    case HashAlg::XXH128:
+        return "XXH128";
+
+    case HashAlg::SHA256_NI:
+        return "SHA256_NI";
+
     default:
         return "NONE";
         break;
@@ -56,24 +394,31 @@ QString Hash::getHashName(const HashAlg alg)
 /**
  * @brief getHashSize 获取哈希算法计算后的哈希长度（Byte）
  * @param alg 哈希算法
- * @return TODO
+ * @return
  */
 size_t Hash::getHashSize(const HashAlg alg)
 {
-    QByteArray data = "FOOOOOOOOOX";
-
     switch (alg) {
     case HashAlg::MD5:
-        return getDataHash(data, HashAlg::MD5).size();
+        return 16;
 
     case HashAlg::SHA1:
-        return getDataHash(data, HashAlg::SHA1).size();
+        return 20;
 
     case HashAlg::SHA256:
-        return getDataHash(data, HashAlg::SHA256).size();
+        return 32;
 
     case HashAlg::SHA512:
-        return getDataHash(data, HashAlg::SHA512).size();
+        return 64;
+
+    case HashAlg::BLAKE3:
+        return BLAKE3_OUT_LEN;
+
+    case HashAlg::XXH128:
+        return sizeof(XXH128_canonical_t);
+
+    case HashAlg::SHA256_NI:
+        return 32;
 
     default:
         return 0;
@@ -5,20 +5,30 @@
 #include <QString>
 #include <QCryptographicHash>
 #include <QByteArray>
+#include <QList>
+
+#define HASH_MAX_SIZE   64  // 所有哈希算法中最长的哈希值（SHA512，Byte）
+#define HASH_MAX_LANES  16  // 多缓冲区 SIMD 同时计算的最大消息数（AVX-512）
 
 enum HashAlg {
     NONE   = -1,
     MD5    = 0,
     SHA1   = 1,
     SHA256 = 2,
-    SHA512 = 3
+    SHA512 = 3,
+    BLAKE3 = 4,     // BLAKE3（libblake3，运行时选择 SSE/AVX2/AVX-512/NEON 实现）
+    XXH128 = 5,     // xxHash XXH3 128 位（libxxhash，非密码学哈希）
+    SHA256_NI = 6   // SHA-256（CPU 支持 SHA-NI 时使用硬件指令，结果与 SHA256 相同）
 };
 
 struct Hash
 {
     static QByteArray getDataHash(const QByteArray& data, HashAlg alg);
+    static QList<QByteArray> getDataHashes(const QList<QByteArray>& blocks, const HashAlg alg);
+    static void getDataHashes(const QList<QByteArray>& blocks, const HashAlg alg, char* digests);
     static QString getHashName(const HashAlg alg);
     static size_t getHashSize(const HashAlg alg);
+    static bool hasSha256Ni();
 };
 
 #endif // HASHALGORITHM_H
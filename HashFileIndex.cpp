@@ -0,0 +1,1578 @@
+#include "HashFileIndex.h"
+#include "HashAlgorithm.h"
+#include "Log.h"
+
+#include <QDir>
+#include <QFileInfo>
+#include <QReadLocker>
+#include <QWriteLocker>
+
+#include <cstddef>
+#include <cstdio>
+#include <cstring>
+
+#if defined(Q_OS_UNIX)
+#include <sys/mman.h>
+#include <unistd.h>
+#elif defined(Q_OS_WIN)
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <io.h>
+#include <windows.h>
+#endif
+
+HashFileIndex::HashFileIndex()
+{
+    static_assert(sizeof(Header) <= HASHFILE_HEADER_SIZE, "hash file header does not fit in HASHFILE_HEADER_SIZE");
+    static_assert(sizeof(Slot) == 24, "unexpected padding in hash file slot");
+    static_assert(sizeof(JournalEntry) == 24, "unexpected padding in hash file journal entry");
+}
+
+HashFileIndex::~HashFileIndex()
+{
+    close();
+    LOG_DEBUG("HashFileIndex::~HashFileIndex auto close");
+}
+
+/**
+ * @brief HashFileIndex::open 打开（不存在时创建）索引目录，表在第一次使用时打开并映射到内存
+ * @param path 索引目录
+ * @return 是否成功
+ */
+bool HashFileIndex::open(const QString& path)
+{
+    ThreadState& s = state();
+    const QString abs_path = QFileInfo(path).absoluteFilePath();
+    if (abs_path == dirPath())
+    {
+        s.lastLog = QString("Hash index %1 is already open").arg(abs_path);
+        return true;
+    }
+
+    close();
+    if (!QDir().mkpath(abs_path))
+    {
+        s.lastLog = QString("Cannot create hash index directory %1").arg(abs_path);
+        return false;
+    }
+
+    QMutexLocker locker(&_tables_mutex);
+    _dir = abs_path;
+    s.lastLog = QString("Successed open hash index %1 (memory-mapped, %2 slots per bucket, max load factor %3)").arg(
+        abs_path, QString::number(HASHFILE_BUCKET_SLOTS), QString::number(HASHFILE_MAX_LOAD_FACTOR));
+    return true;
+}
+
+/**
+ * @brief HashFileIndex::close 同步（checkpoint）并关闭所有打开的表
+ */
+void HashFileIndex::close()
+{
+    QMutexLocker locker(&_tables_mutex);
+    for (const TablePtr& t : std::as_const(_tables))
+    {
+        unloadTable(t.data(), true);
+    }
+    _tables.clear();
+    _dir.clear();
+}
+
+/**
+ * @brief HashFileIndex::removeIndexFiles 关闭索引并删除目录中所有表的文件（目录为空时同时删除目录，不删除其他文件）
+ * @return 是否成功删除
+ */
+bool HashFileIndex::removeIndexFiles()
+{
+    ThreadState& s = state();
+    const QString path = dirPath();
+    if (path.isEmpty())
+    {
+        s.lastLog = "Can not remove hash index: no index directory is open";
+        return false;
+    }
+
+    close();
+    QDir dir(path);
+    const QStringList filters = {"*" HASHFILE_TABLE_SUFFIX, "*" HASHFILE_TABLE_SUFFIX ".tmp", "*" HASHFILE_JOURNAL_SUFFIX, "*" HASHFILE_FILES_SUFFIX};
+    int removed = 0;
+    for (const QFileInfo& info : dir.entryInfoList(filters, QDir::Files))
+    {
+        if (!QFile::remove(info.absoluteFilePath()))
+        {
+            s.lastLog = QString("Failed to remove hash index file %1").arg(info.absoluteFilePath());
+            return false;
+        }
+        ++removed;
+    }
+    QDir().rmdir(path);
+
+    s.lastLog = QString("Successed remove %1 files of hash index %2").arg(QString::number(removed), path);
+    return true;
+}
+
+QString HashFileIndex::dirPath()
+{
+    QMutexLocker locker(&_tables_mutex);
+    return _dir;
+}
+
+IndexBackend HashFileIndex::backend() const
+{
+    return IndexBackend::INDEX_HASHFILE;
+}
+
+bool HashFileIndex::isOpen()
+{
+    if (dirPath().isEmpty())
+    {
+        state().lastLog = "Hash index is not open";
+        return false;
+    }
+    return true;
+}
+
+/**
+ * @brief HashFileIndex::setPoolSize 没有连接，忽略连接数
+ * @param size
+ */
+void HashFileIndex::setPoolSize(const int size)
+{
+    Q_UNUSED(size)
+}
+
+/**
+ * @brief HashFileIndex::connectionStats 没有连接，把查询和写入的哈希个数记在一个虚拟的连接上（等待时间总是 0）
+ * @return
+ */
+QList<DbConnectionStats> HashFileIndex::connectionStats()
+{
+    DbConnectionStats stat;
+    stat.name    = "hash file";
+    stat.queries = _ops.load(std::memory_order_relaxed);
+    return {stat};
+}
+
+void HashFileIndex::resetConnectionStats()
+{
+    _ops.store(0, std::memory_order_relaxed);
+}
+
+HashFileIndex::ThreadState& HashFileIndex::state()
+{
+    if (!_thread_state.hasLocalData())
+    {
+        _thread_state.setLocalData(new ThreadState);
+    }
+    return *_thread_state.localData();
+}
+
+/**
+ * @brief HashFileIndex::filePathOf 表的文件路径（调用者保证索引目录没有变化）
+ * @param tbName 表名
+ * @param suffix 文件后缀
+ * @return
+ */
+QString HashFileIndex::filePathOf(const QString& tbName, const char* suffix) const
+{
+    return QDir(_dir).filePath(tbName + suffix);
+}
+
+void HashFileIndex::setSchemaVersion(const SchemaVersion version)
+{
+    _schema = version;
+}
+
+SchemaVersion HashFileIndex::schemaVersion() const
+{
+    return _schema;
+}
+
+/**
+ * @brief HashFileIndex::setPartitionCount 哈希表文件不支持分区，忽略分区数
+ * @param partitions
+ */
+void HashFileIndex::setPartitionCount(const int partitions)
+{
+    Q_UNUSED(partitions)
+}
+
+int HashFileIndex::partitionCount() const
+{
+    return 0;
+}
+
+/**
+ * @brief HashFileIndex::getTable 获得已经打开的表，没有打开时打开表的文件（未同步时先恢复）。
+ *  返回的引用使表在使用期间不会被删除；表可能同时被关闭（close、deleteTable），加锁之后要用 isLoaded 检查
+ * @param tbName 表名
+ * @return 表，不存在或者打开失败时为空（原因在 lastLog）
+ */
+HashFileIndex::TablePtr HashFileIndex::getTable(const QString& tbName)
+{
+    QMutexLocker locker(&_tables_mutex);
+    if (_dir.isEmpty())
+    {
+        state().lastLog = "Hash index is not open";
+        return TablePtr();
+    }
+
+    TablePtr t = _tables.value(tbName);
+    if (nullptr == t)
+    {
+        t = loadTable(tbName);
+        if (nullptr != t)
+        {
+            _tables.insert(tbName, t);
+        }
+    }
+    return t;
+}
+
+/**
+ * @brief HashFileIndex::isLoaded 表的文件是否仍然打开（已经被关闭或者重建失败时返回 false）。调用者持有表的锁
+ * @param t 表
+ * @return
+ */
+bool HashFileIndex::isLoaded(const Table* t)
+{
+    if (nullptr == t->map)
+    {
+        state().lastLog = QString("Table %1 is closed").arg(t->name);
+        return false;
+    }
+    return true;
+}
+
+/**
+ * @brief HashFileIndex::loadTable 打开表的文件：映射哈希表文件、检查文件头、加载源文件字典。
+ *  哈希表没有同步（上次没有正常关闭）时重建哈希表。调用者持有 _tables_mutex
+ * @param tbName 表名
+ * @return 表，不存在或者打开失败时为空（原因在 lastLog）
+ */
+HashFileIndex::TablePtr HashFileIndex::loadTable(const QString& tbName)
+{
+    ThreadState& s = state();
+    const QString path = filePathOf(tbName, HASHFILE_TABLE_SUFFIX);
+    QFile::remove(path + ".tmp");  // 扩容或者恢复时中断留下的文件（原来的文件仍然完整）
+    if (!QFile::exists(path))
+    {
+        s.lastLog = QString("Table %1 does not exist").arg(tbName);
+        return TablePtr();
+    }
+
+    Table* t = new Table;
+    t->name = tbName;
+    t->file.setFileName(path);
+    t->journal.setFileName(filePathOf(tbName, HASHFILE_JOURNAL_SUFFIX));
+    t->files.setFileName(filePathOf(tbName, HASHFILE_FILES_SUFFIX));
+
+    QString error;
+    if (!t->file.open(QIODevice::ReadWrite) || t->file.size() < HASHFILE_HEADER_SIZE)
+    {
+        error = t->file.isOpen() ? QString("file is too small") : t->file.errorString();
+    }
+    else if (nullptr == (t->map = t->file.map(0, t->file.size())))
+    {
+        error = t->file.errorString();
+    }
+    else
+    {
+        const Header* header = t->header();
+        const quint32 slot_size = sizeof(Slot) + ((header->digestSize + 7) & ~7U);
+        if (0 != std::memcmp(header->magic, HASHFILE_MAGIC, sizeof(header->magic)) || HASHFILE_VERSION != header->version)
+        {
+            error = "not a hash index file";
+        }
+        else if (header->digestSize > HASH_MAX_SIZE || header->slotSize != slot_size || HASHFILE_BUCKET_SLOTS != header->bucketSlots
+                 || 0 == header->bucketCount || 0 != (header->bucketCount & (header->bucketCount - 1))
+                 || t->file.size() != HASHFILE_HEADER_SIZE + (qint64)(slotCount(header) * slot_size))
+        {
+            error = "invalid header";
+        }
+    }
+    if (error.isEmpty() && !t->journal.open(QIODevice::ReadWrite | QIODevice::Append))
+    {
+        error = t->journal.errorString();
+    }
+    if (error.isEmpty() && !t->files.open(QIODevice::ReadWrite | QIODevice::Append))
+    {
+        error = t->files.errorString();
+    }
+    if (!error.isEmpty())
+    {
+        s.lastLog = QString("Failed to open table %1: %2").arg(tbName, error);
+        unloadTable(t, false);
+        delete t;
+        return TablePtr();
+    }
+
+    /* 源文件字典：每行一个路径，没有换行符的最后一行是中断的写入，截掉 */
+    qint64 dict_bytes = 0;
+    t->files.seek(0);
+    while (!t->files.atEnd())
+    {
+        const QByteArray line = t->files.readLine();
+        if (!line.endsWith('\n'))
+        {
+            break;
+        }
+        dict_bytes += line.size();
+        const QString file_path = QString::fromUtf8(line.chopped(1));
+        t->fileIds.insert(file_path, t->filePaths.size());
+        t->filePaths.append(file_path);
+    }
+    if (dict_bytes < t->files.size())
+    {
+        t->files.resize(dict_bytes);
+    }
+
+    /* 未同步时重建；已同步时日志中的记录都已经在哈希表中，清空上次清空之前中断留下的日志 */
+    bool is_succ = true;
+    if (!t->header()->clean)
+    {
+        is_succ = rebuild(t, 0, true);
+    }
+    else if (0 != t->header()->journalBytes || t->journal.size() > 0)
+    {
+        is_succ = resetJournal(t) && syncMap(t->map, HASHFILE_HEADER_SIZE);
+    }
+    if (!is_succ)
+    {
+        unloadTable(t, false);
+        delete t;
+        return TablePtr();
+    }
+    return TablePtr(t);
+}
+
+/**
+ * @brief HashFileIndex::unloadTable 关闭表的文件（等待正在使用表的操作结束）。表对象在最后一个引用释放时删除，
+ *  之后仍持有引用的操作加锁后会发现表已经关闭
+ * @param t 表
+ * @param sync 是否先 checkpoint（删除表时不需要）
+ */
+void HashFileIndex::unloadTable(Table* t, const bool sync)
+{
+    QWriteLocker locker(&t->lock);
+    if (sync && nullptr != t->map)
+    {
+        checkpoint(t);
+    }
+    if (nullptr != t->map)
+    {
+        t->file.unmap(t->map);
+        t->map = nullptr;
+    }
+    t->file.close();
+    t->journal.close();
+    t->files.close();
+}
+
+/**
+ * @brief HashFileIndex::checkpoint 把日志、源文件字典和映射的哈希表写入磁盘，清空日志（之前的日志都已经在哈希表中），
+ *  然后把哈希表标记为已同步。在清空日志和写入文件头之间崩溃时，哈希表仍然是未同步的，从空的日志恢复（槽位已经写入磁盘）。
+ *  调用者持有表的写锁
+ * @param t 表
+ * @return 是否成功
+ */
+bool HashFileIndex::checkpoint(Table* t)
+{
+    Header* header = t->header();
+    if (header->clean && t->pending.isEmpty())
+    {
+        return true;
+    }
+
+    if (!flushJournal(t) || !syncFile(t->journal) || !syncFile(t->files) || !syncMap(t->map, t->file.size()))
+    {
+        state().lastLog = QString("Failed to sync table %1").arg(t->name);
+        return false;
+    }
+    if (!resetJournal(t))
+    {
+        return false;
+    }
+    header->clean = 1;
+    return syncMap(t->map, HASHFILE_HEADER_SIZE);
+}
+
+/**
+ * @brief HashFileIndex::resetJournal 清空日志文件并写入磁盘，文件头中 checkpoint 时的日志长度设为 0（由调用者写入磁盘）。
+ *  调用者持有表的写锁，并且保证日志中的记录都已经在写入磁盘的哈希表中
+ * @param t 表
+ * @return 是否成功
+ */
+bool HashFileIndex::resetJournal(Table* t)
+{
+    if (!t->journal.resize(0) || !syncFile(t->journal))
+    {
+        state().lastLog = QString("Failed to truncate journal of table %1: %2").arg(t->name, t->journal.errorString());
+        return false;
+    }
+    t->header()->journalBytes = 0;
+    return true;
+}
+
+/**
+ * @brief HashFileIndex::markDirty checkpoint 之后第一次修改哈希表之前，把文件头标记为未同步并立即写入磁盘，
+ *  这样崩溃之后打开时知道哈希表中可能有不完整的槽位。调用者持有表的写锁
+ * @param t 表
+ * @return 是否成功
+ */
+bool HashFileIndex::markDirty(Table* t)
+{
+    Header* header = t->header();
+    if (!header->clean)
+    {
+        return true;
+    }
+
+    header->clean = 0;
+    if (!syncMap(t->map, HASHFILE_HEADER_SIZE))
+    {
+        state().lastLog = QString("Failed to sync header of table %1").arg(t->name);
+        return false;
+    }
+    return true;
+}
+
+/**
+ * @brief HashFileIndex::reserve 写入新记录之前保证负载因子不超过 HASHFILE_MAX_LOAD_FACTOR，否则扩容。调用者持有表的写锁
+ * @param t 表
+ * @param newRecords 将要写入的记录数
+ * @return 是否成功
+ */
+bool HashFileIndex::reserve(Table* t, const quint64 newRecords)
+{
+    const Header* header = t->header();
+    if (header->recordCount + newRecords <= slotCount(header) * HASHFILE_MAX_LOAD_FACTOR)
+    {
+        return true;
+    }
+    return rebuild(t, header->recordCount + newRecords, false);
+}
+
+/**
+ * @brief HashFileIndex::rebuild 把哈希表重新放置到一个新文件中（桶数翻倍直到能容纳 minRecords 条记录），
+ *  写入磁盘之后原子地替换原来的文件，新文件总是已同步的。调用者持有表的写锁（或者表还没有被其他线程看到）
+ *  recover 为 true 时（上次没有正常关闭）：丢弃校验失败的槽位，并插入 checkpoint 之后的日志中哈希表里没有的记录，
+ *  日志末尾不完整或校验失败的记录被截掉
+ * @param t 表
+ * @param minRecords 新的哈希表至少要容纳的记录数
+ * @param recover 是否恢复
+ * @return 是否成功
+ */
+bool HashFileIndex::rebuild(Table* t, const quint64 minRecords, const bool recover)
+{
+    ThreadState& s = state();
+    const Header* old_header = t->header();
+    const quint32 digest_size = old_header->digestSize;
+    const quint32 slot_size   = old_header->slotSize;
+
+    /* 恢复：读取 checkpoint 之后的日志，直到第一条不完整或者校验失败的记录 */
+    QByteArray journal;
+    QList<qsizetype> entries;   // journal 中每条有效记录的位置
+    const qsizetype entry_size = sizeof(JournalEntry) + digest_size;
+    if (recover)
+    {
+        if (!flushJournal(t))
+        {
+            return false;
+        }
+        const qint64 start = (qint64)old_header->journalBytes <= t->journal.size() ? (qint64)old_header->journalBytes : 0;
+        t->journal.seek(start);
+        journal = t->journal.readAll();
+
+        qsizetype pos = 0;
+        for (; pos + entry_size <= journal.size(); pos += entry_size)
+        {
+            JournalEntry e;
+            std::memcpy(&e, journal.constData() + pos, sizeof(e));
+            const quint16 check = e.check;
+            e.check = 0;
+            QByteArray buf(reinterpret_cast<const char*>(&e), sizeof(e));
+            buf.append(journal.constData() + pos + sizeof(e), digest_size);
+            if (digest_size != e.digestSize || e.kind > JournalEntry::JOURNAL_COUNTER || check != qChecksum(buf))
+            {
+                break;
+            }
+            entries.append(pos);
+        }
+        if (start + pos < t->journal.size())
+        {
+            t->journal.resize(start + pos);
+        }
+    }
+
+    /* 新的桶数：至少为原来的桶数，翻倍直到负载因子不超过上限 */
+    quint64 records = minRecords;
+    if (recover)
+    {
+        records = 0;
+        for (const qsizetype pos : std::as_const(entries))
+        {
+            records += JournalEntry::JOURNAL_INSERT == static_cast<quint8>(journal.at(pos + offsetof(JournalEntry, kind))) ? 1 : 0;
+        }
+        for (quint64 i = 0; i < slotCount(old_header); ++i)
+        {
+            records += slotAt(t->map, i)->used ? 1 : 0;
+        }
+    }
+    quint64 bucket_count = old_header->bucketCount;
+    while (records > bucket_count * HASHFILE_BUCKET_SLOTS * HASHFILE_MAX_LOAD_FACTOR)
+    {
+        bucket_count *= 2;
+    }
+
+    QFile tmp(t->file.fileName() + ".tmp");
+    const qint64 file_size = HASHFILE_HEADER_SIZE + (qint64)(bucket_count * HASHFILE_BUCKET_SLOTS * slot_size);
+    uchar* map = nullptr;
+    if (!tmp.open(QIODevice::ReadWrite | QIODevice::Truncate) || !tmp.resize(file_size)
+        || nullptr == (map = tmp.map(0, file_size)))
+    {
+        s.lastLog = QString("Failed to rebuild table %1: %2").arg(t->name, tmp.errorString());
+        tmp.close();
+        tmp.remove();
+        return false;
+    }
+
+    Header* header = reinterpret_cast<Header*>(map);
+    std::memcpy(header, old_header, sizeof(Header));
+    header->bucketCount = bucket_count;
+    header->recordCount = 0;
+
+    quint64 dropped = 0;
+    for (quint64 i = 0; i < slotCount(old_header); ++i)
+    {
+        const Slot* src = slotAt(t->map, i);
+        if (!src->used)
+        {
+            continue;
+        }
+        if (recover && src->check != slotChecksum(src, digest_size))
+        {
+            ++dropped;
+            continue;
+        }
+
+        Slot* dst = nullptr;
+        if (nullptr == probe(map, reinterpret_cast<const char*>(src + 1), &dst) && nullptr != dst)
+        {
+            std::memcpy(dst, src, slot_size);
+            ++header->recordCount;
+        }
+    }
+
+    quint64 replayed = 0;
+    for (const qsizetype pos : std::as_const(entries))
+    {
+        JournalEntry e;
+        std::memcpy(&e, journal.constData() + pos, sizeof(e));
+        const char* digest = journal.constData() + pos + sizeof(e);
+
+        Slot* dst = nullptr;
+        Slot* found = probe(map, digest, &dst);
+        if (JournalEntry::JOURNAL_COUNTER == e.kind)  // 按日志的顺序，最后一次修改的值有效
+        {
+            if (nullptr != found)
+            {
+                found->counter = e.counter;
+                ++replayed;
+            }
+        }
+        else if (nullptr == found && nullptr != dst)  // 哈希表中已有的记录保留其中的重复次数（之后的修改也在日志中）
+        {
+            BlockRecord record;
+            record.info.location = e.location;
+            record.info.size     = e.size;
+            record.counter       = e.counter;
+            putSlot(dst, digest, digest_size, record, e.fileId);
+            ++header->recordCount;
+            ++replayed;
+        }
+    }
+
+    /* 新文件写入磁盘并标记为已同步之后替换原来的文件 */
+    bool is_succ = flushJournal(t) && syncFile(t->journal) && syncFile(t->files);
+    if (is_succ)
+    {
+        header->journalBytes = t->journal.size();
+        header->clean = 1;
+        is_succ = syncMap(map, file_size) && syncFile(tmp);
+    }
+    const quint64 record_count = header->recordCount;
+    tmp.unmap(map);
+    tmp.close();
+    if (!is_succ)
+    {
+        s.lastLog = QString("Failed to rebuild table %1: can not sync %2").arg(t->name, tmp.fileName());
+        tmp.remove();
+        return false;
+    }
+
+    t->file.unmap(t->map);
+    t->map = nullptr;
+    t->file.close();
+    if (0 != std::rename(QFile::encodeName(tmp.fileName()).constData(), QFile::encodeName(t->file.fileName()).constData()))
+    {
+        tmp.remove();
+        s.lastLog = QString("Failed to rebuild table %1: can not replace %2").arg(t->name, t->file.fileName());
+    }
+    else
+    {
+        s.lastLog.clear();
+    }
+    if (!t->file.open(QIODevice::ReadWrite) || nullptr == (t->map = t->file.map(0, t->file.size())))
+    {
+        s.lastLog = QString("Failed to reopen table %1: %2").arg(t->name, t->file.errorString());
+        return false;
+    }
+    if (!s.lastLog.isEmpty())
+    {
+        return false;
+    }
+
+    /* 新的哈希表已经包含日志中的所有记录：清空日志（在这之前崩溃时，打开已同步的表会清空日志） */
+    if (!resetJournal(t) || !syncMap(t->map, HASHFILE_HEADER_SIZE))
+    {
+        return false;
+    }
+
+    if (recover)
+    {
+        s.lastLog = QString("Recovered table %1: %2 records, dropped %3 damaged slots, replayed %4 journal entries").arg(
+            t->name, QString::number(record_count), QString::number(dropped), QString::number(replayed));
+        LOG_DEBUG(s.lastLog);
+    }
+    else
+    {
+        LOG_LAZY(LOG_LEVEL_DEBUG, s.lastLog, QString("Grew table %1 to %2 buckets (%3 records)").arg(
+            t->name, QString::number(bucket_count), QString::number(record_count)));
+    }
+    return true;
+}
+
+quint64 HashFileIndex::slotCount(const Header* header)
+{
+    return header->bucketCount * HASHFILE_BUCKET_SLOTS;
+}
+
+/**
+ * @brief HashFileIndex::slotAt 第 i 个槽位（第 i / HASHFILE_BUCKET_SLOTS 个桶中）
+ * @param map 映射的哈希表文件
+ * @param i 槽位下标
+ * @return
+ */
+HashFileIndex::Slot* HashFileIndex::slotAt(uchar* map, const quint64 i)
+{
+    const Header* header = reinterpret_cast<const Header*>(map);
+    return reinterpret_cast<Slot*>(map + HASHFILE_HEADER_SIZE + i * header->slotSize);
+}
+
+/**
+ * @brief HashFileIndex::probe 查找哈希值所在的槽位：从哈希值所在的桶的第一个槽位开始线性探测（依次检查桶中的槽位，
+ *  然后是下一个桶），遇到空槽位时停止。哈希值本身已经是均匀分布的，与 HashIndex 相同取前 8 个字节再做一次乘法混合
+ * @param map 映射的哈希表文件
+ * @param digest 哈希值（文件头中 digestSize 字节）
+ * @param empty [输出] 没有找到时，停止探测的空槽位（哈希表已满时为 nullptr）
+ * @return 哈希值所在的槽位；没有找到返回 nullptr
+ */
+HashFileIndex::Slot* HashFileIndex::probe(uchar* map, const char* digest, Slot** empty)
+{
+    const Header* header = reinterpret_cast<const Header*>(map);
+    const quint64 mask = slotCount(header) - 1;
+
+    quint64 h = 0;
+    std::memcpy(&h, digest, header->digestSize < sizeof(h) ? header->digestSize : sizeof(h));
+    h *= 0x9E3779B97F4A7C15ULL;
+    quint64 i = (((h >> 32) ^ h) & (header->bucketCount - 1)) * HASHFILE_BUCKET_SLOTS;
+
+    for (quint64 n = 0; n <= mask; ++n)
+    {
+        Slot* slot = slotAt(map, i);
+        if (!slot->used)
+        {
+            if (empty) *empty = slot;
+            return nullptr;
+        }
+        if (0 == std::memcmp(slot + 1, digest, header->digestSize))
+        {
+            return slot;
+        }
+        i = (i + 1) & mask;
+    }
+
+    if (empty) *empty = nullptr;
+    return nullptr;
+}
+
+/**
+ * @brief HashFileIndex::slotChecksum 槽位的校验和（不包括原地更新的 counter）
+ * @param slot 槽位
+ * @param digestSize 哈希值长度
+ * @return
+ */
+quint16 HashFileIndex::slotChecksum(const Slot* slot, const quint32 digestSize)
+{
+    char buf[sizeof(quint64) + 2 * sizeof(quint32) + HASH_MAX_SIZE];
+    std::memcpy(buf, &slot->location, sizeof(quint64));
+    std::memcpy(buf + sizeof(quint64), &slot->size, sizeof(quint32));
+    std::memcpy(buf + sizeof(quint64) + sizeof(quint32), &slot->fileId, sizeof(quint32));
+    std::memcpy(buf + sizeof(quint64) + 2 * sizeof(quint32), slot + 1, digestSize);
+    return qChecksum(QByteArrayView(buf, sizeof(quint64) + 2 * sizeof(quint32) + digestSize));
+}
+
+/**
+ * @brief HashFileIndex::putSlot 把记录写入空槽位（used 最后写入）
+ * @param slot 空槽位
+ * @param digest 哈希值
+ * @param digestSize 哈希值长度
+ * @param record 记录（忽略其中的哈希值和源文件路径）
+ * @param fileId 源文件编号
+ */
+void HashFileIndex::putSlot(Slot* slot, const char* digest, const quint32 digestSize, const BlockRecord& record, const quint32 fileId)
+{
+    slot->location = record.info.location;
+    slot->size     = (quint32)record.info.size;
+    slot->counter  = (quint32)record.counter;
+    slot->fileId   = fileId;
+    std::memcpy(slot + 1, digest, digestSize);
+    slot->check    = slotChecksum(slot, digestSize);
+    slot->used     = 1;
+}
+
+/**
+ * @brief HashFileIndex::keyOf 表中使用的定长键：长度与表的哈希值长度相同时直接使用（不复制），较短时在后面补 0
+ * @param t 表
+ * @param hash 哈希值
+ * @param key [输出] 键
+ * @return 哈希值比表的哈希值长时返回 false
+ */
+bool HashFileIndex::keyOf(const Table* t, const QByteArray& hash, QByteArray& key)
+{
+    const qsizetype digest_size = t->header()->digestSize;
+    if (hash.size() > digest_size)
+    {
+        return false;
+    }
+
+    key = hash;
+    if (hash.size() < digest_size)
+    {
+        key.append(QByteArray(digest_size - hash.size(), '\0'));
+    }
+    return true;
+}
+
+/**
+ * @brief HashFileIndex::appendJournal 把新记录加入待写入的日志（flushJournal 时写入文件）
+ * @param t 表
+ * @param digest 哈希值
+ * @param record 记录
+ * @param fileId 源文件编号
+ * @param kind 日志记录的类型（JournalEntry::Kind）
+ */
+void HashFileIndex::appendJournal(Table* t, const char* digest, const BlockRecord& record, const quint32 fileId, const quint8 kind)
+{
+    const quint32 digest_size = t->header()->digestSize;
+
+    JournalEntry e;
+    e.location   = record.info.location;
+    e.size       = (quint32)record.info.size;
+    e.counter    = (quint32)record.counter;
+    e.fileId     = fileId;
+    e.digestSize = (quint8)digest_size;
+    e.kind       = kind;
+    e.check      = 0;
+
+    const qsizetype pos = t->pending.size();
+    t->pending.append(reinterpret_cast<const char*>(&e), sizeof(e));
+    t->pending.append(digest, digest_size);
+    e.check = qChecksum(QByteArrayView(t->pending.constData() + pos, sizeof(e) + digest_size));
+    std::memcpy(t->pending.data() + pos + offsetof(JournalEntry, check), &e.check, sizeof(e.check));
+}
+
+/**
+ * @brief HashFileIndex::appendCounterJournal 把槽位修改后的重复次数加入待写入的日志（恢复时按顺序重放，最后的值有效）
+ * @param t 表
+ * @param slot 修改过 counter 的槽位
+ */
+void HashFileIndex::appendCounterJournal(Table* t, const Slot* slot)
+{
+    BlockRecord record;
+    record.counter = (int)slot->counter;
+    appendJournal(t, reinterpret_cast<const char*>(slot + 1), record, 0, JournalEntry::JOURNAL_COUNTER);
+}
+
+/**
+ * @brief HashFileIndex::flushJournal 把待写入的日志追加到日志文件（进程崩溃不会丢失，checkpoint 时才写入磁盘）
+ * @param t 表
+ * @return 是否成功
+ */
+bool HashFileIndex::flushJournal(Table* t)
+{
+    if (t->pending.isEmpty())
+    {
+        return true;
+    }
+
+    const bool is_succ = t->journal.write(t->pending) == t->pending.size() && t->journal.flush();
+    t->pending.clear();
+    if (!is_succ)
+    {
+        state().lastLog = QString("Failed to append journal of table %1: %2").arg(t->name, t->journal.errorString());
+    }
+    return is_succ;
+}
+
+/**
+ * @brief HashFileIndex::getFileId 源文件在表的字典中的编号（没有时追加到字典文件，在使用这个编号的记录之前写入）。调用者持有表的写锁
+ * @param t 表
+ * @param sourceFilePath 源文件路径
+ * @return 编号，-1 表示失败
+ */
+qint64 HashFileIndex::getFileId(Table* t, const QString& sourceFilePath)
+{
+    const auto it = t->fileIds.constFind(sourceFilePath);
+    if (it != t->fileIds.constEnd())
+    {
+        return it.value();
+    }
+
+    const QByteArray line = sourceFilePath.toUtf8() + '\n';
+    if (t->files.write(line) != line.size() || !t->files.flush())
+    {
+        state().lastLog = QString("Failed to get id of source file %1: %2").arg(sourceFilePath, t->files.errorString());
+        return -1;
+    }
+
+    const quint32 file_id = t->filePaths.size();
+    t->filePaths.append(sourceFilePath);
+    t->fileIds.insert(sourceFilePath, file_id);
+    return file_id;
+}
+
+/**
+ * @brief HashFileIndex::syncFile 把文件写入磁盘
+ * @param file 文件
+ * @return 是否成功
+ */
+bool HashFileIndex::syncFile(QFile& file)
+{
+    if (!file.flush())
+    {
+        return false;
+    }
+#if defined(Q_OS_UNIX)
+    return 0 == ::fsync(file.handle());
+#elif defined(Q_OS_WIN)
+    return FALSE != ::FlushFileBuffers(reinterpret_cast<HANDLE>(::_get_osfhandle(file.handle())));
+#else
+    return true;
+#endif
+}
+
+/**
+ * @brief HashFileIndex::syncMap 把映射区域中修改过的页写入磁盘
+ * @param map 映射区域（页对齐）
+ * @param size 大小
+ * @return 是否成功
+ */
+bool HashFileIndex::syncMap(uchar* map, const qint64 size)
+{
+#if defined(Q_OS_UNIX)
+    return 0 == ::msync(map, size, MS_SYNC);
+#elif defined(Q_OS_WIN)
+    return FALSE != ::FlushViewOfFile(map, size);
+#else
+    Q_UNUSED(map)
+    Q_UNUSED(size)
+    return true;
+#endif
+}
+
+/**
+ * @brief HashFileIndex::createBlockInfoTable 在索引目录中创建空的哈希表文件、日志和源文件字典
+ * @param tbName 要创建的表名
+ * @param hashSize 哈希值的长度（Byte），0 表示使用最长的哈希值长度（较短的哈希值在后面补 0）
+ * @return 是否成功创建
+ */
+bool HashFileIndex::createBlockInfoTable(const QString& tbName, const size_t hashSize)
+{
+    ThreadState& s = state();
+    if (!isOpen())
+    {
+        return false;
+    }
+
+    const quint32 digest_size = hashSize > 0 ? (quint32)hashSize : HASH_MAX_SIZE;
+    if (digest_size > HASH_MAX_SIZE)
+    {
+        s.lastLog = QString("Failed to create table `%1`: hash size %2 is too large").arg(tbName, QString::number(hashSize));
+        return false;
+    }
+
+    QMutexLocker locker(&_tables_mutex);
+    const QString path = filePathOf(tbName, HASHFILE_TABLE_SUFFIX);
+    if (_tables.contains(tbName) || QFile::exists(path))
+    {
+        s.lastLog = QString("Failed to create table `%1`: table already exists").arg(tbName);
+        return false;
+    }
+
+    Header header;
+    std::memset(&header, 0, sizeof(header));
+    std::memcpy(header.magic, HASHFILE_MAGIC, sizeof(header.magic));
+    header.version      = HASHFILE_VERSION;
+    header.digestSize   = digest_size;
+    header.slotSize     = sizeof(Slot) + ((digest_size + 7) & ~7U);
+    header.bucketSlots  = HASHFILE_BUCKET_SLOTS;
+    header.bucketCount  = HASHFILE_INITIAL_BUCKETS;
+    header.clean        = 1;
+    s.lastOp = QString("CREATE %1 (digest %2 B, slot %3 B, %4 buckets x %5 slots)").arg(
+        path, QString::number(digest_size), QString::number(header.slotSize),
+        QString::number(header.bucketCount), QString::number(HASHFILE_BUCKET_SLOTS));
+    LOG_DEBUG(QString("Create table `%1`").arg(tbName));
+    LOG_DEBUG(QString("↳ %1").arg(s.lastOp));
+
+    /* 空槽位全为 0（新文件扩展的部分读出来是 0，不占用磁盘空间） */
+    QFile file(path);
+    QFile journal(filePathOf(tbName, HASHFILE_JOURNAL_SUFFIX));
+    QFile files(filePathOf(tbName, HASHFILE_FILES_SUFFIX));
+    QByteArray head(HASHFILE_HEADER_SIZE, '\0');
+    std::memcpy(head.data(), &header, sizeof(header));
+    QString error;
+    if (!file.open(QIODevice::ReadWrite | QIODevice::NewOnly)
+        || !file.resize(HASHFILE_HEADER_SIZE + (qint64)(slotCount(&header) * header.slotSize))
+        || file.write(head) != head.size() || !syncFile(file))
+    {
+        error = file.errorString();
+    }
+    else if (!journal.open(QIODevice::WriteOnly | QIODevice::Truncate))
+    {
+        error = journal.errorString();
+    }
+    else if (!files.open(QIODevice::WriteOnly | QIODevice::Truncate))
+    {
+        error = files.errorString();
+    }
+    file.close();
+    journal.close();
+    files.close();
+    if (!error.isEmpty())
+    {
+        s.lastLog = QString("Failed to create table `%1`: %2").arg(tbName, error);
+        QFile::remove(path);
+        return false;
+    }
+
+    const TablePtr t = loadTable(tbName);
+    if (nullptr == t)
+    {
+        return false;
+    }
+    _tables.insert(tbName, t);
+    s.lastLog = QString("Successed create table `%1` (hash file, %2 buckets x %3 slots)").arg(
+        tbName, QString::number(HASHFILE_INITIAL_BUCKETS), QString::number(HASHFILE_BUCKET_SLOTS));
+    return true;
+}
+
+/**
+ * @brief HashFileIndex::migrateBlockInfoTableToV2 两种表结构的记录格式相同，同步 v1 表之后复制它的文件作为 v2 表，原表保持不变
+ * @param v1TbName v1 表名
+ * @param v2TbName 新建的 v2 表名（不能已经存在）
+ * @param hashSize 忽略（哈希值长度与 v1 表相同）
+ * @return 是否成功
+ */
+bool HashFileIndex::migrateBlockInfoTableToV2(const QString& v1TbName, const QString& v2TbName, const size_t hashSize)
+{
+    Q_UNUSED(hashSize)
+    ThreadState& s = state();
+    const TablePtr table = getTable(v1TbName);
+    Table* t = table.data();
+    if (nullptr == t)
+    {
+        s.lastLog = QString("Failed to migrate table %1: %2").arg(v1TbName, s.lastLog);
+        return false;
+    }
+    if (isTableExists(v2TbName))
+    {
+        s.lastLog = QString("Failed to migrate table %1 to %2: table already exists").arg(v1TbName, v2TbName);
+        return false;
+    }
+
+    QWriteLocker locker(&t->lock);
+    if (!isLoaded(t) || !checkpoint(t))
+    {
+        return false;
+    }
+
+    const QList<const char*> suffixes = {HASHFILE_JOURNAL_SUFFIX, HASHFILE_FILES_SUFFIX, HASHFILE_TABLE_SUFFIX};  // 哈希表文件最后复制，出现时表才存在
+    for (const char* suffix : suffixes)
+    {
+        if (!QFile::copy(filePathOf(v1TbName, suffix), filePathOf(v2TbName, suffix)))
+        {
+            for (const char* created : suffixes)
+            {
+                QFile::remove(filePathOf(v2TbName, created));
+            }
+            s.lastLog = QString("Failed to migrate table %1 to %2: can not copy %3").arg(v1TbName, v2TbName, filePathOf(v1TbName, suffix));
+            return false;
+        }
+    }
+
+    s.lastLog = QString("Successed migrate %1 rows from table %2 to %3 (hash file, same record layout)").arg(
+        QString::number(t->header()->recordCount), v1TbName, v2TbName);
+    return true;
+}
+
+/**
+ * @brief HashFileIndex::getTableSize 表的文件大小：哈希表文件计为表，日志和源文件字典计为索引
+ * @param tbName 表名
+ * @param tableBytes [输出] 哈希表文件的大小（Byte）
+ * @param indexBytes [输出] 日志和源文件字典的大小（Byte）
+ * @return 是否成功
+ */
+bool HashFileIndex::getTableSize(const QString& tbName, qint64& tableBytes, qint64& indexBytes)
+{
+    ThreadState& s = state();
+    tableBytes = -1;
+    indexBytes = -1;
+    const TablePtr table = getTable(tbName);
+    Table* t = table.data();
+    if (nullptr == t)
+    {
+        s.lastLog = QString("Failed to get size of table %1: %2").arg(tbName, s.lastLog);
+        return false;
+    }
+
+    QReadLocker locker(&t->lock);
+    if (!isLoaded(t))
+    {
+        return false;
+    }
+    tableBytes = t->file.size();
+    indexBytes = t->journal.size() + t->pending.size() + t->files.size();
+    s.lastLog = QString("Table %1: %2 Bytes, journal and dictionary %3 Bytes").arg(tbName, QString::number(tableBytes), QString::number(indexBytes));
+    return true;
+}
+
+/**
+ * @brief HashFileIndex::deleteTable 删除指定名称的表的所有文件
+ * @param tbName 要删除的表名
+ * @return 是否成功删除
+ */
+bool HashFileIndex::deleteTable(const QString& tbName)
+{
+    ThreadState& s = state();
+    if (!isOpen())
+    {
+        return false;
+    }
+
+    QMutexLocker locker(&_tables_mutex);
+    const TablePtr t = _tables.take(tbName);
+    if (nullptr != t)
+    {
+        unloadTable(t.data(), false);
+    }
+    LOG_DEBUG(QString("Delete table `%1`").arg(tbName));
+
+    bool is_succ = true;
+    for (const char* suffix : {HASHFILE_TABLE_SUFFIX, HASHFILE_JOURNAL_SUFFIX, HASHFILE_FILES_SUFFIX})
+    {
+        const QString path = filePathOf(tbName, suffix);
+        is_succ = (!QFile::exists(path) || QFile::remove(path)) && is_succ;
+    }
+    s.lastOp = QString("DELETE %1").arg(filePathOf(tbName, HASHFILE_TABLE_SUFFIX));
+    s.lastLog = is_succ ? QString("Successfully deleted table `%1`").arg(tbName)
+                        : QString("Failed to delete table `%1`: can not remove its files").arg(tbName);
+    return is_succ;
+}
+
+/**
+ * @brief HashFileIndex::isTableExists 指定表名的表是否存在
+ * @param tbName 表名
+ * @return 如果表存在，返回 true；否则返回 false
+ */
+bool HashFileIndex::isTableExists(const QString& tbName)
+{
+    ThreadState& s = state();
+    if (!isOpen())
+    {
+        return false;
+    }
+
+    QMutexLocker locker(&_tables_mutex);
+    const bool exists = _tables.contains(tbName) || QFile::exists(filePathOf(tbName, HASHFILE_TABLE_SUFFIX));
+    s.lastLog = exists ? QString("Table %1 exists").arg(tbName)
+                       : QString("Table %1 does not exist").arg(tbName);
+    return exists;
+}
+
+/**
+ * @brief HashFileIndex::insertNewBlockInfoRow 插入新的块信息行
+ * @param tbName 表名
+ * @param blockHash 块的哈希值
+ * @param sourceFilePath 块所在文件的路径
+ * @param blockLoc 块在源文件中的位置（第几字节）
+ * @param blockSize 块的大小（Byte）
+ * @return
+ */
+bool HashFileIndex::insertNewBlockInfoRow(const QString& tbName, const QByteArray& blockHash,
+                                          const QString& sourceFilePath, const qint64 blockLoc, const int blockSize)
+{
+    return insertNewBlockInfoRows(tbName, {blockHash}, sourceFilePath, {blockLoc}, {blockSize}, {1});
+}
+
+/**
+ * @brief HashFileIndex::getHashRepeatTimes 获取该哈希值在表中的重复次数
+ * @param tbName 表名
+ * @param blockHash 哈希值
+ * @return 重复次数：-1 表示查询失败，否则为重复次数
+ */
+int HashFileIndex::getHashRepeatTimes(const QString& tbName, const QByteArray& blockHash)
+{
+    ThreadState& s = state();
+    const TablePtr table = getTable(tbName);
+    Table* t = table.data();
+    if (nullptr == t)
+    {
+        return -1;
+    }
+
+    QReadLocker locker(&t->lock);
+    if (!isLoaded(t))
+    {
+        return -1;
+    }
+    _ops.fetch_add(1, std::memory_order_relaxed);
+    QByteArray key;
+    const Slot* slot = keyOf(t, blockHash, key) ? probe(t->map, key.constData()) : nullptr;
+    if (nullptr != slot)
+    {
+        LOG_LAZY(LOG_LEVEL_DEBUG, s.lastLog, QString("Find the same hash, repeat times: %1").arg(slot->counter));
+        return slot->counter;
+    }
+    LOG_LAZY(LOG_LEVEL_DEBUG, s.lastLog, QStringLiteral("Do not have same hash"));
+    return 0;
+}
+
+/**
+ * @brief HashFileIndex::updateCounter 更新哈希值的重复次数（原地修改映射的槽位，新的值追加到日志）
+ * @param tbName 表名
+ * @param blockHash 块的哈希值
+ * @param count 新的重复次数
+ * @return 是否更新成功
+ */
+bool HashFileIndex::updateCounter(const QString& tbName, const QByteArray& blockHash, int count)
+{
+    ThreadState& s = state();
+    const TablePtr table = getTable(tbName);
+    Table* t = table.data();
+    if (nullptr == t)
+    {
+        return false;
+    }
+
+    QWriteLocker locker(&t->lock);
+    if (!isLoaded(t))
+    {
+        return false;
+    }
+    _ops.fetch_add(1, std::memory_order_relaxed);
+    QByteArray key;
+    Slot* slot = keyOf(t, blockHash, key) ? probe(t->map, key.constData()) : nullptr;
+    if (nullptr == slot)
+    {
+        s.lastLog = "No matching hash found, Counter update failed";
+        return false;
+    }
+    if (!markDirty(t))
+    {
+        return false;
+    }
+
+    slot->counter = (quint32)count;
+    appendCounterJournal(t, slot);
+    if (!flushJournal(t))
+    {
+        return false;
+    }
+    LOG_LAZY(LOG_LEVEL_DEBUG, s.lastLog, QStringLiteral("Update Counter successful! Number of rows affected: 1"));
+    return true;
+}
+
+/**
+ * @brief HashFileIndex::getTableRowCount 获取表有多少条记录（文件头中的记录数）
+ * @param tbName 表名
+ * @return 行数（负数代表异常）
+ */
+int HashFileIndex::getTableRowCount(const QString& tbName)
+{
+    ThreadState& s = state();
+    const TablePtr table = getTable(tbName);
+    Table* t = table.data();
+    if (nullptr == t)
+    {
+        return -1;
+    }
+
+    QReadLocker locker(&t->lock);
+    if (!isLoaded(t))
+    {
+        return -1;
+    }
+    const int row_count = (int)t->header()->recordCount;
+    s.lastLog = QString("Successed get row count of table `%1`, COUNT = %2").arg(tbName, QString::number(row_count));
+    return row_count;
+}
+
+/**
+ * @brief HashFileIndex::getBlockInfo 根据块的哈希值获得块的信息（包含的信息可用于恢复源数据）
+ * @param tbName 表名
+ * @param blockHash 块的哈希值
+ * @return 查询失败或没有找到时为空的 BlockInfo（size 为 0）
+ */
+BlockInfo HashFileIndex::getBlockInfo(const QString& tbName, const QByteArray& blockHash)
+{
+    QList<BlockInfo> infos;
+    if (!getBlockInfos(tbName, {blockHash}, infos))
+    {
+        return BlockInfo();
+    }
+    return infos.first();
+}
+
+/**
+ * @brief HashFileIndex::getBlockInfos 获取一批哈希值对应的块信息
+ * @param tbName 表名
+ * @param blockHashes 哈希值列表（可以包含重复的哈希）
+ * @param infos [输出] 与 blockHashes 一一对应的块信息；表中没有记录的哈希对应空的 BlockInfo（size 为 0）
+ * @return 是否查询成功
+ */
+bool HashFileIndex::getBlockInfos(const QString& tbName, const QList<QByteArray>& blockHashes, QList<BlockInfo>& infos)
+{
+    ThreadState& s = state();
+    infos.clear();
+    infos.resize(blockHashes.size());
+
+    const TablePtr table = getTable(tbName);
+    Table* t = table.data();
+    if (nullptr == t)
+    {
+        s.lastLog = QString("Failed to retrieve block infos of batch from table %1: %2").arg(tbName, s.lastLog);
+        return false;
+    }
+
+    QReadLocker locker(&t->lock);
+    if (!isLoaded(t))
+    {
+        return false;
+    }
+    _ops.fetch_add(blockHashes.size(), std::memory_order_relaxed);
+    size_t num_found = 0;
+    QByteArray key;
+    for (qsizetype i = 0; i < blockHashes.size(); ++i)
+    {
+        const Slot* slot = keyOf(t, blockHashes.at(i), key) ? probe(t->map, key.constData()) : nullptr;
+        if (nullptr != slot)
+        {
+            BlockInfo& info = infos[i];
+            info.filePath = t->filePaths.value(slot->fileId);
+            info.location = (qint64)slot->location;
+            info.size     = slot->size;
+            ++num_found;
+        }
+    }
+
+    LOG_LAZY(LOG_LEVEL_DEBUG, s.lastLog, QString("Retrieved block info of %1 of %2 hashes from table %3").arg(
+        QString::number(num_found), QString::number(blockHashes.size()), tbName));
+    return true;
+}
+
+/**
+ * @brief HashFileIndex::getHashRepeatTimesBatch 获取一批哈希值在表中的重复次数
+ * @param tbName 表名
+ * @param blockHashes 哈希值列表（可以包含重复的哈希）
+ * @param repeatTimes [输出] 表中已存在的哈希 -> 重复次数；不在表中的哈希不会出现在结果中
+ * @return 是否查询成功
+ */
+bool HashFileIndex::getHashRepeatTimesBatch(const QString& tbName, const QList<QByteArray>& blockHashes,
+                                            QHash<QByteArray, int>& repeatTimes)
+{
+    ThreadState& s = state();
+    repeatTimes.clear();
+
+    const TablePtr table = getTable(tbName);
+    Table* t = table.data();
+    if (nullptr == t)
+    {
+        s.lastLog = QString("Failed to get HashRepeatTimes of batch: %1").arg(s.lastLog);
+        return false;
+    }
+
+    QReadLocker locker(&t->lock);
+    if (!isLoaded(t))
+    {
+        return false;
+    }
+    _ops.fetch_add(blockHashes.size(), std::memory_order_relaxed);
+    QByteArray key;
+    for (const QByteArray& hash : blockHashes)
+    {
+        const Slot* slot = keyOf(t, hash, key) ? probe(t->map, key.constData()) : nullptr;
+        if (nullptr != slot)
+        {
+            repeatTimes.insert(hash, slot->counter);
+        }
+    }
+
+    LOG_LAZY(LOG_LEVEL_DEBUG, s.lastLog, QString("Find %1 of %2 hashes in table %3").arg(QString::number(repeatTimes.size()), QString::number(blockHashes.size()), tbName));
+    return true;
+}
+
+/**
+ * @brief HashFileIndex::insertNewBlockInfoRows 插入一批新的块信息行
+ * @param tbName 表名
+ * @param blockHashes 块的哈希值（不能有重复）
+ * @param sourceFilePath 块所在文件的路径（同一批的块在同一个文件中）
+ * @param blockLocs 块在文件中的位置（第几字节）
+ * @param blockSizes 块的大小（Byte）
+ * @param counters 块的重复次数
+ * @return 是否插入成功（失败时整批都不插入）
+ */
+bool HashFileIndex::insertNewBlockInfoRows(const QString& tbName, const QList<QByteArray>& blockHashes,
+                                           const QString& sourceFilePath, const QList<qint64>& blockLocs,
+                                           const QList<int>& blockSizes, const QList<int>& counters)
+{
+    QList<BlockRecord> records;
+    records.reserve(blockHashes.size());
+    if (blockHashes.size() != blockLocs.size()
+        || blockHashes.size() != blockSizes.size()
+        || blockHashes.size() != counters.size())
+    {
+        state().lastLog = QString("Failed to insert new rows to table %1: size of arguments do not match").arg(tbName);
+        return false;
+    }
+
+    for (qsizetype i = 0; i < blockHashes.size(); ++i)
+    {
+        BlockRecord record;
+        record.hash          = blockHashes.at(i);
+        record.info.filePath = sourceFilePath;
+        record.info.location = blockLocs.at(i);
+        record.info.size     = blockSizes.at(i);
+        record.counter       = counters.at(i);
+        records.append(record);
+    }
+    return copyBlockRecords(tbName, records);
+}
+
+/**
+ * @brief HashFileIndex::addCounters 为一批哈希值增加重复次数（原地修改映射的槽位，修改后的值最后一次追加到日志）
+ * @param tbName 表名
+ * @param blockHashes 块的哈希值
+ * @param increments 每个哈希值 counter 的增量
+ * @return 是否更新成功
+ */
+bool HashFileIndex::addCounters(const QString& tbName, const QList<QByteArray>& blockHashes, const QList<int>& increments)
+{
+    ThreadState& s = state();
+    if (blockHashes.size() != increments.size())
+    {
+        s.lastLog = QString("Update failure: size of arguments do not match");
+        return false;
+    }
+
+    const TablePtr table = getTable(tbName);
+    Table* t = table.data();
+    if (nullptr == t)
+    {
+        return false;
+    }
+
+    if (blockHashes.isEmpty())
+    {
+        return true;
+    }
+
+    QWriteLocker locker(&t->lock);
+    if (!isLoaded(t))
+    {
+        return false;
+    }
+    if (!markDirty(t))
+    {
+        return false;
+    }
+
+    _ops.fetch_add(blockHashes.size(), std::memory_order_relaxed);
+    QByteArray key;
+    for (qsizetype i = 0; i < blockHashes.size(); ++i)
+    {
+        Slot* slot = keyOf(t, blockHashes.at(i), key) ? probe(t->map, key.constData()) : nullptr;
+        if (nullptr != slot)
+        {
+            slot->counter += (quint32)increments.at(i);
+            appendCounterJournal(t, slot);
+        }
+    }
+    if (!flushJournal(t))
+    {
+        return false;
+    }
+
+    LOG_LAZY(LOG_LEVEL_DEBUG, s.lastLog, QString("Update Counter successful! Number of rows: %1").arg(blockHashes.size()));
+    return true;
+}
+
+/**
+ * @brief HashFileIndex::copyBlockRecords 批量写入块信息：需要时先扩容，在映射的哈希表中放置每条记录，最后把新记录一次追加到日志。
+ *  与 COPY 相同，表中已经存在的哈希值会使整批写入失败（在修改哈希表之前检查）
+ * @param tbName 表名
+ * @param records 要写入的块信息（哈希值不能重复，同一批中重复的哈希值合并重复次数）
+ * @return 是否写入成功
+ */
+bool HashFileIndex::copyBlockRecords(const QString& tbName, const QList<BlockRecord>& records)
+{
+    ThreadState& s = state();
+    const TablePtr table = getTable(tbName);
+    Table* t = table.data();
+    if (nullptr == t)
+    {
+        return false;
+    }
+
+    if (records.isEmpty())
+    {
+        return true;
+    }
+
+    QWriteLocker locker(&t->lock);
+    if (!isLoaded(t))
+    {
+        return false;
+    }
+    s.lastOp = QString("APPEND %1 records TO %2").arg(QString::number(records.size()), t->file.fileName());
+    _ops.fetch_add(records.size(), std::memory_order_relaxed);
+
+    QList<QByteArray> keys;
+    keys.reserve(records.size());
+    for (const BlockRecord& record : records)
+    {
+        QByteArray key;
+        if (!keyOf(t, record.hash, key))
+        {
+            s.lastLog = QString("Failed to insert new rows to table %1: hash size %2 is larger than %3").arg(
+                tbName, QString::number(record.hash.size()), QString::number(t->header()->digestSize));
+            return false;
+        }
+        if (nullptr != probe(t->map, key.constData()))
+        {
+            s.lastLog = QString("Failed to insert new rows to table %1: hash %2 already exists").arg(tbName, QString(record.hash.toHex()));
+            return false;
+        }
+        keys.append(key);
+    }
+
+    /* 先取得所有记录的源文件编号（失败时哈希表还没有被修改，字典中多出的路径不影响） */
+    QList<quint32> file_ids;
+    file_ids.reserve(records.size());
+    QString last_path;
+    qint64 file_id = -1;
+    for (qsizetype i = 0; i < records.size(); ++i)
+    {
+        const QString& path = records.at(i).info.filePath;
+        if (0 == i || path != last_path)
+        {
+            last_path = path;
+            file_id = getFileId(t, last_path);
+            if (file_id < 0)
+            {
+                return false;
+            }
+        }
+        file_ids.append((quint32)file_id);
+    }
+
+    if (!reserve(t, records.size()) || !markDirty(t))
+    {
+        return false;
+    }
+
+    Header* header = t->header();
+    for (qsizetype i = 0; i < records.size(); ++i)
+    {
+        const BlockRecord& record = records.at(i);
+        const char* digest = keys.at(i).constData();
+        Slot* empty = nullptr;
+        Slot* slot = probe(t->map, digest, &empty);
+        if (nullptr != slot)
+        {
+            slot->counter += (quint32)record.counter;
+            appendCounterJournal(t, slot);
+            continue;
+        }
+        putSlot(empty, digest, header->digestSize, record, file_ids.at(i));  // reserve 之后总有空槽位
+        ++header->recordCount;
+        appendJournal(t, digest, record, file_ids.at(i));
+    }
+
+    if (!flushJournal(t))
+    {
+        return false;
+    }
+
+    LOG_LAZY(LOG_LEVEL_DEBUG, s.lastLog, QString("Successed insert %1 new rows to table %2").arg(QString::number(records.size()), tbName));
+    return true;
+}
+
+/**
+ * @brief HashFileIndex::forEachHashCounter 遍历表中所有的哈希值和重复次数（用于预加载内存中的哈希索引）
+ * @param tbName 表名
+ * @param callback 每一条记录调用一次：callback(哈希值, 重复次数)
+ * @return 是否成功
+ */
+bool HashFileIndex::forEachHashCounter(const QString& tbName, const std::function<void(const QByteArray&, int)>& callback)
+{
+    ThreadState& s = state();
+    const TablePtr table = getTable(tbName);
+    Table* t = table.data();
+    if (nullptr == t)
+    {
+        s.lastLog = QString("Failed to load hashes from table %1: %2").arg(tbName, s.lastLog);
+        return false;
+    }
+
+    QReadLocker locker(&t->lock);
+    if (!isLoaded(t))
+    {
+        return false;
+    }
+    const Header* header = t->header();
+    size_t rows = 0;
+    for (quint64 i = 0; i < slotCount(header); ++i)
+    {
+        const Slot* slot = slotAt(t->map, i);
+        if (slot->used)
+        {
+            callback(QByteArray(reinterpret_cast<const char*>(slot + 1), header->digestSize), slot->counter);
+            ++rows;
+        }
+    }
+
+    s.lastLog = QString("Successed load %1 hashes from table %2").arg(QString::number(rows), tbName);
+    return true;
+}
+
+QString HashFileIndex::lastSQL()
+{
+    return state().lastOp;
+}
+
+QString HashFileIndex::lastLog()
+{
+    return state().lastLog;
+}
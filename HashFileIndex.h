@@ -0,0 +1,208 @@
+#ifndef HASHFILEINDEX_H
+#define HASHFILEINDEX_H
+
+#include "DedupIndex.h"
+
+#include <QFile>
+#include <QMutex>
+#include <QReadWriteLock>
+#include <QSharedPointer>
+#include <QStringList>
+#include <QThreadStorage>
+
+#include <atomic>
+
+#define HASHFILE_INDEX_DIR_NAME     "block_index_hash"  // 没有指定目录时，在 .bkh 所在的目录中使用这个目录
+#define HASHFILE_TABLE_SUFFIX       ".bhx"              // 哈希表文件（内存映射）
+#define HASHFILE_JOURNAL_SUFFIX     ".bhj"              // 新记录的追加日志（崩溃后据此恢复哈希表）
+#define HASHFILE_FILES_SUFFIX       ".bhf"              // 源文件字典（每行一个路径，行号即编号）
+#define HASHFILE_MAGIC              "BSTHIDX1"          // 哈希表文件头的标识（8 Byte）
+#define HASHFILE_VERSION            1
+#define HASHFILE_HEADER_SIZE        4096                // 文件头占用的大小（一个页，槽位从这里开始）
+#define HASHFILE_BUCKET_SLOTS       8                   // 每个桶的槽位数
+#define HASHFILE_INITIAL_BUCKETS    1024                // 新建哈希表的桶数（2 的幂）
+#define HASHFILE_MAX_LOAD_FACTOR    0.75                // 最大负载因子（超过后桶数翻倍并重新放置所有记录）
+
+/**
+ * @brief 去重索引的原生文件实现（不经过 SQL）：每个块信息表是一个内存映射的开放寻址哈希表文件，
+ *  槽位为定长记录（哈希、块在 .ubk 中的位置、大小、重复次数、源文件编号），按桶存放，从哈希所在的桶开始线性探测，
+ *  负载因子超过 HASHFILE_MAX_LOAD_FACTOR 时把桶数翻倍、重新放置到新文件中再原子替换。
+ *  新记录和重复次数的修改（修改后的值）同时追加到带校验和的日志中：哈希表在 checkpoint（扩容、关闭）之后第一次修改前标记为未同步，
+ *  打开未同步的哈希表时丢弃校验失败的槽位并按顺序重放 checkpoint 之后的日志，重建哈希表。
+ *  两种表结构的记录格式相同（定长哈希、64 位位置、源文件字典），不支持分区。
+ *  查询可以在多个线程中同时进行（每个表一个读写锁），写入互斥
+ */
+class HashFileIndex : public DedupIndex
+{
+public:
+    HashFileIndex();
+    ~HashFileIndex();
+
+    /* 索引目录（应该在没有其他线程使用索引时调用） */
+    bool open(const QString& path);
+    void close();
+    bool removeIndexFiles();
+    QString dirPath();
+
+    IndexBackend backend() const override;
+    bool isOpen() override;
+
+    /* 连接（没有连接） */
+    void setPoolSize(const int size) override;
+    QList<DbConnectionStats> connectionStats() override;
+    void resetConnectionStats() override;
+
+    /* 表结构 */
+    void setSchemaVersion(const SchemaVersion version) override;
+    SchemaVersion schemaVersion() const override;
+    void setPartitionCount(const int partitions) override;
+    int partitionCount() const override;
+
+    /* 表相关操作 */
+    bool createBlockInfoTable(const QString& tbName, const size_t hashSize = 0) override;
+    bool migrateBlockInfoTableToV2(const QString& v1TbName, const QString& v2TbName, const size_t hashSize = 0) override;
+    bool getTableSize(const QString& tbName, qint64& tableBytes, qint64& indexBytes) override;
+    bool deleteTable(const QString& tbName) override;
+    bool isTableExists(const QString& tbName) override;
+    bool insertNewBlockInfoRow(const QString& tbName, const QByteArray& blockHash,
+                               const QString& sourceFilePath, const qint64 blockLoc, const int blockSize) override;
+    int getHashRepeatTimes(const QString& tbName, const QByteArray& blockHash) override;
+    bool updateCounter(const QString& tbName, const QByteArray& blockHash, int count) override;
+    int getTableRowCount(const QString& tbName) override;
+    BlockInfo getBlockInfo(const QString& tbName, const QByteArray& blockHash) override;
+
+    /* 批量操作（在映射的文件中直接查找和修改，写入只在最后追加一次日志） */
+    bool getBlockInfos(const QString& tbName, const QList<QByteArray>& blockHashes, QList<BlockInfo>& infos) override;
+    bool getHashRepeatTimesBatch(const QString& tbName, const QList<QByteArray>& blockHashes,
+                                 QHash<QByteArray, int>& repeatTimes) override;
+    bool insertNewBlockInfoRows(const QString& tbName, const QList<QByteArray>& blockHashes,
+                                const QString& sourceFilePath, const QList<qint64>& blockLocs,
+                                const QList<int>& blockSizes, const QList<int>& counters) override;
+    bool addCounters(const QString& tbName, const QList<QByteArray>& blockHashes, const QList<int>& increments) override;
+    bool copyBlockRecords(const QString& tbName, const QList<BlockRecord>& records) override;
+    bool forEachHashCounter(const QString& tbName, const std::function<void(const QByteArray&, int)>& callback) override;
+
+    /* 日志相关（调用线程最后执行的操作和日志消息） */
+    QString lastSQL() override;
+    QString lastLog() override;
+
+private:
+    Q_DISABLE_COPY(HashFileIndex)
+
+    /**
+     * @brief 哈希表文件头（文件开头的 HASHFILE_HEADER_SIZE 字节）
+     */
+    struct Header
+    {
+        char    magic[8];
+        quint32 version;
+        quint32 digestSize;     // 哈希值长度（Byte）
+        quint32 slotSize;       // 每个槽位的大小（Byte，Slot + 按 8 字节对齐的哈希值）
+        quint32 bucketSlots;    // 每个桶的槽位数
+        quint64 bucketCount;    // 桶数（2 的幂）
+        quint64 recordCount;    // 记录数
+        quint64 journalBytes;   // checkpoint 时日志的长度（之前的日志记录都已经在哈希表中，checkpoint 之后日志被清空，通常为 0）
+        quint32 clean;          // 1 表示 checkpoint 之后没有修改过（0 时打开需要恢复）
+        quint32 reserved;
+    };
+
+    /**
+     * @brief 一个槽位的定长部分（哈希值紧跟在后面）。used 最后写入，check 不包括 counter（counter 原地更新）
+     */
+    struct Slot
+    {
+        quint64 location;       // 块在 .ubk 中的位置（Byte）
+        quint32 size;           // 块的大小（Byte）
+        quint32 counter;        // 重复次数
+        quint32 fileId;         // 源文件在字典中的编号
+        quint8  used;           // 0 表示空槽位
+        quint8  reserved;
+        quint16 check;          // location、size、fileId 和哈希值的校验和
+    };
+
+    /**
+     * @brief 一条日志记录的定长部分（哈希值紧跟在后面，没有对齐）
+     */
+    struct JournalEntry
+    {
+        enum Kind : quint8 {
+            JOURNAL_INSERT  = 0,    // 插入新记录
+            JOURNAL_COUNTER = 1     // 修改重复次数（只有 counter 有效）
+        };
+
+        quint64 location;
+        quint32 size;
+        quint32 counter;        // 插入时的重复次数，或者修改后的重复次数
+        quint32 fileId;
+        quint8  digestSize;
+        quint8  kind;           // Kind
+        quint16 check;          // 这一条日志（check 为 0 时）的校验和
+    };
+
+    /**
+     * @brief 一个已经打开的表
+     */
+    struct Table
+    {
+        QString         name;
+        QReadWriteLock  lock;           // 查询加读锁，写入、扩容加写锁
+        QFile           file;           // 哈希表文件
+        uchar*          map     = nullptr;
+        QFile           journal;        // 追加日志
+        QByteArray      pending;        // 还没有写入日志文件的日志记录
+        QFile           files;          // 源文件字典
+        QStringList     filePaths;      // 编号 -> 路径（只在写锁中修改）
+        QHash<QString, quint32> fileIds;
+
+        Header* header() const { return reinterpret_cast<Header*>(map); }
+    };
+    using TablePtr = QSharedPointer<Table>;
+
+    /**
+     * @brief 每个线程最后执行的操作和日志消息
+     */
+    struct ThreadState
+    {
+        QString lastOp;
+        QString lastLog;
+    };
+
+    ThreadState& state();
+    QString filePathOf(const QString& tbName, const char* suffix) const;
+
+    TablePtr getTable(const QString& tbName);
+    TablePtr loadTable(const QString& tbName);
+    bool isLoaded(const Table* t);
+    void unloadTable(Table* t, const bool sync);
+    bool checkpoint(Table* t);
+    bool resetJournal(Table* t);
+    bool markDirty(Table* t);
+    bool reserve(Table* t, const quint64 newRecords);
+    bool rebuild(Table* t, const quint64 minRecords, const bool recover);
+
+    static quint64 slotCount(const Header* header);
+    static Slot* slotAt(uchar* map, const quint64 i);
+    static Slot* probe(uchar* map, const char* digest, Slot** empty = nullptr);
+    static quint16 slotChecksum(const Slot* slot, const quint32 digestSize);
+    static void putSlot(Slot* slot, const char* digest, const quint32 digestSize, const BlockRecord& record, const quint32 fileId);
+    static bool keyOf(const Table* t, const QByteArray& hash, QByteArray& key);
+
+    void appendJournal(Table* t, const char* digest, const BlockRecord& record, const quint32 fileId,
+                       const quint8 kind = JournalEntry::JOURNAL_INSERT);
+    void appendCounterJournal(Table* t, const Slot* slot);
+    bool flushJournal(Table* t);
+    qint64 getFileId(Table* t, const QString& sourceFilePath);
+    static bool syncFile(QFile& file);
+    static bool syncMap(uchar* map, const qint64 size);
+
+private:
+    SchemaVersion _schema = SchemaVersion::SCHEMA_V1;
+
+    QMutex                  _tables_mutex;  // 保护 _dir 和 _tables
+    QString                 _dir;           // 索引目录（空表示没有打开）
+    QHash<QString, TablePtr> _tables;       // 已经打开的表（表名 -> 表）
+    std::atomic<qint64>     _ops {0};       // 查询和写入的哈希个数（用于统计）
+    QThreadStorage<ThreadState*> _thread_state;
+};
+
+#endif // HASHFILEINDEX_H
@@ -0,0 +1,278 @@
+#include "HashIndex.h"
+
+#include <algorithm>
+#include <cstring>
+
+#define HASH_INDEX_MIN_CAPACITY     1024    // 最少的槽位数
+#define HASH_INDEX_MAX_LOAD_FACTOR  0.5     // 最大负载因子（超过后槽位数翻倍）
+
+HashIndex::HashIndex(const size_t digest_size, const size_t expected_entries)
+    : _digest_size(digest_size)
+{
+    rehash(HASH_INDEX_MIN_CAPACITY);
+    reserve(expected_entries);
+}
+
+/**
+ * @brief HashIndex::find 查找哈希值对应的记录
+ * @param digest 哈希值（长度必须为 digestSize()）
+ * @return 记录的指针；没有找到返回 nullptr（指针在下一次 insert 之前有效）
+ */
+HashIndex::Entry* HashIndex::find(const QByteArray& digest)
+{
+    ++_lookups;
+    const qint64 i = findIndex(digest.constData());
+    if (i < 0)
+    {
+        return nullptr;
+    }
+
+    ++_hits;
+    return &_entries[i];
+}
+
+/**
+ * @brief HashIndex::contains 哈希值是否在索引中（不计入查询统计）
+ * @param digest 哈希值（长度必须为 digestSize()）
+ * @return
+ */
+bool HashIndex::contains(const QByteArray& digest) const
+{
+    return findIndex(digest.constData()) >= 0;
+}
+
+/**
+ * @brief HashIndex::insert 查找哈希值对应的记录，不存在则插入一条新的空记录
+ * @param digest 哈希值（长度必须为 digestSize()）
+ * @param inserted [输出] 是否插入了新记录
+ * @return 记录的指针（在下一次 insert 之前有效）
+ */
+HashIndex::Entry* HashIndex::insert(const QByteArray& digest, bool* inserted)
+{
+    ++_lookups;
+    bool is_new = false;
+    Entry* entry = emplace(digest.constData(), &is_new);
+    if (!is_new)
+    {
+        ++_hits;
+    }
+    if (inserted) *inserted = is_new;
+    return entry;
+}
+
+/**
+ * @brief HashIndex::insertMissed find() 没有找到之后插入哈希值的记录（这次查询已经由 find() 计入统计，这里不再计入）
+ * @param digest 哈希值（长度必须为 digestSize()）
+ * @return 记录的指针（在下一次 insert 之前有效）
+ */
+HashIndex::Entry* HashIndex::insertMissed(const QByteArray& digest)
+{
+    return emplace(digest.constData(), nullptr);
+}
+
+/**
+ * @brief HashIndex::emplace 查找哈希值对应的记录，不存在则插入一条新的空记录（不计入查询统计）
+ * @param key 哈希值（digestSize() 字节）
+ * @param inserted [输出] 是否插入了新记录
+ * @return 记录的指针
+ */
+HashIndex::Entry* HashIndex::emplace(const char* key, bool* inserted)
+{
+    /* 负载因子过高时扩容 */
+    if ((_entries.size() + 1) > (_mask + 1) * HASH_INDEX_MAX_LOAD_FACTOR)
+    {
+        rehash((_mask + 1) * 2);
+    }
+
+    size_t slot = slotOf(key);
+    while (0 != _slots[slot])
+    {
+        const size_t i = _slots[slot] - 1;
+        if (0 == std::memcmp(&_keys[i * _digest_size], key, _digest_size))
+        {
+            if (inserted) *inserted = false;
+            return &_entries[i];
+        }
+        slot = (slot + 1) & _mask;  // 线性探测
+    }
+
+    _slots[slot] = _entries.size() + 1;
+    _keys.insert(_keys.end(), key, key + _digest_size);
+    _entries.emplace_back();
+
+    if (inserted) *inserted = true;
+    return &_entries.back();
+}
+
+/**
+ * @brief HashIndex::reserve 预先分配能容纳指定条数记录的空间，避免运行过程中反复扩容
+ * @param expected_entries 预计的记录条数
+ */
+void HashIndex::reserve(const size_t expected_entries)
+{
+    size_t capacity = _mask + 1;
+    while (expected_entries > capacity * HASH_INDEX_MAX_LOAD_FACTOR)
+    {
+        capacity *= 2;
+    }
+    if (capacity != _mask + 1)
+    {
+        rehash(capacity);
+    }
+    _keys.reserve(expected_entries * _digest_size);
+    _entries.reserve(expected_entries);
+}
+
+/**
+ * @brief HashIndex::clear 清空所有记录（保留已经分配的空间），同时清空统计信息
+ */
+void HashIndex::clear()
+{
+    std::fill(_slots.begin(), _slots.end(), 0);
+    _keys.clear();
+    _entries.clear();
+    _lookups = 0;
+    _hits    = 0;
+}
+
+size_t HashIndex::size() const
+{
+    return _entries.size();
+}
+
+size_t HashIndex::digestSize() const
+{
+    return _digest_size;
+}
+
+/**
+ * @brief HashIndex::indexOf 记录的下标（即插入顺序）
+ * @param entry find/insert 返回的记录指针
+ * @return 下标
+ */
+size_t HashIndex::indexOf(const Entry* entry) const
+{
+    return entry - _entries.data();
+}
+
+/**
+ * @brief HashIndex::digestAt 按插入顺序获取第 i 条记录的哈希值
+ * @param i 下标
+ * @return 哈希值
+ */
+QByteArray HashIndex::digestAt(const size_t i) const
+{
+    return QByteArray(&_keys[i * _digest_size], _digest_size);
+}
+
+/**
+ * @brief HashIndex::entryAt 按插入顺序获取第 i 条记录
+ * @param i 下标
+ * @return 记录
+ */
+HashIndex::Entry& HashIndex::entryAt(const size_t i)
+{
+    return _entries[i];
+}
+
+/**
+ * @brief HashIndex::memoryUsage 索引占用的内存（Byte，包含槽位、哈希值和记录）
+ * @return
+ */
+size_t HashIndex::memoryUsage() const
+{
+    return _slots.capacity() * sizeof(quint32)
+           + _keys.capacity()
+           + _entries.capacity() * sizeof(Entry);
+}
+
+/**
+ * @brief HashIndex::bytesPerEntry 平均每条记录占用的内存（Byte）
+ * @return
+ */
+double HashIndex::bytesPerEntry() const
+{
+    return _entries.empty() ? 0.0 : (double)memoryUsage() / _entries.size();
+}
+
+size_t HashIndex::lookups() const
+{
+    return _lookups;
+}
+
+size_t HashIndex::hits() const
+{
+    return _hits;
+}
+
+/**
+ * @brief HashIndex::hitRate 命中率（%）
+ * @return
+ */
+double HashIndex::hitRate() const
+{
+    return 0 == _lookups ? 0.0 : (double)_hits / _lookups * 100;
+}
+
+/**
+ * @brief HashIndex::resetStats 清空查询统计（例如在预加载之后）
+ */
+void HashIndex::resetStats()
+{
+    _lookups = 0;
+    _hits    = 0;
+}
+
+/**
+ * @brief HashIndex::slotOf 计算哈希值的初始槽位。哈希值本身已经是均匀分布的，
+ *  这里取前 8 个字节再做一次乘法混合，避免非加密哈希在低位上分布不均
+ * @param digest 哈希值
+ * @return 槽位
+ */
+size_t HashIndex::slotOf(const char* digest) const
+{
+    quint64 h = 0;
+    std::memcpy(&h, digest, _digest_size < sizeof(h) ? _digest_size : sizeof(h));
+    h *= 0x9E3779B97F4A7C15ULL;
+    return ((h >> 32) ^ h) & _mask;
+}
+
+/**
+ * @brief HashIndex::findIndex 查找哈希值对应记录的下标
+ * @param digest 哈希值
+ * @return 下标；没有找到返回 -1
+ */
+qint64 HashIndex::findIndex(const char* digest) const
+{
+    size_t slot = slotOf(digest);
+    while (0 != _slots[slot])
+    {
+        const size_t i = _slots[slot] - 1;
+        if (0 == std::memcmp(&_keys[i * _digest_size], digest, _digest_size))
+        {
+            return i;
+        }
+        slot = (slot + 1) & _mask;
+    }
+    return -1;
+}
+
+/**
+ * @brief HashIndex::rehash 将槽位数调整为 capacity 并重新放置所有记录
+ * @param capacity 新的槽位数（2 的幂）
+ */
+void HashIndex::rehash(const size_t capacity)
+{
+    _mask = capacity - 1;
+    _slots.assign(capacity, 0);
+
+    for (size_t i = 0; i < _entries.size(); ++i)
+    {
+        size_t slot = slotOf(&_keys[i * _digest_size]);
+        while (0 != _slots[slot])
+        {
+            slot = (slot + 1) & _mask;
+        }
+        _slots[slot] = i + 1;
+    }
+}
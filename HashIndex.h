@@ -0,0 +1,67 @@
+#ifndef HASHINDEX_H
+#define HASHINDEX_H
+
+#include <QByteArray>
+
+#include <vector>
+
+/**
+ * @brief 进程内的哈希索引：以原始哈希值（digest）为键的开放寻址（线性探测）哈希表，
+ *  用于在分块时不经过数据库就能判断一个块是否出现过，并在内存中累计计数器的增量。
+ *  键和值按插入顺序紧凑地存放，槽位数组只存放下标（4 字节），因此可以按插入顺序遍历所有记录
+ */
+class HashIndex
+{
+public:
+    /**
+     * @brief 索引中每个哈希对应的记录
+     */
+    struct Entry
+    {
+        qint64  location    = 0;    // 块在 Unique-Block file 中的位置（Byte）
+        quint32 size        = 0;    // 块的大小（Byte）
+        quint32 counter     = 0;    // 数据库中已经记录的重复次数
+        quint32 pending     = 0;    // 还没有写入数据库的计数器增量
+    };
+
+    explicit HashIndex(const size_t digest_size, const size_t expected_entries = 0);
+
+    Entry* find(const QByteArray& digest);
+    bool contains(const QByteArray& digest) const;
+    Entry* insert(const QByteArray& digest, bool* inserted = nullptr);
+    Entry* insertMissed(const QByteArray& digest);
+    void reserve(const size_t expected_entries);
+    void clear();
+
+    size_t size() const;
+    size_t digestSize() const;
+    size_t indexOf(const Entry* entry) const;
+    QByteArray digestAt(const size_t i) const;
+    Entry& entryAt(const size_t i);
+
+    /* 统计信息 */
+    size_t memoryUsage() const;
+    double bytesPerEntry() const;
+    size_t lookups() const;
+    size_t hits() const;
+    double hitRate() const;
+    void resetStats();
+
+private:
+    size_t slotOf(const char* digest) const;
+    qint64 findIndex(const char* digest) const;
+    Entry* emplace(const char* key, bool* inserted);
+    void rehash(const size_t capacity);
+
+private:
+    size_t _digest_size;            // 哈希值长度（Byte），同一个索引中所有哈希长度相同
+    size_t _mask            = 0;    // 槽位数 - 1（槽位数总是 2 的幂）
+    std::vector<quint32> _slots;    // 槽位：0 表示空，否则为记录下标 + 1
+    std::vector<char>    _keys;     // 所有哈希值，按插入顺序紧密排列
+    std::vector<Entry>   _entries;  // 所有记录，与 _keys 一一对应
+
+    size_t _lookups         = 0;    // 查询次数
+    size_t _hits            = 0;    // 命中次数
+};
+
+#endif // HASHINDEX_H
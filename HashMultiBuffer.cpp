@@ -0,0 +1,338 @@
+#include "HashMultiBuffer.h"
+
+#include <cstring>
+
+#if (defined(__x86_64__) || defined(__i386__)) && (defined(__GNUC__) || defined(__clang__))
+#define HASH_HAS_X86_MULTI_BUFFER 1
+#endif
+
+namespace {
+
+#if HASH_HAS_X86_MULTI_BUFFER
+
+/* 每个通道一个 32 位字的向量（GCC / Clang 向量扩展），由调用处的 target 决定生成 AVX2 还是 AVX-512 指令 */
+typedef quint32 VecX8  __attribute__((vector_size(32)));
+typedef quint32 VecX16 __attribute__((vector_size(64)));
+
+#define MB_INLINE       inline __attribute__((always_inline))
+#define MB_ROTL(x, n)   (((x) << (n)) | ((x) >> (32 - (n))))
+#define MB_ROTR(x, n)   (((x) >> (n)) | ((x) << (32 - (n))))
+
+const quint32 MD5_IV[4]     = {0x67452301, 0xefcdab89, 0x98badcfe, 0x10325476};
+const quint32 SHA1_IV[5]    = {0x67452301, 0xefcdab89, 0x98badcfe, 0x10325476, 0xc3d2e1f0};
+const quint32 SHA256_IV[8]  = {0x6a09e667, 0xbb67ae85, 0x3c6ef372, 0xa54ff53a, 0x510e527f, 0x9b05688c, 0x1f83d9ab, 0x5be0cd19};
+
+const quint32 MD5_K[64] = {
+    0xd76aa478, 0xe8c7b756, 0x242070db, 0xc1bdceee, 0xf57c0faf, 0x4787c62a, 0xa8304613, 0xfd469501,
+    0x698098d8, 0x8b44f7af, 0xffff5bb1, 0x895cd7be, 0x6b901122, 0xfd987193, 0xa679438e, 0x49b40821,
+    0xf61e2562, 0xc040b340, 0x265e5a51, 0xe9b6c7aa, 0xd62f105d, 0x02441453, 0xd8a1e681, 0xe7d3fbc8,
+    0x21e1cde6, 0xc33707d6, 0xf4d50d87, 0x455a14ed, 0xa9e3e905, 0xfcefa3f8, 0x676f02d9, 0x8d2a4c8a,
+    0xfffa3942, 0x8771f681, 0x6d9d6122, 0xfde5380c, 0xa4beea44, 0x4bdecfa9, 0xf6bb4b60, 0xbebfbc70,
+    0x289b7ec6, 0xeaa127fa, 0xd4ef3085, 0x04881d05, 0xd9d4d039, 0xe6db99e5, 0x1fa27cf8, 0xc4ac5665,
+    0xf4292244, 0x432aff97, 0xab9423a7, 0xfc93a039, 0x655b59c3, 0x8f0ccc92, 0xffeff47d, 0x85845dd1,
+    0x6fa87e4f, 0xfe2ce6e0, 0xa3014314, 0x4e0811a1, 0xf7537e82, 0xbd3af235, 0x2ad7d2bb, 0xeb86d391
+};
+
+const int MD5_S[64] = {
+    7, 12, 17, 22, 7, 12, 17, 22, 7, 12, 17, 22, 7, 12, 17, 22,
+    5,  9, 14, 20, 5,  9, 14, 20, 5,  9, 14, 20, 5,  9, 14, 20,
+    4, 11, 16, 23, 4, 11, 16, 23, 4, 11, 16, 23, 4, 11, 16, 23,
+    6, 10, 15, 21, 6, 10, 15, 21, 6, 10, 15, 21, 6, 10, 15, 21
+};
+
+const quint32 SHA256_K[64] = {
+    0x428a2f98, 0x71374491, 0xb5c0fbcf, 0xe9b5dba5, 0x3956c25b, 0x59f111f1, 0x923f82a4, 0xab1c5ed5,
+    0xd807aa98, 0x12835b01, 0x243185be, 0x550c7dc3, 0x72be5d74, 0x80deb1fe, 0x9bdc06a7, 0xc19bf174,
+    0xe49b69c1, 0xefbe4786, 0x0fc19dc6, 0x240ca1cc, 0x2de92c6f, 0x4a7484aa, 0x5cb0a9dc, 0x76f988da,
+    0x983e5152, 0xa831c66d, 0xb00327c8, 0xbf597fc7, 0xc6e00bf3, 0xd5a79147, 0x06ca6351, 0x14292967,
+    0x27b70a85, 0x2e1b2138, 0x4d2c6dfc, 0x53380d13, 0x650a7354, 0x766a0abb, 0x81c2c92e, 0x92722c85,
+    0xa2bfe8a1, 0xa81a664b, 0xc24b8b70, 0xc76c51a3, 0xd192e819, 0xd6990624, 0xf40e3585, 0x106aa070,
+    0x19a4c116, 0x1e376c08, 0x2748774c, 0x34b0bcb5, 0x391c0cb3, 0x4ed8aa4a, 0x5b9cca4f, 0x682e6ff3,
+    0x748f82ee, 0x78a5636f, 0x84c87814, 0x8cc70208, 0x90befffa, 0xa4506ceb, 0xbef9a3f7, 0xc67178f2
+};
+
+/**
+ * @brief loadWords 把每个通道的一个 64 字节消息块转置为 16 个向量（第 j 个向量的第 l 个元素是通道 l 的第 j 个字）
+ * @param w [输出] 消息字
+ * @param blocks 每个通道的消息块
+ * @param big_endian 消息字是否为大端（SHA 为大端，MD5 为小端）
+ */
+template <typename V, int N>
+MB_INLINE void loadWords(V w[16], const uchar* const blocks[N], const bool big_endian)
+{
+    for (int j = 0; j < 16; ++j)
+    {
+        for (int l = 0; l < N; ++l)
+        {
+            quint32 x;
+            memcpy(&x, blocks[l] + j * 4, 4);
+            w[j][l] = big_endian ? __builtin_bswap32(x) : x;
+        }
+    }
+}
+
+template <typename V, int N>
+MB_INLINE void md5Compress(V s[4], const uchar* const blocks[N])
+{
+    V w[16];
+    loadWords<V, N>(w, blocks, false);
+
+    V a = s[0], b = s[1], c = s[2], d = s[3];
+#pragma GCC unroll 64
+    for (int i = 0; i < 64; ++i)
+    {
+        V f;
+        int g;
+        if (i < 16)         { f = (b & c) | (~b & d);   g = i; }
+        else if (i < 32)    { f = (d & b) | (~d & c);   g = (5 * i + 1) & 15; }
+        else if (i < 48)    { f = b ^ c ^ d;            g = (3 * i + 5) & 15; }
+        else                { f = c ^ (b | ~d);         g = (7 * i) & 15; }
+        f = f + a + MD5_K[i] + w[g];
+        a = d;
+        d = c;
+        c = b;
+        b = b + MB_ROTL(f, MD5_S[i]);
+    }
+    s[0] += a; s[1] += b; s[2] += c; s[3] += d;
+}
+
+template <typename V, int N>
+MB_INLINE void sha1Compress(V s[5], const uchar* const blocks[N])
+{
+    V w[16];
+    loadWords<V, N>(w, blocks, true);
+
+    V a = s[0], b = s[1], c = s[2], d = s[3], e = s[4];
+#pragma GCC unroll 80
+    for (int i = 0; i < 80; ++i)
+    {
+        if (i >= 16)
+        {
+            const V x = w[(i + 13) & 15] ^ w[(i + 8) & 15] ^ w[(i + 2) & 15] ^ w[i & 15];
+            w[i & 15] = MB_ROTL(x, 1);
+        }
+        V f;
+        quint32 k;
+        if (i < 20)         { f = (b & c) | (~b & d);           k = 0x5a827999; }
+        else if (i < 40)    { f = b ^ c ^ d;                    k = 0x6ed9eba1; }
+        else if (i < 60)    { f = (b & c) | (b & d) | (c & d);  k = 0x8f1bbcdc; }
+        else                { f = b ^ c ^ d;                    k = 0xca62c1d6; }
+        const V t = MB_ROTL(a, 5) + f + e + k + w[i & 15];
+        e = d;
+        d = c;
+        c = MB_ROTL(b, 30);
+        b = a;
+        a = t;
+    }
+    s[0] += a; s[1] += b; s[2] += c; s[3] += d; s[4] += e;
+}
+
+template <typename V, int N>
+MB_INLINE void sha256Compress(V s[8], const uchar* const blocks[N])
+{
+    V w[16];
+    loadWords<V, N>(w, blocks, true);
+
+    V a = s[0], b = s[1], c = s[2], d = s[3], e = s[4], f = s[5], g = s[6], h = s[7];
+#pragma GCC unroll 64
+    for (int i = 0; i < 64; ++i)
+    {
+        if (i >= 16)
+        {
+            const V w1  = w[(i + 1) & 15];
+            const V w14 = w[(i + 14) & 15];
+            const V s0 = MB_ROTR(w1, 7) ^ MB_ROTR(w1, 18) ^ (w1 >> 3);
+            const V s1 = MB_ROTR(w14, 17) ^ MB_ROTR(w14, 19) ^ (w14 >> 10);
+            w[i & 15] += s0 + w[(i + 9) & 15] + s1;
+        }
+        const V t1 = h + (MB_ROTR(e, 6) ^ MB_ROTR(e, 11) ^ MB_ROTR(e, 25)) + ((e & f) ^ (~e & g)) + SHA256_K[i] + w[i & 15];
+        const V t2 = (MB_ROTR(a, 2) ^ MB_ROTR(a, 13) ^ MB_ROTR(a, 22)) + ((a & b) ^ (a & c) ^ (b & c));
+        h = g;
+        g = f;
+        f = e;
+        e = d + t1;
+        d = c;
+        c = b;
+        b = a;
+        a = t1 + t2;
+    }
+    s[0] += a; s[1] += b; s[2] += c; s[3] += d; s[4] += e; s[5] += f; s[6] += g; s[7] += h;
+}
+
+template <typename V, int N>
+MB_INLINE void compressLanes(const HashAlg alg, V state[8], const uchar* const blocks[N])
+{
+    switch (alg) {
+    case HashAlg::MD5:
+        md5Compress<V, N>(state, blocks);
+        break;
+
+    case HashAlg::SHA1:
+        sha1Compress<V, N>(state, blocks);
+        break;
+
+    default:
+        sha256Compress<V, N>(state, blocks);
+        break;
+    }
+}
+
+/**
+ * @brief hashLanes 同时计算 N 个等长消息的哈希（每个通道一个消息），包括最后的填充
+ * @param alg 哈希算法（MD5 / SHA1 / SHA256）
+ * @param data N 个消息
+ * @param len 每个消息的长度
+ * @param digests [输出] N 个哈希值（依次存放）
+ */
+template <typename V, int N>
+MB_INLINE void hashLanes(const HashAlg alg, const uchar* const* data, const size_t len, uchar* digests)
+{
+    const quint32* iv = (HashAlg::MD5 == alg) ? MD5_IV : (HashAlg::SHA1 == alg) ? SHA1_IV : SHA256_IV;
+    const int num_words = (HashAlg::MD5 == alg) ? 4 : (HashAlg::SHA1 == alg) ? 5 : 8;
+    const bool big_endian = (HashAlg::MD5 != alg);
+
+    V state[8];
+    for (int i = 0; i < num_words; ++i)
+    {
+        state[i] = V{} + iv[i];
+    }
+
+    const uchar* blocks[N];
+    for (size_t offset = 0; offset + 64 <= len; offset += 64)
+    {
+        for (int l = 0; l < N; ++l)
+        {
+            blocks[l] = data[l] + offset;
+        }
+        compressLanes<V, N>(alg, state, blocks);
+    }
+
+    /* 最后不足 64 字节的数据 + 0x80 + 消息长度（bit）填充为 1 或 2 个消息块，所有通道的长度相同，块数也相同 */
+    uchar tail[N][128];
+    const size_t rem = len % 64;
+    const size_t num_tail = (rem + 9 <= 64) ? 1 : 2;
+    const quint64 bits = (quint64)len * 8;
+    for (int l = 0; l < N; ++l)
+    {
+        memset(tail[l], 0, sizeof(tail[l]));
+        memcpy(tail[l], data[l] + len - rem, rem);
+        tail[l][rem] = 0x80;
+        for (int i = 0; i < 8; ++i)
+        {
+            tail[l][big_endian ? num_tail * 64 - 1 - i : num_tail * 64 - 8 + i] = (uchar)(bits >> (8 * i));
+        }
+    }
+    for (size_t t = 0; t < num_tail; ++t)
+    {
+        for (int l = 0; l < N; ++l)
+        {
+            blocks[l] = tail[l] + t * 64;
+        }
+        compressLanes<V, N>(alg, state, blocks);
+    }
+
+    for (int l = 0; l < N; ++l)
+    {
+        uchar* out = digests + (size_t)l * num_words * 4;
+        for (int i = 0; i < num_words; ++i)
+        {
+            const quint32 x = big_endian ? __builtin_bswap32(state[i][l]) : state[i][l];
+            memcpy(out + i * 4, &x, 4);
+        }
+    }
+}
+
+__attribute__((target("avx2")))
+void hashLanesAvx2(const HashAlg alg, const uchar* const* data, const size_t len, uchar* digests)
+{
+    hashLanes<VecX8, 8>(alg, data, len, digests);
+}
+
+__attribute__((target("avx512f")))
+void hashLanesAvx512(const HashAlg alg, const uchar* const* data, const size_t len, uchar* digests)
+{
+    hashLanes<VecX16, 16>(alg, data, len, digests);
+}
+
+#endif
+
+} // namespace
+
+/**
+ * @brief MultiBufferHash::lanes 当前 CPU 上每次同时计算的消息数
+ * @return 16（AVX-512F）、8（AVX2）；不支持时返回 0
+ */
+int MultiBufferHash::lanes()
+{
+#if HASH_HAS_X86_MULTI_BUFFER
+    static const int num_lanes = []() {
+        __builtin_cpu_init();
+        if (__builtin_cpu_supports("avx512f"))
+        {
+            return 16;
+        }
+        if (__builtin_cpu_supports("avx2"))
+        {
+            return 8;
+        }
+        return 0;
+    }();
+    return num_lanes;
+#else
+    return 0;
+#endif
+}
+
+/**
+ * @brief MultiBufferHash::isSupported 哈希算法是否可以（并且值得）使用多缓冲区实现
+ *  SHA256_NI 在支持 SHA-NI 的 CPU 上逐个计算更快，只有不支持 SHA-NI 时才使用多缓冲区实现
+ * @param alg 哈希算法
+ * @return
+ */
+bool MultiBufferHash::isSupported(const HashAlg alg)
+{
+    if (0 == lanes())
+    {
+        return false;
+    }
+
+    switch (alg) {
+    case HashAlg::MD5:
+    case HashAlg::SHA1:
+    case HashAlg::SHA256:
+        return true;
+
+    case HashAlg::SHA256_NI:
+        return !Hash::hasSha256Ni();
+
+    default:
+        return false;
+    }
+}
+
+/**
+ * @brief MultiBufferHash::hash 同时计算 lanes() 个等长消息的哈希（只能在 isSupported(alg) 为 true 时调用）
+ * @param alg 哈希算法
+ * @param data lanes() 个消息（可以重复指向同一个消息）
+ * @param len 每个消息的长度
+ * @param digests [输出] lanes() 个哈希值，依次存放，每个 Hash::getHashSize(alg) 字节
+ */
+void MultiBufferHash::hash(const HashAlg alg, const uchar* const* data, const size_t len, uchar* digests)
+{
+#if HASH_HAS_X86_MULTI_BUFFER
+    const HashAlg kernel = (HashAlg::SHA256_NI == alg) ? HashAlg::SHA256 : alg;
+    if (16 == lanes())
+    {
+        hashLanesAvx512(kernel, data, len, digests);
+    }
+    else
+    {
+        hashLanesAvx2(kernel, data, len, digests);
+    }
+#else
+    Q_UNUSED(alg);
+    Q_UNUSED(data);
+    Q_UNUSED(len);
+    Q_UNUSED(digests);
+#endif
+}
@@ -0,0 +1,20 @@
+#ifndef HASHMULTIBUFFER_H
+#define HASHMULTIBUFFER_H
+
+#include <QtGlobal>
+
+#include "HashAlgorithm.h"
+
+/**
+ * @brief 多缓冲区（multi-buffer）SIMD 哈希：把多个等长的消息分别放在向量寄存器的不同通道中，同时计算 MD5 / SHA-1 / SHA-256。
+ *  运行时根据 CPU 选择 AVX-512（16 通道）或 AVX2（8 通道）实现，两者都不支持时 lanes() 返回 0，由调用者使用标量实现。
+ *  结果与 QCryptographicHash 完全相同
+ */
+struct MultiBufferHash
+{
+    static int lanes();
+    static bool isSupported(const HashAlg alg);
+    static void hash(const HashAlg alg, const uchar* const* data, const size_t len, uchar* digests);
+};
+
+#endif // HASHMULTIBUFFER_H
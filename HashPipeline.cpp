@@ -0,0 +1,249 @@
+#include "HashPipeline.h"
+
+#include <QThread>
+#include <QElapsedTimer>
+
+#include "InputFile.h"
+#include "Chunker.h"
+
+#define HASH_PIPELINE_BATCH_BLOCKS          32  // 哈希线程每次从队列中取出并批量计算哈希的最大块数
+#define HASH_PIPELINE_BLOCKS_PER_WORKER     (2 * HASH_PIPELINE_BATCH_BLOCKS)   // 默认每个哈希线程对应的流水线槽位数
+
+/**
+ * @brief HashPipeline::HashPipeline
+ * @param fin 源文件（流水线运行期间只能由读取线程访问）
+ * @param block_size 块大小（Byte）
+ * @param alg 哈希算法
+ * @param num_workers 哈希线程数（至少为 1）
+ * @param window 流水线中同时存在的最大块数（0 表示根据线程数自动选择）
+ * @param chunker 基于内容分块（nullptr 表示每块 block_size 个字节；流水线运行期间只能由读取线程访问）
+ */
+HashPipeline::HashPipeline(InputFile* fin, const size_t block_size, const HashAlg alg,
+                           const int num_workers, const size_t window, Chunker* chunker)
+    : _fin(fin)
+    , _chunker(chunker)
+    , _block_size(block_size)
+    , _alg(alg)
+    , _num_workers(qMax(1, num_workers))
+{
+    const size_t min_window = (size_t)_num_workers * HASH_PIPELINE_BLOCKS_PER_WORKER;
+    _slots.resize(qMax(window, min_window));
+}
+
+HashPipeline::~HashPipeline()
+{
+    stop();
+}
+
+/**
+ * @brief HashPipeline::start 启动读取线程和所有哈希线程
+ */
+void HashPipeline::start()
+{
+    _reader = QThread::create([this]() { runReader(); });
+    _reader->start();
+
+    for (int i = 0; i < _num_workers; ++i)
+    {
+        QThread* worker = QThread::create([this]() { runWorker(); });
+        worker->start();
+        _workers.append(worker);
+    }
+}
+
+/**
+ * @brief HashPipeline::next 按源文件中的顺序取出下一个块和它的哈希值（阻塞直到这个块的哈希计算完成）
+ * @param block [输出] 块数据
+ * @param hash [输出] 块的哈希值
+ * @return 是否取到了块；文件已经读完（或者流水线被停止）返回 false
+ */
+bool HashPipeline::next(QByteArray& block, QByteArray& hash)
+{
+    QMutexLocker locker(&_mutex);
+    Slot& slot = _slots[_num_consumed % _slots.size()];
+    while (!_stopped && Slot::HASHED != slot.state && !(_reader_done && _num_consumed == _num_read))
+    {
+        _cond_hashed.wait(&_mutex);
+    }
+
+    if (Slot::HASHED != slot.state)
+    {
+        return false;
+    }
+
+    block = std::move(slot.block);
+    hash  = std::move(slot.hash);
+    slot.block.clear();
+    slot.hash.clear();
+    slot.state = Slot::EMPTY;
+    ++_num_consumed;
+    _cond_slot_free.wakeOne();
+    return true;
+}
+
+/**
+ * @brief HashPipeline::stop 停止流水线并等待所有线程退出（可以重复调用）
+ */
+void HashPipeline::stop()
+{
+    {
+        QMutexLocker locker(&_mutex);
+        _stopped = true;
+        _cond_slot_free.wakeAll();
+        _cond_work.wakeAll();
+        _cond_hashed.wakeAll();
+    }
+
+    if (_reader)
+    {
+        _reader->wait();
+        delete _reader;
+        _reader = nullptr;
+    }
+
+    for (QThread* worker : std::as_const(_workers))
+    {
+        worker->wait();
+        delete worker;
+    }
+    _workers.clear();
+}
+
+int HashPipeline::numWorkers() const
+{
+    return _num_workers;
+}
+
+/**
+ * @brief HashPipeline::hashNsecs 所有哈希线程计算哈希的总耗时（ns，不包括等待的时间）
+ * @return
+ */
+qint64 HashPipeline::hashNsecs()
+{
+    QMutexLocker locker(&_mutex);
+    return _hash_nsecs;
+}
+
+/**
+ * @brief HashPipeline::bytesHashed 所有哈希线程计算了哈希的字节数
+ * @return
+ */
+qint64 HashPipeline::bytesHashed()
+{
+    QMutexLocker locker(&_mutex);
+    return _bytes_hashed;
+}
+
+/**
+ * @brief HashPipeline::hashLatency 哈希线程每次批量计算哈希的耗时分布
+ * @return
+ */
+LatencyHistogram HashPipeline::hashLatency()
+{
+    QMutexLocker locker(&_mutex);
+    return _hash_latency;
+}
+
+/**
+ * @brief HashPipeline::runReader 读取阶段：按顺序读取块，放入空闲的槽位并交给哈希线程
+ */
+void HashPipeline::runReader()
+{
+    QByteArray buf_block;
+    while (true)
+    {
+        {
+            QMutexLocker locker(&_mutex);
+            while (!_stopped && _num_read - _num_consumed >= _slots.size())
+            {
+                _cond_slot_free.wait(&_mutex);
+            }
+            if (_stopped)
+            {
+                return;
+            }
+        }
+
+        /* 读取不持有锁，槽位在被填充之前只属于读取线程 */
+        if (_chunker)
+        {
+            if (!_chunker->next(buf_block))
+            {
+                break;
+            }
+        }
+        else
+        {
+            if (_fin->atEnd())
+            {
+                break;
+            }
+            buf_block = _fin->read(_block_size);
+        }
+
+        QMutexLocker locker(&_mutex);
+        const size_t seq = _num_read;
+        Slot& slot = _slots[seq % _slots.size()];
+        slot.block = buf_block;
+        slot.state = Slot::READ;
+        _work_queue.append(seq);
+        ++_num_read;
+        _cond_work.wakeOne();
+    }
+
+    QMutexLocker locker(&_mutex);
+    _reader_done = true;
+    _cond_work.wakeAll();
+    _cond_hashed.wakeAll();
+}
+
+/**
+ * @brief HashPipeline::runWorker 哈希阶段：每次从队列中取出最多 HASH_PIPELINE_BATCH_BLOCKS 个块，
+ *  用 Hash::getDataHashes 批量计算哈希，写回对应的槽位
+ */
+void HashPipeline::runWorker()
+{
+    QList<size_t> batch_seqs;
+    QList<QByteArray> batch_blocks;
+    QList<QByteArray> batch_hashes;
+    QElapsedTimer timer;
+    while (true)
+    {
+        {
+            QMutexLocker locker(&_mutex);
+            while (!_stopped && _work_queue.isEmpty() && !_reader_done)
+            {
+                _cond_work.wait(&_mutex);
+            }
+            if (_stopped || _work_queue.isEmpty())
+            {
+                return;
+            }
+            while (!_work_queue.isEmpty() && batch_seqs.size() < HASH_PIPELINE_BATCH_BLOCKS)
+            {
+                const size_t seq = _work_queue.takeFirst();
+                batch_seqs.append(seq);
+                batch_blocks.append(_slots[seq % _slots.size()].block);  // 隐式共享，不会复制数据
+            }
+        }
+
+        timer.start();
+        batch_hashes = Hash::getDataHashes(batch_blocks, _alg);  // 计算哈希不持有锁
+        const qint64 nsecs = timer.nsecsElapsed();
+
+        QMutexLocker locker(&_mutex);
+        for (qsizetype i = 0; i < batch_seqs.size(); ++i)
+        {
+            Slot& slot = _slots[batch_seqs.at(i) % _slots.size()];
+            slot.hash  = batch_hashes.at(i);
+            slot.state = Slot::HASHED;
+            _bytes_hashed += batch_blocks.at(i).size();
+        }
+        _hash_nsecs += nsecs;
+        _hash_latency.record(nsecs);
+        batch_seqs.clear();
+        batch_blocks.clear();
+        batch_hashes.clear();
+        _cond_hashed.wakeAll();
+    }
+}
@@ -0,0 +1,82 @@
+#ifndef HASHPIPELINE_H
+#define HASHPIPELINE_H
+
+#include <QByteArray>
+#include <QMutex>
+#include <QWaitCondition>
+#include <QList>
+
+#include <vector>
+
+#include "HashAlgorithm.h"
+#include "LatencyHistogram.h"
+
+class InputFile;
+class Chunker;
+class QThread;
+
+/**
+ * @brief 分块的多线程哈希流水线：读取线程按顺序把源文件切成块，多个哈希线程并行计算哈希，
+ *  调用者（提交阶段，去重 + 写文件）通过 next() 严格按块在源文件中的顺序取出结果，
+ *  因此输出与串行读取 + 计算完全相同。流水线中同时存在的块数不超过 window 个。
+ *  使用 chunker 时读取线程按内容分块（块大小可变），否则每块 block_size 个字节
+ */
+class HashPipeline
+{
+public:
+    HashPipeline(InputFile* fin, const size_t block_size, const HashAlg alg,
+                 const int num_workers, const size_t window = 0, Chunker* chunker = nullptr);
+    ~HashPipeline();
+
+    void start();
+    bool next(QByteArray& block, QByteArray& hash);
+    void stop();
+
+    int numWorkers() const;
+    qint64 hashNsecs();
+    qint64 bytesHashed();
+    LatencyHistogram hashLatency();
+
+private:
+    /**
+     * @brief 环形缓冲区中的一个槽位（块序号 % window）
+     */
+    struct Slot
+    {
+        enum State { EMPTY, READ, HASHED };
+
+        State       state = EMPTY;
+        QByteArray  block;
+        QByteArray  hash;
+    };
+
+    void runReader();
+    void runWorker();
+
+private:
+    InputFile*  _fin;
+    Chunker*    _chunker;   // 基于内容分块（nullptr 表示固定大小分块）
+    size_t      _block_size;
+    HashAlg     _alg;
+    int         _num_workers;
+
+    QMutex              _mutex;
+    QWaitCondition      _cond_slot_free;    // 提交阶段取走了一个块，读取线程可以继续读取
+    QWaitCondition      _cond_work;         // 有新的块需要计算哈希
+    QWaitCondition      _cond_hashed;       // 有块计算完了哈希
+    std::vector<Slot>   _slots;             // 环形缓冲区（大小为 window）
+    QList<size_t>       _work_queue;        // 等待计算哈希的块序号
+
+    size_t  _num_read       = 0;        // 读取线程已经读取的块数
+    size_t  _num_consumed   = 0;        // 提交阶段已经取走的块数
+    bool    _reader_done    = false;    // 读取线程已经读到文件末尾
+    bool    _stopped        = false;    // 流水线被停止
+    qint64  _hash_nsecs     = 0;        // 所有哈希线程计算哈希的总耗时（ns）
+    qint64  _bytes_hashed   = 0;        // 所有哈希线程计算了哈希的字节数
+    LatencyHistogram _hash_latency;     // 每批块计算哈希的耗时
+
+    QThread*            _reader = nullptr;
+    QList<QThread*>     _workers;
+};
+
+#endif // HASHPIPELINE_H
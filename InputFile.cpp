@@ -1,7 +1,27 @@
 #include "InputFile.h"
 
-InputFile::InputFile(QObject *parent, const QString& filePath)
+#include <cerrno>
+#include <cstring>
+
+#include <QMutexLocker>
+
+#ifdef Q_OS_UNIX
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+#endif
+
+/**
+ * @brief InputFile::InputFile 打开输入文件
+ * @param parent
+ * @param filePath 文件路径
+ * @param mode 读取方式（直接 I/O 时忽略内存映射）
+ * @param direct 是否绕过页缓存直接读取设备（文件系统不支持时退化为普通读取）
+ */
+InputFile::InputFile(QObject *parent, const QString& filePath, const InputMode mode, const bool direct)
     : QObject{parent}
+    , _mode(mode)
+    , _direct(direct)
 {
     if (filePath.isEmpty())
     {
@@ -15,11 +35,46 @@ bool InputFile::setFile(const QString& filePath)
 {
     if (_file.isOpen())
     {
-        _file.close();
+        _file.close();  // 同时会解除内存映射
     }
+    _map = nullptr;
+    _pos = 0;
+    _bounce_offset = 0;
+    _bounce_len = 0;
 
     _file.setFileName(filePath);
-    if (!_file.open(QIODevice::ReadOnly))
+    _info.setFile(filePath);
+    QString direct_log;
+#ifdef Q_OS_UNIX
+    if (_direct)
+    {
+        const int fd = openDirectHandle(filePath, O_RDONLY);
+        if (fd >= 0 && _file.open(fd, QIODevice::ReadOnly | QIODevice::Unbuffered, QFileDevice::AutoCloseHandle))
+        {
+            if (!_bounce)
+            {
+                _bounce = static_cast<char*>(qMallocAligned(DIRECT_IO_BUFFER_SIZE, DIRECT_IO_ALIGNMENT));
+                Q_CHECK_PTR(_bounce);
+            }
+        }
+        else
+        {
+            direct_log = QString(", can not open with direct I/O (%1), fall back to page cache").arg(QString::fromLocal8Bit(std::strerror(errno)));
+            if (fd >= 0)
+            {
+                ::close(fd);
+            }
+            _direct = false;
+        }
+    }
+#else
+    if (_direct)
+    {
+        direct_log = QString(", direct I/O is not supported on this platform, fall back to page cache");
+        _direct = false;
+    }
+#endif
+    if (!_file.isOpen() && !_file.open(QIODevice::ReadOnly))
     {
         _last_log = QString("Can not open file %1").arg(_info.filePath());
         return false;
@@ -28,17 +83,94 @@ bool InputFile::setFile(const QString& filePath)
     _sin.setDevice(&_file);
     // 设置流的版本（可以根据实际情况设置，通常用于处理跨版本兼容性）
     _sin.setVersion(QDataStream::Qt_DefaultCompiledVersion);
-    _info.setFile(_file);
-    _last_log = QString("Successed open file %1, size %2 Bytes").arg(_info.filePath(), QString::number(_info.size()));
+    _last_log = QString("Successed open file %1, size %2 Bytes%3").arg(_info.filePath(), QString::number(_info.size()),
+                                                                       _direct ? QString(" (direct I/O)") : direct_log);
+
+    if (InputMode::INPUT_MAPPED == _mode && !_direct && _info.size() > 0 && !mapFile())
+    {
+        _last_log.append(QString(", can not map file (%1), fall back to buffered read").arg(_file.errorString()));
+    }
+    return true;
+}
+
+/**
+ * @brief InputFile::openDirectHandle 以绕过页缓存的方式打开文件（Linux 使用 O_DIRECT，macOS 使用 F_NOCACHE）
+ * @param filePath 文件路径
+ * @param flags open 的标志（O_RDONLY、O_WRONLY | O_CREAT | O_TRUNC ...）
+ * @return 文件描述符，不支持或者打开失败时返回 -1（errno 为失败的原因）
+ */
+int InputFile::openDirectHandle(const QString& filePath, const int flags)
+{
+    const QByteArray path = QFile::encodeName(filePath);
+#if defined(Q_OS_LINUX)
+    return ::open(path.constData(), flags | O_DIRECT | O_CLOEXEC, 0644);
+#elif defined(Q_OS_MACOS)
+    const int fd = ::open(path.constData(), flags | O_CLOEXEC, 0644);
+    if (fd >= 0 && ::fcntl(fd, F_NOCACHE, 1) < 0)
+    {
+        const int err = errno;
+        ::close(fd);
+        errno = err;
+        return -1;
+    }
+    return fd;
+#else
+    Q_UNUSED(path)
+    Q_UNUSED(flags)
+    errno = ENOTSUP;
+    return -1;
+#endif
+}
+
+/**
+ * @brief InputFile::mapFile 把整个文件映射到内存，并提示内核将按顺序读取（提前预读）
+ * @return 是否映射成功
+ */
+bool InputFile::mapFile()
+{
+    _map = _file.map(0, _info.size());
+    if (nullptr == _map)
+    {
+        return false;
+    }
+
+#ifdef Q_OS_UNIX
+    ::madvise(_map, _info.size(), MADV_SEQUENTIAL);
+    ::madvise(_map, _info.size(), MADV_WILLNEED);
+#endif
     return true;
 }
 
+InputMode InputFile::mode()
+{
+    return _mode;
+}
+
+/**
+ * @brief InputFile::isMapped 文件是否已经被映射到内存（映射失败或者空文件时使用普通读取）
+ * @return
+ */
+bool InputFile::isMapped()
+{
+    return nullptr != _map;
+}
+
+/**
+ * @brief InputFile::isDirect 文件是否以直接 I/O 方式打开（文件描述符上的读取必须对齐到 DIRECT_IO_ALIGNMENT）
+ * @return
+ */
+bool InputFile::isDirect()
+{
+    return _direct;
+}
+
 InputFile::~InputFile()
 {
     if (_file.isOpen())
     {
         _file.close();
     }
+    qFreeAligned(_bounce);
 }
 
 bool InputFile::isOpen()
@@ -55,11 +187,153 @@ QDataStream& InputFile::sin()
     return _sin;
 }
 
+/**
+ * @brief InputFile::read 从当前位置读取指定数量的字节（内存映射模式下返回映射区域的视图，不复制数据，在文件关闭之前有效）
+ * @param maxlen 读取的字节
+ * @return
+ */
 QByteArray InputFile::read(const qint64 maxlen)
 {
+    if (_map)
+    {
+        const qint64 len = qMin(maxlen, _info.size() - _pos);
+        QByteArray view = QByteArray::fromRawData(reinterpret_cast<const char*>(_map + _pos), len);
+        _pos += len;
+        return view;
+    }
+    if (_direct)
+    {
+        QByteArray buf(qMax<qint64>(0, qMin(maxlen, _info.size() - _pos)), Qt::Uninitialized);
+        buf.resize(qMax<qint64>(0, readInto(buf.data(), buf.size())));
+        return buf;
+    }
     return _file.read(maxlen);
 }
 
+/**
+ * @brief InputFile::readInto 从当前位置顺序读取最多 maxlen 个字节到调用者提供的缓冲区（不分配内存）
+ * @param data 读取的数据写入的位置（至少 maxlen 字节）
+ * @param maxlen 读取的字节
+ * @return 实际读取的字节数，出错返回 -1
+ */
+qint64 InputFile::readInto(char* data, const qint64 maxlen)
+{
+    if (_map)
+    {
+        const qint64 len = qMax<qint64>(0, qMin(maxlen, _info.size() - _pos));
+        std::memcpy(data, _map + _pos, len);
+        _pos += len;
+        return len;
+    }
+    if (!_direct)
+    {
+        return _file.read(data, maxlen);
+    }
+
+    /* 直接 I/O：位置和目标地址都对齐时整段直接读入调用者的缓冲区，否则经过中转缓冲区 */
+    qint64 total = 0;
+    while (total < maxlen)
+    {
+        const qint64 aligned_len = (maxlen - total) / DIRECT_IO_ALIGNMENT * DIRECT_IO_ALIGNMENT;
+        if (0 == _pos % DIRECT_IO_ALIGNMENT && 0 == reinterpret_cast<quintptr>(data + total) % DIRECT_IO_ALIGNMENT && aligned_len > 0
+            && (_pos < _bounce_offset || _pos >= _bounce_offset + _bounce_len))
+        {
+            const qint64 n = readDirect(_pos, data + total, aligned_len);
+            if (n <= 0)
+            {
+                return (0 == total && n < 0) ? -1 : total;
+            }
+            _pos  += n;
+            total += n;
+            if (n < aligned_len)  // 文件末尾
+            {
+                break;
+            }
+            continue;
+        }
+
+        if (_pos < _bounce_offset || _pos >= _bounce_offset + _bounce_len)
+        {
+            _bounce_offset = _pos / DIRECT_IO_ALIGNMENT * DIRECT_IO_ALIGNMENT;
+            _bounce_len    = qMax<qint64>(0, readDirect(_bounce_offset, _bounce, DIRECT_IO_BUFFER_SIZE));
+            if (_pos >= _bounce_offset + _bounce_len)  // 文件末尾或者出错
+            {
+                break;
+            }
+        }
+        const qint64 n = qMin(maxlen - total, _bounce_offset + _bounce_len - _pos);
+        std::memcpy(data + total, _bounce + (_pos - _bounce_offset), n);
+        _pos  += n;
+        total += n;
+    }
+    return total;
+}
+
+/**
+ * @brief InputFile::readDirect 直接 I/O 模式下用 pread 读取（location、data 和 maxlen 都必须对齐到 DIRECT_IO_ALIGNMENT）
+ * @return 实际读取的字节数（小于 maxlen 表示到达文件末尾），出错返回 -1
+ */
+qint64 InputFile::readDirect(const qint64 location, char* data, const qint64 maxlen)
+{
+#ifndef Q_OS_UNIX
+    return readSeek(location, data, maxlen);    // 其他平台不会以直接 I/O 方式打开文件
+#else
+    qint64 total = 0;
+    while (total < maxlen)
+    {
+        const ssize_t n = ::pread(_file.handle(), data + total, maxlen - total, location + total);
+        if (n < 0)
+        {
+            if (EINTR == errno)
+            {
+                continue;
+            }
+            _last_log = QString("Unable to read %1 Bytes at %2 from file %3 (%4)").arg(QString::number(maxlen), QString::number(location),
+                                                                                      _info.filePath(), QString::fromLocal8Bit(std::strerror(errno)));
+            return 0 == total ? -1 : total;
+        }
+        if (0 == n || 0 != n % DIRECT_IO_ALIGNMENT)  // 文件末尾（最后不足对齐长度的部分只能读到文件结束）
+        {
+            total += n;
+            break;
+        }
+        total += n;
+    }
+    return total;
+#endif
+}
+
+/**
+ * @brief InputFile::readSeek 没有 pread 的平台上读取指定位置的数据（加锁后 seek + read，会移动文件指针）
+ * @return 实际读取的字节数（小于 maxlen 表示到达文件末尾），出错返回 -1
+ */
+qint64 InputFile::readSeek(const qint64 location, char* data, const qint64 maxlen)
+{
+    QMutexLocker locker(&_seek_mutex);
+    if (!_file.seek(location))
+    {
+        _last_log = QString("Unable to seek to %1 in file %2 (%3)").arg(QString::number(location), _info.filePath(), _file.errorString());
+        return -1;
+    }
+    qint64 total = 0;
+    while (total < maxlen)
+    {
+        const qint64 n = _file.read(data + total, maxlen - total);
+        if (n < 0)
+        {
+            _last_log = QString("Unable to read %1 Bytes at %2 from file %3 (%4)").arg(QString::number(maxlen), QString::number(location),
+                                                                                      _info.filePath(), _file.errorString());
+            return -1;
+        }
+        if (0 == n)  // 文件末尾
+        {
+            break;
+        }
+        total += n;
+    }
+    return total;
+}
+
 /**
  * @brief InputFile::readFrom 从指定位置读取指定数量的字节
  * @param position 位置
@@ -68,6 +342,22 @@ QByteArray InputFile::read(const qint64 maxlen)
  */
 QByteArray InputFile::readFrom(const qint64 location, const qint64 maxlen)
 {
+    if (_map)
+    {
+        if (location < 0 || location > _info.size())
+        {
+            _last_log = "Unable to move file pointer to specified location";
+            return nullptr;
+        }
+        _pos = location;
+        return read(maxlen);
+    }
+    if (_direct)
+    {
+        _pos = qMax<qint64>(0, location);
+        return read(maxlen);
+    }
+
     // 移动文件指针到指定的位置
     if (!_file.seek(location))
     {
@@ -78,18 +368,80 @@ QByteArray InputFile::readFrom(const qint64 location, const qint64 maxlen)
     return _file.read(maxlen);
 }
 
+/**
+ * @brief InputFile::readAt 从指定位置读取指定数量的字节（pread，不移动文件指针，可以在多个线程中同时调用；没有 pread 的平台上加锁 seek + read）
+ * @param location 位置
+ * @param data 读取的数据写入的位置（至少 maxlen 字节）
+ * @param maxlen 读取的字节
+ * @return 实际读取的字节数，出错返回 -1
+ */
+qint64 InputFile::readAt(const qint64 location, char* data, const qint64 maxlen)
+{
+    if (_map)
+    {
+        if (location < 0 || location > _info.size())
+        {
+            _last_log = QString("Unable to read %1 Bytes at %2 from file %3").arg(QString::number(maxlen), QString::number(location), _info.filePath());
+            return -1;
+        }
+        const qint64 len = qMin(maxlen, _info.size() - location);
+        std::memcpy(data, _map + location, len);
+        return len;
+    }
+    if (_direct)  // 读取覆盖块的对齐区间（不使用共享的中转缓冲区，保持线程安全）
+    {
+        if (0 == location % DIRECT_IO_ALIGNMENT && 0 == maxlen % DIRECT_IO_ALIGNMENT && 0 == reinterpret_cast<quintptr>(data) % DIRECT_IO_ALIGNMENT)
+        {
+            return readDirect(location, data, maxlen);
+        }
+        const qint64 head = location % DIRECT_IO_ALIGNMENT;
+        const qint64 span = (head + maxlen + DIRECT_IO_ALIGNMENT - 1) / DIRECT_IO_ALIGNMENT * DIRECT_IO_ALIGNMENT;
+        char* aligned = static_cast<char*>(qMallocAligned(span, DIRECT_IO_ALIGNMENT));
+        Q_CHECK_PTR(aligned);
+        const qint64 n = readDirect(location - head, aligned, span);
+        const qint64 len = qBound<qint64>(0, n - head, maxlen);
+        if (len > 0)
+        {
+            std::memcpy(data, aligned + head, len);
+        }
+        qFreeAligned(aligned);
+        return n < 0 ? -1 : len;
+    }
+
+#ifdef Q_OS_UNIX
+    qint64 total = 0;
+    while (total < maxlen)
+    {
+        const ssize_t n = ::pread(_file.handle(), data + total, maxlen - total, location + total);
+        if (n < 0)
+        {
+            _last_log = QString("Unable to read %1 Bytes at %2 from file %3").arg(QString::number(maxlen), QString::number(location), _info.filePath());
+            return -1;
+        }
+        if (0 == n)  // 文件末尾
+        {
+            break;
+        }
+        total += n;
+    }
+    return total;
+#else
+    return readSeek(location, data, maxlen);
+#endif
+}
+
 /**
  * @brief InputFile::curPtrPostion 当前输入流指针位于文件的位置
  * @return 指针位置
  */
 qint64 InputFile::curPtrPostion()
 {
-    return _file.pos();
+    return (_map || _direct) ? _pos : _file.pos();
 }
 
 bool InputFile::atEnd()
 {
-    return _file.atEnd();
+    return (_map || _direct) ? _pos >= _info.size() : _file.atEnd();
 }
 
 /**
@@ -102,6 +454,15 @@ qint64 InputFile::fileSize()
 }
 
 
+/**
+ * @brief InputFile::handle 文件描述符（用于 pread 和异步 I/O，内存映射模式下同样有效）
+ * @return 文件描述符，文件没有打开时返回 -1
+ */
+int InputFile::handle()
+{
+    return _file.handle();
+}
+
 /**
  * @brief InputFile::filePath 获取文件路径
  * @return 文件路径
@@ -116,3 +477,22 @@ QString InputFile::lastLog()
 {
     return _last_log;
 }
+
+/**
+ * @brief InputFile::getInputModeName 获得读取方式名字字符串
+ * @param mode 读取方式
+ * @return
+ */
+QString InputFile::getInputModeName(const InputMode mode)
+{
+    switch (mode) {
+    case InputMode::INPUT_BUFFERED:
+        return "BUFFERED";
+
+    case InputMode::INPUT_MAPPED:
+        return "MAPPED";
+
+    default:
+        return "NONE";
+    }
+}
@@ -6,6 +6,18 @@
 #include <QFile>
 #include <QFileInfo>
 #include <QDataStream>
+#include <QMutex>
+
+#define DIRECT_IO_ALIGNMENT     4096                // 直接 I/O 时缓冲区地址、文件位置和读写长度的对齐（Byte）
+#define DIRECT_IO_BUFFER_SIZE   (1024 * 1024)       // 直接 I/O 时顺序读取的中转缓冲区大小（Byte）
+
+/**
+ * @brief 输入文件的读取方式
+ */
+enum InputMode {
+    INPUT_BUFFERED  = 0,    // 通过 QFile 读取，每次读取都会复制到新的 QByteArray
+    INPUT_MAPPED    = 1     // 内存映射（QFile::map + madvise），读取的块是映射区域的零拷贝视图
+};
 
 /**
  * @brief 输入文件
@@ -14,25 +26,51 @@ class InputFile : public QObject
 {
     Q_OBJECT
 public:
-    explicit InputFile(QObject *parent = nullptr, const QString& filePath = nullptr);
+    explicit InputFile(QObject *parent = nullptr, const QString& filePath = nullptr,
+                       const InputMode mode = InputMode::INPUT_BUFFERED, const bool direct = false);
     ~InputFile();
 
     bool setFile(const QString& filePath);
+    InputMode mode();
+    bool isMapped();
+    bool isDirect();
     bool isOpen();
     QDataStream& sin();
     QByteArray read(const qint64 maxlen);
+    qint64 readInto(char* data, const qint64 maxlen);
     QByteArray readFrom(const qint64 location, const qint64 maxlen);
+    qint64 readAt(const qint64 location, char* data, const qint64 maxlen);
     qint64 curPtrPostion();
     bool atEnd();
     qint64 fileSize();
+    int handle();
     QString filePath();
     QString lastLog();
 
+    static QString getInputModeName(const InputMode mode);
+    static int openDirectHandle(const QString& filePath, const int flags);
+
+private:
+    bool mapFile();
+    qint64 readDirect(const qint64 location, char* data, const qint64 maxlen);
+    qint64 readSeek(const qint64 location, char* data, const qint64 maxlen);
+
 private:
     QString _last_log;
     QFile _file;
     QFileInfo _info;
     QDataStream _sin;
+
+    InputMode _mode;
+    uchar* _map = nullptr;  // 内存映射的起始地址（nullptr 表示没有映射）
+    qint64 _pos = 0;        // 内存映射和直接 I/O 模式下读取指针的位置
+
+    bool _direct = false;   // 是否绕过页缓存（O_DIRECT）直接读取设备
+    char* _bounce = nullptr;        // 直接 I/O 时顺序读取的中转缓冲区（对齐到 DIRECT_IO_ALIGNMENT）
+    qint64 _bounce_offset = 0;      // ↑ 中的数据在文件中的位置
+    qint64 _bounce_len = 0;         // ↑ 中有效数据的长度
+
+    QMutex _seek_mutex;     // 没有 pread 的平台上 readAt 用 seek + read 读取，需要互斥
 };
 
 #endif // INPUTFILE_H
@@ -0,0 +1,528 @@
+#include "IoEngine.h"
+
+#include <cerrno>
+#include <cstring>
+
+#include <QFile>
+#include <QThread>
+
+#ifdef Q_OS_UNIX
+#include <unistd.h>
+#endif
+#ifdef Q_OS_LINUX
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <linux/io_uring.h>
+#endif
+
+#define IO_ENGINE_CANCEL_TAG    (~0ULL)     // 取消请求的标记（内部使用，不返回给调用者）
+
+/**
+ * @brief IoEngine::IoEngine
+ * @param mode I/O 引擎（io_uring 不可用时退化为同步读写，lastLog() 中是原因）
+ * @param queue_depth 队列深度（同时进行的最大请求数）
+ */
+IoEngine::IoEngine(const IoEngineMode mode, const int queue_depth)
+    : _queue_depth(qBound(1, queue_depth, IO_ENGINE_MAX_QUEUE_DEPTH))
+{
+    if (IoEngineMode::IO_ENGINE_URING == mode && !setupRing(_queue_depth))
+    {
+        _last_log = QString("io_uring is unavailable (%1), fall back to synchronous I/O").arg(_last_log);
+    }
+}
+
+IoEngine::~IoEngine()
+{
+#ifdef Q_OS_LINUX
+    if (_ring_fd >= 0)
+    {
+        wait();
+        ::munmap(_sqes, _sqes_size);
+        if (_cq_ptr != _sq_ptr)
+        {
+            ::munmap(_cq_ptr, _cq_size);
+        }
+        ::munmap(_sq_ptr, _sq_size);
+        ::close(_ring_fd);
+    }
+#endif
+}
+
+/**
+ * @brief IoEngine::setupRing 创建 io_uring 并映射提交队列和完成队列
+ * @param entries 提交队列的长度
+ * @return 是否成功
+ */
+bool IoEngine::setupRing(const unsigned entries)
+{
+#ifdef Q_OS_LINUX
+    struct io_uring_params params;
+    std::memset(&params, 0, sizeof(params));
+    const int ring_fd = (int)::syscall(__NR_io_uring_setup, entries, &params);
+    if (ring_fd < 0)
+    {
+        _last_log = QString("io_uring_setup: %1").arg(std::strerror(errno));
+        return false;
+    }
+    if (!(params.features & IORING_FEAT_RW_CUR_POS))  // IORING_OP_READ / IORING_OP_WRITE 需要 Linux 5.6
+    {
+        _last_log = "kernel is older than 5.6";
+        ::close(ring_fd);
+        return false;
+    }
+
+    _sq_size = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+    _cq_size = params.cq_off.cqes + params.cq_entries * sizeof(struct io_uring_cqe);
+    const bool single_mmap = params.features & IORING_FEAT_SINGLE_MMAP;
+    if (single_mmap)
+    {
+        _sq_size = _cq_size = qMax(_sq_size, _cq_size);
+    }
+
+    _sq_ptr = ::mmap(nullptr, _sq_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ring_fd, IORING_OFF_SQ_RING);
+    if (MAP_FAILED == _sq_ptr)
+    {
+        _last_log = QString("mmap SQ ring: %1").arg(std::strerror(errno));
+        ::close(ring_fd);
+        return false;
+    }
+    _cq_ptr = single_mmap ? _sq_ptr : ::mmap(nullptr, _cq_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ring_fd, IORING_OFF_CQ_RING);
+    if (MAP_FAILED == _cq_ptr)
+    {
+        _last_log = QString("mmap CQ ring: %1").arg(std::strerror(errno));
+        ::munmap(_sq_ptr, _sq_size);
+        ::close(ring_fd);
+        return false;
+    }
+    _sqes_size = params.sq_entries * sizeof(struct io_uring_sqe);
+    _sqes = ::mmap(nullptr, _sqes_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ring_fd, IORING_OFF_SQES);
+    if (MAP_FAILED == _sqes)
+    {
+        _last_log = QString("mmap SQEs: %1").arg(std::strerror(errno));
+        if (!single_mmap)
+        {
+            ::munmap(_cq_ptr, _cq_size);
+        }
+        ::munmap(_sq_ptr, _sq_size);
+        ::close(ring_fd);
+        return false;
+    }
+
+    char* sq = static_cast<char*>(_sq_ptr);
+    char* cq = static_cast<char*>(_cq_ptr);
+    _sq_head  = reinterpret_cast<unsigned*>(sq + params.sq_off.head);
+    _sq_tail  = reinterpret_cast<unsigned*>(sq + params.sq_off.tail);
+    _sq_mask  = reinterpret_cast<unsigned*>(sq + params.sq_off.ring_mask);
+    _sq_array = reinterpret_cast<unsigned*>(sq + params.sq_off.array);
+    _cq_head  = reinterpret_cast<unsigned*>(cq + params.cq_off.head);
+    _cq_tail  = reinterpret_cast<unsigned*>(cq + params.cq_off.tail);
+    _cq_mask  = reinterpret_cast<unsigned*>(cq + params.cq_off.ring_mask);
+    _cqes     = cq + params.cq_off.cqes;
+    _queue_depth = qMin<int>(_queue_depth, params.sq_entries);
+    _ring_fd  = ring_fd;
+    return true;
+#else
+    Q_UNUSED(entries)
+    _last_log = "not supported on this platform";
+    return false;
+#endif
+}
+
+bool IoEngine::isUring() const
+{
+    return _ring_fd >= 0;
+}
+
+int IoEngine::queueDepth() const
+{
+    return isUring() ? _queue_depth : 1;
+}
+
+/**
+ * @brief IoEngine::name 实际使用的 I/O 引擎和队列深度
+ * @return
+ */
+QString IoEngine::name() const
+{
+    return isUring() ? QString("io_uring (QD %1)").arg(_queue_depth) : QString("sync");
+}
+
+QString IoEngine::lastLog() const
+{
+    return _last_log;
+}
+
+/**
+ * @brief IoEngine::read 提交一个读取请求（同步读写时立即读取）
+ * @param fd 文件描述符
+ * @param data 读取的数据写入的位置（至少 len 字节，在 wait() 返回之前不能使用）
+ * @param len 读取的字节
+ * @param offset 在文件中的位置
+ * @param tag 标记（原样返回到结果中）
+ */
+void IoEngine::read(const int fd, char* data, const size_t len, const qint64 offset, const quint64 tag)
+{
+#ifdef Q_OS_LINUX
+    if (isUring())
+    {
+        submit(IORING_OP_READ, fd, data, len, offset, tag);
+        return;
+    }
+#endif
+
+    ++_requests;
+    ++_in_flight_sum;
+#ifdef Q_OS_UNIX
+    size_t total = 0;
+    while (total < len)
+    {
+        const ssize_t n = ::pread(fd, data + total, len - total, offset + total);
+        if (n < 0 && EINTR == errno)
+        {
+            continue;
+        }
+        if (n < 0)
+        {
+            complete(tag, -errno);
+            return;
+        }
+        if (0 == n)  // 文件末尾
+        {
+            break;
+        }
+        total += n;
+    }
+    complete(tag, total);
+#else
+    QFile file;  // 没有 pread 的平台上通过 QFile 在文件描述符上 seek + read
+    if (!file.open(fd, QIODevice::ReadOnly | QIODevice::Unbuffered, QFileDevice::DontCloseHandle) || !file.seek(offset))
+    {
+        complete(tag, -EIO);
+        return;
+    }
+    qint64 total = 0;
+    while (total < (qint64)len)
+    {
+        const qint64 n = file.read(data + total, len - total);
+        if (n < 0)
+        {
+            complete(tag, -EIO);
+            return;
+        }
+        if (0 == n)  // 文件末尾
+        {
+            break;
+        }
+        total += n;
+    }
+    complete(tag, total);
+#endif
+}
+
+/**
+ * @brief IoEngine::write 提交一个写入请求（同步读写时立即写入）
+ * @param fd 文件描述符
+ * @param data 写入的数据（在 wait() 返回之前不能修改）
+ * @param len 写入的字节
+ * @param offset 在文件中的位置
+ * @param tag 标记（原样返回到结果中）
+ */
+void IoEngine::write(const int fd, const char* data, const size_t len, const qint64 offset, const quint64 tag)
+{
+#ifdef Q_OS_LINUX
+    if (isUring())
+    {
+        submit(IORING_OP_WRITE, fd, const_cast<char*>(data), len, offset, tag);
+        return;
+    }
+#endif
+
+    ++_requests;
+    ++_in_flight_sum;
+#ifdef Q_OS_UNIX
+    size_t total = 0;
+    while (total < len)
+    {
+        const ssize_t n = ::pwrite(fd, data + total, len - total, offset + total);
+        if (n < 0 && EINTR == errno)
+        {
+            continue;
+        }
+        if (n <= 0)
+        {
+            complete(tag, n < 0 ? -errno : -EIO);
+            return;
+        }
+        total += n;
+    }
+    complete(tag, total);
+#else
+    QFile file;  // 没有 pwrite 的平台上通过 QFile 在文件描述符上 seek + write
+    if (!file.open(fd, QIODevice::WriteOnly | QIODevice::Unbuffered, QFileDevice::DontCloseHandle)
+        || !file.seek(offset) || file.write(data, len) != (qint64)len)
+    {
+        complete(tag, -EIO);
+        return;
+    }
+    complete(tag, len);
+#endif
+}
+
+/**
+ * @brief IoEngine::wait 提交所有还没有提交的请求，等待所有请求完成
+ *  （io_uring_enter 失败时取消所有请求并等待内核不再使用它们的缓冲区，被取消的请求结果为 -ECANCELED）
+ * @return 上次 wait() / waitSome() 之后完成的所有请求的结果（按完成的顺序）
+ */
+QList<IoEngine::Completion> IoEngine::wait()
+{
+    while (_in_flight > 0)
+    {
+        if (!enter(1))
+        {
+            cancelAll();
+            break;
+        }
+        reap();
+    }
+    return std::move(_done);
+}
+
+/**
+ * @brief IoEngine::waitSome 提交所有还没有提交的请求；还没有请求完成时等待至少一个请求完成
+ * @return 上次 wait() / waitSome() 之后完成的所有请求的结果（按完成的顺序）
+ */
+QList<IoEngine::Completion> IoEngine::waitSome()
+{
+    if (_in_flight > 0)
+    {
+        submitPending();
+        reap();
+        if (_done.isEmpty())
+        {
+            if (enter(1))
+            {
+                reap();
+            }
+            else
+            {
+                cancelAll();
+            }
+        }
+    }
+    return std::move(_done);
+}
+
+/**
+ * @brief IoEngine::submitPending 把已经放入提交队列的请求提交给内核，不等待完成
+ *  （请求默认在队列满或者等待时才批量提交，调用者去做其他事情之前调用，使请求在这期间进行）
+ */
+void IoEngine::submitPending()
+{
+    if (_to_submit > 0)
+    {
+        enter(0);
+    }
+}
+
+/**
+ * @brief IoEngine::inFlight 正在进行（还没有取出结果）的请求数
+ * @return
+ */
+int IoEngine::inFlight() const
+{
+    return _in_flight;
+}
+
+qint64 IoEngine::requests() const
+{
+    return _requests;
+}
+
+qint64 IoEngine::bytes() const
+{
+    return _bytes;
+}
+
+/**
+ * @brief IoEngine::avgInFlight 平均每次提交请求时正在进行的请求数（包括这个请求，即实际达到的平均队列深度）
+ * @return
+ */
+double IoEngine::avgInFlight() const
+{
+    return 0 == _requests ? 0.0 : (double)_in_flight_sum / _requests;
+}
+
+/**
+ * @brief IoEngine::submit 把请求放入提交队列；正在进行的请求达到队列深度时提交并等待至少一个请求完成
+ */
+void IoEngine::submit(const quint8 opcode, const int fd, void* data, const size_t len, const qint64 offset, const quint64 tag)
+{
+#ifdef Q_OS_LINUX
+    while (_in_flight >= (unsigned)_queue_depth)
+    {
+        if (!enter(1))
+        {
+            cancelAll();
+            complete(tag, -EIO);
+            return;
+        }
+        reap();
+    }
+
+    const unsigned tail = *_sq_tail;
+    const unsigned index = tail & *_sq_mask;
+    struct io_uring_sqe* sqe = static_cast<struct io_uring_sqe*>(_sqes) + index;
+    std::memset(sqe, 0, sizeof(*sqe));
+    sqe->opcode    = opcode;
+    sqe->fd        = fd;
+    sqe->addr      = reinterpret_cast<quint64>(data);
+    sqe->len       = len;
+    sqe->off       = offset;
+    sqe->user_data = tag;
+    _sq_array[index] = index;
+    __atomic_store_n(_sq_tail, tail + 1, __ATOMIC_RELEASE);
+
+    ++_to_submit;
+    ++_in_flight;
+    ++_requests;
+    _in_flight_sum += _in_flight;
+#else
+    Q_UNUSED(opcode) Q_UNUSED(fd) Q_UNUSED(data) Q_UNUSED(len) Q_UNUSED(offset)
+    complete(tag, -ENOSYS);
+#endif
+}
+
+/**
+ * @brief IoEngine::enter 提交所有还没有提交的请求，并等待至少 min_complete 个请求完成
+ * @return 是否成功（失败时所有正在进行的请求都被当作失败）
+ */
+bool IoEngine::enter(const unsigned min_complete)
+{
+#ifdef Q_OS_LINUX
+    while (true)
+    {
+        const int ret = (int)::syscall(__NR_io_uring_enter, _ring_fd, _to_submit, min_complete,
+                                       min_complete > 0 ? IORING_ENTER_GETEVENTS : 0, nullptr, 0);
+        if (ret >= 0)
+        {
+            _to_submit -= qMin<unsigned>(ret, _to_submit);
+            return true;
+        }
+        if (EINTR == errno || EAGAIN == errno || EBUSY == errno)  // 完成队列已满或者内核暂时没有资源：先取出已经完成的请求再重试
+        {
+            reap();
+            continue;
+        }
+
+        _last_log = QString("io_uring_enter: %1").arg(std::strerror(errno));
+        return false;
+    }
+#else
+    Q_UNUSED(min_complete)
+    return false;
+#endif
+}
+
+/**
+ * @brief IoEngine::cancelAll io_uring_enter 失败后放弃所有请求：还没有提交给内核的请求从提交队列中撤回，
+ *  已经提交的请求尝试取消（需要 Linux 5.19），然后一直等到它们全部完成（内核不再读写它们的缓冲区）才返回
+ */
+void IoEngine::cancelAll()
+{
+#ifdef Q_OS_LINUX
+    const QString reason = _last_log;
+
+    /* 撤回还没有提交的请求（内核只读取到上次 io_uring_enter 时的 tail） */
+    unsigned tail = *_sq_tail;
+    for (; _to_submit > 0; --_to_submit)
+    {
+        --tail;
+        const struct io_uring_sqe* sqe = static_cast<const struct io_uring_sqe*>(_sqes) + (tail & *_sq_mask);
+        complete(sqe->user_data, -ECANCELED);
+        --_in_flight;
+    }
+    __atomic_store_n(_sq_tail, tail, __ATOMIC_RELEASE);
+
+#ifdef IORING_ASYNC_CANCEL_ANY
+    if (_in_flight > 0 && tail - __atomic_load_n(_sq_head, __ATOMIC_ACQUIRE) <= *_sq_mask)
+    {
+        const unsigned index = tail & *_sq_mask;
+        struct io_uring_sqe* sqe = static_cast<struct io_uring_sqe*>(_sqes) + index;
+        std::memset(sqe, 0, sizeof(*sqe));
+        sqe->opcode       = IORING_OP_ASYNC_CANCEL;
+        sqe->fd           = -1;
+        sqe->cancel_flags = IORING_ASYNC_CANCEL_ANY;
+        sqe->user_data    = IO_ENGINE_CANCEL_TAG;
+        _sq_array[index]  = index;
+        __atomic_store_n(_sq_tail, tail + 1, __ATOMIC_RELEASE);
+        _to_submit = 1;
+        if (!enter(0))
+        {
+            __atomic_store_n(_sq_tail, tail, __ATOMIC_RELEASE);
+            _to_submit = 0;
+        }
+    }
+#endif
+
+    /* 已经提交的请求完成时内核直接写入完成队列，不需要 io_uring_enter 也能取出 */
+    while (_in_flight > 0)
+    {
+        reap();
+        if (_in_flight > 0 && !enter(1))
+        {
+            QThread::usleep(100);
+        }
+    }
+    _last_log = QString("%1, requests in flight were cancelled").arg(reason);
+#endif
+}
+
+/**
+ * @brief IoEngine::reap 取出完成队列中所有已经完成的请求
+ */
+void IoEngine::reap()
+{
+#ifdef Q_OS_LINUX
+    unsigned head = *_cq_head;
+    const unsigned tail = __atomic_load_n(_cq_tail, __ATOMIC_ACQUIRE);
+    while (head != tail)
+    {
+        const struct io_uring_cqe* cqe = static_cast<const struct io_uring_cqe*>(_cqes) + (head & *_cq_mask);
+        if (IO_ENGINE_CANCEL_TAG != cqe->user_data)
+        {
+            complete(cqe->user_data, cqe->res);
+            --_in_flight;
+        }
+        ++head;
+    }
+    __atomic_store_n(_cq_head, head, __ATOMIC_RELEASE);
+#endif
+}
+
+void IoEngine::complete(const quint64 tag, const qint64 result)
+{
+    if (result > 0)
+    {
+        _bytes += result;
+    }
+    _done.append({tag, result});
+}
+
+/**
+ * @brief IoEngine::getIoEngineModeName 获得 I/O 引擎名字字符串
+ * @param mode I/O 引擎
+ * @return
+ */
+QString IoEngine::getIoEngineModeName(const IoEngineMode mode)
+{
+    switch (mode) {
+    case IoEngineMode::IO_ENGINE_SYNC:
+        return "SYNC";
+
+    case IoEngineMode::IO_ENGINE_URING:
+        return "URING";
+
+    default:
+        return "NONE";
+    }
+}
@@ -0,0 +1,96 @@
+#ifndef IOENGINE_H
+#define IOENGINE_H
+
+#include <QList>
+#include <QString>
+
+#define IO_ENGINE_MAX_QUEUE_DEPTH   1024            // 最大队列深度
+#define IO_ENGINE_REQUEST_SIZE      (64 * 1024)     // 顺序读写（分块读取源文件、写入输出文件）时每个请求的最大长度（Byte）
+
+/**
+ * @brief 读写文件的 I/O 引擎
+ */
+enum IoEngineMode {
+    IO_ENGINE_SYNC  = 0,    // 同步读写（QFile / pread / pwrite），每次只有一个请求
+    IO_ENGINE_URING = 1     // io_uring 异步读写，同时保持最多 queue depth 个请求（不可用时退化为同步读写）
+};
+
+/**
+ * @brief 异步 I/O 引擎：提交的读写请求放入 io_uring 的提交队列，正在进行的请求达到队列深度时等待最早完成的请求，
+ *  wait() 等待所有请求完成、waitSome() 等待至少一个请求完成，并返回已经完成的请求的结果。直接使用 io_uring 系统调用（不依赖 liburing），
+ *  内核不支持时（非 Linux、内核太旧或者被禁用）退化为同步的 pread / pwrite（没有它们的平台上通过 QFile 读写）。
+ *  提交的缓冲区在请求完成之前不能被修改或释放。不是线程安全的
+ */
+class IoEngine
+{
+public:
+    /**
+     * @brief 一个请求的结果
+     */
+    struct Completion
+    {
+        quint64 tag     = 0;    // 提交时指定的标记
+        qint64  result  = 0;    // 读写的字节数，出错时为 -errno
+    };
+
+    IoEngine(const IoEngineMode mode, const int queue_depth);
+    ~IoEngine();
+
+    bool isUring() const;
+    int queueDepth() const;
+    QString name() const;
+    QString lastLog() const;
+
+    void read(const int fd, char* data, const size_t len, const qint64 offset, const quint64 tag = 0);
+    void write(const int fd, const char* data, const size_t len, const qint64 offset, const quint64 tag = 0);
+    QList<Completion> wait();
+    QList<Completion> waitSome();
+    void submitPending();
+    int inFlight() const;
+
+    qint64 requests() const;
+    qint64 bytes() const;
+    double avgInFlight() const;
+
+    static QString getIoEngineModeName(const IoEngineMode mode);
+
+private:
+    Q_DISABLE_COPY(IoEngine)
+
+    bool setupRing(const unsigned entries);
+    void submit(const quint8 opcode, const int fd, void* data, const size_t len, const qint64 offset, const quint64 tag);
+    bool enter(const unsigned min_complete);
+    void cancelAll();
+    void reap();
+    void complete(const quint64 tag, const qint64 result);
+
+private:
+    int     _queue_depth;
+    QString _last_log;
+
+    /* io_uring（_ring_fd 为 -1 表示使用同步读写） */
+    int         _ring_fd    = -1;
+    void*       _sq_ptr     = nullptr;  // 提交队列环的映射
+    size_t      _sq_size    = 0;
+    void*       _cq_ptr     = nullptr;  // 完成队列环的映射（内核支持 IORING_FEAT_SINGLE_MMAP 时与提交队列相同）
+    size_t      _cq_size    = 0;
+    void*       _sqes       = nullptr;  // 提交队列项数组的映射
+    size_t      _sqes_size  = 0;
+    unsigned*   _sq_head    = nullptr;
+    unsigned*   _sq_tail    = nullptr;
+    unsigned*   _sq_mask    = nullptr;
+    unsigned*   _sq_array   = nullptr;
+    unsigned*   _cq_head    = nullptr;
+    unsigned*   _cq_tail    = nullptr;
+    unsigned*   _cq_mask    = nullptr;
+    void*       _cqes       = nullptr;
+    unsigned    _to_submit  = 0;        // 已经放入提交队列但还没有提交给内核的请求数
+    unsigned    _in_flight  = 0;        // 已经放入提交队列但还没有完成的请求数
+
+    QList<Completion> _done;            // 上次 wait() 之后完成的请求
+    qint64  _requests       = 0;        // 提交的请求数
+    qint64  _bytes          = 0;        // 成功读写的字节数
+    qint64  _in_flight_sum  = 0;        // 每次提交请求时正在进行的请求数之和（用于计算平均队列深度）
+};
+
+#endif // IOENGINE_H
@@ -0,0 +1,175 @@
+#include "LatencyHistogram.h"
+
+#include <QtAlgorithms>
+
+#include <cstring>
+
+LatencyHistogram::LatencyHistogram()
+{
+    std::memset(_buckets, 0, sizeof(_buckets));
+}
+
+/**
+ * @brief LatencyHistogram::record 记录一次耗时
+ * @param nsecs 耗时（ns，负数按 0 记录）
+ */
+void LatencyHistogram::record(const qint64 nsecs)
+{
+    const quint64 value = nsecs > 0 ? nsecs : 0;
+    ++_buckets[bucketOf(value)];
+    ++_count;
+    _total += value;
+    if ((qint64)value > _max)
+    {
+        _max = value;
+    }
+}
+
+/**
+ * @brief LatencyHistogram::merge 把另一个直方图的记录合并到这个直方图（用于汇总多个线程的记录）
+ * @param other 另一个直方图
+ */
+void LatencyHistogram::merge(const LatencyHistogram& other)
+{
+    for (int i = 0; i < LATENCY_HISTOGRAM_BUCKETS; ++i)
+    {
+        _buckets[i] += other._buckets[i];
+    }
+    _count += other._count;
+    _total += other._total;
+    _max = qMax(_max, other._max);
+}
+
+void LatencyHistogram::clear()
+{
+    std::memset(_buckets, 0, sizeof(_buckets));
+    _count = 0;
+    _total = 0;
+    _max   = 0;
+}
+
+qint64 LatencyHistogram::count() const
+{
+    return _count;
+}
+
+qint64 LatencyHistogram::totalNsecs() const
+{
+    return _total;
+}
+
+qint64 LatencyHistogram::maxNsecs() const
+{
+    return _max;
+}
+
+/**
+ * @brief LatencyHistogram::percentile 分位数（所在桶的上界，不超过最大值）
+ * @param p 百分比（0 - 100）
+ * @return 耗时（ns，没有记录时为 0）
+ */
+qint64 LatencyHistogram::percentile(const double p) const
+{
+    if (0 == _count)
+    {
+        return 0;
+    }
+
+    const quint64 rank = qMax<quint64>(1, (quint64)(qBound(0.0, p, 100.0) / 100.0 * _count + 0.5));  // 第 rank 小的记录
+    quint64 seen = 0;
+    for (int i = 0; i < LATENCY_HISTOGRAM_BUCKETS; ++i)
+    {
+        seen += _buckets[i];
+        if (seen >= rank)
+        {
+            return qMin<qint64>(bucketUpper(i), _max);
+        }
+    }
+    return _max;
+}
+
+/**
+ * @brief LatencyHistogram::stats 转换为写入结果的统计信息
+ * @param elapsed_nsecs 任务的总耗时（ns），用于计算这个阶段的耗时占比
+ * @return
+ */
+PhaseStats LatencyHistogram::stats(const qint64 elapsed_nsecs) const
+{
+    PhaseStats s;
+    s.count = _count;
+    s.p50Us = percentile(50) / 1000.0;
+    s.p90Us = percentile(90) / 1000.0;
+    s.p99Us = percentile(99) / 1000.0;
+    s.maxUs = _max / 1000.0;
+    s.share = elapsed_nsecs > 0 ? (double)_total / elapsed_nsecs * 100 : 0.0;
+    return s;
+}
+
+/**
+ * @brief LatencyHistogram::getPhaseName 阶段的名称（用于表头和导出的字段名）
+ * @param phase 阶段
+ * @return
+ */
+QString LatencyHistogram::getPhaseName(const Phase phase)
+{
+    switch (phase) {
+    case PHASE_READ:        return "Read";
+    case PHASE_HASH:        return "Hash";
+    case PHASE_DB_LOOKUP:   return "DbLookup";
+    case PHASE_DB_WRITE:    return "DbWrite";
+    case PHASE_FILE_WRITE:  return "FileWrite";
+    default:                return "Unknown";
+    }
+}
+
+/**
+ * @brief LatencyHistogram::formatStats 一个阶段的统计信息显示为 "p50 / p90 / p99 / max µs (占比%)"
+ * @param stats 统计信息
+ * @return 没有计时记录时为 "-"
+ */
+QString LatencyHistogram::formatStats(const PhaseStats& stats)
+{
+    if (0 == stats.count)
+    {
+        return "-";
+    }
+    return QString("%1 / %2 / %3 / %4 µs (%5%)").arg(QString::number(stats.p50Us, 'f', 1), QString::number(stats.p90Us, 'f', 1),
+                                                     QString::number(stats.p99Us, 'f', 1), QString::number(stats.maxUs, 'f', 1),
+                                                     QString::number(stats.share, 'f', 1));
+}
+
+/**
+ * @brief LatencyHistogram::bucketOf 耗时所在的桶：最高位决定 2 的幂区间，接下来的 LATENCY_HISTOGRAM_SUB_BITS 位决定区间中的桶
+ * @param nsecs 耗时（ns）
+ * @return
+ */
+int LatencyHistogram::bucketOf(const quint64 nsecs)
+{
+    const int sub_count = 1 << LATENCY_HISTOGRAM_SUB_BITS;
+    if (nsecs < (quint64)sub_count)
+    {
+        return (int)nsecs;
+    }
+    const int msb   = 63 - qCountLeadingZeroBits(nsecs);
+    const int shift = msb - LATENCY_HISTOGRAM_SUB_BITS;
+    const int sub   = (int)((nsecs >> shift) & (sub_count - 1));
+    return (shift + 1) * sub_count + sub;
+}
+
+/**
+ * @brief LatencyHistogram::bucketUpper 桶中的最大值
+ * @param bucket 桶
+ * @return
+ */
+quint64 LatencyHistogram::bucketUpper(const int bucket)
+{
+    const int sub_count = 1 << LATENCY_HISTOGRAM_SUB_BITS;
+    if (bucket < sub_count)
+    {
+        return bucket;
+    }
+    const int shift = bucket / sub_count - 1;
+    const quint64 sub = bucket % sub_count;
+    const quint64 lower = ((quint64)sub_count + sub) << shift;
+    return lower + (((quint64)1 << shift) - 1);
+}
@@ -0,0 +1,67 @@
+#ifndef LATENCYHISTOGRAM_H
+#define LATENCYHISTOGRAM_H
+
+#include <QString>
+
+#define LATENCY_HISTOGRAM_SUB_BITS  3       // 每个 2 的幂区间再细分为 2^3 = 8 个桶（分位数的相对误差不超过 12.5%）
+#define LATENCY_HISTOGRAM_BUCKETS   ((64 - LATENCY_HISTOGRAM_SUB_BITS + 1) << LATENCY_HISTOGRAM_SUB_BITS)
+
+/**
+ * @brief 分块和恢复循环中被计时的阶段
+ */
+enum Phase {
+    PHASE_READ          = 0,    // 读取源文件 / .bkh（使用流水线时为等待流水线给出下一个块的时间）
+    PHASE_HASH          = 1,    // 计算哈希
+    PHASE_DB_LOOKUP     = 2,    // 查询哈希是否重复（哈希索引 + 数据库）/ 解析块的位置
+    PHASE_DB_WRITE      = 3,    // 插入新行、更新计数器、COPY
+    PHASE_FILE_WRITE    = 4,    // 写入 .ubk、.bkh / 恢复的文件
+    PHASE_COUNT         = 5
+};
+
+/**
+ * @brief 一个阶段的延迟统计（写入 ResultComput，单位 µs）
+ */
+struct PhaseStats
+{
+    qint64  count   = 0;        // 计时的次数
+    double  p50Us   = 0.0;
+    double  p90Us   = 0.0;
+    double  p99Us   = 0.0;
+    double  maxUs   = 0.0;
+    double  share   = 0.0;      // 这个阶段的总耗时占任务总耗时的比例（%，多线程的阶段为所有线程之和，可能超过 100%）
+};
+
+/**
+ * @brief 对数分桶的延迟直方图（ns）：小于 8 ns 的值各占一个桶，之后每个 2 的幂区间分为 8 个桶，
+ *  记录一次只需要计算最高位和一次数组自增，内存固定（约 4 KB），可以直接复制和合并。不是线程安全的
+ */
+class LatencyHistogram
+{
+public:
+    LatencyHistogram();
+
+    void record(const qint64 nsecs);
+    void merge(const LatencyHistogram& other);
+    void clear();
+
+    qint64 count() const;
+    qint64 totalNsecs() const;
+    qint64 maxNsecs() const;
+    qint64 percentile(const double p) const;
+    PhaseStats stats(const qint64 elapsed_nsecs) const;
+
+    static QString getPhaseName(const Phase phase);
+    static QString formatStats(const PhaseStats& stats);
+
+private:
+    static int bucketOf(const quint64 nsecs);
+    static quint64 bucketUpper(const int bucket);
+
+private:
+    quint64 _buckets[LATENCY_HISTOGRAM_BUCKETS];
+    qint64  _count  = 0;
+    qint64  _total  = 0;    // 所有记录之和（ns）
+    qint64  _max    = 0;
+};
+
+#endif // LATENCYHISTOGRAM_H
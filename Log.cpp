@@ -0,0 +1,35 @@
+#include "Log.h"
+
+/**
+ * @brief Log::fromName 从名称解析日志级别（不区分大小写）
+ * @param name debug、info、warning（warn）、error、off
+ * @param default_level 名称为空或者无法识别时使用的级别
+ * @return
+ */
+LogLevel Log::fromName(const QString& name, const LogLevel default_level)
+{
+    const QString n = name.trimmed().toLower();
+    if ("debug" == n)                   return LOG_LEVEL_DEBUG;
+    if ("info" == n)                    return LOG_LEVEL_INFO;
+    if ("warning" == n || "warn" == n)  return LOG_LEVEL_WARNING;
+    if ("error" == n)                   return LOG_LEVEL_ERROR;
+    if ("off" == n)                     return LOG_LEVEL_OFF;
+    return default_level;
+}
+
+/**
+ * @brief Log::getLevelName 日志级别的名称
+ * @param level 日志级别
+ * @return
+ */
+QString Log::getLevelName(const LogLevel level)
+{
+    switch (level) {
+    case LOG_LEVEL_DEBUG:   return "DEBUG";
+    case LOG_LEVEL_INFO:    return "INFO";
+    case LOG_LEVEL_WARNING: return "WARNING";
+    case LOG_LEVEL_ERROR:   return "ERROR";
+    case LOG_LEVEL_OFF:     return "OFF";
+    default:                return "UNKNOWN";
+    }
+}
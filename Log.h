@@ -0,0 +1,59 @@
+#ifndef LOG_H
+#define LOG_H
+
+#include <QDebug>
+#include <QString>
+
+#include <atomic>
+
+#define LOG_LEVEL_ENV       "BST_LOG_LEVEL"     // 环境变量：设置日志级别（debug、info、warning、error、off）
+
+/**
+ * @brief 日志级别：低于当前级别的消息不会被格式化
+ */
+enum LogLevel {
+    LOG_LEVEL_DEBUG     = 0,    // 每个块 / 每次数据库操作的消息（只用于调试，会明显拖慢测试）
+    LOG_LEVEL_INFO      = 1,    // 默认
+    LOG_LEVEL_WARNING   = 2,
+    LOG_LEVEL_ERROR     = 3,
+    LOG_LEVEL_OFF       = 4
+};
+
+/**
+ * @brief 进程内的日志级别（所有线程共用）。热路径上的消息通过下面的宏输出，
+ *  级别没有启用时只做一次原子读取和比较，不会构造 QString、不会调用 toHex()
+ */
+class Log
+{
+public:
+    static LogLevel level()
+    {
+        return (LogLevel)_level.load(std::memory_order_relaxed);
+    }
+
+    static void setLevel(const LogLevel level)
+    {
+        _level.store(level, std::memory_order_relaxed);
+    }
+
+    static bool isEnabled(const LogLevel level)
+    {
+        return level >= _level.load(std::memory_order_relaxed);
+    }
+
+    static LogLevel fromName(const QString& name, const LogLevel default_level);
+    static QString getLevelName(const LogLevel level);
+
+private:
+    static inline std::atomic<int> _level{LOG_LEVEL_INFO};
+};
+
+/* 级别启用时才计算 message 并输出到 qDebug */
+#define LOG_DEBUG(message) \
+    do { if (Log::isEnabled(LOG_LEVEL_DEBUG)) { qDebug().noquote() << (message); } } while (0)
+
+/* 级别启用时才计算 message 并保存到 target（例如 _last_log），否则清空 target，不会留下之前的消息 */
+#define LOG_LAZY(level, target, message) \
+    do { if (Log::isEnabled(level)) { (target) = (message); } else { (target).clear(); } } while (0)
+
+#endif // LOG_H
@@ -0,0 +1,480 @@
+#include "OutputFile.h"
+#include "InputFile.h"
+#include "IoEngine.h"
+
+#include <QElapsedTimer>
+#include <QtEndian>
+
+#include <cerrno>
+#include <cstring>
+
+#ifdef Q_OS_UNIX
+#include <fcntl.h>
+#include <sys/uio.h>
+#include <unistd.h>
+#endif
+
+/**
+ * @brief OutputFile::OutputFile 创建（覆盖）输出文件
+ * @param parent
+ * @param filePath 文件路径
+ * @param mode 写入方式
+ * @param buffer_size 聚合写入时暂存缓冲区的大小（Byte）
+ * @param use_writev 聚合写入时，放不下的数据是否和缓冲区中的数据用一次 writev 写入（否则先复制到缓冲区再写入）
+ * @param direct 是否绕过页缓存直接写入设备（总是聚合写入、不使用 writev；文件系统不支持时退化为普通写入）
+ */
+OutputFile::OutputFile(QObject *parent, const QString& filePath, const OutputMode mode,
+                       const size_t buffer_size, const bool use_writev, const bool direct)
+    : QObject{parent}
+    , _mode(mode)
+    , _use_writev(use_writev)
+{
+    if (filePath.isEmpty())
+    {
+        qFatal("File path is empty");
+        return;
+    }
+
+    _file.setFileName(filePath);
+    _info.setFile(_file);
+
+    /* 直接 I/O：数据只能从对齐的缓冲区写入，因此总是聚合写入 */
+    QString direct_log;
+#ifdef Q_OS_UNIX
+    if (direct)
+    {
+        const int fd = InputFile::openDirectHandle(filePath, O_WRONLY | O_CREAT | O_TRUNC);
+        if (fd >= 0 && _file.open(fd, QIODevice::WriteOnly | QIODevice::Unbuffered, QFileDevice::AutoCloseHandle))
+        {
+            _direct     = true;
+            _mode       = OutputMode::OUTPUT_AGGREGATED;
+            _use_writev = false;
+        }
+        else
+        {
+            direct_log = QString(", can not open with direct I/O (%1), fall back to page cache").arg(QString::fromLocal8Bit(std::strerror(errno)));
+            if (fd >= 0)
+            {
+                ::close(fd);
+            }
+        }
+    }
+#else
+    if (direct)
+    {
+        direct_log = QString(", direct I/O is not supported on this platform, fall back to page cache");
+    }
+#endif
+
+    /* 聚合写入时直接写文件描述符，不使用 QFile 的写缓冲区 */
+    const QIODevice::OpenMode open_mode = OutputMode::OUTPUT_AGGREGATED == _mode ? (QIODevice::WriteOnly | QIODevice::Unbuffered) : QIODevice::WriteOnly;
+    if (!_file.isOpen() && !_file.open(open_mode))
+    {
+        _last_log = QString("Can not create file %1").arg(_info.filePath());
+        return;
+    }
+
+    if (OutputMode::OUTPUT_AGGREGATED == _mode)
+    {
+        _capacity = qMax<size_t>(OUTPUT_BUFFER_ALIGNMENT, buffer_size / OUTPUT_BUFFER_ALIGNMENT * OUTPUT_BUFFER_ALIGNMENT);
+        _buffer = static_cast<char*>(qMallocAligned(_capacity, OUTPUT_BUFFER_ALIGNMENT));
+        Q_CHECK_PTR(_buffer);
+    }
+    else
+    {
+        _sout.setDevice(&_file);
+        // 设置流的版本（可以根据实际情况设置，通常用于处理跨版本兼容性）
+        _sout.setVersion(QDataStream::Qt_DefaultCompiledVersion);
+    }
+    _last_log = QString("Successed create file %1 (%2%3)").arg(_info.filePath(), getOutputModeName(_mode), _direct ? QString(", direct I/O") : direct_log);
+}
+
+OutputFile::~OutputFile()
+{
+    close();
+    qFreeAligned(_buffer);
+}
+
+bool OutputFile::isOpen()
+{
+    return _file.isOpen();
+}
+
+/**
+ * @brief OutputFile::hasError 是否有写入失败（失败之后的写入都会被忽略，lastLog() 中是失败的原因）
+ * @return
+ */
+bool OutputFile::hasError()
+{
+    return _failed;
+}
+
+OutputMode OutputFile::mode()
+{
+    return _mode;
+}
+
+/**
+ * @brief OutputFile::isDirect 文件是否以直接 I/O 方式打开
+ * @return
+ */
+bool OutputFile::isDirect()
+{
+    return _direct;
+}
+
+/**
+ * @brief OutputFile::file 底层的文件（多线程恢复时各线程用 pwrite 直接写入文件描述符，此时不能再调用 write()）
+ * @return
+ */
+QFile* OutputFile::file()
+{
+    return &_file;
+}
+
+/**
+ * @brief OutputFile::setIoEngine 聚合写入时通过异步 I/O 引擎写入（每次写入拆分为多个请求同时进行，完成后才返回）
+ * @param io I/O 引擎（不能与其他正在等待的请求共用；nullptr 表示同步写入）
+ */
+void OutputFile::setIoEngine(IoEngine* io)
+{
+    _io = io;
+}
+
+/**
+ * @brief OutputFile::write 在文件末尾写入数据（聚合写入时复制到暂存缓冲区，调用返回后 data 可以立即被重用）
+ * @param data 数据
+ * @param len 数据长度（Byte）
+ * @return 是否写入成功
+ */
+bool OutputFile::write(const char* data, const qint64 len)
+{
+    if (_failed || len <= 0)
+    {
+        return !_failed;
+    }
+
+    QElapsedTimer timer;
+    timer.start();
+    bool is_succ = true;
+    if (OutputMode::OUTPUT_STREAM == _mode)
+    {
+        is_succ = len == _sout.writeRawData(data, len);
+    }
+    else if (_used + len <= _capacity)  // 放得下：只复制
+    {
+        std::memcpy(_buffer + _used, data, len);
+        _used += len;
+        if (_used == _capacity)
+        {
+            is_succ = flush();
+        }
+    }
+    else if (_direct)  // 直接 I/O：所有数据都经过对齐的暂存缓冲区，缓冲区满时写入
+    {
+        qint64 pos = 0;
+        while (is_succ && pos < len)
+        {
+            const qint64 n = qMin<qint64>(_capacity - _used, len - pos);
+            std::memcpy(_buffer + _used, data + pos, n);
+            _used += n;
+            pos   += n;
+            if (_used == _capacity)
+            {
+                is_succ = flush();
+            }
+        }
+    }
+    else if (_use_writev)  // 放不下：缓冲区中的数据和新数据一次写入，不复制新数据
+    {
+        is_succ = writeFully(_buffer, _used, data, len);
+        _used = 0;
+    }
+    else  // 放不下：填满缓冲区、写入，剩下的数据继续放入缓冲区（超过缓冲区大小的部分直接写入）
+    {
+        const qint64 head = _capacity - _used;
+        std::memcpy(_buffer + _used, data, head);
+        _used = _capacity;
+        is_succ = flush();
+        const qint64 rest = len - head;
+        if (is_succ && rest >= (qint64)_capacity)
+        {
+            is_succ = writeFully(nullptr, 0, data + head, rest);
+        }
+        else if (is_succ)
+        {
+            std::memcpy(_buffer, data + head, rest);
+            _used = rest;
+        }
+    }
+
+    if (is_succ)
+    {
+        _bytes += len;
+    }
+    else
+    {
+        _failed = true;
+        _last_log = QString("Unable to write %1 Bytes to file %2 (%3)").arg(QString::number(len), _info.filePath(), _file.errorString());
+    }
+    _nsecs += timer.nsecsElapsed();
+    return is_succ;
+}
+
+bool OutputFile::write(const QByteArray& data)
+{
+    return write(data.constData(), data.size());
+}
+
+/**
+ * @brief OutputFile::writeBigEndian 写入一个 4 字节的无符号整数（大端，与 QDataStream << quint32 相同）
+ * @param value
+ * @return 是否写入成功
+ */
+bool OutputFile::writeBigEndian(const quint32 value)
+{
+    char buf[sizeof(quint32)];
+    qToBigEndian(value, buf);
+    return write(buf, sizeof(buf));
+}
+
+/**
+ * @brief OutputFile::flush 把暂存缓冲区中的数据写入文件（直接 I/O 时只写入对齐的部分，剩下的部分移到缓冲区开头）
+ * @return 是否写入成功
+ */
+bool OutputFile::flush()
+{
+    if (OutputMode::OUTPUT_STREAM == _mode)
+    {
+        return _file.isOpen() && _file.flush();
+    }
+    const size_t len = _direct ? _used / OUTPUT_BUFFER_ALIGNMENT * OUTPUT_BUFFER_ALIGNMENT : _used;
+    if (0 == len)
+    {
+        return !_failed;
+    }
+
+    const bool is_succ = writeFully(_buffer, len, nullptr, 0);
+    std::memmove(_buffer, _buffer + len, _used - len);
+    _used -= len;
+    if (!is_succ)
+    {
+        _failed = true;
+        _last_log = QString("Unable to write file %1 (%2)").arg(_info.filePath(), _file.errorString());
+    }
+    return is_succ;
+}
+
+/**
+ * @brief OutputFile::close 写入暂存缓冲区中剩下的数据并关闭文件（可以重复调用）
+ */
+void OutputFile::close()
+{
+    if (!_file.isOpen())
+    {
+        return;
+    }
+
+    QElapsedTimer timer;
+    timer.start();
+    flush();
+    if (_direct && !_failed && !writeDirectTail())
+    {
+        _failed = true;
+        _last_log = QString("Unable to write the tail of file %1 (%2)").arg(_info.filePath(), _file.errorString());
+    }
+    _file.close();
+    _nsecs += timer.nsecsElapsed();
+}
+
+/**
+ * @brief OutputFile::writeDirectTail 直接 I/O 时写入缓冲区中最后不足对齐长度的数据：补 0 到对齐长度写入，再把文件截断到实际大小
+ * @return 是否写入成功
+ */
+bool OutputFile::writeDirectTail()
+{
+    if (0 == _used)
+    {
+        return true;
+    }
+
+    const size_t padded = (_used + OUTPUT_BUFFER_ALIGNMENT - 1) / OUTPUT_BUFFER_ALIGNMENT * OUTPUT_BUFFER_ALIGNMENT;
+    std::memset(_buffer + _used, 0, padded - _used);
+    const qint64 file_size = _offset + _used;
+    const bool is_succ = writeFully(_buffer, padded, nullptr, 0);
+    _used = 0;
+    return is_succ && _file.resize(file_size);
+}
+
+/**
+ * @brief OutputFile::writeFully 把 buffer 和 data 两段数据按顺序写到文件末尾（两段都有数据时用一次 writev，没有 writev 的平台上
+ *  依次通过 QFile 写入），处理部分写入。
+ *  使用 I/O 引擎时两段数据都拆分为最多 IO_ENGINE_REQUEST_SIZE 字节的请求同时写入
+ * @return 是否写入成功
+ */
+bool OutputFile::writeFully(const char* buffer, const qint64 buffer_len, const char* data, const qint64 data_len)
+{
+    if (_io)
+    {
+        const char* parts[2]     = {buffer, data};
+        const qint64 part_len[2] = {buffer_len, data_len};
+        qint64 expected = 0;
+        for (int i = 0; i < 2; ++i)
+        {
+            for (qint64 pos = 0; pos < part_len[i]; pos += IO_ENGINE_REQUEST_SIZE)
+            {
+                const qint64 len = qMin<qint64>(IO_ENGINE_REQUEST_SIZE, part_len[i] - pos);
+                _io->write(_file.handle(), parts[i] + pos, len, _offset + expected, len);  // 标记为请求的长度
+                expected += len;
+            }
+        }
+        _offset += expected;
+
+        bool is_succ = true;
+        for (const IoEngine::Completion& done : _io->wait())
+        {
+            is_succ = is_succ && done.result == (qint64)done.tag;
+        }
+        return is_succ;
+    }
+
+#ifdef Q_OS_UNIX
+    struct iovec iov[2];
+    int iov_cnt = 0;
+    if (buffer_len > 0)
+    {
+        iov[iov_cnt].iov_base = const_cast<char*>(buffer);
+        iov[iov_cnt].iov_len  = buffer_len;
+        ++iov_cnt;
+    }
+    if (data_len > 0)
+    {
+        iov[iov_cnt].iov_base = const_cast<char*>(data);
+        iov[iov_cnt].iov_len  = data_len;
+        ++iov_cnt;
+    }
+
+    struct iovec* cur = iov;
+    while (iov_cnt > 0)
+    {
+        const ssize_t n = ::writev(_file.handle(), cur, iov_cnt);
+        if (n < 0)
+        {
+            if (EINTR == errno)
+            {
+                continue;
+            }
+            return false;
+        }
+
+        /* 部分写入：跳过已经写入的部分 */
+        _offset += n;
+        size_t written = n;
+        while (iov_cnt > 0 && written >= cur->iov_len)
+        {
+            written -= cur->iov_len;
+            ++cur;
+            --iov_cnt;
+        }
+        if (iov_cnt > 0)
+        {
+            cur->iov_base = static_cast<char*>(cur->iov_base) + written;
+            cur->iov_len -= written;
+        }
+    }
+    return true;
+#else
+    if (buffer_len > 0)
+    {
+        if (_file.write(buffer, buffer_len) != buffer_len)
+        {
+            return false;
+        }
+        _offset += buffer_len;
+    }
+    if (data_len > 0)
+    {
+        if (_file.write(data, data_len) != data_len)
+        {
+            return false;
+        }
+        _offset += data_len;
+    }
+    return true;
+#endif
+}
+
+/**
+ * @brief OutputFile::bytesWritten 写入的字节数
+ * @return
+ */
+qint64 OutputFile::bytesWritten()
+{
+    return _bytes;
+}
+
+/**
+ * @brief OutputFile::writeNsecs 写入（包括关闭文件时写入剩下的数据）的总耗时（ns）
+ * @return
+ */
+qint64 OutputFile::writeNsecs()
+{
+    return _nsecs;
+}
+
+/**
+ * @brief OutputFile::filePath 获取文件路径
+ * @return 文件路径
+ */
+QString OutputFile::filePath()
+{
+    return _info.filePath();
+}
+
+QString OutputFile::lastLog()
+{
+    return _last_log;
+}
+
+/**
+ * @brief OutputFile::getOutputModeName 获得写入方式名字字符串
+ * @param mode 写入方式
+ * @return
+ */
+QString OutputFile::getOutputModeName(const OutputMode mode)
+{
+    switch (mode) {
+    case OutputMode::OUTPUT_STREAM:
+        return "STREAM";
+
+    case OutputMode::OUTPUT_AGGREGATED:
+        return "AGGREGATED";
+
+    default:
+        return "NONE";
+    }
+}
+
+/**
+ * @brief OutputFile::processWriteSyscalls 整个进程到目前为止 write 类系统调用（write / writev / pwrite ...）的次数，
+ *  来自 /proc/self/io 的 syscw（不包括发往数据库的 socket send）
+ * @return 次数；不支持时返回 -1
+ */
+qint64 OutputFile::processWriteSyscalls()
+{
+    QFile io("/proc/self/io");
+    if (!io.open(QIODevice::ReadOnly | QIODevice::Text))
+    {
+        return -1;
+    }
+
+    while (!io.atEnd())
+    {
+        const QByteArray line = io.readLine();
+        if (line.startsWith("syscw:"))
+        {
+            return line.mid(6).trimmed().toLongLong();
+        }
+    }
+    return -1;
+}
@@ -0,0 +1,81 @@
+#ifndef OUTPUTFILE_H
+#define OUTPUTFILE_H
+
+#include <QObject>
+#include <QString>
+#include <QFile>
+#include <QFileInfo>
+#include <QDataStream>
+
+#define OUTPUT_BUFFER_ALIGNMENT     4096                // 暂存缓冲区的对齐（页大小）
+#define OUTPUT_DEFAULT_BUFFER_SIZE  (16 * 1024 * 1024)  // 默认暂存缓冲区大小（Byte）
+
+class IoEngine;
+
+/**
+ * @brief 输出文件的写入方式
+ */
+enum OutputMode {
+    OUTPUT_STREAM       = 0,    // 通过 QDataStream::writeRawData 逐块写入（QFile 只有很小的写缓冲区，小块时每个块几乎都是一次系统调用）
+    OUTPUT_AGGREGATED   = 1     // 先复制到大的暂存缓冲区，缓冲区满时一次写入（可选用 writev 把缓冲区和放不下的数据合并为一次系统调用）
+};
+
+/**
+ * @brief 输出文件（Unique-Block file、Block-Hash file 和恢复的文件），只能顺序写入，不是线程安全的。
+ *  聚合写入时数据在 close() / flush() 之前可能还在暂存缓冲区中。
+ *  直接 I/O 时总是聚合写入：每次只写入缓冲区中对齐的部分，最后不足对齐长度的部分在 close() 时补 0 写入再截断文件
+ */
+class OutputFile : public QObject
+{
+    Q_OBJECT
+public:
+    explicit OutputFile(QObject *parent = nullptr, const QString& filePath = nullptr,
+                        const OutputMode mode = OutputMode::OUTPUT_AGGREGATED,
+                        const size_t buffer_size = OUTPUT_DEFAULT_BUFFER_SIZE, const bool use_writev = true,
+                        const bool direct = false);
+    ~OutputFile();
+
+    bool isOpen();
+    bool hasError();
+    OutputMode mode();
+    bool isDirect();
+    QFile* file();
+    void setIoEngine(IoEngine* io);
+    bool write(const char* data, const qint64 len);
+    bool write(const QByteArray& data);
+    bool writeBigEndian(const quint32 value);
+    bool flush();
+    void close();
+    qint64 bytesWritten();
+    qint64 writeNsecs();
+    QString filePath();
+    QString lastLog();
+
+    static QString getOutputModeName(const OutputMode mode);
+    static qint64 processWriteSyscalls();
+
+private:
+    bool writeFully(const char* buffer, const qint64 buffer_len, const char* data, const qint64 data_len);
+    bool writeDirectTail();
+
+private:
+    QString _last_log;
+    QFile _file;
+    QFileInfo _info;
+    QDataStream _sout;
+
+    OutputMode _mode;
+    bool    _use_writev;
+    bool    _direct     = false;    // 绕过页缓存直接写入设备（只从对齐的暂存缓冲区写入对齐的长度）
+    IoEngine* _io       = nullptr;  // 聚合写入时把暂存缓冲区拆分为多个请求同时写入（nullptr 表示用 write / writev 同步写入）
+    qint64  _offset     = 0;        // 已经写入文件的字节数（下一次写入的位置）
+    char*   _buffer     = nullptr;  // 暂存缓冲区（聚合写入）
+    size_t  _capacity   = 0;        // 暂存缓冲区大小（Byte）
+    size_t  _used       = 0;        // 暂存缓冲区中还没有写入文件的字节数
+    bool    _failed     = false;    // 写入出错之后不再写入
+
+    qint64  _bytes      = 0;        // 写入的字节数
+    qint64  _nsecs      = 0;        // 写入的总耗时（ns，包括复制到暂存缓冲区）
+};
+
+#endif // OUTPUTFILE_H
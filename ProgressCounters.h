@@ -0,0 +1,63 @@
+#ifndef PROGRESSCOUNTERS_H
+#define PROGRESSCOUNTERS_H
+
+#include <QtGlobal>
+
+#include <atomic>
+
+#define PROGRESS_POLL_INTERVAL_MS   100     // ui 读取进度的间隔（10 Hz）
+
+/**
+ * @brief 计算任务的进度：计算线程只更新这些原子计数器（不发送信号，不进入 ui 线程的事件队列），
+ *  ui 线程用定时器每 PROGRESS_POLL_INTERVAL_MS 读取一次并刷新控件。
+ *  每个计数器单独读写（relaxed），ui 读到的几个值之间可能相差一次更新，只用于显示
+ */
+struct ProgressCounters
+{
+    std::atomic<qint64> position        {0};    // 当前任务已经处理的字节数（分块：源文件；恢复：.bkh 文件）
+    std::atomic<qint64> total           {0};    // ↑ 的最大值
+
+    /* 分块 */
+    std::atomic<qint64> fileBlocks      {0};    // 源文件一共会被分多少块（基于内容分块时在结束前为估计值）
+    std::atomic<qint64> hashRecords     {0};    // 数据表中的哈希记录条数
+    std::atomic<qint64> repeats         {0};    // 重复的块数
+    std::atomic<qint64> segNsecs        {0};    // 分块已经用的时间（ns）
+
+    /* 恢复 */
+    std::atomic<qint64> needRecover     {0};    // 需要恢复的块数
+    std::atomic<qint64> recovered       {0};    // 成功恢复的块数
+    std::atomic<qint64> unrecovered     {0};    // 无法恢复的块数
+    std::atomic<qint64> recoverNsecs    {0};    // 恢复已经用的时间（ns）
+
+    /**
+     * @brief beginSegmentation 开始分块：清空分块的计数器（恢复的计数器保持上次的结果）
+     * @param file_size 源文件大小
+     * @param file_blocks 源文件一共会被分多少块
+     */
+    void beginSegmentation(const qint64 file_size, const qint64 file_blocks)
+    {
+        position.store(0, std::memory_order_relaxed);
+        total.store(file_size, std::memory_order_relaxed);
+        fileBlocks.store(file_blocks, std::memory_order_relaxed);
+        hashRecords.store(0, std::memory_order_relaxed);
+        repeats.store(0, std::memory_order_relaxed);
+        segNsecs.store(0, std::memory_order_relaxed);
+    }
+
+    /**
+     * @brief beginRecover 开始恢复：清空恢复的计数器
+     * @param file_size .bkh 文件大小
+     * @param need_recover 需要恢复的块数
+     */
+    void beginRecover(const qint64 file_size, const qint64 need_recover)
+    {
+        position.store(0, std::memory_order_relaxed);
+        total.store(file_size, std::memory_order_relaxed);
+        needRecover.store(need_recover, std::memory_order_relaxed);
+        recovered.store(0, std::memory_order_relaxed);
+        unrecovered.store(0, std::memory_order_relaxed);
+        recoverNsecs.store(0, std::memory_order_relaxed);
+    }
+};
+
+#endif // PROGRESSCOUNTERS_H
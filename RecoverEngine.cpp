@@ -0,0 +1,366 @@
+#include "RecoverEngine.h"
+
+#include <QElapsedTimer>
+#include <QFile>
+#include <QMutexLocker>
+#include <QThread>
+
+#include <cerrno>
+
+#ifdef Q_OS_UNIX
+#include <unistd.h>
+#endif
+
+#include "InputFile.h"
+
+#define RECOVER_ENGINE_TASKS_PER_WORKER     64  // 默认每个线程对应的任务队列长度
+
+/**
+ * @brief RecoverEngine::RecoverEngine
+ * @param out 恢复文件（必须已经以写入方式打开，引擎运行期间不能再通过 QFile 写入）
+ * @param block_size 块大小（Byte），也是没有指定长度时无法恢复的块的填充长度
+ * @param num_workers 读取线程数（至少为 1）
+ * @param max_pending 任务队列的最大长度（0 表示根据线程数自动选择）
+ */
+RecoverEngine::RecoverEngine(QFile* out, const size_t block_size, const int num_workers, const size_t max_pending)
+    : _out(out)
+    , _block_size(block_size)
+    , _num_workers(qMax(1, num_workers))
+    , _blank_block(block_size, '\0')
+{
+    _max_pending = max_pending > 0 ? max_pending : (size_t)_num_workers * RECOVER_ENGINE_TASKS_PER_WORKER;
+}
+
+RecoverEngine::~RecoverEngine()
+{
+    stop();
+}
+
+/**
+ * @brief RecoverEngine::setInputMode 设置读取源文件的方式（必须在 start 之前调用）
+ * @param mode 读取方式
+ */
+void RecoverEngine::setInputMode(const InputMode mode)
+{
+    _input_mode = mode;
+}
+
+/**
+ * @brief RecoverEngine::setSourceCacheCapacity 设置每个线程最多同时打开的源文件数（必须在 start 之前调用）
+ * @param capacity 容量
+ */
+void RecoverEngine::setSourceCacheCapacity(const size_t capacity)
+{
+    _cache_capacity = capacity;
+}
+
+/**
+ * @brief RecoverEngine::setDirectIo 设置是否绕过页缓存直接读取源文件（必须在 start 之前调用；恢复文件仍然通过页缓存写入）
+ * @param direct
+ */
+void RecoverEngine::setDirectIo(const bool direct)
+{
+    _direct_io = direct;
+}
+
+/**
+ * @brief RecoverEngine::start 启动所有读取线程
+ */
+void RecoverEngine::start()
+{
+    for (int i = 0; i < _num_workers; ++i)
+    {
+        QThread* worker = QThread::create([this]() { runWorker(); });
+        worker->start();
+        _workers.append(worker);
+    }
+}
+
+/**
+ * @brief RecoverEngine::submit 提交一个恢复任务（队列已满时阻塞）
+ * @param out_offset 块在恢复文件中的位置（Byte）
+ * @param info 块在源文件中的位置（size 为 0 表示无法恢复，写入全 0 的块）
+ * @param size 块在恢复文件中的长度（0 表示与 info.size 相同；无法恢复时为 block_size）
+ */
+void RecoverEngine::submit(const qint64 out_offset, const BlockInfo& info, const qint64 size)
+{
+    qint64 len = size;
+    if (len <= 0)
+    {
+        len = info.size > 0 ? (qint64)info.size : (qint64)_block_size;
+    }
+    submitRange(info, QList<Piece>{Piece{out_offset, 0, len}});
+}
+
+/**
+ * @brief RecoverEngine::submitRange 提交一个合并读取任务（队列已满时阻塞）
+ * @param range 要读取的源文件范围（size 为 0 表示无法恢复，每个 piece 写入全 0 的块）
+ * @param pieces 范围中的每个块在恢复文件中的位置
+ */
+void RecoverEngine::submitRange(const BlockInfo& range, const QList<Piece>& pieces)
+{
+    QMutexLocker locker(&_mutex);
+    while (!_stopped && (size_t)_tasks.size() >= _max_pending)
+    {
+        _cond_space.wait(&_mutex);
+    }
+    if (_stopped)
+    {
+        return;
+    }
+
+    _tasks.append(Task{range, pieces});
+    ++_in_flight;
+    _cond_task.wakeOne();
+}
+
+/**
+ * @brief RecoverEngine::waitForDone 等待所有已经提交的任务完成
+ */
+void RecoverEngine::waitForDone()
+{
+    QMutexLocker locker(&_mutex);
+    while (!_stopped && _in_flight > 0)
+    {
+        _cond_done.wait(&_mutex);
+    }
+}
+
+/**
+ * @brief RecoverEngine::stop 等待已经提交的任务完成，然后停止所有线程（可以重复调用）
+ */
+void RecoverEngine::stop()
+{
+    waitForDone();
+    {
+        QMutexLocker locker(&_mutex);
+        _stopped = true;
+        _cond_task.wakeAll();
+        _cond_space.wakeAll();
+        _cond_done.wakeAll();
+    }
+
+    for (QThread* worker : std::as_const(_workers))
+    {
+        worker->wait();
+        delete worker;
+    }
+    _workers.clear();
+}
+
+int RecoverEngine::numWorkers() const
+{
+    return _num_workers;
+}
+
+size_t RecoverEngine::recoveredBlocks()
+{
+    QMutexLocker locker(&_mutex);
+    return _recovered;
+}
+
+size_t RecoverEngine::unrecoveredBlocks()
+{
+    QMutexLocker locker(&_mutex);
+    return _unrecovered;
+}
+
+qint64 RecoverEngine::bytesRecovered()
+{
+    QMutexLocker locker(&_mutex);
+    return _bytes;
+}
+
+/**
+ * @brief RecoverEngine::sourceCacheStats 所有线程的源文件句柄缓存的统计信息（在 stop 之后才完整）
+ * @return
+ */
+SourceFileCache::Stats RecoverEngine::sourceCacheStats()
+{
+    QMutexLocker locker(&_mutex);
+    return _cache_stats;
+}
+
+/**
+ * @brief RecoverEngine::readLatency 所有线程每次读取源文件（一个范围）的耗时分布（在 stop 之后才完整）
+ * @return
+ */
+LatencyHistogram RecoverEngine::readLatency()
+{
+    QMutexLocker locker(&_mutex);
+    return _read_latency;
+}
+
+/**
+ * @brief RecoverEngine::writeLatency 所有线程每次写入恢复文件（一个块）的耗时分布（在 stop 之后才完整）
+ * @return
+ */
+LatencyHistogram RecoverEngine::writeLatency()
+{
+    QMutexLocker locker(&_mutex);
+    return _write_latency;
+}
+
+/**
+ * @brief RecoverEngine::sourceReads 读取源文件的次数（合并读取时小于恢复的块数）
+ * @return
+ */
+size_t RecoverEngine::sourceReads()
+{
+    QMutexLocker locker(&_mutex);
+    return _reads;
+}
+
+QString RecoverEngine::lastLog()
+{
+    QMutexLocker locker(&_mutex);
+    return _last_log;
+}
+
+/**
+ * @brief RecoverEngine::runWorker 读取线程：取出任务，从源文件读取块并写到恢复文件中的对应位置
+ */
+void RecoverEngine::runWorker()
+{
+    SourceFileCache sources(_cache_capacity, _input_mode, _direct_io);  // 当前线程打开的源文件（不与其他线程共享）
+    QByteArray buf_block;
+    Task task;
+    LatencyHistogram read_latency;      // 当前线程的计时，线程退出时合并
+    LatencyHistogram write_latency;
+    QElapsedTimer timer;
+
+    while (true)
+    {
+        {
+            QMutexLocker locker(&_mutex);
+            while (!_stopped && _tasks.isEmpty())
+            {
+                _cond_task.wait(&_mutex);
+            }
+            if (_tasks.isEmpty())
+            {
+                break;
+            }
+            task = _tasks.takeFirst();
+            _cond_space.wakeOne();
+        }
+
+        /* 从源文件读取整个范围（可能出现数据库中没有记录、源文件丢失或者读取失败的情况） */
+        bool is_read = false;
+        QString log;
+        if (task.range.size > 0)
+        {
+            timer.start();
+            InputFile* source = sources.open(task.range.filePath);
+
+            if (source->isOpen())
+            {
+                buf_block.resize(task.range.size);
+                is_read = (qint64)task.range.size == source->readAt(task.range.location, buf_block.data(), task.range.size);
+            }
+            read_latency.record(timer.nsecsElapsed());
+            if (!is_read)
+            {
+                log = source->lastLog();
+            }
+        }
+
+        /* 把范围中的每个块写到恢复文件中的对应位置 */
+        size_t num_recovered = 0;
+        qint64 num_bytes = 0;
+        for (const Piece& piece : std::as_const(task.pieces))
+        {
+            timer.start();
+            if (is_read && writeAt(piece.outOffset, buf_block.constData() + piece.offset, piece.size))
+            {
+                write_latency.record(timer.nsecsElapsed());
+                ++num_recovered;
+                num_bytes += piece.size;
+                continue;
+            }
+
+            if (is_read)
+            {
+                log = QString("Unable to write recover file %1").arg(_out->fileName());
+            }
+            writeBlank(piece.outOffset, piece.size);
+            write_latency.record(timer.nsecsElapsed());
+        }
+
+        QMutexLocker locker(&_mutex);
+        _recovered   += num_recovered;
+        _unrecovered += task.pieces.size() - num_recovered;
+        _bytes       += num_bytes;
+        if (task.range.size > 0)
+        {
+            ++_reads;
+        }
+        if (!log.isEmpty())
+        {
+            _last_log = log;
+        }
+        if (0 == --_in_flight)
+        {
+            _cond_done.wakeAll();
+        }
+    }
+
+    QMutexLocker locker(&_mutex);
+    _cache_stats += sources.stats();
+    _read_latency.merge(read_latency);
+    _write_latency.merge(write_latency);
+}
+
+/**
+ * @brief RecoverEngine::writeAt 把数据写到恢复文件的指定位置（pwrite，不移动文件指针，可以在多个线程中同时调用；没有 pwrite 的平台上加锁 seek + write）
+ * @param out_offset 位置
+ * @param data 数据
+ * @param len 长度
+ * @return 是否全部写入
+ */
+bool RecoverEngine::writeAt(const qint64 out_offset, const char* data, const qint64 len)
+{
+#ifdef Q_OS_UNIX
+    qint64 total = 0;
+    while (total < len)
+    {
+        const ssize_t n = ::pwrite(_out->handle(), data + total, len - total, out_offset + total);
+        if (n < 0 && EINTR == errno)
+        {
+            continue;
+        }
+        if (n <= 0)
+        {
+            return false;
+        }
+        total += n;
+    }
+    return true;
+#else
+    QMutexLocker locker(&_out_mutex);   // 没有 pwrite 的平台上 seek + write 需要互斥
+    return _out->seek(out_offset) && _out->write(data, len) == len;
+#endif
+}
+
+/**
+ * @brief RecoverEngine::writeBlank 在恢复文件的指定位置写入 len 个 0（无法恢复的块）
+ * @param out_offset 位置
+ * @param len 长度（超过 block_size 时分多次写入）
+ * @return 是否全部写入
+ */
+bool RecoverEngine::writeBlank(const qint64 out_offset, const qint64 len)
+{
+    /* block_size 为 0 时没有填充块，临时用一段 0 填充（否则循环不会前进） */
+    const QByteArray blank = _blank_block.isEmpty() ? QByteArray(qMin<qint64>(len, 64 * 1024), '\0') : _blank_block;
+    qint64 total = 0;
+    while (total < len)
+    {
+        const qint64 n = qMin<qint64>(len - total, blank.size());
+        if (!writeAt(out_offset + total, blank.constData(), n))
+        {
+            return false;
+        }
+        total += n;
+    }
+    return true;
+}
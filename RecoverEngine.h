@@ -0,0 +1,106 @@
+#ifndef RECOVERENGINE_H
+#define RECOVERENGINE_H
+
+#include <QByteArray>
+#include <QMutex>
+#include <QWaitCondition>
+#include <QList>
+#include <QString>
+
+#include "BlockInfo.h"
+#include "InputFile.h"
+#include "LatencyHistogram.h"
+#include "SourceFileCache.h"
+
+class QFile;
+class QThread;
+
+/**
+ * @brief 多线程恢复引擎：多个线程并行地从源文件读取块，并用 pwrite 把每个块写到恢复文件中的最终位置
+ *  （由调用者根据块的顺序和长度计算），因此写入顺序与块的顺序无关，恢复的文件与逐块恢复完全相同。
+ *  每个线程各自打开需要的源文件，使用 pread 读取，不共享文件指针。
+ *  一个任务可以一次读取源文件中一段连续的范围，再把其中的多个块分别写到恢复文件中（合并读取）
+ */
+class RecoverEngine
+{
+public:
+    /**
+     * @brief 合并读取的范围中的一个块：范围内偏移 offset 处的 size 个字节写到恢复文件的 outOffset 处
+     *  （无法恢复时在 outOffset 处写入 size 个 0）
+     */
+    struct Piece
+    {
+        qint64  outOffset   = 0;
+        qint64  offset      = 0;
+        qint64  size        = 0;
+    };
+
+    RecoverEngine(QFile* out, const size_t block_size, const int num_workers, const size_t max_pending = 0);
+    ~RecoverEngine();
+
+    void setInputMode(const InputMode mode);
+    void setSourceCacheCapacity(const size_t capacity);
+    void setDirectIo(const bool direct);
+    void start();
+    void submit(const qint64 out_offset, const BlockInfo& info, const qint64 size = 0);
+    void submitRange(const BlockInfo& range, const QList<Piece>& pieces);
+    void waitForDone();
+    void stop();
+
+    int numWorkers() const;
+    size_t recoveredBlocks();
+    size_t unrecoveredBlocks();
+    qint64 bytesRecovered();
+    size_t sourceReads();
+    SourceFileCache::Stats sourceCacheStats();
+    LatencyHistogram readLatency();
+    LatencyHistogram writeLatency();
+    QString lastLog();
+
+private:
+    /**
+     * @brief 一个恢复任务：读取源文件中 range 描述的范围，把其中的每个块写到恢复文件中
+     *  （range.size 为 0 表示数据库中没有记录这些块，每个 piece 写入全 0 的块）
+     */
+    struct Task
+    {
+        BlockInfo       range;
+        QList<Piece>    pieces;
+    };
+
+    void runWorker();
+    bool writeAt(const qint64 out_offset, const char* data, const qint64 len);
+    bool writeBlank(const qint64 out_offset, const qint64 len);
+
+private:
+    QFile*      _out;
+    size_t      _block_size;
+    int         _num_workers;
+    size_t      _max_pending;
+    QByteArray  _blank_block;   // 无法恢复的块用全是 0 的数据填充
+    InputMode   _input_mode = InputMode::INPUT_BUFFERED;   // 读取源文件的方式
+    size_t      _cache_capacity = 64;   // 每个线程最多同时打开的源文件数
+    bool        _direct_io = false;     // 是否绕过页缓存直接读取源文件
+
+    QMutex          _out_mutex;     // 没有 pwrite 的平台上保护恢复文件的 seek + write
+    QMutex          _mutex;
+    QWaitCondition  _cond_task;     // 有新的任务
+    QWaitCondition  _cond_space;    // 任务队列有空位
+    QWaitCondition  _cond_done;     // 所有提交的任务都已经完成
+    QList<Task>     _tasks;         // 等待执行的任务
+    size_t          _in_flight  = 0;    // 已经提交但还没有完成的任务数
+    bool            _stopped    = false;
+
+    size_t  _recovered      = 0;    // 成功恢复的块数量
+    size_t  _unrecovered    = 0;    // 无法恢复的块数量
+    qint64  _bytes          = 0;    // 成功恢复的字节数
+    size_t  _reads          = 0;    // 读取源文件的次数
+    SourceFileCache::Stats _cache_stats;    // 所有线程的源文件句柄缓存的统计信息（线程退出时累加）
+    LatencyHistogram _read_latency;         // 所有线程每次读取源文件的耗时（线程退出时合并）
+    LatencyHistogram _write_latency;        // 所有线程每次写入恢复文件的耗时（线程退出时合并）
+    QString _last_log;
+
+    QList<QThread*> _workers;
+};
+
+#endif // RECOVERENGINE_H
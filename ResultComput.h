@@ -2,7 +2,19 @@
 #define RESULTCOMPUT_H
 
 #include <QString>
+#include <QList>
 #include "HashAlgorithm.h"
+#include "LatencyHistogram.h"
+#include "RunOptions.h"
+
+/**
+ * @brief 分块时写入吞吐量随行数变化的一个点
+ */
+struct IngestPoint
+{
+    qint64  rows            = 0;    // 这个任务已经写入块信息表的行数
+    double  blocksPerSec    = 0.0;  // 从上一个点到这个点之间的分块吞吐量（块/s，包括重复的块）
+};
 
 /**
  * @brief 用于存储计算任务的结果
@@ -17,9 +29,46 @@ struct ResultComput
     size_t  repeatRecord    =   0;      // 重复的哈希值/块数量
     double  repeatRate      =   0.0;    // 重复率
     double  segTime         =   0.0;    // 分块任务所用的时间
+    SegMode segMode         =   SegMode::SEG_ROW;  // 分块时与数据库的交互方式
+    size_t  batchSize       =   1;      // 每次数据库往返处理的块数（逐块模式为 1）
+    int     hashThreads     =   0;      // 分块时计算哈希的线程数（0 表示串行）
+    InputMode inputMode     =   InputMode::INPUT_BUFFERED;  // 读取源文件的方式
+    double  hashGBps        =   0.0;    // 哈希算法的吞吐量（GB/s，按计算哈希的总耗时计算，多线程时为单个线程的吞吐量）
+    double  indexHitRate    =   0.0;    // 进程内哈希索引的命中率（%，未使用索引时为 0）
+    double  indexBytesPerEntry = 0.0;   // 进程内哈希索引平均每条记录占用的内存（Byte）
+    ChunkMode chunkMode     =   ChunkMode::CHUNK_FIXED;     // 分块方式
+    double  avgChunkSize    =   0.0;    // 实际的平均块大小（Byte）
+    double  segMBps         =   0.0;    // 分块吞吐量（MB/s，按源文件大小计算）
+    bool    bufferPool      =   false;  // 是否使用了可重用的缓冲区池
+    double  segAllocsPerBlock = -1.0;   // 分块时平均每个块的堆分配次数（整个进程，-1 表示不支持统计）
+    OutputMode outputMode   =   OutputMode::OUTPUT_AGGREGATED;  // 写入输出文件的方式
+    qint64  segWriteSyscalls =  -1;     // 分块时 write 类系统调用的次数（整个进程，-1 表示不支持统计）
+    double  segWriteMBps    =   0.0;    // 分块时写入 .ubk 和 .bkh 的吞吐量（MB/s，按写入的总耗时计算）
+    IoEngineMode ioEngine   =   IoEngineMode::IO_ENGINE_SYNC;   // 实际使用的 I/O 引擎（io_uring 不可用时为 SYNC）
+    int     queueDepth      =   1;      // 实际使用的队列深度（同步读写为 1）
+    double  segIoInFlight   =   0.0;    // 分块时 I/O 引擎平均同时进行的读写请求数（没有选择 io_uring 时为 0）
+    bool    directIo        =   false;  // 分块时源文件、.ubk 和 .bkh 是否实际以直接 I/O 打开（文件系统不支持时为 false）
+    SchemaVersion schemaVersion = SchemaVersion::SCHEMA_V1;     // 块信息表的结构
+    qint64  tableBytes      =   -1;     // 分块结束后块信息表占用的磁盘空间（Byte，包括 TOAST，-1 表示无法获取）
+    qint64  indexBytes      =   -1;     // 分块结束后块信息表所有索引占用的磁盘空间（Byte，-1 表示无法获取）
+    int     tablePartitions =   0;      // 块信息表的哈希分区数（0 表示不分区）
+    QList<IngestPoint> ingestCurve;     // 分块吞吐量随写入行数的变化（写入的行数每翻一倍一个点）
+    IndexBackend indexBackend = IndexBackend::INDEX_POSTGRESQL; // 去重索引（块信息表）的后端
     size_t  recoveredBlock  =   0;      // 成功恢复的块数量
     double  recoveredRate   =   0.0;    // 恢复率
     double  recoveredTime   =   0.0;    // 恢复任务所用时间
+    double  recoveredMBps   =   0.0;    // 恢复速度（MB/s，按成功恢复的字节数计算）
+    int     recoverThreads  =   0;      // 恢复时读取源文件的线程数（0 表示串行）
+    double  coalesceRatio   =   0.0;    // 恢复时平均每次读取源文件读取的块数（合并读取的效果，逐块读取为 1）
+    size_t  sourceCacheHits      = 0;   // 恢复时源文件句柄缓存的命中次数
+    size_t  sourceCacheMisses    = 0;   // 恢复时源文件句柄缓存的未命中次数（打开文件的次数）
+    size_t  sourceCacheEvictions = 0;   // 恢复时因为缓存已满而关闭源文件的次数
+    double  recoverAllocsPerBlock = -1.0;   // 恢复时平均每个块的堆分配次数（整个进程，-1 表示不支持统计）
+    qint64  recoverWriteSyscalls = -1;      // 恢复时 write 类系统调用的次数（整个进程，-1 表示不支持统计）
+    double  recoverWriteMBps = -1.0;        // 逐块恢复时写入恢复的文件的吞吐量（MB/s，-1 表示多线程恢复，不统计）
+    double  recoverIoInFlight = 0.0;        // 恢复时 I/O 引擎平均同时进行的读写请求数（没有选择 io_uring 时为 0）
+    PhaseStats segPhases[PHASE_COUNT];      // 分块时每个阶段的延迟分布和耗时占比
+    PhaseStats recoverPhases[PHASE_COUNT];  // 恢复时每个阶段的延迟分布和耗时占比（恢复不计算哈希、不写数据库）
 };
 
 #endif // RESULTCOMPUT_H
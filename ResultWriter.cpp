@@ -0,0 +1,174 @@
+#include "ResultWriter.h"
+
+#include <QFile>
+#include <QTextStream>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QJsonObject>
+
+/**
+ * @brief ResultWriter::formatIngestCurve 吞吐量曲线转换为以空格分隔的 "行数:块/s"（不含逗号，可以直接写入 CSV）
+ * @param curve 吞吐量曲线
+ * @return 例如 "1024:52011.3 2048:49870.0"
+ */
+QString ResultWriter::formatIngestCurve(const QList<IngestPoint>& curve)
+{
+    QStringList points;
+    for (const IngestPoint& point : curve)
+    {
+        points.append(QString("%1:%2").arg(QString::number(point.rows), QString::number(point.blocksPerSec, 'f', 1)));
+    }
+    return points.join(' ');
+}
+
+/**
+ * @brief ResultWriter::getFields 按输出顺序列出一条结果的所有字段（字段名 -> 值）
+ * @param result 计算结果
+ * @return
+ */
+QList<QPair<QString, QVariant>> ResultWriter::getFields(const ResultComput& result)
+{
+    QList<QPair<QString, QVariant>> fields = {
+        {"sourceFilePath",      result.sourceFilePath},                             // 源文件路径
+        {"hashAlg",             Hash::getHashName(result.hashAlg)},                 // 分块/恢复所用的哈希函数
+        {"blockSize",           (qulonglong)result.blockSize},                      // 分块大小
+        {"totalBlock",          (qulonglong)result.totalBlock},                     // 源文件被分成了多少块
+        {"hashRecordDB",        (qulonglong)result.hashRecordDB},                   // 数据库数据表中中记录的哈希条数
+        {"repeatRecord",        (qulonglong)result.repeatRecord},                   // 重复的哈希值/块数量
+        {"repeatRate",          result.repeatRate},                                 // 重复率
+        {"segTime",             result.segTime},                                    // 分块任务所用的时间
+        {"segMode",             RunOptions::getSegModeName(result.segMode)},        // 分块模式
+        {"batchSize",           (qulonglong)result.batchSize},                      // 每次数据库往返处理的块数
+        {"hashThreads",         result.hashThreads},                                // 分块时计算哈希的线程数
+        {"hashGBps",            result.hashGBps},                                   // 哈希算法的吞吐量（GB/s）
+        {"inputMode",           InputFile::getInputModeName(result.inputMode)},     // 读取源文件的方式
+        {"indexHitRate",        result.indexHitRate},                               // 进程内哈希索引的命中率
+        {"indexBytesPerEntry",  result.indexBytesPerEntry},                         // 进程内哈希索引平均每条记录占用的内存
+        {"chunkMode",           RunOptions::getChunkModeName(result.chunkMode)},    // 分块方式
+        {"avgChunkSize",        result.avgChunkSize},                               // 实际的平均块大小
+        {"segMBps",             result.segMBps},                                    // 分块吞吐量（MB/s）
+        {"bufferPool",          result.bufferPool},                                 // 是否使用了可重用的缓冲区池
+        {"segAllocsPerBlock",   result.segAllocsPerBlock},                          // 分块时平均每个块的堆分配次数
+        {"outputMode",          OutputFile::getOutputModeName(result.outputMode)},  // 写入输出文件的方式
+        {"segWriteSyscalls",    result.segWriteSyscalls},                           // 分块时 write 类系统调用的次数
+        {"segWriteMBps",        result.segWriteMBps},                               // 分块时写入 .ubk 和 .bkh 的吞吐量（MB/s）
+        {"ioEngine",            IoEngine::getIoEngineModeName(result.ioEngine)},    // 实际使用的 I/O 引擎
+        {"queueDepth",          result.queueDepth},                                 // 实际使用的队列深度
+        {"segIoInFlight",       result.segIoInFlight},                              // 分块时 I/O 引擎平均同时进行的读写请求数
+        {"directIo",            result.directIo},                                   // 是否实际以直接 I/O 读写
+        {"schemaVersion",       RunOptions::getSchemaVersionName(result.schemaVersion)},  // 块信息表的结构
+        {"tableBytes",          result.tableBytes},                                 // 块信息表占用的磁盘空间（Byte）
+        {"indexBytes",          result.indexBytes},                                 // 块信息表的索引占用的磁盘空间（Byte）
+        {"tablePartitions",     result.tablePartitions},                            // 块信息表的哈希分区数
+        {"ingestCurve",         formatIngestCurve(result.ingestCurve)},             // 分块吞吐量随写入行数的变化
+        {"indexBackend",        DedupIndex::getIndexBackendName(result.indexBackend)}, // 去重索引的后端
+        {"recoveredBlock",      (qulonglong)result.recoveredBlock},                 // 成功恢复的块数量
+        {"recoveredRate",       result.recoveredRate},                              // 恢复率
+        {"recoveredTime",       result.recoveredTime},                              // 恢复任务所用时间
+        {"recoverThreads",      result.recoverThreads},                             // 恢复时读取源文件的线程数
+        {"recoveredMBps",       result.recoveredMBps},                              // 恢复速度（MB/s）
+        {"coalesceRatio",       result.coalesceRatio},                              // 平均每次读取源文件读取的块数
+        {"sourceCacheHits",     (qulonglong)result.sourceCacheHits},                // 源文件句柄缓存的命中次数
+        {"sourceCacheMisses",   (qulonglong)result.sourceCacheMisses},              // 源文件句柄缓存的未命中次数
+        {"sourceCacheEvictions",(qulonglong)result.sourceCacheEvictions},           // 因为缓存已满而关闭源文件的次数
+        {"recoverAllocsPerBlock", result.recoverAllocsPerBlock},                    // 恢复时平均每个块的堆分配次数
+        {"recoverWriteSyscalls", result.recoverWriteSyscalls},                      // 恢复时 write 类系统调用的次数
+        {"recoverWriteMBps",    result.recoverWriteMBps},                           // 逐块恢复时写入恢复的文件的吞吐量（MB/s）
+        {"recoverIoInFlight",   result.recoverIoInFlight},                          // 恢复时 I/O 引擎平均同时进行的读写请求数
+    };
+
+    /* 每个阶段的延迟分位数（µs）和耗时占比（%），例如 segReadP50Us、recoverFileWriteShare */
+    auto append_phases = [&fields](const QString& prefix, const PhaseStats* phases) {
+        for (int i = 0; i < PHASE_COUNT; ++i)
+        {
+            const QString name = prefix + LatencyHistogram::getPhaseName(Phase(i));
+            fields.append({name + "P50Us",  phases[i].p50Us});
+            fields.append({name + "P90Us",  phases[i].p90Us});
+            fields.append({name + "P99Us",  phases[i].p99Us});
+            fields.append({name + "MaxUs",  phases[i].maxUs});
+            fields.append({name + "Share",  phases[i].share});
+        }
+    };
+    append_phases("seg", result.segPhases);
+    append_phases("recover", result.recoverPhases);
+    return fields;
+}
+
+/**
+ * @brief ResultWriter::saveToCSV 所有运算结果保存为 CSV（第一行为字段名）
+ * @param path 文件路径
+ * @param results 运算结果
+ * @param error [输出] 失败的原因
+ * @return 是否成功
+ */
+bool ResultWriter::saveToCSV(const QString& path, const QList<ResultComput>& results, QString& error)
+{
+    QFile file(path);
+    if (!file.open(QIODevice::WriteOnly | QIODevice::Text))
+    {
+        error = file.errorString();
+        return false;
+    }
+
+    QTextStream out(&file);
+    QStringList header;
+    for (const auto& field : getFields(ResultComput()))
+    {
+        header.append(field.first);
+    }
+    out << header.join(',') << "\n";
+
+    /* 遍历 QList<ResultComput>，将每个 ResultComput 写入一行 CSV  */
+    for (const ResultComput& result : results)
+    {
+        const QList<QPair<QString, QVariant>> fields = getFields(result);
+        for (qsizetype i = 0; i < fields.size(); ++i)
+        {
+            const QVariant& value = fields.at(i).second;
+            if (QMetaType::Double == value.typeId())
+            {
+                out << value.toDouble();
+            }
+            else
+            {
+                out << value.toString();
+            }
+            out << (i + 1 < fields.size() ? "," : "\n");
+        }
+    }
+
+    file.close();
+    return true;
+}
+
+/**
+ * @brief ResultWriter::saveToJSON 所有运算结果保存为 JSON（数组，每条结果一个对象）
+ * @param path 文件路径
+ * @param results 运算结果
+ * @param error [输出] 失败的原因
+ * @return 是否成功
+ */
+bool ResultWriter::saveToJSON(const QString& path, const QList<ResultComput>& results, QString& error)
+{
+    QFile file(path);
+    if (!file.open(QIODevice::WriteOnly | QIODevice::Text))
+    {
+        error = file.errorString();
+        return false;
+    }
+
+    QJsonArray array;
+    for (const ResultComput& result : results)
+    {
+        QJsonObject object;
+        for (const auto& field : getFields(result))
+        {
+            object.insert(field.first, QJsonValue::fromVariant(field.second));
+        }
+        array.append(object);
+    }
+
+    file.write(QJsonDocument(array).toJson(QJsonDocument::Indented));
+    file.close();
+    return true;
+}
@@ -0,0 +1,22 @@
+#ifndef RESULTWRITER_H
+#define RESULTWRITER_H
+
+#include <QList>
+#include <QPair>
+#include <QString>
+#include <QVariant>
+
+#include "ResultComput.h"
+
+/**
+ * @brief 把计算任务的结果保存为 CSV 或 JSON（图形界面和命令行共用，两种格式的字段名和顺序相同）
+ */
+struct ResultWriter
+{
+    static QString formatIngestCurve(const QList<IngestPoint>& curve);
+    static QList<QPair<QString, QVariant>> getFields(const ResultComput& result);
+    static bool saveToCSV(const QString& path, const QList<ResultComput>& results, QString& error);
+    static bool saveToJSON(const QString& path, const QList<ResultComput>& results, QString& error);
+};
+
+#endif // RESULTWRITER_H
@@ -0,0 +1,197 @@
+#ifndef RUNOPTIONS_H
+#define RUNOPTIONS_H
+
+#include <QString>
+#include <QList>
+#include <QStringList>
+
+#include "BlockInfo.h"
+#include "DedupIndex.h"
+#include "InputFile.h"
+#include "OutputFile.h"
+#include "IoEngine.h"
+
+/**
+ * @brief 分块任务与数据库的交互方式
+ */
+enum SegMode {
+    SEG_ROW   = 0,  // 逐块：每个块一次 SELECT + 一次 INSERT/UPDATE
+    SEG_BATCH = 1,  // 分批：每 N 个块一次集合查询 + 一次批量 INSERT + 一次批量 UPDATE
+    SEG_COPY  = 2   // 批量导入（仅用于空表）：在内存中去重，新行通过 COPY ... FROM STDIN (FORMAT binary) 每 N 行写入一次
+};
+
+/**
+ * @brief 源文件的分块方式
+ */
+enum ChunkMode {
+    CHUNK_FIXED  = 0,   // 固定大小分块：每 block_size 个字节一块
+    CHUNK_CDC    = 1    // 基于内容的分块（FastCDC）：block_size 为平均块大小，块的大小在 [block_size / 最小块除数, block_size * 最大块倍数] 之间
+};
+
+/**
+ * @brief 计算任务的可选运行参数（由 UI 或基准测试设置，在开始任务前发送给子线程）
+ */
+struct RunOptions
+{
+    SegMode segMode     =   SegMode::SEG_ROW;   // 分块模式
+    size_t  batchSize   =   1024;               // SEG_BATCH 模式下每批处理的块数；SEG_COPY 模式下每次 COPY 写入的行数
+    bool    compareIngest   =   false;          // 基准测试中每个块大小额外以 ROW 和 COPY 模式各运行一次，对比写入性能
+    bool    useHashIndex    =   false;          // 使用进程内哈希索引，已知的哈希不再查询数据库，计数器在内存中累计并在最后写入
+    bool    preloadHashIndex=   false;          // 开始分块前从数据表预加载所有哈希到索引（之后未命中的哈希不再查询数据库）
+    int     hashThreads     =   0;              // 分块时计算哈希的线程数（0 表示在计算线程中串行读取并计算哈希）
+    int     recoverThreads  =   0;              // 恢复时并行读取源文件的线程数（0 表示逐块串行恢复）
+    size_t  recoverWindow   =   4096;           // 恢复时每次读取并解析位置的哈希条数
+    bool    bulkResolve     =   true;           // 恢复时每个窗口用一次集合查询解析所有哈希的位置（否则每个哈希一次查询）
+    bool    sortedRecover   =   false;          // 恢复时把每个窗口中的块按 (源文件, 位置) 排序并合并相邻的块，一次顺序读取
+    InputMode inputMode     =   InputMode::INPUT_BUFFERED;  // 读取源文件的方式（分块和恢复）
+    bool    compareInput    =   false;          // 基准测试中每个块大小额外以另一种读取方式运行一次，对比普通读取和内存映射
+    size_t  sourceCacheCapacity = 64;           // 恢复时（每个线程）最多同时打开的源文件数
+    ChunkMode chunkMode     =   ChunkMode::CHUNK_FIXED;     // 分块方式
+    size_t  cdcMinDivisor   =   4;              // 基于内容分块时，最小块大小 = 平均块大小 / cdcMinDivisor
+    size_t  cdcMaxMultiplier=   4;              // 基于内容分块时，最大块大小 = 平均块大小 * cdcMaxMultiplier
+    bool    compareChunking =   false;          // 基准测试中每个块大小额外以另一种分块方式运行一次，对比重复率和吞吐量
+    bool    useBufferPool   =   true;           // 串行分块和恢复时把数据读入可重用的缓冲区池，块和哈希都是缓冲区的视图（不为每个块分配堆内存）
+    bool    compareBufferPool = false;          // 基准测试中每个块大小额外以相反的缓冲区池设置运行一次，对比每个块的堆分配次数
+    OutputMode outputMode   =   OutputMode::OUTPUT_AGGREGATED;  // 写入 .ubk、.bkh 和恢复的文件的方式
+    size_t  outputBufferMB  =   16;             // 聚合写入时每个输出文件的暂存缓冲区大小（MB）
+    bool    outputWritev    =   true;           // 聚合写入时放不下的数据和缓冲区中的数据用一次 writev 写入（不复制）
+    bool    compareOutput   =   false;          // 基准测试中每个块大小额外以另一种写入方式运行一次，对比写入的系统调用次数和吞吐量
+    IoEngineMode ioEngine   =   IoEngineMode::IO_ENGINE_SYNC;   // 分块读取源文件、逐块恢复读取源文件以及聚合写入输出文件时使用的 I/O 引擎
+    int     queueDepth      =   32;             // io_uring 的队列深度（同时进行的最大请求数）
+    QList<int> benchmarkQueueDepths;            // 基准测试中每个块大小额外以 io_uring 和这些队列深度各运行一次（第一个块大小的结果画在队列深度图表上）
+    bool    directIo        =   false;          // 以 O_DIRECT 打开源文件、.ubk、.bkh 和恢复的文件（绕过页缓存，macOS 上为 F_NOCACHE）
+    SchemaVersion schemaVersion = SchemaVersion::SCHEMA_V1;     // 块信息表的结构（v2 使用单独的表，表名以 _v2 结尾）
+    bool    compareSchema   =   false;          // 基准测试中每个块大小额外以另一种表结构运行一次，对比表和索引的大小以及查询延迟
+    int     dbConnections   =   1;              // 数据库连接池的大小（计算线程使用默认连接，其余连接由工作线程使用；恢复时不批量解析则并行查询窗口中的哈希）
+    int     tablePartitions =   0;              // 新建的块信息表按 block_hash 哈希分区的分区数（0 表示不分区，表名以 _p<分区数> 结尾）
+    bool    comparePartitions = false;          // 基准测试中每个块大小额外以另一种表布局（分区 / 不分区）运行一次，对比吞吐量随行数的变化
+    IndexBackend indexBackend = IndexBackend::INDEX_POSTGRESQL;  // 去重索引（块信息表）的后端（SQLite 和哈希表文件不需要连接数据库）
+    QString indexPath;                          // SQLite 数据库文件或者哈希表文件的目录（为空时使用 .bkh 所在目录中的 SQLITE_INDEX_FILE_NAME / HASHFILE_INDEX_DIR_NAME）
+    bool    compareIndex    =   false;          // 基准测试中每个块大小额外以其他去重索引后端各运行一次（没有连接数据库时不包括 PostgreSQL）
+
+    /**
+     * @brief getCdcMinSize 基于内容分块时的最小块大小
+     * @param avg_size 平均块大小
+     * @return
+     */
+    size_t getCdcMinSize(const size_t avg_size) const
+    {
+        return qMax<size_t>(1, avg_size / qMax<size_t>(1, cdcMinDivisor));
+    }
+
+    /**
+     * @brief getCdcMaxSize 基于内容分块时的最大块大小
+     * @param avg_size 平均块大小
+     * @return
+     */
+    size_t getCdcMaxSize(const size_t avg_size) const
+    {
+        return avg_size * qMax<size_t>(1, cdcMaxMultiplier);
+    }
+
+    /**
+     * @brief getOutputBufferSize 聚合写入时每个输出文件的暂存缓冲区大小
+     * @return 缓冲区大小（Byte）
+     */
+    size_t getOutputBufferSize() const
+    {
+        return qMax<size_t>(1, outputBufferMB) * 1024 * 1024;
+    }
+
+    /**
+     * @brief parseQueueDepths 解析逗号分隔的队列深度列表（忽略无效的值）
+     * @param text 例如 "1,2,4,8"
+     * @return
+     */
+    static QList<int> parseQueueDepths(const QString& text)
+    {
+        QList<int> depths;
+        for (const QString& item : text.split(',', Qt::SkipEmptyParts))
+        {
+            bool is_ok = false;
+            const int depth = item.trimmed().toInt(&is_ok);
+            if (is_ok && depth > 0 && depth <= IO_ENGINE_MAX_QUEUE_DEPTH && !depths.contains(depth))
+            {
+                depths.append(depth);
+            }
+        }
+        return depths;
+    }
+
+    /**
+     * @brief joinQueueDepths 把队列深度列表转为逗号分隔的字符串（parseQueueDepths 的逆操作）
+     * @param depths
+     * @return
+     */
+    static QString joinQueueDepths(const QList<int>& depths)
+    {
+        QStringList items;
+        for (const int depth : depths)
+        {
+            items.append(QString::number(depth));
+        }
+        return items.join(',');
+    }
+
+    /**
+     * @brief getSegModeName 获得分块模式名字字符串
+     * @param mode 分块模式
+     * @return
+     */
+    static QString getSegModeName(const SegMode mode)
+    {
+        switch (mode) {
+        case SegMode::SEG_ROW:
+            return "ROW";
+
+        case SegMode::SEG_BATCH:
+            return "BATCH";
+
+        case SegMode::SEG_COPY:
+            return "COPY";
+
+        default:
+            return "NONE";
+        }
+    }
+
+    /**
+     * @brief getSchemaVersionName 获得块信息表结构名字字符串
+     * @param version 表结构
+     * @return
+     */
+    static QString getSchemaVersionName(const SchemaVersion version)
+    {
+        switch (version) {
+        case SchemaVersion::SCHEMA_V1:
+            return "V1";
+
+        case SchemaVersion::SCHEMA_V2:
+            return "V2";
+
+        default:
+            return "NONE";
+        }
+    }
+
+    /**
+     * @brief getChunkModeName 获得分块方式名字字符串
+     * @param mode 分块方式
+     * @return
+     */
+    static QString getChunkModeName(const ChunkMode mode)
+    {
+        switch (mode) {
+        case ChunkMode::CHUNK_FIXED:
+            return "FIXED";
+
+        case ChunkMode::CHUNK_CDC:
+            return "CDC";
+
+        default:
+            return "NONE";
+        }
+    }
+};
+
+#endif // RUNOPTIONS_H
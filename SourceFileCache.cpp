@@ -0,0 +1,108 @@
+#include "SourceFileCache.h"
+
+SourceFileCache::Stats& SourceFileCache::Stats::operator+=(const Stats& other)
+{
+    hits      += other.hits;
+    misses    += other.misses;
+    evictions += other.evictions;
+    return *this;
+}
+
+/**
+ * @brief SourceFileCache::SourceFileCache
+ * @param capacity 最多同时打开的文件数（至少为 1）
+ * @param mode 打开文件的方式
+ * @param direct 是否绕过页缓存直接读取
+ */
+SourceFileCache::SourceFileCache(const size_t capacity, const InputMode mode, const bool direct)
+    : _capacity(qMax<size_t>(1, capacity))
+    , _mode(mode)
+    , _direct(direct)
+{
+    _files.reserve(_capacity);
+}
+
+SourceFileCache::~SourceFileCache()
+{
+    clear();
+}
+
+/**
+ * @brief SourceFileCache::open 获取指定路径的源文件，没有打开过的文件会被打开并加入缓存
+ * @param file_path 文件路径（不能为空）
+ * @return 文件（可能打开失败，调用者需要检查 isOpen()；打开失败的文件同样会被缓存，避免反复尝试）。
+ *  指针在下一次 open 或 clear 之前有效
+ */
+InputFile* SourceFileCache::open(const QString& file_path)
+{
+    ++_tick;
+
+    auto it = _files.find(file_path);
+    if (_files.end() != it)
+    {
+        ++_stats.hits;
+        it->lastUse = _tick;
+        return it->file;
+    }
+
+    ++_stats.misses;
+    if ((size_t)_files.size() >= _capacity)
+    {
+        evictLeastRecentlyUsed();
+    }
+
+    Entry entry;
+    entry.file    = new InputFile(nullptr, file_path, _mode, _direct);
+    entry.lastUse = _tick;
+    _files.insert(file_path, entry);
+    return entry.file;
+}
+
+/**
+ * @brief SourceFileCache::clear 关闭所有文件（不清空统计信息）
+ */
+void SourceFileCache::clear()
+{
+    for (const Entry& entry : std::as_const(_files))
+    {
+        delete entry.file;
+    }
+    _files.clear();
+}
+
+size_t SourceFileCache::capacity() const
+{
+    return _capacity;
+}
+
+size_t SourceFileCache::size() const
+{
+    return _files.size();
+}
+
+const SourceFileCache::Stats& SourceFileCache::stats() const
+{
+    return _stats;
+}
+
+/**
+ * @brief SourceFileCache::evictLeastRecentlyUsed 关闭最久没有使用的文件（只在未命中并且缓存已满时调用，遍历的代价与容量成正比）
+ */
+void SourceFileCache::evictLeastRecentlyUsed()
+{
+    auto lru = _files.begin();
+    for (auto it = _files.begin(); it != _files.end(); ++it)
+    {
+        if (it->lastUse < lru->lastUse)
+        {
+            lru = it;
+        }
+    }
+
+    if (_files.end() != lru)
+    {
+        delete lru->file;
+        _files.erase(lru);
+        ++_stats.evictions;
+    }
+}
@@ -0,0 +1,60 @@
+#ifndef SOURCEFILECACHE_H
+#define SOURCEFILECACHE_H
+
+#include <QHash>
+#include <QString>
+
+#include "InputFile.h"
+
+/**
+ * @brief 恢复时使用的源文件句柄缓存：按文件路径缓存已经打开的 InputFile（或内存映射），
+ *  最多同时打开 capacity 个文件，超过时关闭最久没有使用的文件（LRU）。
+ *  不是线程安全的，多线程恢复时每个线程使用自己的缓存
+ */
+class SourceFileCache
+{
+public:
+    /**
+     * @brief 缓存的统计信息
+     */
+    struct Stats
+    {
+        size_t  hits        = 0;    // 命中次数（文件已经打开）
+        size_t  misses      = 0;    // 未命中次数（需要打开文件）
+        size_t  evictions   = 0;    // 因为缓存已满而关闭文件的次数
+
+        Stats& operator+=(const Stats& other);
+    };
+
+    explicit SourceFileCache(const size_t capacity, const InputMode mode = InputMode::INPUT_BUFFERED, const bool direct = false);
+    ~SourceFileCache();
+
+    InputFile* open(const QString& file_path);
+    void clear();
+
+    size_t capacity() const;
+    size_t size() const;
+    const Stats& stats() const;
+
+private:
+    /**
+     * @brief 缓存中的一个文件
+     */
+    struct Entry
+    {
+        InputFile*  file    = nullptr;
+        quint64     lastUse = 0;    // 最后一次使用的时间（_tick）
+    };
+
+    void evictLeastRecentlyUsed();
+
+private:
+    QHash<QString, Entry>   _files;     // 文件路径 -> 打开的文件
+    size_t      _capacity;              // 最多同时打开的文件数
+    InputMode   _mode;                  // 打开文件的方式
+    bool        _direct;                // 是否以直接 I/O 方式打开文件
+    quint64     _tick   = 0;            // 每次访问加 1，用于判断最久没有使用的文件
+    Stats       _stats;
+};
+
+#endif // SOURCEFILECACHE_H
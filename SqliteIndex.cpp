@@ -0,0 +1,1142 @@
+#include "SqliteIndex.h"
+#include "Log.h"
+
+#include <QSqlQuery>
+#include <QSqlError>
+#include <QFile>
+#include <QFileInfo>
+#include <QStringList>
+
+SqliteIndex::SqliteIndex()
+{
+}
+
+SqliteIndex::~SqliteIndex()
+{
+    _thread_state.setLocalData(nullptr);  // 析构线程的连接在这里关闭，其他使用过连接的线程应该已经结束
+    close();
+    qDeleteAll(_conns);
+    LOG_DEBUG("SqliteIndex::~SqliteIndex auto close");
+}
+
+/**
+ * @brief SqliteIndex::open 打开（不存在时创建）数据库文件，调用线程立即打开连接并设置 WAL 模式，其他线程第一次使用时打开各自的连接
+ * @param path 数据库文件路径
+ * @return 是否成功
+ */
+bool SqliteIndex::open(const QString& path)
+{
+    ThreadState& s = state();
+    const QString abs_path = QFileInfo(path).absoluteFilePath();
+    if (abs_path == filePath() && isOpen())
+    {
+        s.lastLog = QString("SQLite index %1 is already open").arg(abs_path);
+        return true;
+    }
+
+    {
+        QMutexLocker locker(&_conn_mutex);
+        _path = abs_path;
+    }
+    _generation.fetch_add(1, std::memory_order_relaxed);
+    clearFileCache();  // 字典的编号只在同一个数据库文件中有效
+
+    if (!openConnection(s))
+    {
+        return false;
+    }
+    s.lastLog = QString("Successed open SQLite index %1 (WAL, synchronous NORMAL, cache %2 MB, mmap %3 MB)").arg(
+        abs_path, QString::number(SQLITE_CACHE_SIZE_KB / 1024), QString::number(SQLITE_MMAP_SIZE / 1048576));
+    return true;
+}
+
+/**
+ * @brief SqliteIndex::close 关闭调用线程的连接，其他线程的连接在下一次使用时发现数据库文件已经关闭
+ */
+void SqliteIndex::close()
+{
+    if (_thread_state.hasLocalData())
+    {
+        closeConnection(state());
+    }
+    {
+        QMutexLocker locker(&_conn_mutex);
+        _path.clear();
+    }
+    _generation.fetch_add(1, std::memory_order_relaxed);
+    clearFileCache();
+}
+
+/**
+ * @brief SqliteIndex::removeDatabaseFile 关闭并删除数据库文件（以及 WAL 和共享内存文件）
+ * @return 是否成功删除
+ */
+bool SqliteIndex::removeDatabaseFile()
+{
+    ThreadState& s = state();
+    const QString path = filePath();
+    if (path.isEmpty())
+    {
+        s.lastLog = "Can not remove SQLite index: no database file is open";
+        return false;
+    }
+
+    close();
+    QFile::remove(path + "-wal");
+    QFile::remove(path + "-shm");
+    if (!QFile::remove(path))
+    {
+        s.lastLog = QString("Failed to remove SQLite index %1").arg(path);
+        return false;
+    }
+    s.lastLog = QString("Successed remove SQLite index %1").arg(path);
+    return true;
+}
+
+QString SqliteIndex::filePath()
+{
+    QMutexLocker locker(&_conn_mutex);
+    return _path;
+}
+
+IndexBackend SqliteIndex::backend() const
+{
+    return IndexBackend::INDEX_SQLITE;
+}
+
+/**
+ * @brief SqliteIndex::isOpen 数据库文件是否已经打开。调用线程第一次调用（或者数据库文件变化之后）时打开自己的连接
+ * @return
+ */
+bool SqliteIndex::isOpen()
+{
+    ThreadState& s = state();
+    if (nullptr != s.conn && s.generation == _generation.load(std::memory_order_relaxed))
+    {
+        return true;
+    }
+    return openConnection(s);
+}
+
+/**
+ * @brief SqliteIndex::setPoolSize 每个线程总是使用自己的连接，忽略连接数
+ * @param size
+ */
+void SqliteIndex::setPoolSize(const int size)
+{
+    Q_UNUSED(size)
+}
+
+/**
+ * @brief SqliteIndex::connectionStats 每个连接的查询次数（没有连接池，等待时间总是 0）
+ * @return
+ */
+QList<DbConnectionStats> SqliteIndex::connectionStats()
+{
+    QList<DbConnectionStats> stats;
+    QMutexLocker locker(&_conn_mutex);
+    for (const Connection* conn : std::as_const(_conns))
+    {
+        DbConnectionStats stat;
+        stat.name    = conn->name;
+        stat.queries = conn->queries.load(std::memory_order_relaxed);
+        stats.append(stat);
+    }
+    return stats;
+}
+
+void SqliteIndex::resetConnectionStats()
+{
+    QMutexLocker locker(&_conn_mutex);
+    for (Connection* conn : std::as_const(_conns))
+    {
+        conn->queries.store(0, std::memory_order_relaxed);
+    }
+}
+
+/**
+ * @brief SqliteIndex::state 调用线程的状态（第一次调用时创建，线程结束时删除）
+ * @return
+ */
+SqliteIndex::ThreadState& SqliteIndex::state()
+{
+    if (!_thread_state.hasLocalData())
+    {
+        ThreadState* s = new ThreadState;
+        s->index = this;
+        _thread_state.setLocalData(s);
+    }
+    return *_thread_state.localData();
+}
+
+SqliteIndex::ThreadState::~ThreadState()
+{
+    index->closeConnection(*this);
+}
+
+/**
+ * @brief SqliteIndex::openConnection 在调用线程中打开当前数据库文件的连接（Qt 的连接只能在打开它的线程中使用），并设置连接的参数：
+ *  journal_mode = WAL      读不阻塞写，写入只追加到 WAL
+ *  synchronous = NORMAL    WAL 模式下只在 checkpoint 时 fsync（断电可能丢失最后的事务，但数据库不会损坏）
+ *  temp_store = MEMORY     排序、临时索引在内存中
+ *  cache_size / mmap_size  更大的页缓存，读取时直接访问映射的文件
+ * @param s 调用线程的状态
+ * @return 是否成功
+ */
+bool SqliteIndex::openConnection(ThreadState& s)
+{
+    closeConnection(s);  // 数据库文件已经变化的旧连接
+
+    const int generation = _generation.load(std::memory_order_relaxed);
+    Connection* conn = nullptr;
+    QString path;
+    {
+        QMutexLocker locker(&_conn_mutex);
+        path = _path;
+        if (path.isEmpty())
+        {
+            s.lastLog = "SQLite index is not open";
+            return false;
+        }
+        for (Connection* c : std::as_const(_conns))
+        {
+            if (!c->inUse)
+            {
+                conn = c;
+                break;
+            }
+        }
+        if (nullptr == conn)
+        {
+            conn = new Connection;
+            conn->name = QString(SQLITE_CONN_PREFIX "%1").arg(_conns.size());
+            _conns.append(conn);
+        }
+        conn->inUse = true;
+    }
+
+    conn->db = QSqlDatabase::addDatabase("QSQLITE", conn->name);
+    conn->db.setDatabaseName(path);
+    conn->db.setConnectOptions(QString("QSQLITE_BUSY_TIMEOUT=%1").arg(SQLITE_BUSY_TIMEOUT_MS));
+    s.conn       = conn;
+    s.generation = generation;
+    if (!conn->db.open())
+    {
+        s.lastLog = QString("Cannot open SQLite index %1: %2").arg(path, conn->db.lastError().text());
+        closeConnection(s);
+        return false;
+    }
+
+    const QStringList pragmas = {
+        "PRAGMA journal_mode = WAL",
+        "PRAGMA synchronous = NORMAL",
+        "PRAGMA temp_store = MEMORY",
+        QString("PRAGMA cache_size = -%1").arg(SQLITE_CACHE_SIZE_KB),   // 负数单位为 KiB
+        QString("PRAGMA mmap_size = %1").arg(SQLITE_MMAP_SIZE)
+    };
+    QSqlQuery q(conn->db);
+    for (const QString& pragma : pragmas)
+    {
+        s.lastSql = pragma;
+        if (!exec(s, q, pragma))
+        {
+            s.lastLog = QString("Failed to configure SQLite index %1: %2").arg(path, q.lastError().text());
+            q.finish();
+            closeConnection(s);
+            return false;
+        }
+    }
+    return true;
+}
+
+/**
+ * @brief SqliteIndex::closeConnection 关闭调用线程的连接（连接对象保留，给之后的线程使用）
+ * @param s 调用线程的状态
+ */
+void SqliteIndex::closeConnection(ThreadState& s)
+{
+    Connection* conn = s.conn;
+    if (nullptr == conn)
+    {
+        return;
+    }
+
+    s.conn = nullptr;
+    conn->db.close();
+    conn->db = QSqlDatabase();
+    QSqlDatabase::removeDatabase(conn->name);
+    QMutexLocker locker(&_conn_mutex);
+    conn->inUse = false;
+}
+
+/**
+ * @brief SqliteIndex::exec 执行查询并计入调用线程的连接的查询次数
+ * @param s 调用线程的状态
+ * @param q 查询（已经 prepare 时 sql 为空）
+ * @param sql 要执行的 SQL 语句
+ * @return 是否执行成功
+ */
+bool SqliteIndex::exec(ThreadState& s, QSqlQuery& q, const QString& sql)
+{
+    s.conn->queries.fetch_add(1, std::memory_order_relaxed);
+    return sql.isEmpty() ? q.exec() : q.exec(sql);
+}
+
+/**
+ * @brief SqliteIndex::finishTransaction 成功时提交调用线程的事务，否则回滚
+ * @param s 调用线程的状态
+ * @param is_succ 事务中的操作是否都成功
+ * @return 是否成功提交
+ */
+bool SqliteIndex::finishTransaction(ThreadState& s, const bool is_succ)
+{
+    if (!is_succ)
+    {
+        s.conn->db.rollback();
+        return false;
+    }
+    if (!s.conn->db.commit())
+    {
+        s.lastLog = QString("Failed to commit transaction: %1").arg(s.conn->db.lastError().text());
+        s.conn->db.rollback();
+        return false;
+    }
+    return true;
+}
+
+void SqliteIndex::setSchemaVersion(const SchemaVersion version)
+{
+    _schema = version;
+}
+
+SchemaVersion SqliteIndex::schemaVersion() const
+{
+    return _schema;
+}
+
+/**
+ * @brief SqliteIndex::setPartitionCount SQLite 不支持分区，忽略分区数
+ * @param partitions
+ */
+void SqliteIndex::setPartitionCount(const int partitions)
+{
+    Q_UNUSED(partitions)
+}
+
+int SqliteIndex::partitionCount() const
+{
+    return 0;
+}
+
+/**
+ * @brief SqliteIndex::createBlockInfoTable 在数据库文件中创建指定名称的块信息表（按当前的表结构）
+ * @param tbName 要创建的表名
+ * @param hashSize 哈希值的长度（Byte），v2 表结构用 CHECK 约束哈希列为定长；0 表示不限制
+ * @return 是否成功创建
+ */
+bool SqliteIndex::createBlockInfoTable(const QString& tbName, const size_t hashSize)
+{
+    ThreadState& s = state();
+    if (!isOpen())
+    {
+        return false;
+    }
+
+    QString sql;
+    if (SchemaVersion::SCHEMA_V2 == _schema)
+    {
+        if (!createFilesTable())
+        {
+            return false;
+        }
+
+        // 哈希为主键的 WITHOUT ROWID 表：行按哈希存放在主键的 B 树中，查询哈希只需要一次 B 树查找，没有单独的索引
+        sql = QString("CREATE TABLE %1 ("
+                      "block_hash BLOB NOT NULL PRIMARY KEY%2,"
+                      "file_id INTEGER NOT NULL,"
+                      "block_loc INTEGER NOT NULL,"
+                      "block_size INTEGER NOT NULL,"
+                      "counter INTEGER NOT NULL DEFAULT 1) WITHOUT ROWID;").arg(
+            tbName, hashSize > 0 ? QString(" CHECK (length(block_hash) = %1)").arg(QString::number(hashSize)) : QString());
+    }
+    else
+    {
+        // SQLite 的 INTEGER 为 64 位，位置不需要 NUMERIC
+        sql = QString("CREATE TABLE %1 ("
+                      "block_hash BLOB NOT NULL UNIQUE,"
+                      "source_file_path TEXT NOT NULL,"
+                      "block_loc INTEGER NOT NULL,"
+                      "block_size INTEGER NOT NULL,"
+                      "counter INTEGER NOT NULL DEFAULT 1);").arg(tbName);
+    }
+    s.lastSql = sql;
+    LOG_DEBUG(QString("Create table `%1`").arg(tbName));
+    LOG_DEBUG(QString("↳ Run SQL: %1").arg(sql));
+
+    QSqlQuery q(s.conn->db);
+    if (exec(s, q, sql))
+    {
+        s.lastLog = QString("Successed create table `%1` (SQLite, schema v%2)").arg(tbName, QString::number(_schema));
+        return true;
+    }
+
+    s.lastLog = QString("Failed to create table `%1`: %2").arg(tbName, q.lastError().text());
+    return false;
+}
+
+/**
+ * @brief SqliteIndex::createFilesTable 创建 v2 表结构的源文件字典表（已经存在时不做任何事）
+ * @return 是否成功
+ */
+bool SqliteIndex::createFilesTable()
+{
+    ThreadState& s = state();
+    QString sql = "CREATE TABLE IF NOT EXISTS " V2_FILES_TABLE " ("
+                  "file_id INTEGER PRIMARY KEY,"
+                  "path TEXT NOT NULL UNIQUE);";
+    s.lastSql = sql;
+
+    QSqlQuery q(s.conn->db);
+    if (exec(s, q, sql))
+    {
+        return true;
+    }
+
+    s.lastLog = QString("Failed to create table `%1`: %2").arg(QString(V2_FILES_TABLE), q.lastError().text());
+    return false;
+}
+
+/**
+ * @brief SqliteIndex::getFileId 源文件在字典表中的编号（字典中没有时插入），结果会被缓存
+ * @param sourceFilePath 源文件路径
+ * @param pending 在事务中调用时不为空：新的编号先放在这里，事务提交之后再由调用者放入缓存
+ *  （事务回滚时插入的编号也被撤销，不能让其他线程从缓存中拿到它）
+ * @return 编号，-1 表示失败
+ */
+int SqliteIndex::getFileId(const QString& sourceFilePath, QHash<QString, int>* pending)
+{
+    {
+        QMutexLocker locker(&_file_mutex);
+        const auto it = _file_ids.constFind(sourceFilePath);
+        if (it != _file_ids.constEnd())
+        {
+            return it.value();
+        }
+    }
+    if (pending && pending->contains(sourceFilePath))
+    {
+        return pending->value(sourceFilePath);
+    }
+
+    ThreadState& s = state();
+    QSqlQuery q(s.conn->db);
+    QString sql = "INSERT OR IGNORE INTO " V2_FILES_TABLE " (path) VALUES (?)";
+    s.lastSql = sql;
+    q.prepare(sql);
+    q.addBindValue(sourceFilePath);
+    if (!exec(s, q))
+    {
+        s.lastLog = QString("Failed to get id of source file %1: %2").arg(sourceFilePath, q.lastError().text());
+        return -1;
+    }
+
+    sql = "SELECT file_id FROM " V2_FILES_TABLE " WHERE path = ?";
+    s.lastSql = sql;
+    q.prepare(sql);
+    q.addBindValue(sourceFilePath);
+    if (!exec(s, q) || !q.next())
+    {
+        s.lastLog = QString("Failed to get id of source file %1: %2").arg(sourceFilePath, q.lastError().text());
+        return -1;
+    }
+
+    const int file_id = q.value(0).toInt();
+    if (pending)
+    {
+        pending->insert(sourceFilePath, file_id);
+        return file_id;
+    }
+    QMutexLocker locker(&_file_mutex);
+    _file_ids.insert(sourceFilePath, file_id);
+    _file_paths.insert(file_id, sourceFilePath);
+    return file_id;
+}
+
+/**
+ * @brief SqliteIndex::getFilePath 字典表中编号对应的源文件路径。缓存中没有时重新加载整个字典（字典表很小）
+ * @param fileId 编号
+ * @return 源文件路径，未知的编号返回空字符串
+ */
+QString SqliteIndex::getFilePath(const int fileId)
+{
+    {
+        QMutexLocker locker(&_file_mutex);
+        const auto it = _file_paths.constFind(fileId);
+        if (it != _file_paths.constEnd())
+        {
+            return it.value();
+        }
+    }
+
+    ThreadState& s = state();
+    QSqlQuery q(s.conn->db);
+    q.setForwardOnly(true);
+    QString sql = "SELECT file_id, path FROM " V2_FILES_TABLE;
+    s.lastSql = sql;
+    if (!exec(s, q, sql))
+    {
+        s.lastLog = QString("Failed to load source files from table %1: %2").arg(QString(V2_FILES_TABLE), q.lastError().text());
+        return QString();
+    }
+
+    QMutexLocker locker(&_file_mutex);
+    while (q.next())
+    {
+        const int id = q.value(0).toInt();
+        const QString path = q.value(1).toString();
+        _file_ids.insert(path, id);
+        _file_paths.insert(id, path);
+    }
+    return _file_paths.value(fileId);
+}
+
+void SqliteIndex::clearFileCache()
+{
+    QMutexLocker locker(&_file_mutex);
+    _file_ids.clear();
+    _file_paths.clear();
+}
+
+/**
+ * @brief SqliteIndex::migrateBlockInfoTableToV2 把 v1 表结构的块信息表复制为 v2 表结构的新表（在一个事务中，失败时不留下新表），原表保持不变
+ * @param v1TbName v1 表名
+ * @param v2TbName 新建的 v2 表名（不能已经存在）
+ * @param hashSize 哈希值的长度（Byte），0 表示不限制
+ * @return 是否成功
+ */
+bool SqliteIndex::migrateBlockInfoTableToV2(const QString& v1TbName, const QString& v2TbName, const size_t hashSize)
+{
+    ThreadState& s = state();
+    if (!isOpen())
+    {
+        return false;
+    }
+
+    if (!s.conn->db.transaction())
+    {
+        s.lastLog = QString("Failed to migrate table %1: %2").arg(v1TbName, s.conn->db.lastError().text());
+        return false;
+    }
+
+    const SchemaVersion schema = _schema;
+    _schema = SchemaVersion::SCHEMA_V2;
+    bool is_succ = createBlockInfoTable(v2TbName, hashSize);
+    _schema = schema;
+
+    QSqlQuery q(s.conn->db);
+    if (is_succ)
+    {
+        QString sql = QString("INSERT OR IGNORE INTO " V2_FILES_TABLE " (path) SELECT DISTINCT source_file_path FROM %1").arg(v1TbName);
+        s.lastSql = sql;
+        is_succ = exec(s, q, sql);
+    }
+    if (is_succ)
+    {
+        QString sql = QString("INSERT INTO %1 (block_hash, file_id, block_loc, block_size, counter) "
+                              "SELECT t.block_hash, f.file_id, t.block_loc, t.block_size, t.counter "
+                              "FROM %2 AS t JOIN " V2_FILES_TABLE " AS f ON f.path = t.source_file_path").arg(v2TbName, v1TbName);
+        s.lastSql = sql;
+        is_succ = exec(s, q, sql);
+    }
+
+    const QString error = q.lastError().text().isEmpty() ? s.lastLog : q.lastError().text();
+    const int rows = q.numRowsAffected();
+    if (!finishTransaction(s, is_succ))
+    {
+        s.lastLog = QString("Failed to migrate table %1 to %2: %3").arg(v1TbName, v2TbName, is_succ ? s.lastLog : error);
+        return false;
+    }
+
+    s.lastLog = QString("Successed migrate %1 rows from table %2 to %3 (SQLite, schema v2)").arg(QString::number(rows), v1TbName, v2TbName);
+    return true;
+}
+
+/**
+ * @brief SqliteIndex::getTableSize 表和所有索引占用的页的大小（通过 dbstat 虚拟表，SQLite 编译时需要 SQLITE_ENABLE_DBSTAT_VTAB）。
+ *  v2 表没有单独的索引（主键即表）
+ * @param tbName 表名
+ * @param tableBytes [输出] 表的大小（Byte）
+ * @param indexBytes [输出] 索引的大小（Byte）
+ * @return 是否成功
+ */
+bool SqliteIndex::getTableSize(const QString& tbName, qint64& tableBytes, qint64& indexBytes)
+{
+    ThreadState& s = state();
+    tableBytes = -1;
+    indexBytes = -1;
+    if (!isOpen())
+    {
+        return false;
+    }
+
+    QSqlQuery q(s.conn->db);
+    QString sql = "SELECT COALESCE(sum(CASE WHEN name = ? THEN pgsize END), 0), COALESCE(sum(CASE WHEN name = ? THEN 0 ELSE pgsize END), 0) "
+                  "FROM dbstat WHERE name = ? OR name IN (SELECT name FROM sqlite_master WHERE type = 'index' AND tbl_name = ?)";
+    s.lastSql = sql;
+    q.prepare(sql);
+    for (int i = 0; i < 4; ++i)
+    {
+        q.addBindValue(tbName);
+    }
+
+    if (!exec(s, q) || !q.next())
+    {
+        s.lastLog = QString("Failed to get size of table %1: %2").arg(tbName, q.lastError().text());
+        return false;
+    }
+
+    tableBytes = q.value(0).toLongLong();
+    indexBytes = q.value(1).toLongLong();
+    s.lastLog = QString("Table %1: %2 Bytes, indexes %3 Bytes").arg(tbName, QString::number(tableBytes), QString::number(indexBytes));
+    return true;
+}
+
+/**
+ * @brief SqliteIndex::deleteTable 删除指定名称的表
+ * @param tbName 要删除的表名
+ * @return 是否成功删除
+ */
+bool SqliteIndex::deleteTable(const QString& tbName)
+{
+    ThreadState& s = state();
+    if (!isOpen())
+    {
+        return false;
+    }
+
+    QString sql = QString("DROP TABLE IF EXISTS %1;").arg(tbName);
+    s.lastSql = sql;
+    LOG_DEBUG(QString("Delete table `%1`").arg(tbName));
+
+    QSqlQuery q(s.conn->db);
+    if (exec(s, q, sql))
+    {
+        s.lastLog = QString("Successfully deleted table `%1`").arg(tbName);
+        return true;
+    }
+
+    s.lastLog = QString("Failed to delete table `%1`: %2").arg(tbName, q.lastError().text());
+    return false;
+}
+
+/**
+ * @brief SqliteIndex::isTableExists 指定表名的表是否存在
+ * @param tbName 表名
+ * @return 如果表存在，返回 true；否则返回 false
+ */
+bool SqliteIndex::isTableExists(const QString& tbName)
+{
+    ThreadState& s = state();
+    if (!isOpen())
+    {
+        return false;
+    }
+
+    QSqlQuery q(s.conn->db);
+    QString sql = "SELECT EXISTS (SELECT 1 FROM sqlite_master WHERE type = 'table' AND name = ?)";
+    s.lastSql = sql;
+    q.prepare(sql);
+    q.addBindValue(tbName);
+
+    if (exec(s, q) && q.next())
+    {
+        const bool exists = q.value(0).toBool();
+        s.lastLog = exists ? QString("Table %1 exists").arg(tbName)
+                           : QString("Table %1 does not exist").arg(tbName);
+        return exists;
+    }
+
+    s.lastLog = QString("Failed to check is table %1 exists: %2").arg(tbName, q.lastError().text());
+    return false;
+}
+
+/**
+ * @brief SqliteIndex::insertNewBlockInfoRow 插入新的块信息行
+ * @param tbName 表名
+ * @param blockHash 块的哈希值
+ * @param sourceFilePath 块所在文件的路径
+ * @param blockLoc 块在源文件中的位置（第几字节）
+ * @param blockSize 块的大小（Byte）
+ * @return
+ */
+bool SqliteIndex::insertNewBlockInfoRow(const QString& tbName, const QByteArray& blockHash,
+                                        const QString& sourceFilePath, const qint64 blockLoc, const int blockSize)
+{
+    return insertNewBlockInfoRows(tbName, {blockHash}, sourceFilePath, {blockLoc}, {blockSize}, {1});
+}
+
+/**
+ * @brief SqliteIndex::getHashRepeatTimes 获取该哈希值在表中的重复次数
+ * @param tbName 表名
+ * @param blockHash 哈希值
+ * @return 重复次数：-1 表示查询失败，否则为重复次数
+ */
+int SqliteIndex::getHashRepeatTimes(const QString& tbName, const QByteArray& blockHash)
+{
+    ThreadState& s = state();
+    if (!isOpen())
+    {
+        return -1;
+    }
+
+    QSqlQuery q(s.conn->db);
+    QString sql = QString("SELECT counter FROM %1 WHERE block_hash = ?").arg(tbName);
+    s.lastSql = sql;
+    q.prepare(sql);
+    q.addBindValue(blockHash);
+
+    if (!exec(s, q))
+    {
+        s.lastLog = QString("Failed to get HashRepeatTimes: %1").arg(q.lastError().text());
+        return -1;
+    }
+
+    if (q.next())
+    {
+        const int counter = q.value(0).toInt();
+        LOG_LAZY(LOG_LEVEL_DEBUG, s.lastLog, QString("Find the same hash, repeat times: %1").arg(counter));
+        return counter;
+    }
+    LOG_LAZY(LOG_LEVEL_DEBUG, s.lastLog, QStringLiteral("Do not have same hash"));
+    return 0;
+}
+
+/**
+ * @brief SqliteIndex::updateCounter 更新表的 counter 字段（哈希值重复次数）
+ * @param tbName 表名
+ * @param blockHash 块的哈希值
+ * @param count 新的重复次数
+ * @return 是否更新成功
+ */
+bool SqliteIndex::updateCounter(const QString& tbName, const QByteArray& blockHash, int count)
+{
+    ThreadState& s = state();
+    if (!isOpen())
+    {
+        return false;
+    }
+
+    QSqlQuery q(s.conn->db);
+    QString sql = QString("UPDATE %1 SET counter = ? WHERE block_hash = ?").arg(tbName);
+    s.lastSql = sql;
+    q.prepare(sql);
+    q.addBindValue(count);
+    q.addBindValue(blockHash);
+
+    if (!exec(s, q))
+    {
+        s.lastLog = QString("Update failure: %1").arg(q.lastError().text());
+        return false;
+    }
+    if (q.numRowsAffected() > 0)
+    {
+        LOG_LAZY(LOG_LEVEL_DEBUG, s.lastLog, QString("Update Counter successful! Number of rows affected: %1").arg(q.numRowsAffected()));
+        return true;
+    }
+
+    s.lastLog = "No matching hash found, Counter update failed";
+    return false;
+}
+
+/**
+ * @brief SqliteIndex::getTableRowCount 获取表有多少条记录
+ * @param tbName 表名
+ * @return 行数（负数代表异常）
+ */
+int SqliteIndex::getTableRowCount(const QString& tbName)
+{
+    ThreadState& s = state();
+    if (!isOpen())
+    {
+        return -1;
+    }
+
+    QString sql = QString("SELECT COUNT(*) FROM %1").arg(tbName);
+    s.lastSql = sql;
+    QSqlQuery q(s.conn->db);
+    if (!exec(s, q, sql))
+    {
+        s.lastLog = QString("Failed get row count of table `%1`: %2").arg(tbName, q.lastError().text());
+        return -2;
+    }
+
+    if (q.next())
+    {
+        const int row_count = q.value(0).toInt();
+        s.lastLog = QString("Successed get row count of table `%1`, COUNT = %2").arg(tbName, QString::number(row_count));
+        return row_count;
+    }
+    return 0;
+}
+
+/**
+ * @brief SqliteIndex::getBlockInfo 根据块的哈希值获得块的信息（包含的信息可用于恢复源数据）
+ * @param tbName 表名
+ * @param blockHash 块的哈希值
+ * @return 查询失败或没有找到时为空的 BlockInfo（size 为 0）
+ */
+BlockInfo SqliteIndex::getBlockInfo(const QString& tbName, const QByteArray& blockHash)
+{
+    QList<BlockInfo> infos;
+    if (!getBlockInfos(tbName, {blockHash}, infos))
+    {
+        return BlockInfo();
+    }
+    return infos.first();
+}
+
+/**
+ * @brief SqliteIndex::getBlockInfos 获取一批哈希值对应的块信息（每个不同的哈希执行一次预编译的查询）
+ * @param tbName 表名
+ * @param blockHashes 哈希值列表（可以包含重复的哈希）
+ * @param infos [输出] 与 blockHashes 一一对应的块信息；表中没有记录的哈希对应空的 BlockInfo（size 为 0）
+ * @return 是否查询成功
+ */
+bool SqliteIndex::getBlockInfos(const QString& tbName, const QList<QByteArray>& blockHashes, QList<BlockInfo>& infos)
+{
+    ThreadState& s = state();
+    infos.clear();
+    infos.resize(blockHashes.size());
+
+    if (!isOpen())
+    {
+        return false;
+    }
+
+    if (blockHashes.isEmpty())
+    {
+        return true;
+    }
+
+    QSqlQuery q(s.conn->db);
+    q.setForwardOnly(true);
+    const bool is_v2 = SchemaVersion::SCHEMA_V2 == _schema;
+    QString sql = QString("SELECT %1, block_loc, block_size FROM %2 WHERE block_hash = ?").arg(QString(is_v2 ? "file_id" : "source_file_path"), tbName);
+    s.lastSql = sql;
+    q.prepare(sql);
+
+    QHash<QByteArray, BlockInfo> found;
+    size_t num_found = 0;
+    for (const QByteArray& hash : blockHashes)
+    {
+        if (found.contains(hash))
+        {
+            continue;
+        }
+
+        q.bindValue(0, hash);
+        if (!exec(s, q))
+        {
+            s.lastLog = QString("Failed to retrieve block infos of batch from table %1: %2").arg(tbName, q.lastError().text());
+            infos.fill(BlockInfo());
+            return false;
+        }
+
+        BlockInfo info;
+        if (q.next())
+        {
+            info.filePath = is_v2 ? getFilePath(q.value(0).toInt()) : q.value(0).toString();
+            info.location = q.value(1).toLongLong();
+            info.size     = q.value(2).toUInt();
+            ++num_found;
+        }
+        found.insert(hash, info);
+    }
+
+    for (qsizetype i = 0; i < blockHashes.size(); ++i)
+    {
+        infos[i] = found.value(blockHashes.at(i));
+    }
+
+    LOG_LAZY(LOG_LEVEL_DEBUG, s.lastLog, QString("Retrieved block info of %1 of %2 distinct hashes from table %3").arg(
+        QString::number(num_found), QString::number(found.size()), tbName));
+    return true;
+}
+
+/**
+ * @brief SqliteIndex::getHashRepeatTimesBatch 获取一批哈希值在表中的重复次数（每个哈希执行一次预编译的查询）
+ * @param tbName 表名
+ * @param blockHashes 哈希值列表（可以包含重复的哈希）
+ * @param repeatTimes [输出] 表中已存在的哈希 -> 重复次数；不在表中的哈希不会出现在结果中
+ * @return 是否查询成功
+ */
+bool SqliteIndex::getHashRepeatTimesBatch(const QString& tbName, const QList<QByteArray>& blockHashes,
+                                          QHash<QByteArray, int>& repeatTimes)
+{
+    ThreadState& s = state();
+    repeatTimes.clear();
+
+    if (!isOpen())
+    {
+        return false;
+    }
+
+    if (blockHashes.isEmpty())
+    {
+        return true;
+    }
+
+    QSqlQuery q(s.conn->db);
+    q.setForwardOnly(true);
+    QString sql = QString("SELECT counter FROM %1 WHERE block_hash = ?").arg(tbName);
+    s.lastSql = sql;
+    q.prepare(sql);
+
+    for (const QByteArray& hash : blockHashes)
+    {
+        q.bindValue(0, hash);
+        if (!exec(s, q))
+        {
+            s.lastLog = QString("Failed to get HashRepeatTimes of batch: %1").arg(q.lastError().text());
+            repeatTimes.clear();
+            return false;
+        }
+        if (q.next())
+        {
+            repeatTimes.insert(hash, q.value(0).toInt());
+        }
+    }
+
+    LOG_LAZY(LOG_LEVEL_DEBUG, s.lastLog, QString("Find %1 of %2 hashes in table %3").arg(QString::number(repeatTimes.size()), QString::number(blockHashes.size()), tbName));
+    return true;
+}
+
+/**
+ * @brief SqliteIndex::insertNewBlockInfoRows 在一个事务中插入一批新的块信息行
+ * @param tbName 表名
+ * @param blockHashes 块的哈希值（不能有重复）
+ * @param sourceFilePath 块所在文件的路径（同一批的块在同一个文件中）
+ * @param blockLocs 块在文件中的位置（第几字节）
+ * @param blockSizes 块的大小（Byte）
+ * @param counters 块的重复次数
+ * @return 是否插入成功（失败时整批都不插入）
+ */
+bool SqliteIndex::insertNewBlockInfoRows(const QString& tbName, const QList<QByteArray>& blockHashes,
+                                         const QString& sourceFilePath, const QList<qint64>& blockLocs,
+                                         const QList<int>& blockSizes, const QList<int>& counters)
+{
+    QList<BlockRecord> records;
+    records.reserve(blockHashes.size());
+    if (blockHashes.size() != blockLocs.size()
+        || blockHashes.size() != blockSizes.size()
+        || blockHashes.size() != counters.size())
+    {
+        state().lastLog = QString("Failed to insert new rows to table %1: size of arguments do not match").arg(tbName);
+        return false;
+    }
+
+    for (qsizetype i = 0; i < blockHashes.size(); ++i)
+    {
+        BlockRecord record;
+        record.hash          = blockHashes.at(i);
+        record.info.filePath = sourceFilePath;
+        record.info.location = blockLocs.at(i);
+        record.info.size     = blockSizes.at(i);
+        record.counter       = counters.at(i);
+        records.append(record);
+    }
+    return copyBlockRecords(tbName, records);
+}
+
+/**
+ * @brief SqliteIndex::addCounters 在一个事务中为一批哈希值增加重复次数
+ * @param tbName 表名
+ * @param blockHashes 块的哈希值
+ * @param increments 每个哈希值 counter 的增量
+ * @return 是否更新成功
+ */
+bool SqliteIndex::addCounters(const QString& tbName, const QList<QByteArray>& blockHashes, const QList<int>& increments)
+{
+    ThreadState& s = state();
+    if (!isOpen())
+    {
+        return false;
+    }
+
+    if (blockHashes.size() != increments.size())
+    {
+        s.lastLog = QString("Update failure: size of arguments do not match");
+        return false;
+    }
+
+    if (blockHashes.isEmpty())
+    {
+        return true;
+    }
+
+    if (!s.conn->db.transaction())
+    {
+        s.lastLog = QString("Update failure: %1").arg(s.conn->db.lastError().text());
+        return false;
+    }
+
+    QSqlQuery q(s.conn->db);
+    QString sql = QString("UPDATE %1 SET counter = counter + ? WHERE block_hash = ?").arg(tbName);
+    s.lastSql = sql;
+    q.prepare(sql);
+
+    bool is_succ = true;
+    for (qsizetype i = 0; i < blockHashes.size() && is_succ; ++i)
+    {
+        q.bindValue(0, increments.at(i));
+        q.bindValue(1, blockHashes.at(i));
+        is_succ = exec(s, q);
+    }
+    if (!is_succ)
+    {
+        s.lastLog = QString("Update failure: %1").arg(q.lastError().text());
+    }
+    q.finish();
+    if (!finishTransaction(s, is_succ))
+    {
+        return false;
+    }
+
+    LOG_LAZY(LOG_LEVEL_DEBUG, s.lastLog, QString("Update Counter successful! Number of rows: %1").arg(blockHashes.size()));
+    return true;
+}
+
+/**
+ * @brief SqliteIndex::copyBlockRecords 在一个事务中批量写入块信息（SQLite 没有 COPY，这是它最快的批量写入方式）。
+ *  与 COPY 相同，表中不能已经存在相同的哈希值，否则整批写入失败
+ * @param tbName 表名
+ * @param records 要写入的块信息（哈希值不能重复）
+ * @return 是否写入成功
+ */
+bool SqliteIndex::copyBlockRecords(const QString& tbName, const QList<BlockRecord>& records)
+{
+    ThreadState& s = state();
+    if (!isOpen())
+    {
+        return false;
+    }
+
+    if (records.isEmpty())
+    {
+        return true;
+    }
+
+    if (!s.conn->db.transaction())
+    {
+        s.lastLog = QString("Failed to insert new rows to table %1: %2").arg(tbName, s.conn->db.lastError().text());
+        return false;
+    }
+
+    const bool is_v2 = SchemaVersion::SCHEMA_V2 == _schema;
+    QSqlQuery q(s.conn->db);
+    QString sql = is_v2 ? QString("INSERT INTO %1 (block_hash, file_id, block_loc, block_size, counter) VALUES (?, ?, ?, ?, ?)").arg(tbName)
+                        : QString("INSERT INTO %1 (block_hash, source_file_path, block_loc, block_size, counter) VALUES (?, ?, ?, ?, ?)").arg(tbName);
+    s.lastSql = sql;
+    q.prepare(sql);
+
+    bool is_succ = true;
+    QString last_path;
+    int file_id = 0;
+    QHash<QString, int> new_file_ids;  // 事务中插入字典的编号（提交之后才放入缓存）
+    for (qsizetype i = 0; i < records.size() && is_succ; ++i)
+    {
+        const BlockRecord& record = records.at(i);
+        if (is_v2 && (0 == i || record.info.filePath != last_path))
+        {
+            last_path = record.info.filePath;
+            file_id = getFileId(last_path, &new_file_ids);
+            if (file_id < 0)
+            {
+                is_succ = false;
+                break;
+            }
+        }
+
+        q.bindValue(0, record.hash);
+        if (is_v2)
+        {
+            q.bindValue(1, file_id);
+        }
+        else
+        {
+            q.bindValue(1, record.info.filePath);
+        }
+        q.bindValue(2, record.info.location);
+        q.bindValue(3, (qint64)record.info.size);
+        q.bindValue(4, record.counter);
+        is_succ = exec(s, q);
+        if (!is_succ)
+        {
+            s.lastLog = QString("Failed to insert new rows to table %1: %2").arg(tbName, q.lastError().text());
+        }
+    }
+    q.finish();
+    if (!finishTransaction(s, is_succ))
+    {
+        return false;
+    }
+
+    if (!new_file_ids.isEmpty())
+    {
+        QMutexLocker locker(&_file_mutex);
+        for (auto it = new_file_ids.constBegin(); it != new_file_ids.constEnd(); ++it)
+        {
+            _file_ids.insert(it.key(), it.value());
+            _file_paths.insert(it.value(), it.key());
+        }
+    }
+
+    LOG_LAZY(LOG_LEVEL_DEBUG, s.lastLog, QString("Successed insert %1 new rows to table %2").arg(QString::number(records.size()), tbName));
+    return true;
+}
+
+/**
+ * @brief SqliteIndex::forEachHashCounter 遍历表中所有的哈希值和重复次数（用于预加载内存中的哈希索引）
+ * @param tbName 表名
+ * @param callback 每一行调用一次：callback(哈希值, 重复次数)
+ * @return 是否查询成功
+ */
+bool SqliteIndex::forEachHashCounter(const QString& tbName, const std::function<void(const QByteArray&, int)>& callback)
+{
+    ThreadState& s = state();
+    if (!isOpen())
+    {
+        return false;
+    }
+
+    QSqlQuery q(s.conn->db);
+    q.setForwardOnly(true);
+    QString sql = QString("SELECT block_hash, counter FROM %1").arg(tbName);
+    s.lastSql = sql;
+
+    if (!exec(s, q, sql))
+    {
+        s.lastLog = QString("Failed to load hashes from table %1: %2").arg(tbName, q.lastError().text());
+        return false;
+    }
+
+    size_t rows = 0;
+    while (q.next())
+    {
+        callback(q.value(0).toByteArray(), q.value(1).toInt());
+        ++rows;
+    }
+
+    s.lastLog = QString("Successed load %1 hashes from table %2").arg(QString::number(rows), tbName);
+    return true;
+}
+
+QString SqliteIndex::lastSQL()
+{
+    return state().lastSql;
+}
+
+QString SqliteIndex::lastLog()
+{
+    return state().lastLog;
+}
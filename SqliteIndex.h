@@ -0,0 +1,134 @@
+#ifndef SQLITEINDEX_H
+#define SQLITEINDEX_H
+
+#include "DedupIndex.h"
+
+#include <QSqlDatabase>
+#include <QMutex>
+#include <QThreadStorage>
+
+#include <atomic>
+
+class QSqlQuery;
+
+#define SQLITE_INDEX_FILE_NAME      "block_index.sqlite"    // 没有指定数据库文件时，在 .bkh 所在的目录中使用这个文件
+#define SQLITE_CONN_PREFIX          "bst_sqlite_"           // 每个线程的连接的名字前缀（之后是连接的编号）
+#define SQLITE_BUSY_TIMEOUT_MS      30000                   // 其他连接正在写入时等待写锁的最长时间
+#define SQLITE_CACHE_SIZE_KB        (64 * 1024)             // 每个连接的页缓存（PRAGMA cache_size，KiB）
+#define SQLITE_MMAP_SIZE            (256LL * 1024 * 1024)   // 通过内存映射读取的数据库文件大小（PRAGMA mmap_size，Byte）
+
+/**
+ * @brief 去重索引的嵌入式 SQLite 实现：块信息表保存在一个本地数据库文件中（不需要数据库服务器，查询没有网络往返），
+ *  以 WAL 模式打开（读不阻塞写，提交时只追加 WAL，synchronous = NORMAL 只在 checkpoint 时 fsync）。
+ *  表结构与 PostgreSQL 相同（v2 表以哈希为主键、WITHOUT ROWID，行直接存放在主键的 B 树中），不支持分区和 COPY：
+ *  批量查询重复执行同一条预编译语句，批量写入在一个事务中重复执行。每个线程第一次使用时打开自己的连接，线程结束时关闭
+ */
+class SqliteIndex : public DedupIndex
+{
+public:
+    SqliteIndex();
+    ~SqliteIndex();
+
+    /* 数据库文件（应该在没有其他线程使用连接时调用） */
+    bool open(const QString& path);
+    void close();
+    bool removeDatabaseFile();
+    QString filePath();
+
+    IndexBackend backend() const override;
+    bool isOpen() override;
+
+    /* 连接（每个线程一个连接，没有连接数的限制） */
+    void setPoolSize(const int size) override;
+    QList<DbConnectionStats> connectionStats() override;
+    void resetConnectionStats() override;
+
+    /* 表结构 */
+    void setSchemaVersion(const SchemaVersion version) override;
+    SchemaVersion schemaVersion() const override;
+    void setPartitionCount(const int partitions) override;
+    int partitionCount() const override;
+
+    /* 表相关操作 */
+    bool createBlockInfoTable(const QString& tbName, const size_t hashSize = 0) override;
+    bool migrateBlockInfoTableToV2(const QString& v1TbName, const QString& v2TbName, const size_t hashSize = 0) override;
+    bool getTableSize(const QString& tbName, qint64& tableBytes, qint64& indexBytes) override;
+    bool deleteTable(const QString& tbName) override;
+    bool isTableExists(const QString& tbName) override;
+    bool insertNewBlockInfoRow(const QString& tbName, const QByteArray& blockHash,
+                               const QString& sourceFilePath, const qint64 blockLoc, const int blockSize) override;
+    int getHashRepeatTimes(const QString& tbName, const QByteArray& blockHash) override;
+    bool updateCounter(const QString& tbName, const QByteArray& blockHash, int count) override;
+    int getTableRowCount(const QString& tbName) override;
+    BlockInfo getBlockInfo(const QString& tbName, const QByteArray& blockHash) override;
+
+    /* 批量操作（没有网络往返，重复执行预编译语句；写入在一个事务中） */
+    bool getBlockInfos(const QString& tbName, const QList<QByteArray>& blockHashes, QList<BlockInfo>& infos) override;
+    bool getHashRepeatTimesBatch(const QString& tbName, const QList<QByteArray>& blockHashes,
+                                 QHash<QByteArray, int>& repeatTimes) override;
+    bool insertNewBlockInfoRows(const QString& tbName, const QList<QByteArray>& blockHashes,
+                                const QString& sourceFilePath, const QList<qint64>& blockLocs,
+                                const QList<int>& blockSizes, const QList<int>& counters) override;
+    bool addCounters(const QString& tbName, const QList<QByteArray>& blockHashes, const QList<int>& increments) override;
+    bool copyBlockRecords(const QString& tbName, const QList<BlockRecord>& records) override;
+    bool forEachHashCounter(const QString& tbName, const std::function<void(const QByteArray&, int)>& callback) override;
+
+    /* 日志相关（调用线程最后执行的 SQL 语句和日志消息） */
+    QString lastSQL() override;
+    QString lastLog() override;
+
+private:
+    Q_DISABLE_COPY(SqliteIndex)
+
+    /**
+     * @brief 一个线程的连接（关闭后保留，用于统计和给之后的线程复用编号）
+     */
+    struct Connection
+    {
+        QString             name;
+        QSqlDatabase        db;
+        bool                inUse       = false;    // 是否被某个线程使用（由 _conn_mutex 保护）
+        std::atomic<qint64> queries     {0};
+    };
+
+    /**
+     * @brief 每个线程的状态：使用的连接、最后执行的 SQL 语句和日志消息。线程结束时析构并关闭连接
+     */
+    struct ThreadState
+    {
+        SqliteIndex*    index   = nullptr;
+        Connection*     conn    = nullptr;
+        int             generation = 0;     // 打开连接时数据库文件的版本（与 _generation 不同时重新打开）
+        QString         lastSql;
+        QString         lastLog;
+
+        ~ThreadState();
+    };
+
+    ThreadState& state();
+    bool openConnection(ThreadState& s);
+    void closeConnection(ThreadState& s);
+    bool exec(ThreadState& s, QSqlQuery& q, const QString& sql = QString());
+    bool finishTransaction(ThreadState& s, const bool is_succ);
+
+    bool createFilesTable();
+    int getFileId(const QString& sourceFilePath, QHash<QString, int>* pending = nullptr);
+    QString getFilePath(const int fileId);
+    void clearFileCache();
+
+private:
+    SchemaVersion _schema = SchemaVersion::SCHEMA_V1;
+
+    QMutex              _conn_mutex;    // 保护 _path 和 _conns
+    QString             _path;          // 数据库文件路径（空表示没有打开）
+    QList<Connection*>  _conns;
+    std::atomic<int>    _generation {0};    // 每次打开、关闭数据库文件时加一，线程据此发现自己的连接已经过期（不需要加锁）
+    QThreadStorage<ThreadState*> _thread_state;
+
+    /* v2 源文件字典的缓存（路径 <-> 编号）。由 _file_mutex 保护 */
+    QMutex              _file_mutex;
+    QHash<QString, int> _file_ids;
+    QHash<int, QString> _file_paths;
+};
+
+#endif // SQLITEINDEX_H
@@ -1,4 +1,5 @@
 #include "mainwindow.h"
+#include "Log.h"
 
 #include <QApplication>
 
@@ -7,6 +8,7 @@ int main(int argc, char *argv[])
     QApplication a(argc, argv);
     a.setWindowIcon(QIcon(":/icons/logo.png"));
 
+    Log::setLevel(Log::fromName(qEnvironmentVariable(LOG_LEVEL_ENV), LOG_LEVEL_INFO));  // 每个块的调试日志需要通过环境变量打开
     qDebug() << "Available drivers:" << QSqlDatabase::drivers();
 
     MainWindow w;
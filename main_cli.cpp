@@ -0,0 +1,16 @@
+#include "CliRunner.h"
+
+#include <QCoreApplication>
+
+int main(int argc, char *argv[])
+{
+    QCoreApplication a(argc, argv);
+    QCoreApplication::setApplicationName("BlockStorageTesterCli");
+
+    CliRunner runner;
+    if (!runner.parseArguments(a.arguments()))
+    {
+        return 1;
+    }
+    return runner.run();
+}
@@ -2,6 +2,7 @@
 #include "ui_mainwindow.h"
 
 #include "ThemeStyle.h"
+#include "ResultWriter.h"
 
 #include <QPixmap>
 #include <QMessageBox>
@@ -10,6 +11,7 @@
 #include <QFileDialog>
 #include <QProgressBar>
 #include <QToolTip>
+#include <QTimer>
 
 #include <QSqlQuery>
 #include <QSqlError>
@@ -32,6 +34,8 @@ MainWindow::MainWindow(QWidget *parent)
     ui->cvRecoverTime->setVisible(false);
     ui->cvSegAndRecoverTime->setRubberBand(QChartView::RectangleRubberBand); // 启用缩放
     ui->cvRepeatRate->setRubberBand(QChartView::RectangleRubberBand); // 启用缩放
+    ui->cvQueueDepth->setRubberBand(QChartView::RectangleRubberBand); // 启用缩放
+    ui->cvIngestRows->setRubberBand(QChartView::RectangleRubberBand); // 启用缩放
 
     /* 图表显示 */
 #if 0
@@ -62,6 +66,22 @@ MainWindow::MainWindow(QWidget *parent)
     _scatter_repeat_rate  = nullptr;
     _chart_repeat_rate    = nullptr;
 
+    _x_queue_depth        = nullptr;
+    _y_queue_depth        = nullptr;
+    _spline_seg_qd        = nullptr;
+    _scatter_seg_qd       = nullptr;
+    _spline_recover_qd    = nullptr;
+    _scatter_recover_qd   = nullptr;
+    _chart_queue_depth    = nullptr;
+
+    _x_ingest             = nullptr;
+    _y_ingest             = nullptr;
+    _spline_ingest_flat   = nullptr;
+    _scatter_ingest_flat  = nullptr;
+    _spline_ingest_part   = nullptr;
+    _scatter_ingest_part  = nullptr;
+    _chart_ingest         = nullptr;
+
     _font_tital           = nullptr;
 
     initAllCharts();
@@ -89,7 +109,18 @@ MainWindow::MainWindow(QWidget *parent)
     QStringList res_list_header;
     res_list_header << "File\npath" << "Hash alg" << "Block\nsize"  << "Total\nblocks"
                     << "Hash\nrecords" << "Repeat\nrecords" << "Repeat\nrate" << "Seg time"
-                    << "Recovered\nblocks" << "Recovered\nrate" << "Recover\ntime";
+                    << "Seg\nmode" << "Batch\nsize" << "Hash\nthreads" << "Hash\nGB/s" << "Input\nI/O" << "Index\nhit rate" << "Index\nB/entry"
+                    << "Chunking" << "Avg\nchunk" << "Seg\nMB/s"
+                    << "Recovered\nblocks" << "Recovered\nrate" << "Recover\ntime"
+                    << "Recover\nthreads" << "Recover\nMB/s" << "Blocks\nper read"
+                    << "Buffer\npool" << "Seg\nallocs/blk" << "Recover\nallocs/blk"
+                    << "Output\nI/O" << "Seg write\nsyscalls" << "Seg write\nMB/s" << "Recover write\nsyscalls" << "Recover write\nMB/s"
+                    << "I/O\nengine" << "Queue\ndepth" << "Seg I/O\nin flight" << "Recover I/O\nin flight"
+                    << "Direct\nI/O"
+                    << "Seg read\np50/p90/p99/max" << "Seg hash\np50/p90/p99/max" << "Seg DB lookup\np50/p90/p99/max"
+                    << "Seg DB write\np50/p90/p99/max" << "Seg file write\np50/p90/p99/max"
+                    << "Recover read\np50/p90/p99/max" << "Recover DB lookup\np50/p90/p99/max" << "Recover file write\np50/p90/p99/max"
+                    << "DB\nschema" << "Table\nMB" << "Index\nMB" << "Table\npartitions" << "Index\nbackend";
     ui->tbwResult->setColumnCount(res_list_header.size());
     ui->tbwResult->setHorizontalHeaderLabels(res_list_header);
     ui->tbwResult->horizontalHeader()->setSectionResizeMode(QHeaderView::Stretch);
@@ -103,6 +134,11 @@ MainWindow::MainWindow(QWidget *parent)
     // ui->tbwResult->horizontalHeader()->setSectionResizeMode(8, QHeaderView::ResizeToContents);
     // ui->tbwResult->horizontalHeader()->setSectionResizeMode(9, QHeaderView::ResizeToContents);
     // ui->tbwResult->horizontalHeader()->setSectionResizeMode(10, QHeaderView::ResizeToContents);
+    ui->tbwResult->horizontalHeader()->setSectionResizeMode(8, QHeaderView::ResizeToContents);
+    ui->tbwResult->horizontalHeader()->setSectionResizeMode(9, QHeaderView::ResizeToContents);
+    ui->tbwResult->horizontalHeader()->setSectionResizeMode(10, QHeaderView::ResizeToContents);
+    ui->tbwResult->horizontalHeader()->setSectionResizeMode(11, QHeaderView::ResizeToContents);
+    ui->tbwResult->horizontalHeader()->setSectionResizeMode(12, QHeaderView::ResizeToContents);
 
     /* 状态栏显示 */
     QLabel* lbRuningJobInfo = new QLabel(this);
@@ -144,6 +180,12 @@ MainWindow::MainWindow(QWidget *parent)
 
         _chart_repeat_rate->zoomReset(); // 使用zoomReset恢复到初始缩放状态
         _chart_repeat_rate->zoom(_orig_rect_chart_repeat_rate.width() / _chart_repeat_rate->plotArea().width()); // 根据记录的初始大小恢复
+
+        _chart_queue_depth->zoomReset();
+        _chart_queue_depth->zoom(_orig_rect_chart_queue_depth.width() / _chart_queue_depth->plotArea().width());
+
+        _chart_ingest->zoomReset();
+        _chart_ingest->zoom(_orig_rect_chart_ingest.width() / _chart_ingest->plotArea().width());
     });
 
     /* 接收/处理子线程任务发出的信号 */
@@ -157,6 +199,7 @@ MainWindow::MainWindow(QWidget *parent)
     connect(_asyncJob, &AsyncComputeModule::signalDisconnDb, _asyncJob, &AsyncComputeModule::disconnectCurrentDatabase);
     connect(_asyncJob, &AsyncComputeModule::signalDbConnState, this, &MainWindow::asyncJobDbConnStateChanged);
     connect(_asyncJob, &AsyncComputeModule::signalDropCurDb, _asyncJob, &AsyncComputeModule::dropCurrentDatabase);
+    connect(_asyncJob, &AsyncComputeModule::signalSetRunOptions, _asyncJob, &AsyncComputeModule::setRunOptions);
 #if 0
     connect(_asyncJob, &AsyncComputeModule::signalRunTestSegmentationPerformance, _asyncJob, &AsyncComputeModule::runTestSegmentationProfmance);
     connect(_asyncJob, &AsyncComputeModule::signalTestSegmentationPerformanceFinished,
@@ -183,24 +226,19 @@ MainWindow::MainWindow(QWidget *parent)
 
     connect(_asyncJob, &AsyncComputeModule::signalSetActivityWidget, this, &MainWindow::setActivityWidget);
     connect(_asyncJob, &AsyncComputeModule::signalSetLbRuningJobInfo, this, [=](const QString& info){lbRuningJobInfo->setText(info);});
-    connect(_asyncJob, &AsyncComputeModule::signalSetProgressBarValue, this, [=](const int number){progressBar->setValue(number);});
-    connect(_asyncJob, &AsyncComputeModule::signalSetProgressBarRange, this, [=](const int minimum, const int maximum){progressBar->setRange(minimum, maximum);});
-    connect(_asyncJob, &AsyncComputeModule::signalSetLcdTotalFileBlocks, this, [=](const int number){ui->lcdTotalFileBlocks->display(number);});
-    connect(_asyncJob, &AsyncComputeModule::signalSetLcdTotalDbHashRecords, this, [=](const int number){ui->lcdTotalDbHashRecords->display(number);});
-    connect(_asyncJob, &AsyncComputeModule::signalSetLcdTotalRepeat, this, [=](const int number){ui->lcdTotalRepeat->display(number);});
-    connect(_asyncJob, &AsyncComputeModule::signalSetLcdRepeatPercent, this, [=](const double number){ui->lcdRepeatPercent->display(QString::number(number, 'f', 2));});
-    connect(_asyncJob, &AsyncComputeModule::signalSetLcdSegmentationTime, this, [=](const double number){ui->lcdSegmentationTime->display(QString::number(number, 'f', 2));});
-    connect(_asyncJob, &AsyncComputeModule::signalSetLcdNumNeedRecover, this, [=](const int number){ui->lcdNumNeedRecover->display(number);});
-    connect(_asyncJob, &AsyncComputeModule::signalSetLcdTotalUnrecovered, this, [=](const int number){ui->lcdTotalUnrecovered->display(number);});
-    connect(_asyncJob, &AsyncComputeModule::signalSetLcdTotalRecovered, this, [=](const int number){ui->lcdTotalRecovered->display(number);});
-    connect(_asyncJob, &AsyncComputeModule::signalSetLcdRecoveredPercent, this, [=](const double number){ui->lcdRecoveredPercent->display(QString::number(number, 'f', 2));});
-    connect(_asyncJob, &AsyncComputeModule::signalSetLcdRecoverTime, this, [=](const double number){ui->lcdRecoverTime->display(QString::number(number, 'f', 2));});
+
+    /* 进度：计算线程只更新原子计数器（不发送信号），这里每 PROGRESS_POLL_INTERVAL_MS 读取一次，刷新进度条和 LCD */
+    QTimer* timerProgress = new QTimer(this);
+    connect(timerProgress, &QTimer::timeout, this, [=](){ refreshProgress(progressBar); });
+    timerProgress->start(PROGRESS_POLL_INTERVAL_MS);
 
     connect(_asyncJob, &AsyncComputeModule::signalCurSegmentationResult, this, &MainWindow::addSegmentationResult);
     connect(_asyncJob, &AsyncComputeModule::signalCurRecoverResult, this, &MainWindow::addRecoverResult);
 
     connect(_asyncJob, &AsyncComputeModule::signalAddPointSegTimeAndRepeateRate, this, &MainWindow::addPointSegTimeAndRepeateRate);
     connect(_asyncJob, &AsyncComputeModule::signalAddPointRecoverTime, this, &MainWindow::addPointRecoverTime);
+    connect(_asyncJob, &AsyncComputeModule::signalAddPointQueueDepth, this, &MainWindow::addPointQueueDepth);
+    connect(_asyncJob, &AsyncComputeModule::signalAddPointIngestCurve, this, &MainWindow::addPointsIngestCurve);
 
     loadSettings();
 }
@@ -229,6 +267,41 @@ void MainWindow::saveSettings()
 
     settings.setValue("cbBlockSize", ui->cbBlockSize->currentIndex());
     settings.setValue("cbHashAlg", ui->cbHashAlg->currentIndex());
+    settings.setValue("cbSegMode", ui->cbSegMode->currentIndex());
+    settings.setValue("sbBatchSize", ui->sbBatchSize->value());
+    settings.setValue("cbCompareIngest", ui->cbCompareIngest->isChecked());
+    settings.setValue("cbUseHashIndex", ui->cbUseHashIndex->isChecked());
+    settings.setValue("cbPreloadHashIndex", ui->cbPreloadHashIndex->isChecked());
+    settings.setValue("sbHashThreads", ui->sbHashThreads->value());
+    settings.setValue("sbRecoverThreads", ui->sbRecoverThreads->value());
+    settings.setValue("sbRecoverWindow", ui->sbRecoverWindow->value());
+    settings.setValue("cbBulkResolve", ui->cbBulkResolve->isChecked());
+    settings.setValue("cbSortedRecover", ui->cbSortedRecover->isChecked());
+    settings.setValue("cbInputMode", ui->cbInputMode->currentIndex());
+    settings.setValue("cbCompareInput", ui->cbCompareInput->isChecked());
+    settings.setValue("sbSourceCache", ui->sbSourceCache->value());
+    settings.setValue("cbChunkMode", ui->cbChunkMode->currentIndex());
+    settings.setValue("sbCdcMinDivisor", ui->sbCdcMinDivisor->value());
+    settings.setValue("sbCdcMaxMultiplier", ui->sbCdcMaxMultiplier->value());
+    settings.setValue("cbCompareChunking", ui->cbCompareChunking->isChecked());
+    settings.setValue("cbBufferPool", ui->cbBufferPool->isChecked());
+    settings.setValue("cbCompareBufferPool", ui->cbCompareBufferPool->isChecked());
+    settings.setValue("cbOutputMode", ui->cbOutputMode->currentIndex());
+    settings.setValue("sbOutputBuffer", ui->sbOutputBuffer->value());
+    settings.setValue("cbOutputWritev", ui->cbOutputWritev->isChecked());
+    settings.setValue("cbCompareOutput", ui->cbCompareOutput->isChecked());
+    settings.setValue("cbIoEngine", ui->cbIoEngine->currentIndex());
+    settings.setValue("sbQueueDepth", ui->sbQueueDepth->value());
+    settings.setValue("leQueueDepths", ui->leQueueDepths->text());
+    settings.setValue("cbDirectIo", ui->cbDirectIo->isChecked());
+    settings.setValue("cbSchema", ui->cbSchema->currentIndex());
+    settings.setValue("cbCompareSchema", ui->cbCompareSchema->isChecked());
+    settings.setValue("sbDbConnections", ui->sbDbConnections->value());
+    settings.setValue("sbTablePartitions", ui->sbTablePartitions->value());
+    settings.setValue("cbComparePartitions", ui->cbComparePartitions->isChecked());
+    settings.setValue("cbIndexBackend", ui->cbIndexBackend->currentIndex());
+    settings.setValue("leIndexPath", ui->leIndexPath->text());
+    settings.setValue("cbCompareIndex", ui->cbCompareIndex->isChecked());
 
     writeInfoLog("Successed save settings");
 }
@@ -252,6 +325,41 @@ void MainWindow::loadSettings()
 
     ui->cbBlockSize->setCurrentIndex(settings.value("cbBlockSize", 0).toInt());
     ui->cbHashAlg->setCurrentIndex(settings.value("cbHashAlg", 0).toInt());
+    ui->cbSegMode->setCurrentIndex(settings.value("cbSegMode", 0).toInt());
+    ui->sbBatchSize->setValue(settings.value("sbBatchSize", 1024).toInt());
+    ui->cbCompareIngest->setChecked(settings.value("cbCompareIngest", false).toBool());
+    ui->cbUseHashIndex->setChecked(settings.value("cbUseHashIndex", false).toBool());
+    ui->cbPreloadHashIndex->setChecked(settings.value("cbPreloadHashIndex", false).toBool());
+    ui->sbHashThreads->setValue(settings.value("sbHashThreads", 0).toInt());
+    ui->sbRecoverThreads->setValue(settings.value("sbRecoverThreads", 0).toInt());
+    ui->sbRecoverWindow->setValue(settings.value("sbRecoverWindow", 4096).toInt());
+    ui->cbBulkResolve->setChecked(settings.value("cbBulkResolve", true).toBool());
+    ui->cbSortedRecover->setChecked(settings.value("cbSortedRecover", false).toBool());
+    ui->cbInputMode->setCurrentIndex(settings.value("cbInputMode", 0).toInt());
+    ui->cbCompareInput->setChecked(settings.value("cbCompareInput", false).toBool());
+    ui->sbSourceCache->setValue(settings.value("sbSourceCache", 64).toInt());
+    ui->cbChunkMode->setCurrentIndex(settings.value("cbChunkMode", 0).toInt());
+    ui->sbCdcMinDivisor->setValue(settings.value("sbCdcMinDivisor", 4).toInt());
+    ui->sbCdcMaxMultiplier->setValue(settings.value("sbCdcMaxMultiplier", 4).toInt());
+    ui->cbCompareChunking->setChecked(settings.value("cbCompareChunking", false).toBool());
+    ui->cbBufferPool->setChecked(settings.value("cbBufferPool", true).toBool());
+    ui->cbCompareBufferPool->setChecked(settings.value("cbCompareBufferPool", false).toBool());
+    ui->cbOutputMode->setCurrentIndex(settings.value("cbOutputMode", 1).toInt());
+    ui->sbOutputBuffer->setValue(settings.value("sbOutputBuffer", 16).toInt());
+    ui->cbOutputWritev->setChecked(settings.value("cbOutputWritev", true).toBool());
+    ui->cbCompareOutput->setChecked(settings.value("cbCompareOutput", false).toBool());
+    ui->cbIoEngine->setCurrentIndex(settings.value("cbIoEngine", 0).toInt());
+    ui->sbQueueDepth->setValue(settings.value("sbQueueDepth", 32).toInt());
+    ui->leQueueDepths->setText(settings.value("leQueueDepths", "").toString());
+    ui->cbDirectIo->setChecked(settings.value("cbDirectIo", false).toBool());
+    ui->cbSchema->setCurrentIndex(settings.value("cbSchema", 0).toInt());
+    ui->cbCompareSchema->setChecked(settings.value("cbCompareSchema", false).toBool());
+    ui->sbDbConnections->setValue(settings.value("sbDbConnections", 1).toInt());
+    ui->sbTablePartitions->setValue(settings.value("sbTablePartitions", 0).toInt());
+    ui->cbComparePartitions->setChecked(settings.value("cbComparePartitions", false).toBool());
+    ui->cbIndexBackend->setCurrentIndex(settings.value("cbIndexBackend", 0).toInt());
+    ui->leIndexPath->setText(settings.value("leIndexPath", "").toString());
+    ui->cbCompareIndex->setChecked(settings.value("cbCompareIndex", false).toBool());
 
     writeSuccLog("Successed load settings");
 }
@@ -273,6 +381,51 @@ void MainWindow::asyncJobDbConnStateChanged(const bool is_conn)
     }
 }
 
+/**
+ * @brief MainWindow::getRunOptions 从 UI 读取计算任务的运行参数
+ * @return 运行参数
+ */
+RunOptions MainWindow::getRunOptions() const
+{
+    RunOptions options;
+    options.segMode   = SegMode(ui->cbSegMode->currentIndex());
+    options.batchSize = ui->sbBatchSize->value();
+    options.compareIngest = ui->cbCompareIngest->isChecked();
+    options.useHashIndex  = ui->cbUseHashIndex->isChecked();
+    options.preloadHashIndex = ui->cbPreloadHashIndex->isChecked();
+    options.hashThreads   = ui->sbHashThreads->value();
+    options.recoverThreads = ui->sbRecoverThreads->value();
+    options.recoverWindow = ui->sbRecoverWindow->value();
+    options.bulkResolve   = ui->cbBulkResolve->isChecked();
+    options.sortedRecover = ui->cbSortedRecover->isChecked();
+    options.inputMode     = InputMode(ui->cbInputMode->currentIndex());
+    options.compareInput  = ui->cbCompareInput->isChecked();
+    options.sourceCacheCapacity = ui->sbSourceCache->value();
+    options.chunkMode     = ChunkMode(ui->cbChunkMode->currentIndex());
+    options.cdcMinDivisor = ui->sbCdcMinDivisor->value();
+    options.cdcMaxMultiplier = ui->sbCdcMaxMultiplier->value();
+    options.compareChunking  = ui->cbCompareChunking->isChecked();
+    options.useBufferPool     = ui->cbBufferPool->isChecked();
+    options.compareBufferPool = ui->cbCompareBufferPool->isChecked();
+    options.outputMode      = OutputMode(ui->cbOutputMode->currentIndex());
+    options.outputBufferMB  = ui->sbOutputBuffer->value();
+    options.outputWritev    = ui->cbOutputWritev->isChecked();
+    options.compareOutput   = ui->cbCompareOutput->isChecked();
+    options.ioEngine        = IoEngineMode(ui->cbIoEngine->currentIndex());
+    options.queueDepth      = ui->sbQueueDepth->value();
+    options.benchmarkQueueDepths = RunOptions::parseQueueDepths(ui->leQueueDepths->text());
+    options.directIo        = ui->cbDirectIo->isChecked();
+    options.schemaVersion   = (1 == ui->cbSchema->currentIndex()) ? SchemaVersion::SCHEMA_V2 : SchemaVersion::SCHEMA_V1;
+    options.compareSchema   = ui->cbCompareSchema->isChecked();
+    options.dbConnections   = ui->sbDbConnections->value();
+    options.tablePartitions = ui->sbTablePartitions->value();
+    options.comparePartitions = ui->cbComparePartitions->isChecked();
+    options.indexBackend    = IndexBackend(ui->cbIndexBackend->currentIndex());
+    options.indexPath       = ui->leIndexPath->text().trimmed();
+    options.compareIndex    = ui->cbCompareIndex->isChecked();
+    return options;
+}
+
 void MainWindow::initAllCharts()
 {
     writeInfoLog("Start init all charts");
@@ -296,6 +449,14 @@ void MainWindow::initAllCharts()
     {
         ui->cvRepeatRate->setChart(new QChart());
     }
+    if (ui->cvQueueDepth->chart() != nullptr)
+    {
+        ui->cvQueueDepth->setChart(new QChart());
+    }
+    if (ui->cvIngestRows->chart() != nullptr)
+    {
+        ui->cvIngestRows->setChart(new QChart());
+    }
 
     delete _font_tital    ;     // 字体 - 标题
 
@@ -327,6 +488,22 @@ void MainWindow::initAllCharts()
     delete _scatter_repeat_rate ;    // 数据点 - 哈希重复率
     delete _chart_repeat_rate   ;    // 画布 - 哈希重复率
 
+    delete _x_queue_depth       ;
+    delete _y_queue_depth       ;
+    delete _spline_seg_qd       ;
+    delete _scatter_seg_qd      ;
+    delete _spline_recover_qd   ;
+    delete _scatter_recover_qd  ;
+    delete _chart_queue_depth   ;    // 画布 - 队列深度
+
+    delete _x_ingest            ;
+    delete _y_ingest            ;
+    delete _spline_ingest_flat  ;
+    delete _scatter_ingest_flat ;
+    delete _spline_ingest_part  ;
+    delete _scatter_ingest_part ;
+    delete _chart_ingest        ;    // 画布 - 吞吐量随写入行数的变化
+
 #if 0
     _x_seg_time          = new QLogValueAxis();
     _y_seg_time          = new QValueAxis();
@@ -355,6 +532,22 @@ void MainWindow::initAllCharts()
     _scatter_repeat_rate = new QScatterSeries();
     _chart_repeat_rate   = new QChart();
 
+    _x_queue_depth       = new QLogValueAxis();
+    _y_queue_depth       = new QValueAxis();
+    _spline_seg_qd       = new QLineSeries();
+    _scatter_seg_qd      = new QScatterSeries();
+    _spline_recover_qd   = new QLineSeries();
+    _scatter_recover_qd  = new QScatterSeries();
+    _chart_queue_depth   = new QChart();
+
+    _x_ingest            = new QLogValueAxis();
+    _y_ingest            = new QValueAxis();
+    _spline_ingest_flat  = new QLineSeries();
+    _scatter_ingest_flat = new QScatterSeries();
+    _spline_ingest_part  = new QLineSeries();
+    _scatter_ingest_part = new QScatterSeries();
+    _chart_ingest        = new QChart();
+
     /* 创建字体并设置字体大小 */
     _font_tital          = new QFont();
     _font_tital->setPointSize(ThemeStyle::FONT_TITLE_SIZE);  // 设置标题字体大小为16
@@ -398,6 +591,34 @@ void MainWindow::initAllCharts()
               _y_repeat_rate, "Percent (%)");
     _orig_rect_chart_repeat_rate = _chart_repeat_rate->plotArea();
 
+    initChart(ui->cvQueueDepth, _chart_queue_depth,
+              QString("Segmentation and Recover throughput versus io_uring queue depth (Base on %1)").arg(hash_name),
+              *_font_tital, true,
+              QList<QLineSeries*>() << _spline_seg_qd << _spline_recover_qd,
+              QList<QString>() << "" << "",
+              QList<QScatterSeries*>() << _scatter_seg_qd << _scatter_recover_qd,
+              QList<QString>() << "Segmentation" << "Restoration",
+              QList<Qt::GlobalColor>() << Qt::blue << Qt::green,
+              QList<Qt::GlobalColor>() << Qt::red  << Qt::darkYellow,
+              _x_queue_depth, "Queue depth",
+              _y_queue_depth, "Throughput (MB/s)");
+    _x_queue_depth->setRange(1, IO_ENGINE_MAX_QUEUE_DEPTH);  // 队列深度从 1 开始
+    _orig_rect_chart_queue_depth = _chart_queue_depth->plotArea();
+
+    initChart(ui->cvIngestRows, _chart_ingest,
+              QString("Segmentation throughput versus rows written, unpartitioned and hash-partitioned table (Base on %1)").arg(hash_name),
+              *_font_tital, true,
+              QList<QLineSeries*>() << _spline_ingest_flat << _spline_ingest_part,
+              QList<QString>() << "" << "",
+              QList<QScatterSeries*>() << _scatter_ingest_flat << _scatter_ingest_part,
+              QList<QString>() << "Unpartitioned" << "Partitioned",
+              QList<Qt::GlobalColor>() << Qt::blue << Qt::green,
+              QList<Qt::GlobalColor>() << Qt::red  << Qt::darkYellow,
+              _x_ingest, "Rows written",
+              _y_ingest, "Throughput (blocks/s)");
+    _x_ingest->setRange(INGEST_CURVE_FIRST_ROWS, INGEST_CURVE_FIRST_ROWS * 2);  // 添加点时扩大
+    _orig_rect_chart_ingest = _chart_ingest->plotArea();
+
     writeSuccLog("Successed init all charts");
 }
 
@@ -779,6 +1000,92 @@ bool MainWindow::addPointRecoverTime(const ResultComput &result)
     return true;
 }
 
+/**
+ * @brief MainWindow::addPointQueueDepth 在绘图区添加某个队列深度下分块和恢复速度的点
+ * @param result 计算结果
+ */
+bool MainWindow::addPointQueueDepth(const ResultComput &result)
+{
+    if (!_chart_queue_depth) {
+        qDebug() << "Add data point failed: chart queue depth is nullptr";
+        writeErrorLog("Add data point failed: chart queue depth is nullptr");
+        return false;
+    }
+    if (!_spline_seg_qd || !_spline_recover_qd) {
+        qDebug() << "Add data point failed: spline queue depth is nullptr";
+        writeErrorLog("Add data point failed: spline queue depth is nullptr");
+        return false;
+    }
+    if (!_scatter_seg_qd || !_scatter_recover_qd) {
+        qDebug() << "Add data point failed: scatter queue depth is nullptr";
+        writeErrorLog("Add data point failed: scatter queue depth is nullptr");
+        return false;
+    }
+
+    writeInfoLog(QString("Add data point (%1, %2), (%1, %3) to chart Queue depth").arg(
+        QString::number(result.queueDepth), QString::number(result.segMBps, 'f', 2), QString::number(result.recoveredMBps, 'f', 2)));
+    _spline_seg_qd->append( result.queueDepth, result.segMBps);
+    _scatter_seg_qd->append(result.queueDepth, result.segMBps);
+    _spline_recover_qd->append( result.queueDepth, result.recoveredMBps);
+    _scatter_recover_qd->append(result.queueDepth, result.recoveredMBps);
+
+    const double max_mbps = qMax(result.segMBps, result.recoveredMBps);
+    if (max_mbps > _y_queue_depth->max())
+    {
+        _y_queue_depth->setRange(0.0, max_mbps);
+        _orig_rect_chart_queue_depth = _chart_queue_depth->plotArea();
+    }
+
+    return true;
+}
+
+/**
+ * @brief MainWindow::addPointsIngestCurve 在绘图区添加一次分块的吞吐量随写入行数变化的所有点（按表是否分区画到不同的曲线上）
+ * @param result 分块的计算结果
+ */
+bool MainWindow::addPointsIngestCurve(const ResultComput &result)
+{
+    if (!_chart_ingest) {
+        qDebug() << "Add data point failed: chart ingest is nullptr";
+        writeErrorLog("Add data point failed: chart ingest is nullptr");
+        return false;
+    }
+    if (!_spline_ingest_flat || !_spline_ingest_part) {
+        qDebug() << "Add data point failed: spline ingest is nullptr";
+        writeErrorLog("Add data point failed: spline ingest is nullptr");
+        return false;
+    }
+    if (!_scatter_ingest_flat || !_scatter_ingest_part) {
+        qDebug() << "Add data point failed: scatter ingest is nullptr";
+        writeErrorLog("Add data point failed: scatter ingest is nullptr");
+        return false;
+    }
+
+    const bool partitioned = result.tablePartitions > 0;
+    QLineSeries*    spline  = partitioned ? _spline_ingest_part  : _spline_ingest_flat;
+    QScatterSeries* scatter = partitioned ? _scatter_ingest_part : _scatter_ingest_flat;
+    writeInfoLog(QString("Add %1 data points to chart Ingest rows (%2 partitions)").arg(
+        QString::number(result.ingestCurve.size()), QString::number(result.tablePartitions)));
+    for (const IngestPoint& point : result.ingestCurve)
+    {
+        spline->append( point.rows, point.blocksPerSec);
+        scatter->append(point.rows, point.blocksPerSec);
+
+        if (point.rows > _x_ingest->max())
+        {
+            _x_ingest->setMax(point.rows * 2);
+            _orig_rect_chart_ingest = _chart_ingest->plotArea();
+        }
+        if (point.blocksPerSec > _y_ingest->max())
+        {
+            _y_ingest->setRange(0.0, point.blocksPerSec);
+            _orig_rect_chart_ingest = _chart_ingest->plotArea();
+        }
+    }
+
+    return true;
+}
+
 void MainWindow::writeInfoLog(const QString& msg)
 {
     ui->txbLog->setTextColor(Qt::black);
@@ -803,6 +1110,34 @@ void MainWindow::writeSuccLog(const QString& msg)
     ui->txbLog->append(QString("[INFO] %1").arg(msg));
 }
 
+/**
+ * @brief MainWindow::refreshProgress 读取计算任务的进度计数器，刷新进度条和 LCD（由定时器调用）
+ * @param progress_bar 状态栏中的进度条（范围 0 - 100）
+ */
+void MainWindow::refreshProgress(QProgressBar* progress_bar)
+{
+    const ProgressCounters& progress = _asyncJob->progress();
+    const qint64 position = progress.position.load(std::memory_order_relaxed);
+    const qint64 total    = progress.total.load(std::memory_order_relaxed);
+    progress_bar->setValue(total > 0 ? (int)(qMin(position, total) * 100 / total) : 0);  // 文件可能超过 int 的范围，按百分比显示
+
+    const qint64 file_blocks = progress.fileBlocks.load(std::memory_order_relaxed);
+    const qint64 repeats     = progress.repeats.load(std::memory_order_relaxed);
+    ui->lcdTotalFileBlocks->display(QString::number(file_blocks));
+    ui->lcdTotalDbHashRecords->display(QString::number(progress.hashRecords.load(std::memory_order_relaxed)));
+    ui->lcdTotalRepeat->display(QString::number(repeats));
+    ui->lcdRepeatPercent->display(QString::number(0 == file_blocks ? 0.0 : (double)repeats / file_blocks * 100, 'f', 2));
+    ui->lcdSegmentationTime->display(QString::number(progress.segNsecs.load(std::memory_order_relaxed) / 1e9, 'f', 2));
+
+    const qint64 need_recover = progress.needRecover.load(std::memory_order_relaxed);
+    const qint64 recovered    = progress.recovered.load(std::memory_order_relaxed);
+    ui->lcdNumNeedRecover->display(QString::number(need_recover));
+    ui->lcdTotalUnrecovered->display(QString::number(progress.unrecovered.load(std::memory_order_relaxed)));
+    ui->lcdTotalRecovered->display(QString::number(recovered));
+    ui->lcdRecoveredPercent->display(QString::number(0 == need_recover ? 0.0 : (double)recovered / need_recover * 100, 'f', 2));
+    ui->lcdRecoverTime->display(QString::number(progress.recoverNsecs.load(std::memory_order_relaxed) / 1e9, 'f', 2));
+}
+
 /** 设置小部件的可操作性
  * @brief MainWindow::setActivityWidget
  * @param activity true:启用； false:禁用
@@ -830,6 +1165,41 @@ void MainWindow::setActivityWidget(const bool activity)
 
     ui->cbBlockSize->setEnabled(activity);
     ui->cbHashAlg->setEnabled(activity);
+    ui->cbSegMode->setEnabled(activity);
+    ui->sbBatchSize->setEnabled(activity);
+    ui->cbCompareIngest->setEnabled(activity);
+    ui->cbUseHashIndex->setEnabled(activity);
+    ui->cbPreloadHashIndex->setEnabled(activity);
+    ui->sbHashThreads->setEnabled(activity);
+    ui->sbRecoverThreads->setEnabled(activity);
+    ui->sbRecoverWindow->setEnabled(activity);
+    ui->cbBulkResolve->setEnabled(activity);
+    ui->cbSortedRecover->setEnabled(activity);
+    ui->cbInputMode->setEnabled(activity);
+    ui->cbCompareInput->setEnabled(activity);
+    ui->sbSourceCache->setEnabled(activity);
+    ui->cbChunkMode->setEnabled(activity);
+    ui->sbCdcMinDivisor->setEnabled(activity);
+    ui->sbCdcMaxMultiplier->setEnabled(activity);
+    ui->cbCompareChunking->setEnabled(activity);
+    ui->cbBufferPool->setEnabled(activity);
+    ui->cbCompareBufferPool->setEnabled(activity);
+    ui->cbOutputMode->setEnabled(activity);
+    ui->sbOutputBuffer->setEnabled(activity);
+    ui->cbOutputWritev->setEnabled(activity);
+    ui->cbCompareOutput->setEnabled(activity);
+    ui->cbIoEngine->setEnabled(activity);
+    ui->sbQueueDepth->setEnabled(activity);
+    ui->leQueueDepths->setEnabled(activity);
+    ui->cbDirectIo->setEnabled(activity);
+    ui->cbSchema->setEnabled(activity);
+    ui->cbCompareSchema->setEnabled(activity);
+    ui->sbDbConnections->setEnabled(activity);
+    ui->sbTablePartitions->setEnabled(activity);
+    ui->cbComparePartitions->setEnabled(activity);
+    ui->cbIndexBackend->setEnabled(activity);
+    ui->leIndexPath->setEnabled(activity);
+    ui->cbCompareIndex->setEnabled(activity);
     ui->btnRunSingleTest->setEnabled(activity);
 
     ui->cbBenchmarkAlg->setEnabled(activity);
@@ -1054,6 +1424,7 @@ void MainWindow::startSingleTest()
                           ui->leRecoverFile->text(),
                           QString::number(block_size), ui->cbHashAlg->currentText(), QString::number(alg)));
 
+    emit _asyncJob->signalSetRunOptions(getRunOptions());
     emit _asyncJob->signalRunSingleTest(ui->leSourceFile->text(),
                                         ui->leUniqueBlockFile->text(),
                                         ui->leBlockHashFile->text(),
@@ -1121,6 +1492,7 @@ void MainWindow::startBenchmarkTest()
                           ui->leRecoverFile->text(),
                           ui->cbHashAlg->currentText(), QString::number(alg)));
 
+    emit _asyncJob->signalSetRunOptions(getRunOptions());
     emit _asyncJob->signalRunBenchmarkTest(ui->leSourceFile->text(),
                                            ui->leUniqueBlockFile->text(),
                                            ui->leBlockHashFile->text(),
@@ -1147,6 +1519,34 @@ void MainWindow::addSegmentationResult(const ResultComput& seg_result)
     ui->tbwResult->setItem(i_row, 5, new QTableWidgetItem(QString::number(seg_result.repeatRecord)));
     ui->tbwResult->setItem(i_row, 6, new QTableWidgetItem(QString::number(seg_result.repeatRate, 'f', 2).append('%')));
     ui->tbwResult->setItem(i_row, 7, new QTableWidgetItem(QString::number(seg_result.segTime, 'f', 2).append('s')));
+    ui->tbwResult->setItem(i_row, 8, new QTableWidgetItem(RunOptions::getSegModeName(seg_result.segMode)));
+    ui->tbwResult->setItem(i_row, 9, new QTableWidgetItem(QString::number(seg_result.batchSize)));
+    ui->tbwResult->setItem(i_row, 10, new QTableWidgetItem(QString::number(seg_result.hashThreads)));
+    ui->tbwResult->setItem(i_row, 11, new QTableWidgetItem(QString::number(seg_result.hashGBps, 'f', 2)));
+    ui->tbwResult->setItem(i_row, 12, new QTableWidgetItem(InputFile::getInputModeName(seg_result.inputMode)));
+    ui->tbwResult->setItem(i_row, 13, new QTableWidgetItem(QString::number(seg_result.indexHitRate, 'f', 2).append('%')));
+    ui->tbwResult->setItem(i_row, 14, new QTableWidgetItem(QString::number(seg_result.indexBytesPerEntry, 'f', 1)));
+    ui->tbwResult->setItem(i_row, 15, new QTableWidgetItem(RunOptions::getChunkModeName(seg_result.chunkMode)));
+    ui->tbwResult->setItem(i_row, 16, new QTableWidgetItem(QString::number(seg_result.avgChunkSize, 'f', 0)));
+    ui->tbwResult->setItem(i_row, 17, new QTableWidgetItem(QString::number(seg_result.segMBps, 'f', 2)));
+    ui->tbwResult->setItem(i_row, 24, new QTableWidgetItem(seg_result.bufferPool ? "yes" : "no"));
+    ui->tbwResult->setItem(i_row, 25, new QTableWidgetItem(seg_result.segAllocsPerBlock < 0 ? "n/a" : QString::number(seg_result.segAllocsPerBlock, 'f', 2)));
+    ui->tbwResult->setItem(i_row, 27, new QTableWidgetItem(OutputFile::getOutputModeName(seg_result.outputMode)));
+    ui->tbwResult->setItem(i_row, 28, new QTableWidgetItem(seg_result.segWriteSyscalls < 0 ? "n/a" : QString::number(seg_result.segWriteSyscalls)));
+    ui->tbwResult->setItem(i_row, 29, new QTableWidgetItem(QString::number(seg_result.segWriteMBps, 'f', 2)));
+    ui->tbwResult->setItem(i_row, 32, new QTableWidgetItem(IoEngine::getIoEngineModeName(seg_result.ioEngine)));
+    ui->tbwResult->setItem(i_row, 33, new QTableWidgetItem(QString::number(seg_result.queueDepth)));
+    ui->tbwResult->setItem(i_row, 34, new QTableWidgetItem(QString::number(seg_result.segIoInFlight, 'f', 2)));
+    ui->tbwResult->setItem(i_row, 36, new QTableWidgetItem(seg_result.directIo ? "yes" : "no"));
+    for (int i = 0; i < PHASE_COUNT; ++i)  // 每个阶段的延迟分位数（µs）和耗时占比
+    {
+        ui->tbwResult->setItem(i_row, 37 + i, new QTableWidgetItem(LatencyHistogram::formatStats(seg_result.segPhases[i])));
+    }
+    ui->tbwResult->setItem(i_row, 45, new QTableWidgetItem(RunOptions::getSchemaVersionName(seg_result.schemaVersion)));
+    ui->tbwResult->setItem(i_row, 46, new QTableWidgetItem(seg_result.tableBytes < 0 ? "n/a" : QString::number(seg_result.tableBytes / 1048576.0, 'f', 2)));
+    ui->tbwResult->setItem(i_row, 47, new QTableWidgetItem(seg_result.indexBytes < 0 ? "n/a" : QString::number(seg_result.indexBytes / 1048576.0, 'f', 2)));
+    ui->tbwResult->setItem(i_row, 48, new QTableWidgetItem(0 == seg_result.tablePartitions ? "no" : QString::number(seg_result.tablePartitions)));
+    ui->tbwResult->setItem(i_row, 49, new QTableWidgetItem(DedupIndex::getIndexBackendName(seg_result.indexBackend)));
 
     /* 设置焦点到新增行的第一列，并选中整行 */
     ui->tbwResult->setCurrentCell(i_row, 0);
@@ -1163,9 +1563,19 @@ void MainWindow::addRecoverResult(const ResultComput& recover_result)
     const size_t i_row = ui->tbwResult->rowCount() - 1;
 
     /* 从中间部分开始填充之前没补充的每一列数据 */
-    ui->tbwResult->setItem(i_row, 8,  new QTableWidgetItem(QString::number(recover_result.recoveredBlock)));
-    ui->tbwResult->setItem(i_row, 9,  new QTableWidgetItem(QString::number(recover_result.recoveredRate, 'f', 2).append('%')));
-    ui->tbwResult->setItem(i_row, 10, new QTableWidgetItem(QString::number(recover_result.recoveredTime, 'f', 2).append('s')));
+    ui->tbwResult->setItem(i_row, 18, new QTableWidgetItem(QString::number(recover_result.recoveredBlock)));
+    ui->tbwResult->setItem(i_row, 19, new QTableWidgetItem(QString::number(recover_result.recoveredRate, 'f', 2).append('%')));
+    ui->tbwResult->setItem(i_row, 20, new QTableWidgetItem(QString::number(recover_result.recoveredTime, 'f', 2).append('s')));
+    ui->tbwResult->setItem(i_row, 21, new QTableWidgetItem(QString::number(recover_result.recoverThreads)));
+    ui->tbwResult->setItem(i_row, 22, new QTableWidgetItem(QString::number(recover_result.recoveredMBps, 'f', 2)));
+    ui->tbwResult->setItem(i_row, 23, new QTableWidgetItem(QString::number(recover_result.coalesceRatio, 'f', 2)));
+    ui->tbwResult->setItem(i_row, 26, new QTableWidgetItem(recover_result.recoverAllocsPerBlock < 0 ? "n/a" : QString::number(recover_result.recoverAllocsPerBlock, 'f', 2)));
+    ui->tbwResult->setItem(i_row, 30, new QTableWidgetItem(recover_result.recoverWriteSyscalls < 0 ? "n/a" : QString::number(recover_result.recoverWriteSyscalls)));
+    ui->tbwResult->setItem(i_row, 31, new QTableWidgetItem(recover_result.recoverWriteMBps < 0 ? "n/a" : QString::number(recover_result.recoverWriteMBps, 'f', 2)));
+    ui->tbwResult->setItem(i_row, 35, new QTableWidgetItem(QString::number(recover_result.recoverIoInFlight, 'f', 2)));
+    ui->tbwResult->setItem(i_row, 42, new QTableWidgetItem(LatencyHistogram::formatStats(recover_result.recoverPhases[PHASE_READ])));
+    ui->tbwResult->setItem(i_row, 43, new QTableWidgetItem(LatencyHistogram::formatStats(recover_result.recoverPhases[PHASE_DB_LOOKUP])));
+    ui->tbwResult->setItem(i_row, 44, new QTableWidgetItem(LatencyHistogram::formatStats(recover_result.recoverPhases[PHASE_FILE_WRITE])));
 
     /* 设置焦点到新增行的第一列，并选中整行 */
     ui->tbwResult->setCurrentCell(i_row, 0);
@@ -1185,37 +1595,14 @@ bool MainWindow::saveResultComputToCSV()
 
     QString csv_path = source_info.dir().filePath(QString("RESULT_").append(source_info.baseName().append(".csv")));
 
-    QFile file(csv_path);
-    if (!file.open(QIODevice::WriteOnly | QIODevice::Text))
+    QString error;
+    if (!ResultWriter::saveToCSV(csv_path, *_listResultComput, error))
     {
-        qDebug() << "Unable to open file for writing:" << file.errorString();
+        qDebug() << "Unable to open file for writing:" << error;
         return false;
     }
 
-    QTextStream out(&file);
-    out << "sourceFilePath,hashAlg,blockSize,"
-           "totalBlock,hashRecordDB,repeatRecord,repeatRate,segTime,"
-           "recoveredBlock,recoveredRate,recoveredTime"
-           "\n";
-
-    /* 遍历 QList<ResultComput>，将每个 ResultComput 写入一行 CSV  */
-    for (const ResultComput& result : *_listResultComput)
-    {
-        out << result.sourceFilePath << ','  // 源文件路径
-            << Hash::getHashName(result.hashAlg)  << ','  // 分块/恢复所用的哈希函数
-            << result.blockSize      << ','  // 分块大小
-            << result.totalBlock     << ','  // 源文件被分成了多少块
-            << result.hashRecordDB   << ','  // 数据库数据表中中记录的哈希条数
-            << result.repeatRecord   << ','  // 重复的哈希值/块数量
-            << result.repeatRate     << ','  // 重复率
-            << result.segTime        << ','  // 分块任务所用的时间
-            << result.recoveredBlock << ','  // 成功恢复的块数量
-            << result.recoveredRate  << ','  // 恢复率
-            << result.recoveredTime  << "\n";// 恢复任务所用时间
-    }
-
     qDebug() << "Successed save result compute to path:" << csv_path;
-    file.close();
     return true;
 }
 
@@ -1378,13 +1765,27 @@ void MainWindow::closeEvent(QCloseEvent* event)
     delete _x_repeat_rate;
     delete _y_repeat_rate;
 
+    delete _x_queue_depth;
+    delete _y_queue_depth;
+
+    delete _x_ingest;
+    delete _y_ingest;
+
     delete _spline_seg_time     ;    // 平滑曲线 - 分块时间
     delete _spline_recover_time ;    // 平滑曲线 - 恢复时间
     delete _spline_repeat_rate  ;    // 平滑曲线 - 哈希重复率
+    delete _spline_seg_qd       ;    // 平滑曲线 - 不同队列深度的分块速度
+    delete _spline_recover_qd   ;    // 平滑曲线 - 不同队列深度的恢复速度
+    delete _spline_ingest_flat  ;    // 平滑曲线 - 不分区的表的分块吞吐量
+    delete _spline_ingest_part  ;    // 平滑曲线 - 分区的表的分块吞吐量
 
     delete _scatter_seg_time    ;    // 数据点 - 分块时间
     delete _scatter_recover_time;    // 数据点 - 恢复时间
     delete _scatter_repeat_rate ;    // 数据点 - 哈希重复率
+    delete _scatter_seg_qd      ;    // 数据点 - 不同队列深度的分块速度
+    delete _scatter_recover_qd  ;    // 数据点 - 不同队列深度的恢复速度
+    delete _scatter_ingest_flat ;    // 数据点 - 不分区的表的分块吞吐量
+    delete _scatter_ingest_part ;    // 数据点 - 分区的表的分块吞吐量
 
     /* 注意，画布最后再删除，因为上面图表对象是chart的子对象 */
 #if 0
@@ -1393,6 +1794,8 @@ void MainWindow::closeEvent(QCloseEvent* event)
 #endif
     delete _chart_seg_recover_time;
     delete _chart_repeat_rate   ;    // 画布 - 哈希重复率
+    delete _chart_queue_depth   ;    // 画布 - 队列深度
+    delete _chart_ingest        ;    // 画布 - 吞吐量随写入行数的变化
 
     delete _font_tital    ;     // 字体 - 标题
 
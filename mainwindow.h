@@ -3,6 +3,7 @@
 
 #include "AsyncComputeModule.h"
 #include "ResultComput.h"
+#include "RunOptions.h"
 
 #include <QMainWindow>
 #include <QThread>
@@ -13,6 +14,7 @@
 #include <QScatterSeries>
 #include <QCategoryAxis>
 #include <QLogValueAxis>
+#include <QProgressBar>
 
 QT_BEGIN_NAMESPACE
 namespace Ui { class MainWindow; }
@@ -62,6 +64,9 @@ private:
     /* 数据库 & 数据表相关操作 */
     void asyncJobDbConnStateChanged(const bool is_conn);
 
+    /* 从 UI 读取计算任务的运行参数 */
+    RunOptions getRunOptions() const;
+
     /* 绘图 */
     void initAllCharts();
     bool initChart(QChartView* chartView,
@@ -81,6 +86,11 @@ private:
 
     bool addPointSegTimeAndRepeateRate(const ResultComput& result);
     bool addPointRecoverTime(const ResultComput& result);
+    bool addPointQueueDepth(const ResultComput& result);
+    bool addPointsIngestCurve(const ResultComput& result);
+
+    /* 进度 */
+    void refreshProgress(QProgressBar* progress_bar);
 
 private slots:
     void setActivityWidget(const bool activity);
@@ -139,6 +149,24 @@ private:
     QChart*         _chart_repeat_rate;     // 画布 - 哈希重复率
     QRectF          _orig_rect_chart_repeat_rate; // 画布范围
 
+    QLogValueAxis*  _x_queue_depth;
+    QValueAxis*     _y_queue_depth;
+    QLineSeries*    _spline_seg_qd;         // 平滑曲线 - 不同队列深度的分块速度
+    QScatterSeries* _scatter_seg_qd;        // 数据点 - 不同队列深度的分块速度
+    QLineSeries*    _spline_recover_qd;     // 平滑曲线 - 不同队列深度的恢复速度
+    QScatterSeries* _scatter_recover_qd;    // 数据点 - 不同队列深度的恢复速度
+    QChart*         _chart_queue_depth;     // 画布 - 分块速度 & 恢复速度（队列深度）
+    QRectF          _orig_rect_chart_queue_depth; // 画布范围
+
+    QLogValueAxis*  _x_ingest;
+    QValueAxis*     _y_ingest;
+    QLineSeries*    _spline_ingest_flat;    // 平滑曲线 - 不分区的表的分块吞吐量
+    QScatterSeries* _scatter_ingest_flat;   // 数据点 - 不分区的表的分块吞吐量
+    QLineSeries*    _spline_ingest_part;    // 平滑曲线 - 分区的表的分块吞吐量
+    QScatterSeries* _scatter_ingest_part;   // 数据点 - 分区的表的分块吞吐量
+    QChart*         _chart_ingest;          // 画布 - 分块吞吐量（写入的行数）
+    QRectF          _orig_rect_chart_ingest; // 画布范围
+
     QFont*      _font_tital;                // 字体 - 标题
 };
 #endif // MAINWINDOW_H